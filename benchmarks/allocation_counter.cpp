@@ -0,0 +1,39 @@
+///////////////////////////////////////////////////////////////////////
+// Global heap allocation counter implementation
+///////////////////////////////////////////////////////////////////////
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<uint64_t> allocations { 0 };
+}
+
+namespace benchmarks
+{
+	uint64_t allocation_count()
+	{
+		return allocations.load(std::memory_order_relaxed);
+	}
+}
+
+void* operator new(std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if(void* ptr = std::malloc(size == 0 ? 1 : size))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
@@ -0,0 +1,15 @@
+///////////////////////////////////////////////////////////////////////
+// Global heap allocation counter for benchmarks
+//
+// Replaces the global operator new/delete for the benchmark executable
+// and counts every allocation made by any thread.
+///////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+
+namespace benchmarks
+{
+	// Total number of calls to the global operator new since program start
+	uint64_t allocation_count();
+}
@@ -0,0 +1,25 @@
+///////////////////////////////////////////////////////////////////////
+// Benchmark entry point
+//
+// Results are written as JSON with --benchmark_out=<file>
+// --benchmark_out_format=json (see the run_benchmarks target). The build
+// type is added to the context, as results of unoptimized builds should
+// not be compared.
+///////////////////////////////////////////////////////////////////////
+#include <benchmark/benchmark.h>
+
+#ifndef UTILITYLIB_BUILD_TYPE
+#define UTILITYLIB_BUILD_TYPE ""
+#endif
+
+int main(int argc, char** argv)
+{
+	benchmark::Initialize(&argc, argv);
+	if(benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+
+	benchmark::AddCustomContext("utilitylib_build_type", UTILITYLIB_BUILD_TYPE);
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
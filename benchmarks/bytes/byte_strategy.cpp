@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////
+// Benchmarks of fused versus sequential byte_strategy pipelines
+//
+// A checksum -> encode -> checksum pipeline over buffers larger than
+// the cache, applied once per stage or fused into one pass per block.
+///////////////////////////////////////////////////////////////////////
+#include <benchmark/benchmark.h>
+
+#include <bytes/byte_strategy.h>
+
+namespace
+{
+	struct sum_checksum
+	{
+		struct kernel
+		{
+			uint32_t sum = 0;
+			void process(uint8_t* block, std::size_t size) { for(std::size_t i = 0; i < size; i++) sum += block[i]; }
+			void finish(bytes::buffer& b) { b.append(reinterpret_cast<const uint8_t*>(&sum), sizeof(sum)); }
+		};
+
+		static bytes::buffer& apply(bytes::buffer& b)
+		{
+			kernel k;
+			k.process(b.get(), b.size());
+			k.finish(b);
+			return b;
+		}
+	};
+
+	struct xor_encode
+	{
+		struct kernel
+		{
+			void process(uint8_t* block, std::size_t size) { for(std::size_t i = 0; i < size; i++) block[i] ^= 0x5A; }
+			void finish(bytes::buffer&) {}
+		};
+
+		static bytes::buffer& apply(bytes::buffer& b)
+		{
+			kernel k;
+			k.process(b.get(), b.size());
+			return b;
+		}
+	};
+
+	using pipeline = bytes::byte_strategy<sum_checksum, xor_encode, sum_checksum>;
+
+	void byte_strategy_sequential(benchmark::State& state)
+	{
+		const auto size = static_cast<std::size_t>(state.range(0));
+		bytes::buffer b { size };
+		for(auto _ : state)
+		{
+			b.resize(size);
+			pipeline::apply_sequential(b);
+			benchmark::DoNotOptimize(b.get());
+		}
+		state.SetBytesProcessed(state.iterations() * size);
+	}
+
+	void byte_strategy_fused(benchmark::State& state)
+	{
+		const auto size = static_cast<std::size_t>(state.range(0));
+		bytes::buffer b { size };
+		for(auto _ : state)
+		{
+			b.resize(size);
+			pipeline::apply(b);
+			benchmark::DoNotOptimize(b.get());
+		}
+		state.SetBytesProcessed(state.iterations() * size);
+	}
+}
+
+BENCHMARK(byte_strategy_sequential)->Arg(4 << 10)->Arg(256 << 10)->Arg(16 << 20);
+BENCHMARK(byte_strategy_fused)->Arg(4 << 10)->Arg(256 << 10)->Arg(16 << 20);
@@ -0,0 +1,102 @@
+///////////////////////////////////////////////////////////////////////
+// Benchmarks of the LZ compression for typical message sizes
+//
+// The strategy round trip reports the heap allocations per message,
+// which should be zero once the buffer and scratch space have grown.
+///////////////////////////////////////////////////////////////////////
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <cstring>
+#include <vector>
+
+#include <bytes/compression.h>
+
+#include "../allocation_counter.h"
+
+namespace
+{
+	std::vector<uint8_t> make_message(std::size_t size)
+	{
+		const std::string words[] = { "{\"order\":", "\"price\":", "1024.50,", "\"qty\":", "300,", "\"symbol\":", "\"ABC\",", "\"side\":\"buy\"}" };
+		std::vector<uint8_t> data;
+		uint32_t state = 7;
+		while(data.size() < size)
+		{
+			state = state * 1103515245 + 12345;
+			const auto& w = words[(state >> 16) % 8];
+			data.insert(data.end(), w.begin(), w.end());
+		}
+		data.resize(size);
+		return data;
+	}
+
+	void lz_compress(benchmark::State& state)
+	{
+		const auto input = make_message(static_cast<std::size_t>(state.range(0)));
+		std::vector<uint8_t> output(bytes::lz_compress_bound(input.size()));
+		std::size_t compressed_size = 0;
+
+		for(auto _ : state)
+		{
+			compressed_size = bytes::lz_compress(input.data(), input.size(), output.data(), output.size());
+			benchmark::DoNotOptimize(compressed_size);
+		}
+
+		state.SetBytesProcessed(state.iterations() * input.size());
+		state.counters["ratio"] = static_cast<double>(input.size()) / compressed_size;
+	}
+
+	void lz_decompress(benchmark::State& state)
+	{
+		const auto input = make_message(static_cast<std::size_t>(state.range(0)));
+		std::vector<uint8_t> compressed(bytes::lz_compress_bound(input.size()));
+		compressed.resize(bytes::lz_compress(input.data(), input.size(), compressed.data(), compressed.size()));
+		std::vector<uint8_t> output(input.size());
+
+		for(auto _ : state)
+			benchmark::DoNotOptimize(bytes::lz_decompress(compressed.data(), compressed.size(), output.data(), output.size()));
+
+		state.SetBytesProcessed(state.iterations() * input.size());
+	}
+
+	// Compresses and decompresses in place through the byte strategies, refilling the same buffer
+	void lz_strategy_round_trip(benchmark::State& state, bool compressible)
+	{
+		auto input = make_message(static_cast<std::size_t>(state.range(0)));
+		if(!compressible)
+		{
+			uint32_t noise = 1;
+			for(auto& byte : input)
+			{
+				noise = noise * 1664525 + 1013904223;
+				byte = static_cast<uint8_t>(noise >> 24);
+			}
+		}
+
+		// One round trip grows the buffer and the scratch space
+		bytes::buffer b { std::vector<uint8_t>(input) };
+		bytes::lz_compress_strategy::apply(b);
+		bytes::lz_decompress_strategy::apply(b);
+
+		const auto before = benchmarks::allocation_count();
+		for(auto _ : state)
+		{
+			b.resize(input.size());
+			std::memcpy(b.get(), input.data(), input.size());
+			bytes::lz_compress_strategy::apply(b);
+			bytes::lz_decompress_strategy::apply(b);
+			benchmark::DoNotOptimize(b.get());
+		}
+
+		if(b.size() != input.size())
+			state.SkipWithError("Round trip changed the size");
+		state.counters["allocs_per_msg"] = benchmark::Counter(static_cast<double>(benchmarks::allocation_count() - before) / static_cast<double>(state.iterations()));
+		state.SetBytesProcessed(state.iterations() * input.size());
+	}
+}
+
+BENCHMARK(lz_compress)->Arg(200)->Arg(1 << 10)->Arg(4 << 10)->Arg(64 << 10);
+BENCHMARK(lz_decompress)->Arg(200)->Arg(1 << 10)->Arg(4 << 10)->Arg(64 << 10);
+BENCHMARK_CAPTURE(lz_strategy_round_trip, compressible, true)->Arg(200)->Arg(4 << 10)->Arg(64 << 10);
+BENCHMARK_CAPTURE(lz_strategy_round_trip, incompressible, false)->Arg(200)->Arg(4 << 10)->Arg(64 << 10);
@@ -0,0 +1,29 @@
+///////////////////////////////////////////////////////////////////////
+// Benchmarks of the CRC32C implementations
+///////////////////////////////////////////////////////////////////////
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include <bytes/crc32c.h>
+
+namespace
+{
+	template <uint32_t (*function)(const uint8_t*, std::size_t, uint32_t)>
+	void crc32c_throughput(benchmark::State& state)
+	{
+		if(function == &bytes::crc32c_hardware && !bytes::crc32c_hardware_available())
+		{
+			state.SkipWithError("SSE4.2 not available");
+			return;
+		}
+
+		std::vector<uint8_t> data(static_cast<std::size_t>(state.range(0)), 0xA5);
+		for(auto _ : state)
+			benchmark::DoNotOptimize(function(data.data(), data.size(), 0));
+		state.SetBytesProcessed(state.iterations() * data.size());
+	}
+}
+
+BENCHMARK_TEMPLATE(crc32c_throughput, bytes::crc32c_portable)->Arg(64)->Arg(1 << 10)->Arg(64 << 10);
+BENCHMARK_TEMPLATE(crc32c_throughput, bytes::crc32c_hardware)->Arg(64)->Arg(1 << 10)->Arg(64 << 10);
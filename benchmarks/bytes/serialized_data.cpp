@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////
+// Benchmarks of serialized_data construction
+//
+// Reports the number of heap allocations per message next to the time,
+// comparing against the previous std::vector based storage.
+///////////////////////////////////////////////////////////////////////
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include <bytes/serialize.h>
+
+#include "../allocation_counter.h"
+
+namespace
+{
+	template <std::size_t N>
+	struct message
+	{
+		std::array<bytes::byte, N> payload;
+	};
+}
+
+template <std::size_t N> struct bytes::serialized_size<message<N>> { static constexpr std::size_t value = N; };
+
+template <std::size_t N> struct bytes::serializer<message<N>, N>
+{
+	using buffer_type = std::array<bytes::byte, N>;
+	static buffer_type serialize(const message<N>& m) { return m.payload; }
+};
+
+namespace
+{
+	template <std::size_t N>
+	void report_allocations(benchmark::State& state, uint64_t before)
+	{
+		const auto allocations = benchmarks::allocation_count() - before;
+		state.counters["allocs_per_msg"] = benchmark::Counter(static_cast<double>(allocations) / state.iterations());
+		state.SetBytesProcessed(state.iterations() * N);
+	}
+
+	// Previous implementation: always copies into a std::vector
+	template <std::size_t N>
+	void serialized_data_vector(benchmark::State& state)
+	{
+		message<N> m {};
+		const auto before = benchmarks::allocation_count();
+		for(auto _ : state)
+		{
+			const auto data = bytes::serializer<message<N>>::serialize(m);
+			std::vector<bytes::byte> v(data.begin(), data.end());
+			benchmark::DoNotOptimize(v.data());
+		}
+		report_allocations<N>(state, before);
+	}
+
+	template <std::size_t N>
+	void serialized_data_pooled(benchmark::State& state)
+	{
+		message<N> m {};
+		const auto before = benchmarks::allocation_count();
+		for(auto _ : state)
+		{
+			bytes::serialized_data d { m };
+			benchmark::DoNotOptimize(d.get());
+		}
+		report_allocations<N>(state, before);
+	}
+}
+
+BENCHMARK_TEMPLATE(serialized_data_vector, 16);
+BENCHMARK_TEMPLATE(serialized_data_pooled, 16);
+BENCHMARK_TEMPLATE(serialized_data_vector, 64);
+BENCHMARK_TEMPLATE(serialized_data_pooled, 64);
+BENCHMARK_TEMPLATE(serialized_data_vector, 512);
+BENCHMARK_TEMPLATE(serialized_data_pooled, 512);
+BENCHMARK_TEMPLATE(serialized_data_vector, 4096);
+BENCHMARK_TEMPLATE(serialized_data_pooled, 4096);
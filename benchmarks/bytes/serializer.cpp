@@ -0,0 +1,164 @@
+///////////////////////////////////////////////////////////////////////
+// Benchmarks of serializer<T> encoding and decoding
+//
+// Structs of N bytes made of 64-bit fields, serialized field by field
+// through the arithmetic serializers (as a hand-written serializer
+// specialization would), plus a mixed struct with a fixed-size string.
+///////////////////////////////////////////////////////////////////////
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <string>
+
+#include <bytes/serialize.h>
+
+namespace
+{
+	template <std::size_t N>
+	struct fields
+	{
+		std::array<uint64_t, N / sizeof(uint64_t)> values;
+	};
+
+	struct mixed
+	{
+		int32_t integer;
+		uint32_t large_number;
+		double real_number;
+		std::string message;
+		int64_t counter;
+	};
+
+	constexpr std::size_t mixed_string_length = 32;
+}
+
+template <std::size_t N> struct bytes::serialized_size<fields<N>> { static constexpr std::size_t value = N; };
+
+template <std::size_t N> struct bytes::serializer<fields<N>, N>
+{
+	using value_type = fields<N>;
+	using buffer_type = std::array<bytes::byte, N>;
+
+	static void serialize_at(const value_type& value, bytes::byte* destination)
+	{
+		for(const auto v : value.values)
+		{
+			bytes::serializer<uint64_t>::serialize_at(v, destination);
+			destination += sizeof(uint64_t);
+		}
+	}
+
+	static buffer_type serialize(const value_type& value)
+	{
+		buffer_type buffer;
+		serialize_at(value, buffer.data());
+		return buffer;
+	}
+
+	static value_type deserialize(const buffer_type& buffer)
+	{
+		value_type result;
+		const auto* source = buffer.data();
+		for(auto& v : result.values)
+		{
+			v = bytes::serializer<uint64_t>::deserialize(*reinterpret_cast<const bytes::serializer<uint64_t>::buffer_type*>(source));
+			source += sizeof(uint64_t);
+		}
+		return result;
+	}
+};
+
+template <> struct bytes::serialized_size<mixed> { static constexpr std::size_t value = 4 + 4 + 8 + mixed_string_length + 8; };
+
+template <> auto bytes::serializer<mixed>::serialize_at(const mixed& value, bytes::byte* ptr) -> void
+{
+	bytes::serializer<int32_t>::serialize_at(value.integer, ptr);
+	ptr += sizeof(int32_t);
+	bytes::serializer<uint32_t>::serialize_at(value.large_number, ptr);
+	ptr += sizeof(uint32_t);
+	bytes::serializer<double>::serialize_at(value.real_number, ptr);
+	ptr += sizeof(double);
+	bytes::serializer<std::string, mixed_string_length>::serialize_at(value.message, ptr);
+	ptr += mixed_string_length;
+	bytes::serializer<int64_t>::serialize_at(value.counter, ptr);
+}
+
+template <> auto bytes::serializer<mixed>::serialize(const mixed& value) -> typename bytes::serializer<mixed>::buffer_type
+{
+	buffer_type buffer {};
+	serialize_at(value, buffer.data());
+	return buffer;
+}
+
+template <> auto bytes::serializer<mixed>::deserialize(const bytes::serializer<mixed>::buffer_type& buffer) -> mixed
+{
+	const auto* ptr = buffer.data();
+	mixed result {};
+
+	result.integer = bytes::serializer<int32_t>::deserialize(*reinterpret_cast<const bytes::serializer<int32_t>::buffer_type*>(ptr));
+	ptr += sizeof(int32_t);
+	result.large_number = bytes::serializer<uint32_t>::deserialize(*reinterpret_cast<const bytes::serializer<uint32_t>::buffer_type*>(ptr));
+	ptr += sizeof(uint32_t);
+	result.real_number = bytes::serializer<double>::deserialize(*reinterpret_cast<const bytes::serializer<double>::buffer_type*>(ptr));
+	ptr += sizeof(double);
+
+	using string_serializer = bytes::serializer<std::string, mixed_string_length>;
+	result.message = string_serializer::deserialize(*reinterpret_cast<const string_serializer::buffer_type*>(ptr));
+	ptr += mixed_string_length;
+	result.counter = bytes::serializer<int64_t>::deserialize(*reinterpret_cast<const bytes::serializer<int64_t>::buffer_type*>(ptr));
+
+	return result;
+}
+
+namespace
+{
+	template <typename T>
+	T sample();
+
+	template <>
+	mixed sample<mixed>() { return mixed { 42, 0xDEADBEEF, 1.5, "Hello World!", -1 }; }
+
+	template <typename T>
+	T sample()
+	{
+		T value;
+		for(std::size_t i = 0; i < value.values.size(); i++)
+			value.values[i] = i * 0x9E3779B97F4A7C15ULL;
+		return value;
+	}
+
+	template <typename T>
+	void serializer_encode(benchmark::State& state)
+	{
+		const auto value = sample<T>();
+		for(auto _ : state)
+		{
+			auto buffer = bytes::serializer<T>::serialize(value);
+			benchmark::DoNotOptimize(buffer);
+		}
+		state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes::serialized_size<T>::value));
+	}
+
+	template <typename T>
+	void serializer_decode(benchmark::State& state)
+	{
+		const auto buffer = bytes::serializer<T>::serialize(sample<T>());
+		for(auto _ : state)
+		{
+			auto value = bytes::serializer<T>::deserialize(buffer);
+			benchmark::DoNotOptimize(value);
+		}
+		state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes::serialized_size<T>::value));
+	}
+}
+
+BENCHMARK_TEMPLATE(serializer_encode, fields<16>);
+BENCHMARK_TEMPLATE(serializer_decode, fields<16>);
+BENCHMARK_TEMPLATE(serializer_encode, fields<64>);
+BENCHMARK_TEMPLATE(serializer_decode, fields<64>);
+BENCHMARK_TEMPLATE(serializer_encode, fields<512>);
+BENCHMARK_TEMPLATE(serializer_decode, fields<512>);
+BENCHMARK_TEMPLATE(serializer_encode, fields<4096>);
+BENCHMARK_TEMPLATE(serializer_decode, fields<4096>);
+BENCHMARK_TEMPLATE(serializer_encode, mixed);
+BENCHMARK_TEMPLATE(serializer_decode, mixed);
@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////
+// Benchmarks of per-peer table lookups keyed by endpoints
+///////////////////////////////////////////////////////////////////////
+#include <benchmark/benchmark.h>
+
+#include <vector>
+#include <unordered_map>
+
+#include <containers/flat_hash_map.h>
+#include <networking/endpoint.h>
+
+namespace
+{
+	struct session
+	{
+		uint64_t packets;
+		uint64_t bytes;
+	};
+
+	std::vector<networking::endpoint> make_peers(std::size_t count)
+	{
+		std::vector<networking::endpoint> peers;
+		peers.reserve(count);
+		for(std::size_t i = 0; i < count; i++)
+		{
+			sockaddr_in a {};
+			a.sin_family = AF_INET;
+			a.sin_port = htons(static_cast<uint16_t>(1024 + i % 50000));
+			a.sin_addr.s_addr = htonl(static_cast<uint32_t>(0x0A000000 + i * 7));
+			peers.emplace_back(a);
+		}
+		return peers;
+	}
+
+	template <typename map_type>
+	void peer_table_lookup(benchmark::State& state)
+	{
+		const auto peers = make_peers(static_cast<std::size_t>(state.range(0)));
+		map_type table;
+		for(const auto& p : peers)
+			table[p] = session { 0, 0 };
+
+		std::size_t i = 0;
+		for(auto _ : state)
+		{
+			auto& s = table.find(peers[i])->second;
+			s.packets++;
+			s.bytes += 100;
+			i = (i + 7919) % peers.size();
+		}
+
+		state.SetItemsProcessed(state.iterations());
+	}
+}
+
+BENCHMARK_TEMPLATE(peer_table_lookup, std::unordered_map<networking::endpoint, session>)->Arg(1000)->Arg(1000000);
+BENCHMARK_TEMPLATE(peer_table_lookup, utility::flat_hash_map<networking::endpoint, session>)->Arg(1000)->Arg(1000000);
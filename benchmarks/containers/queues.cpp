@@ -0,0 +1,198 @@
+///////////////////////////////////////////////////////////////////////
+// Benchmarks of the single-producer single-consumer queues
+//
+// Throughput with a producer thread filling the queue while the benchmark
+// thread reads, and the round trip of one element through a pair of
+// queues with an echo thread. Both threads are pinned to different CPUs
+// (on Linux), so the numbers measure the cache-line transfers between two
+// cores rather than the scheduler.
+//
+// Note: The producers wait for free space themselves, as neither queue
+//       reports being full.
+///////////////////////////////////////////////////////////////////////
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <containers/circular_buffer.h>
+#include <containers/safe_queue.h>
+
+namespace
+{
+	constexpr std::size_t queue_capacity = 1024;
+
+	using circular_queue = utility::circular_buffer<uint64_t, queue_capacity>;
+	using growing_queue = utility::safe_queue<uint64_t>;
+
+	// Queues of queue_capacity elements
+	template <typename queue_type> struct make_queue { static queue_type* create() { return new queue_type(); } };
+	template <> struct make_queue<growing_queue> { static growing_queue* create() { return new growing_queue(queue_capacity); } };
+
+	// The first two CPUs the process may run on, or none where affinity is not available
+	std::vector<unsigned> usable_cpus()
+	{
+		std::vector<unsigned> result;
+#ifdef __linux__
+		cpu_set_t set;
+		if(::sched_getaffinity(0, sizeof(set), &set) != 0)
+			return result;
+
+		for(unsigned cpu = 0; cpu < CPU_SETSIZE && result.size() < 2; cpu++)
+		{
+			if(CPU_ISSET(cpu, &set))
+				result.push_back(cpu);
+		}
+#endif
+		return result;
+	}
+
+	void pin_thread(unsigned cpu)
+	{
+#ifdef __linux__
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set);
+#else
+		(void)cpu;
+#endif
+	}
+
+	// Pins the benchmark thread to the first CPU and restores its affinity when it goes out of scope
+	// Spinning threads sharing a CPU only measure the scheduler, so runs with a single CPU are skipped.
+	class pinned_scope
+	{
+		public:
+			explicit pinned_scope(benchmark::State& state) : _cpus(usable_cpus())
+			{
+#ifdef __linux__
+				if(_cpus.size() == 1)
+				{
+					state.SkipWithError("Needs two CPUs");
+					return;
+				}
+
+				if(_cpus.size() == 2)
+				{
+					::pthread_getaffinity_np(::pthread_self(), sizeof(_previous), &_previous);
+					pin_thread(_cpus[0]);
+				}
+#else
+				(void)state;
+#endif
+			}
+
+			~pinned_scope()
+			{
+#ifdef __linux__
+				if(_cpus.size() == 2)
+					::pthread_setaffinity_np(::pthread_self(), sizeof(_previous), &_previous);
+#endif
+			}
+
+			bool skipped() const { return _cpus.size() == 1; }
+
+			// Pins the calling (partner) thread to the second CPU
+			void pin_partner() const
+			{
+				if(_cpus.size() == 2)
+					pin_thread(_cpus[1]);
+			}
+
+		private:
+			std::vector<unsigned> _cpus;
+#ifdef __linux__
+			cpu_set_t _previous;
+#endif
+	};
+
+	template <typename queue_type>
+	void push_when_free(queue_type& queue, uint64_t value, const std::atomic<bool>& running)
+	{
+		while(queue.size() >= queue_capacity - 1)
+		{
+			if(!running.load(std::memory_order_relaxed))
+				return;
+		}
+		queue.push(value);
+	}
+
+	template <typename queue_type>
+	void queue_spsc_throughput(benchmark::State& state)
+	{
+		std::unique_ptr<queue_type> queue { make_queue<queue_type>::create() };
+		std::atomic<bool> running { true };
+		pinned_scope pinned { state };
+		if(pinned.skipped())
+			return;
+
+		std::thread producer { [&]()
+		{
+			pinned.pin_partner();
+			for(uint64_t i = 0; running.load(std::memory_order_relaxed); i++)
+				push_when_free(*queue, i, running);
+		} };
+
+		uint64_t value = 0;
+		for(auto _ : state)
+		{
+			while(!queue->read(value))
+			{
+			}
+			benchmark::DoNotOptimize(value);
+		}
+
+		running = false;
+		producer.join();
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	template <typename queue_type>
+	void queue_ping_pong(benchmark::State& state)
+	{
+		std::unique_ptr<queue_type> requests { make_queue<queue_type>::create() };
+		std::unique_ptr<queue_type> responses { make_queue<queue_type>::create() };
+		std::atomic<bool> running { true };
+		pinned_scope pinned { state };
+		if(pinned.skipped())
+			return;
+
+		std::thread echo { [&]()
+		{
+			pinned.pin_partner();
+			uint64_t value = 0;
+			while(running.load(std::memory_order_relaxed))
+			{
+				if(requests->read(value))
+					responses->push(value);
+			}
+		} };
+
+		uint64_t value = 0;
+		for(auto _ : state)
+		{
+			requests->push(value);
+			while(!responses->read(value))
+			{
+			}
+			value++;
+		}
+
+		running = false;
+		echo.join();
+	}
+}
+
+BENCHMARK_TEMPLATE(queue_spsc_throughput, circular_queue)->UseRealTime();
+BENCHMARK_TEMPLATE(queue_spsc_throughput, growing_queue)->UseRealTime();
+BENCHMARK_TEMPLATE(queue_ping_pong, circular_queue)->UseRealTime();
+BENCHMARK_TEMPLATE(queue_ping_pong, growing_queue)->UseRealTime();
@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////
+// Benchmarks of the process-shared ring buffer
+//
+// The ping-pong round trip (with a thread sleeping in wait() on the other
+// end) compares to the Unix and loopback socket benchmarks.
+///////////////////////////////////////////////////////////////////////
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <containers/shared_ring.h>
+
+namespace
+{
+	void shared_ring_push_read(benchmark::State& state)
+	{
+		const auto size = static_cast<std::size_t>(state.range(0));
+		auto consumer = utility::shared_ring::create("", 1 << 20, utility::shared_ring_role::consumer);
+		auto producer = utility::shared_ring::attach(consumer.fd(), utility::shared_ring_role::producer);
+		std::vector<uint8_t> message(size, 0x5a);
+
+		for(auto _ : state)
+		{
+			producer.push(message.data(), size);
+			std::size_t received = 0;
+			benchmark::DoNotOptimize(consumer.peek(received));
+			consumer.pop();
+		}
+
+		state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size));
+	}
+
+	void shared_ring_ping_pong(benchmark::State& state)
+	{
+		const auto size = static_cast<std::size_t>(state.range(0));
+		auto requests = utility::shared_ring::create("", 1 << 16, utility::shared_ring_role::producer);
+		auto responses = utility::shared_ring::create("", 1 << 16, utility::shared_ring_role::consumer);
+		std::atomic<bool> running { true };
+
+		std::thread echo { [&]()
+		{
+			auto in = utility::shared_ring::attach(requests.fd(), utility::shared_ring_role::consumer);
+			auto out = utility::shared_ring::attach(responses.fd(), utility::shared_ring_role::producer);
+			while(running.load(std::memory_order_relaxed))
+			{
+				if(!in.wait(std::chrono::milliseconds { 10 }))
+					continue;
+
+				std::size_t received = 0;
+				const auto* data = in.peek(received);
+				out.push(data, received);
+				in.pop();
+			}
+		} };
+
+		while(!requests.consumer_attached() || responses.producers() == 0)
+			std::this_thread::yield();
+
+		std::vector<uint8_t> message(size, 0x5a);
+		for(auto _ : state)
+		{
+			requests.push(message.data(), size);
+			responses.wait(std::chrono::seconds { 1 });
+			responses.pop();
+		}
+
+		running = false;
+		echo.join();
+		state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size * 2));
+	}
+}
+
+BENCHMARK(shared_ring_push_read)->Arg(64)->Arg(1024)->Arg(16384);
+BENCHMARK(shared_ring_ping_pong)->Arg(64)->Arg(1024)->Arg(16384)->UseRealTime();
@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////
+// Benchmarks of the hot-path cost of metrics
+///////////////////////////////////////////////////////////////////////
+#include <benchmark/benchmark.h>
+
+#include <metrics/counter.h>
+#include <metrics/histogram.h>
+#include <metrics/probes.h>
+#include <metrics/trace.h>
+
+namespace
+{
+	metrics::counter shared_counter;
+	metrics::histogram shared_histogram;
+
+	void metrics_counter_add(benchmark::State& state)
+	{
+		for(auto _ : state)
+			shared_counter.add();
+	}
+
+	void metrics_histogram_record(benchmark::State& state)
+	{
+		uint64_t value = 1;
+		for(auto _ : state)
+		{
+			shared_histogram.record(value);
+			value = (value * 7) & 0xfffff;
+		}
+	}
+
+	// The cost of a probe point while probes are disabled
+	void metrics_disabled_probe(benchmark::State& state)
+	{
+		for(auto _ : state)
+			benchmark::DoNotOptimize(metrics::connection_probes_enabled());
+	}
+}
+
+BENCHMARK(metrics_counter_add)->ThreadRange(1, 8);
+BENCHMARK(metrics_histogram_record)->ThreadRange(1, 8);
+BENCHMARK(metrics_disabled_probe);
+
+namespace
+{
+	void metrics_trace_event(benchmark::State& state)
+	{
+		metrics::enable_tracing();
+		for(auto _ : state)
+			metrics::trace(metrics::trace_event::user, metrics::trace_phase::instant, 1);
+		metrics::disable_tracing();
+		metrics::clear_trace();
+	}
+
+	void metrics_trace_disabled(benchmark::State& state)
+	{
+		for(auto _ : state)
+			metrics::trace(metrics::trace_event::user, metrics::trace_phase::instant, 1);
+	}
+}
+
+BENCHMARK(metrics_trace_event);
+BENCHMARK(metrics_trace_disabled);
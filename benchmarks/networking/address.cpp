@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////
+// Benchmarks of address creation and formatting
+//
+// Compares the numeric fast paths against getaddrinfo/getnameinfo,
+// which were used for every address before.
+///////////////////////////////////////////////////////////////////////
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include <networking/address.h>
+#include <networking/numeric_address.h>
+
+namespace
+{
+	const std::string hosts[] = { "192.168.100.200", "2001:db8::ff00:42:8329" };
+
+	void address_create_getaddrinfo(benchmark::State& state)
+	{
+		const auto& host = hosts[state.range(0)];
+		struct addrinfo hints {};
+		hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+		hints.ai_socktype = SOCK_DGRAM;
+
+		for(auto _ : state)
+		{
+			struct addrinfo* result = nullptr;
+			benchmark::DoNotOptimize(getaddrinfo(host.c_str(), "4242", &hints, &result));
+			freeaddrinfo(result);
+		}
+	}
+
+	void address_create_numeric(benchmark::State& state)
+	{
+		const auto& host = hosts[state.range(0)];
+		for(auto _ : state)
+			benchmark::DoNotOptimize(networking::create_address(host, 4242, networking::protocol::udp));
+	}
+
+	void address_format_getnameinfo(benchmark::State& state)
+	{
+		const auto a = networking::create_address(hosts[state.range(0)], 4242, networking::protocol::udp);
+		char host[NI_MAXHOST];
+		char service[NI_MAXSERV];
+
+		for(auto _ : state)
+			benchmark::DoNotOptimize(getnameinfo(&a.get(), a.length(), host, sizeof(host), service, sizeof(service), NI_NUMERICHOST | NI_NUMERICSERV));
+	}
+
+	void address_format_numeric(benchmark::State& state)
+	{
+		const auto a = networking::create_address(hosts[state.range(0)], 4242, networking::protocol::udp);
+		char buffer[networking::max_address_string_length];
+
+		for(auto _ : state)
+			benchmark::DoNotOptimize(a.format(buffer, sizeof(buffer)));
+	}
+
+	void address_port_number(benchmark::State& state)
+	{
+		const auto a = networking::create_address(hosts[state.range(0)], 4242, networking::protocol::udp);
+		for(auto _ : state)
+			benchmark::DoNotOptimize(a.port_number());
+	}
+}
+
+BENCHMARK(address_create_getaddrinfo)->Arg(0)->Arg(1);
+BENCHMARK(address_create_numeric)->Arg(0)->Arg(1);
+BENCHMARK(address_format_getnameinfo)->Arg(0)->Arg(1);
+BENCHMARK(address_format_numeric)->Arg(0)->Arg(1);
+BENCHMARK(address_port_number)->Arg(0)->Arg(1);
@@ -0,0 +1,160 @@
+///////////////////////////////////////////////////////////////////////
+// Benchmarks of Unix domain sockets against loopback TCP and UDP
+//
+// Ping-pong round trips with an echo thread on the other end, so the
+// time per iteration is the round-trip latency; the byte rate is the
+// throughput for the message size.
+///////////////////////////////////////////////////////////////////////
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <networking/address.h>
+#include <networking/tcp/listener.h>
+#include <networking/tcp/connection.h>
+#include <networking/udp/socket.h>
+
+namespace
+{
+	class keep_connection : public networking::tcp::incoming_connection_callback
+	{
+		public:
+			void on_new_connection(networking::tcp::connection&& c) override { connections.push_back(std::move(c)); }
+			std::vector<networking::tcp::connection> connections;
+	};
+
+	// Receives exactly size bytes
+	bool receive_all(networking::tcp::connection& c, uint8_t* data, std::size_t size)
+	{
+		std::size_t received = 0;
+		while(received < size)
+		{
+			auto result = c.receive(data + received, size - received);
+			if(result <= 0)
+				return false;
+			received += static_cast<std::size_t>(result);
+		}
+		return true;
+	}
+
+	void stream_ping_pong(benchmark::State& state, const networking::address& local)
+	{
+		const auto size = static_cast<std::size_t>(state.range(0));
+		keep_connection accepted;
+		networking::tcp::listener l { accepted, local };
+		if(!l.start())
+		{
+			state.SkipWithError("Could not start the listener");
+			return;
+		}
+
+		// With the port chosen for loopback TCP (bound to port 0)
+		const auto target = l.bound_address();
+
+		networking::socket_options options;
+		options.no_delay = (local.family() != AF_UNIX) ? std::optional<bool> { true } : std::nullopt;
+		networking::tcp::connection client { target, false, options };
+		if(client.state() != networking::tcp::connection::status::open || !l.accept())
+		{
+			state.SkipWithError("Could not connect");
+			return;
+		}
+		auto& server = accepted.connections.front();
+		if(local.family() != AF_UNIX)
+			server.set_options(options);
+
+		std::thread echo { [&server, size]()
+		{
+			std::vector<uint8_t> buffer(size);
+			while(receive_all(server, buffer.data(), size))
+				server.send(buffer.data(), size);
+		} };
+
+		std::vector<uint8_t> message(size, 0x5a);
+		for(auto _ : state)
+		{
+			client.send(message.data(), size);
+			benchmark::DoNotOptimize(receive_all(client, message.data(), size));
+		}
+
+		client.close();
+		echo.join();
+		state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size * 2));
+	}
+
+	void datagram_ping_pong(benchmark::State& state, const networking::address& server_address, const networking::address& client_address)
+	{
+		const auto size = static_cast<std::size_t>(state.range(0));
+		networking::udp::socket server { server_address.ip_version_value() };
+		networking::udp::socket client { client_address.ip_version_value() };
+		if(!server.bind(server_address) || !client.bind(client_address))
+		{
+			state.SkipWithError("Could not bind");
+			return;
+		}
+
+		const auto server_target = server.bound_to();	// The real port for loopback UDP
+
+		std::thread echo { [&server, size]()
+		{
+			std::vector<uint8_t> buffer(size + 1);
+			networking::address sender;
+			for(;;)
+			{
+				auto received = server.receive_from(buffer.data(), buffer.size(), sender);
+				if(received <= 0)
+					return;
+				server.send_to(buffer.data(), static_cast<std::size_t>(received), sender);
+			}
+		} };
+
+		std::vector<uint8_t> message(size, 0x5a);
+		networking::address sender;
+		for(auto _ : state)
+		{
+			client.send_to(message.data(), size, server_target);
+			benchmark::DoNotOptimize(client.receive_from(message.data(), size, sender));
+		}
+
+		// A zero-length datagram stops the echo thread
+		client.send_to(message.data(), 0, server_target);
+		echo.join();
+		state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size * 2));
+	}
+
+	std::string local_name(const char* name)
+	{
+		return std::string { "@utilitylib_benchmark_" } + name + "_" + std::to_string(::getpid());
+	}
+
+	void unix_stream(benchmark::State& state)
+	{
+		stream_ping_pong(state, networking::create_local_address(local_name("stream")));
+	}
+
+	void tcp_loopback(benchmark::State& state)
+	{
+		stream_ping_pong(state, networking::create_numeric_address("127.0.0.1", 0, networking::ip_version::ipv4));
+	}
+
+	void unix_datagram(benchmark::State& state)
+	{
+		datagram_ping_pong(state, networking::create_local_address(local_name("dgram_server")), networking::create_local_address(local_name("dgram_client")));
+	}
+
+	void udp_loopback(benchmark::State& state)
+	{
+		const auto any_port = networking::create_numeric_address("127.0.0.1", 0, networking::ip_version::ipv4);
+		datagram_ping_pong(state, any_port, any_port);
+	}
+}
+
+BENCHMARK(unix_stream)->Arg(64)->Arg(1024)->Arg(16384)->UseRealTime();
+BENCHMARK(tcp_loopback)->Arg(64)->Arg(1024)->Arg(16384)->UseRealTime();
+BENCHMARK(unix_datagram)->Arg(64)->Arg(1024)->Arg(16384)->UseRealTime();
+BENCHMARK(udp_loopback)->Arg(64)->Arg(1024)->Arg(16384)->UseRealTime();
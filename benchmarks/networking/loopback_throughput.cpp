@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////
+// Benchmarks of loopback TCP and UDP throughput
+//
+// One-way streams from the benchmark thread to a receiving thread, per
+// send size. The round-trip latencies are in local_sockets.cpp.
+//
+// UDP does not apply backpressure, so datagrams the receiver cannot keep
+// up with are dropped by the kernel: the "delivered" counter reports the
+// fraction that arrived.
+///////////////////////////////////////////////////////////////////////
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <vector>
+
+#include <networking/address.h>
+#include <networking/tcp/listener.h>
+#include <networking/tcp/connection.h>
+#include <networking/udp/socket.h>
+
+namespace
+{
+	class keep_connection : public networking::tcp::incoming_connection_callback
+	{
+		public:
+			void on_new_connection(networking::tcp::connection&& c) override { connections.push_back(std::move(c)); }
+			std::vector<networking::tcp::connection> connections;
+	};
+
+	void tcp_loopback_throughput(benchmark::State& state)
+	{
+		const auto size = static_cast<std::size_t>(state.range(0));
+		keep_connection accepted;
+		networking::tcp::listener l { accepted, networking::create_numeric_address("127.0.0.1", 0, networking::ip_version::ipv4) };
+		if(!l.start())
+		{
+			state.SkipWithError("Could not start the listener");
+			return;
+		}
+
+		networking::tcp::connection client { networking::create_numeric_address("127.0.0.1", l.bound_address().port_number(), networking::ip_version::ipv4) };
+		if(client.state() != networking::tcp::connection::status::open || !l.accept())
+		{
+			state.SkipWithError("Could not connect");
+			return;
+		}
+
+		auto& server = accepted.connections.front();
+		std::thread receiver { [&server]()
+		{
+			std::vector<uint8_t> buffer(1 << 18);
+			while(server.receive(buffer.data(), buffer.size()) > 0)
+			{
+			}
+		} };
+
+		// Blocking sends, so the rate is what the receiver keeps up with
+		std::vector<uint8_t> message(size, 0x5a);
+		std::size_t sent = 0;
+		for(auto _ : state)
+		{
+			std::size_t offset = 0;
+			while(offset < size)
+			{
+				const auto result = client.send(message.data() + offset, size - offset);
+				if(result <= 0)
+				{
+					state.SkipWithError("Send failed");
+					break;
+				}
+				offset += static_cast<std::size_t>(result);
+			}
+			sent += offset;
+		}
+
+		client.shutdown();
+		receiver.join();
+		state.SetBytesProcessed(static_cast<int64_t>(sent));
+	}
+
+	void udp_loopback_throughput(benchmark::State& state)
+	{
+		const auto size = static_cast<std::size_t>(state.range(0));
+		const auto any_port = networking::create_numeric_address("127.0.0.1", 0, networking::ip_version::ipv4);
+		networking::udp::socket server { networking::ip_version::ipv4 };
+		networking::udp::socket client { networking::ip_version::ipv4 };
+		if(!server.bind(any_port) || !client.bind(any_port))
+		{
+			state.SkipWithError("Could not bind");
+			return;
+		}
+
+		const auto server_target = server.bound_to();
+		std::atomic<uint64_t> received { 0 };
+		std::atomic<bool> stopped { false };
+
+		// A zero-length datagram stops the receiver
+		std::thread receiver { [&server, &received, &stopped, size]()
+		{
+			std::vector<uint8_t> buffer(size + 1);
+			networking::address sender;
+			while(server.receive_from(buffer.data(), buffer.size(), sender) > 0)
+				received.fetch_add(1, std::memory_order_relaxed);
+			stopped = true;
+		} };
+
+		std::vector<uint8_t> message(size, 0x5a);
+		for(auto _ : state)
+			benchmark::DoNotOptimize(client.send_to(message.data(), size, server_target));
+
+		// The stop datagram is dropped as well while the receive buffer is full
+		while(!stopped.load())
+		{
+			client.send_to(message.data(), 0, server_target);
+			std::this_thread::sleep_for(std::chrono::milliseconds { 1 });
+		}
+		receiver.join();
+
+		state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * size));
+		state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+		state.counters["delivered"] = static_cast<double>(received.load()) / static_cast<double>(std::max<int64_t>(state.iterations(), 1));
+	}
+}
+
+BENCHMARK(tcp_loopback_throughput)->Arg(64)->Arg(1024)->Arg(16384)->Arg(65536)->UseRealTime();
+BENCHMARK(udp_loopback_throughput)->Arg(64)->Arg(1024)->Arg(8192)->UseRealTime();
@@ -13,6 +13,8 @@ namespace bytes
 		public:
 			// Constructors / destructor
 			buffer();
+			explicit buffer(std::size_t size);
+			explicit buffer(std::vector<uint8_t>&&);
 			~buffer();
 
 			// Copy construction/assignment
@@ -24,11 +26,15 @@ namespace bytes
 			buffer& operator=(buffer&&);
 
 			// Public interface
-			uint8_t* get() { return &_buffer[0]; }
-			const uint8_t* get() const { return &_buffer[0]; }
+			uint8_t* get() { return _buffer.data(); }
+			const uint8_t* get() const { return _buffer.data(); }
 			std::size_t size() const { return _buffer.size(); }
+			bool empty() const { return _buffer.empty(); }
 
 			void reserve(std::size_t);
+			void resize(std::size_t);
+			void append(const uint8_t* data, std::size_t size);
+			std::vector<uint8_t> release();	// Hands over the storage, leaving the buffer empty
 
 		private:
 			std::vector<uint8_t> _buffer;
@@ -1,32 +1,147 @@
 /////////////////////////////////////////////////////////////////////////
 // Helper for combining an ordered list of byte manipulations
+//
+// A strategy provides "static buffer& apply(buffer&)". It may in addition
+// provide a default-constructible nested "kernel" type with the members
+//
+//     void process(uint8_t* block, std::size_t size);	// In-place, called for consecutive blocks
+//     void finish(buffer&);							// Called once after the last block
+//
+// Consecutive strategies with a kernel are fused at compile time into a
+// single pass over cache-sized blocks, where every block is passed through
+// all kernels before moving on to the next block. Strategies without a
+// kernel are applied to the whole buffer as before.
+//
+// Note: finish may only append to the buffer. Appended bytes are passed
+//       through the process function of all later kernels in the run before
+//       their finish is called, so fused and sequential results are equal.
 /////////////////////////////////////////////////////////////////////////
 #pragma once
 
+#include <tuple>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+
+#include <bytes/buffer.h>
+
 namespace bytes
 {
-	template <typename... strategies>
-	struct byte_strategy
+	// Block size used for fused pipelines (fits comfortably in L1 cache)
+	constexpr std::size_t default_strategy_block_size = 16 * 1024;
+
+	// Detects whether a strategy provides a block-wise kernel
+	template <typename T, typename = void> struct has_kernel : std::false_type {};
+	template <typename T> struct has_kernel<T, std::void_t<typename T::kernel>> : std::true_type {};
+	template <typename T> constexpr bool has_kernel_v = has_kernel<T>::value;
+
+	template <std::size_t block_size, typename... strategies>
+	struct basic_byte_strategy
 	{
-			using buffer_type = class buffer;
+			using buffer_type = buffer;
+
+			// Apply the strategies, fusing consecutive kernels into single passes
+			static buffer_type& apply(buffer_type& buffer)
+			{
+				return pipeline<type_list<>, strategies...>::apply(buffer);
+			}
 
-			static constexpr void apply(buffer_type& buffer)
+			// Apply the strategies one after another, each touching the whole buffer
+			static buffer_type& apply_sequential(buffer_type& buffer)
 			{
-				apply<strategies...>(buffer);
+				return apply_sequential<strategies...>(buffer);
 			}
 
 		// Implementation details
 		private:
+			template <typename... Ts> struct type_list {};
+
 			template <typename U>
-			static constexpr void apply(buffer_type& buffer)
+			static buffer_type& apply_sequential(buffer_type& buffer)
 			{
-				U::apply(buffer);
+				return U::apply(buffer);
 			}
 
-			template <typename U, typename... remaining>
-			static constexpr void apply(buffer_type& buffer)
+			template <typename U, typename V, typename... remaining>
+			static buffer_type& apply_sequential(buffer_type& buffer)
 			{
-				apply<remaining...>(U::apply(buffer));
+				return apply_sequential<V, remaining...>(U::apply(buffer));
+			}
+
+			// Collects a run of kernel strategies until a strategy without a kernel (or the end) is reached
+			template <typename fused, typename... remaining> struct pipeline;
+
+			template <typename... fused>
+			struct pipeline<type_list<fused...>>
+			{
+				static buffer_type& apply(buffer_type& buffer)
+				{
+					return run<fused...>(buffer);
+				}
+			};
+
+			template <typename... fused, typename U, typename... remaining>
+			struct pipeline<type_list<fused...>, U, remaining...>
+			{
+				static buffer_type& apply(buffer_type& buffer)
+				{
+					if constexpr (has_kernel_v<U>)
+						return pipeline<type_list<fused..., U>, remaining...>::apply(buffer);
+					else
+						return pipeline<type_list<>, remaining...>::apply(U::apply(run<fused...>(buffer)));
+				}
+			};
+
+			// Executes a run of kernel strategies
+			template <typename... fused>
+			static buffer_type& run(buffer_type& buffer)
+			{
+				if constexpr (sizeof...(fused) == 0)
+					return buffer;
+				else if constexpr (sizeof...(fused) == 1)
+					return apply_sequential<fused...>(buffer);
+				else
+				{
+					std::tuple<typename fused::kernel...> kernels {};
+
+					const auto size = buffer.size();
+					for(std::size_t offset = 0; offset < size; offset += block_size)
+						process<0>(kernels, buffer.get() + offset, std::min(block_size, size - offset));
+
+					finish<0>(kernels, buffer);
+					return buffer;
+				}
+			}
+
+			// Passes a block through the kernels from index I onwards
+			template <std::size_t I, typename tuple_type>
+			static void process(tuple_type& kernels, uint8_t* block, std::size_t size)
+			{
+				if constexpr (I < std::tuple_size_v<tuple_type>)
+				{
+					std::get<I>(kernels).process(block, size);
+					process<I + 1>(kernels, block, size);
+				}
+			}
+
+			// Finishes the kernels in order, feeding appended data through the remaining kernels
+			template <std::size_t I, typename tuple_type>
+			static void finish(tuple_type& kernels, buffer_type& buffer)
+			{
+				if constexpr (I < std::tuple_size_v<tuple_type>)
+				{
+					const auto previous_size = buffer.size();
+					std::get<I>(kernels).finish(buffer);
+
+					const auto size = buffer.size();
+					for(std::size_t offset = previous_size; offset < size; offset += block_size)
+						process<I + 1>(kernels, buffer.get() + offset, std::min(block_size, size - offset));
+
+					finish<I + 1>(kernels, buffer);
+				}
 			}
 	};
+
+	template <typename... strategies>
+	using byte_strategy = basic_byte_strategy<default_strategy_block_size, strategies...>;
 }
@@ -0,0 +1,114 @@
+/////////////////////////////////////////////////////////////////////////
+// Byte chain definition
+//
+// A rope of reference-counted slabs. Appending, prepending, slicing and
+// splitting only manipulate the list of segments, the payload bytes are
+// never copied. Slabs are shared between chains and are immutable once
+// they have been added to a chain.
+//
+// Every segment records its position in the chain, as a running offset,
+// so operations taking an offset find their segment by binary search:
+// slicing and splitting are O(log segments), plus the segments covered.
+// A segment list cannot locate an arbitrary offset in constant time, so
+// this is traded against appending: the positions of an appended or
+// prepended chain are rebased, which is O(segments of the argument), but
+// never touches the payload. Chains hold few segments (headers, frames),
+// so both stay small in practice.
+//
+// Note: Appending/prepending onto an empty chain is O(1).
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#ifdef USE_POSIX
+#include <sys/uio.h>
+#endif
+
+namespace bytes
+{
+	class buffer;
+
+	class chain
+	{
+		public:
+			// Reference-counted storage shared between chains
+			using slab = std::shared_ptr<const std::vector<uint8_t>>;
+
+			// A view into part of a slab
+			struct segment
+			{
+				slab storage;
+				std::size_t offset;
+				std::size_t length;
+				std::size_t position;	// Of the first byte, in running offsets (the chain's first byte is at _origin)
+
+				const uint8_t* data() const { return storage->data() + offset; }
+			};
+
+			using segment_list = std::deque<segment>;
+			using const_iterator = segment_list::const_iterator;
+
+		public:
+			// Constructors / destructor
+			chain();
+			chain(const uint8_t* data, std::size_t size);	// Copies the data into a new slab
+			explicit chain(std::vector<uint8_t>&&);			// Adopts the vector as a slab
+			explicit chain(buffer&&);						// Adopts the buffer storage as a slab
+			explicit chain(slab, std::size_t offset, std::size_t length);
+			~chain();
+
+			// Copy construction/assignment (shares the slabs)
+			chain(const chain&);
+			chain& operator=(const chain&);
+
+			// Move construction/assignment
+			chain(chain&&);
+			chain& operator=(chain&&);
+
+			// Public interface
+			std::size_t size() const { return _size; }
+			bool empty() const { return _size == 0; }
+			std::size_t number_of_segments() const { return _segments.size(); }
+			const_iterator begin() const { return _segments.cbegin(); }
+			const_iterator end() const { return _segments.cend(); }
+
+			void append(chain&&);			// O(segments of the argument), leaves the argument empty
+			void append(const chain&);		// Shares the slabs of the argument
+			void prepend(chain&&);			// O(segments of the argument), leaves the argument empty
+			void prepend(const chain&);		// Shares the slabs of the argument
+
+			void trim_front(std::size_t n);	// Drops the first n bytes
+			void trim_back(std::size_t n);	// Drops the last n bytes
+			chain split(std::size_t offset);	// Returns the first offset bytes and keeps the remainder
+			chain slice(std::size_t offset, std::size_t length) const;
+			chain prefix(std::size_t length) const { return slice(0, length); }
+			chain suffix(std::size_t length) const { return slice(length < _size ? _size - length : 0, length); }
+
+			void clear();
+
+			// Copies the content to contiguous memory
+			std::size_t copy_to(uint8_t* destination, std::size_t destination_size) const;
+			std::vector<uint8_t> flatten() const;
+
+#ifdef USE_POSIX
+			// Fills an iovec array for scatter-gather I/O and returns the number of entries written
+			std::size_t to_iovec(struct iovec* destination, std::size_t max_entries) const;
+			std::vector<struct iovec> to_iovec() const;
+#endif
+
+		private:
+			// Index of the segment containing the byte at offset (offset < size())
+			std::size_t find_segment(std::size_t offset) const;
+			void push_back(segment);
+			void push_front(segment);
+
+		private:
+			segment_list _segments;
+			std::size_t _size;
+			std::size_t _origin;	// Position of the first byte (wraps around, only differences are used)
+	};
+}
@@ -0,0 +1,45 @@
+/////////////////////////////////////////////////////////////////////////
+// Fast LZ77-family compression and matching byte strategies
+//
+// The compressed stream uses the LZ4 block layout (token, literals,
+// 16-bit offset, match length), with a hash table sized to the input so
+// that small messages (a few hundred bytes) stay cheap to compress.
+//
+// Note: Streams are self-contained; matches never reference data from
+//       earlier buffers.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <bytes/buffer.h>
+
+namespace bytes
+{
+	// Worst-case compressed size for an input of "size" bytes
+	constexpr std::size_t lz_compress_bound(std::size_t size) { return size + size / 255 + 16; }
+
+	// Compresses into destination and returns the compressed size, or 0 if destination is too small
+	std::size_t lz_compress(const uint8_t* source, std::size_t size, uint8_t* destination, std::size_t capacity);
+
+	// Decompresses exactly original_size bytes into destination, returns false for malformed input
+	bool lz_decompress(const uint8_t* source, std::size_t size, uint8_t* destination, std::size_t original_size);
+
+	// Number of bytes prepended to the payload by lz_compress_strategy
+	constexpr std::size_t lz_header_size = 5;
+
+	// Replaces the buffer with [format][original size][payload], storing the
+	// data uncompressed if compression does not make it smaller
+	struct lz_compress_strategy
+	{
+		static buffer& apply(buffer& b);
+	};
+
+	// Reverses lz_compress_strategy
+	// Note: A malformed buffer is cleared.
+	struct lz_decompress_strategy
+	{
+		static buffer& apply(buffer& b);
+	};
+}
@@ -0,0 +1,54 @@
+/////////////////////////////////////////////////////////////////////////
+// CRC32C (Castagnoli) checksums and matching byte strategies
+//
+// Uses the SSE4.2 crc32 instruction when the CPU supports it (selected at
+// runtime), interleaving three independent streams for large buffers.
+// Otherwise a slicing-by-8 table implementation is used.
+//
+// The checksum is chainable: crc32c(b, n, crc32c(a, m)) equals the
+// checksum of a followed by b.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <bytes/buffer.h>
+
+namespace bytes
+{
+	// Computes the checksum using the fastest available implementation
+	uint32_t crc32c(const uint8_t* data, std::size_t size, uint32_t crc = 0);
+
+	// Individual implementations (the hardware version requires crc32c_hardware_available())
+	uint32_t crc32c_portable(const uint8_t* data, std::size_t size, uint32_t crc = 0);
+	uint32_t crc32c_hardware(const uint8_t* data, std::size_t size, uint32_t crc = 0);
+	bool crc32c_hardware_available();
+
+	// Number of bytes appended to a buffer by crc32c_append
+	constexpr std::size_t crc32c_size = 4;
+
+	// Appends the checksum of the buffer (little-endian)
+	struct crc32c_append
+	{
+		struct kernel
+		{
+			uint32_t crc = 0;
+
+			void process(uint8_t* block, std::size_t size) { crc = crc32c(block, size, crc); }
+			void finish(buffer& b);
+		};
+
+		static buffer& apply(buffer& b);
+	};
+
+	// Checks and removes the checksum appended by crc32c_append
+	// Note: A buffer failing the check (or being too short) is cleared.
+	struct crc32c_verify
+	{
+		static buffer& apply(buffer& b);
+	};
+
+	// Checks and removes the trailing checksum, returning false (buffer unchanged) on mismatch
+	bool verify_and_strip_crc32c(buffer& b);
+}
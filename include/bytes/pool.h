@@ -0,0 +1,66 @@
+/////////////////////////////////////////////////////////////////////////
+// Thread-local size-class memory pool
+//
+// Hands out byte blocks rounded up to a power-of-two size class, and
+// keeps released blocks on per-thread free lists for reuse. Blocks may be
+// released from another thread than the one that allocated them; they
+// are then cached by the releasing thread.
+//
+// Note: Requests larger than the largest size class bypass the pool.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bytes
+{
+	class size_class_pool
+	{
+		public:
+			// Size classes are 2^smallest_class_bits ... 2^largest_class_bits bytes
+			static constexpr std::size_t smallest_class_bits = 6;
+			static constexpr std::size_t largest_class_bits = 16;
+			static constexpr std::size_t number_of_classes = largest_class_bits - smallest_class_bits + 1;
+			static constexpr std::size_t smallest_class_size = std::size_t(1) << smallest_class_bits;
+			static constexpr std::size_t largest_class_size = std::size_t(1) << largest_class_bits;
+
+			// Maximum number of cached blocks per size class and thread
+			static constexpr std::size_t max_cached_blocks = 64;
+
+			// Allocate/release a block of at least "size" bytes
+			// Note: The size passed to release must be the size passed to allocate.
+			static uint8_t* allocate(std::size_t size);
+			static void release(uint8_t* block, std::size_t size);
+
+			// Returns the size actually reserved for a request of "size" bytes
+			static constexpr std::size_t block_size(std::size_t size)
+			{
+				if(size > largest_class_size)
+					return size;
+
+				std::size_t s = smallest_class_size;
+				while(s < size)
+					s <<= 1;
+				return s;
+			}
+
+			// Returns the size class index for a request, or number_of_classes if not pooled
+			static constexpr std::size_t size_class(std::size_t size)
+			{
+				if(size > largest_class_size)
+					return number_of_classes;
+
+				std::size_t index = 0;
+				while((smallest_class_size << index) < size)
+					index++;
+				return index;
+			}
+
+			// Number of blocks currently cached by the calling thread
+			static std::size_t cached_blocks();
+
+			// Releases all blocks cached by the calling thread back to the system
+			static void trim();
+	};
+}
@@ -10,6 +10,8 @@
 #include <algorithm>
 #include <type_traits>
 
+#include <bytes/pool.h>
+
 namespace bytes
 {
 	using byte = uint8_t;
@@ -29,26 +31,117 @@ namespace bytes
 			static T deserialize(const buffer_type&);
 	};
 
+	// Number of bytes stored inside a serialized_data object before falling back to pooled storage
+	constexpr std::size_t serialized_data_inline_size = 64;
+
 	// A buffer to hold serialized data
-	class serialized_data
+	// Payloads up to inline_capacity bytes are stored in the object itself, larger
+	// payloads are stored in blocks from the thread-local size_class_pool.
+	template <std::size_t inline_capacity = serialized_data_inline_size>
+	class basic_serialized_data
 	{
 		public:
-			// Constructor
-			template <typename T>
-			serialized_data(T entity) :
-				_data(serializer<T>::serialize(entity))
+			// Constructors / destructor
+			template <typename T, typename = typename std::enable_if_t<!std::is_same_v<std::decay_t<T>, basic_serialized_data>>>
+			basic_serialized_data(const T& entity) :
+				_size(std::tuple_size_v<typename serializer<T>::buffer_type>),
+				_external(nullptr)
+			{
+				const auto data = serializer<T>::serialize(entity);
+				std::copy(data.begin(), data.end(), allocate());
+			}
+
+			basic_serialized_data(const byte* data, std::size_t size) :
+				_size(size),
+				_external(nullptr)
+			{
+				std::copy(data, data + size, allocate());
+			}
+
+			~basic_serialized_data()
 			{
+				deallocate();
+			}
+
+			// Copy construction/assignment
+			basic_serialized_data(const basic_serialized_data& d) :
+				_size(d._size),
+				_external(nullptr)
+			{
+				std::copy(d.get(), d.get() + d._size, allocate());
+			}
+
+			basic_serialized_data& operator=(const basic_serialized_data& d)
+			{
+				if(this != &d)
+				{
+					deallocate();
+					_size = d._size;
+					std::copy(d.get(), d.get() + d._size, allocate());
+				}
+				return *this;
+			}
+
+			// Move construction/assignment (steals pooled storage, copies inline storage)
+			basic_serialized_data(basic_serialized_data&& d) noexcept :
+				_size(d._size),
+				_external(d._external)
+			{
+				if(_external == nullptr)
+					std::copy(d._inline.begin(), d._inline.begin() + _size, _inline.begin());
+
+				d._external = nullptr;
+				d._size = 0;
+			}
+
+			basic_serialized_data& operator=(basic_serialized_data&& d) noexcept
+			{
+				if(this != &d)
+				{
+					deallocate();
+					_size = d._size;
+					_external = d._external;
+					if(_external == nullptr)
+						std::copy(d._inline.begin(), d._inline.begin() + _size, _inline.begin());
+
+					d._external = nullptr;
+					d._size = 0;
+				}
+				return *this;
 			}
 
 			// Public interface
-			byte* get() { return &_data[0]; }
-			const byte* get() const { return &_data[0]; }
-			std::size_t size() const { return _data.size(); }
+			byte* get() { return _external != nullptr ? _external : _inline.data(); }
+			const byte* get() const { return _external != nullptr ? _external : _inline.data(); }
+			std::size_t size() const { return _size; }
+			bool is_inline() const { return _external == nullptr; }
+
+			static constexpr std::size_t inline_size() { return inline_capacity; }
 
 		private:
-			std::vector<byte> _data;
+			byte* allocate()
+			{
+				if(_size <= inline_capacity)
+					return _inline.data();
+
+				_external = size_class_pool::allocate(_size);
+				return _external;
+			}
+
+			void deallocate()
+			{
+				size_class_pool::release(_external, _size);
+				_external = nullptr;
+			}
+
+		private:
+			std::size_t _size;
+			byte* _external;	// Pooled storage, or nullptr when stored inline
+			std::array<byte, inline_capacity> _inline;
 	};
 
+	using serialized_data = basic_serialized_data<>;
+
 	// Serialization of arithmetic types (integers and floating point numbers)
 	template <typename T, std::size_t S = sizeof(T), typename = typename std::enable_if_t<std::is_arithmetic_v<T>>>
 	constexpr auto serialize_at(const T& value, byte* destination) -> void
@@ -0,0 +1,285 @@
+/////////////////////////////////////////////////////////////////////////
+// Open-addressing hash map
+//
+// Stores all entries in one flat array (linear probing, power-of-two
+// capacity, backward-shift deletion), with a one-byte tag per slot holding
+// seven bits of the hash, so most mismatching slots are rejected without
+// comparing keys. Suited for large tables of small keys, e.g. per-peer
+// state keyed by networking::endpoint.
+//
+// Note: Not thread-safe. Inserting or erasing invalidates iterators and
+//       pointers to values.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <new>
+#include <tuple>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+namespace utility
+{
+	template <typename K, typename V, typename hash_type = std::hash<K>, typename key_equal = std::equal_to<K>>
+	class flat_hash_map
+	{
+		public:
+			using key_type = K;
+			using mapped_type = V;
+			using value_type = std::pair<const K, V>;
+
+		private:
+			// Slot tags: zero marks an empty slot, otherwise the high bit plus seven hash bits
+			using tag_type = uint8_t;
+			constexpr static tag_type empty_tag = 0;
+			constexpr static std::size_t min_capacity = 16;
+
+			// Maximum load factor of 7/8
+			constexpr static bool over_loaded(std::size_t size, std::size_t capacity) { return size * 8 > capacity * 7; }
+
+			using slot_type = typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type;
+
+		public:
+			template <bool is_const>
+			class basic_iterator
+			{
+				public:
+					using map_type = typename std::conditional<is_const, const flat_hash_map, flat_hash_map>::type;
+					using reference = typename std::conditional<is_const, const value_type&, value_type&>::type;
+					using pointer = typename std::conditional<is_const, const value_type*, value_type*>::type;
+
+					basic_iterator(map_type* map, std::size_t index) : _map(map), _index(index) { skip_empty(); }
+
+					reference operator*() const { return _map->slot(_index); }
+					pointer operator->() const { return &_map->slot(_index); }
+					basic_iterator& operator++() { _index++; skip_empty(); return *this; }
+					bool operator==(const basic_iterator& i) const { return _index == i._index; }
+					bool operator!=(const basic_iterator& i) const { return _index != i._index; }
+
+				private:
+					friend class flat_hash_map;
+
+					void skip_empty()
+					{
+						while(_index < _map->_capacity && _map->_tags[_index] == empty_tag)
+							_index++;
+					}
+
+					map_type* _map;
+					std::size_t _index;
+			};
+
+			using iterator = basic_iterator<false>;
+			using const_iterator = basic_iterator<true>;
+
+		public:
+			// Constructor / destructor
+			explicit flat_hash_map(std::size_t expected_size = 0) :
+				_tags(), _slots(), _capacity(0), _size(0), _hash(), _equal()
+			{
+				reserve(expected_size);
+			}
+
+			~flat_hash_map() { clear(); }
+
+			// Copy construction/assignment
+			flat_hash_map(const flat_hash_map& m) : flat_hash_map(m._size)
+			{
+				for(const auto& entry : m)
+					emplace(entry.first, entry.second);
+			}
+
+			flat_hash_map& operator=(const flat_hash_map& m)
+			{
+				if(this != &m)
+				{
+					flat_hash_map copy { m };
+					swap(copy);
+				}
+				return *this;
+			}
+
+			// Move construction/assignment
+			flat_hash_map(flat_hash_map&& m) : flat_hash_map() { swap(m); }
+			flat_hash_map& operator=(flat_hash_map&& m) { swap(m); return *this; }
+
+			// Public interface
+			std::size_t size() const { return _size; }
+			bool empty() const { return _size == 0; }
+			std::size_t capacity() const { return _capacity; }
+
+			iterator begin() { return iterator { this, 0 }; }
+			iterator end() { return iterator { this, _capacity }; }
+			const_iterator begin() const { return const_iterator { this, 0 }; }
+			const_iterator end() const { return const_iterator { this, _capacity }; }
+
+			iterator find(const K& key) { return iterator { this, find_index(key) }; }
+			const_iterator find(const K& key) const { return const_iterator { this, find_index(key) }; }
+			bool contains(const K& key) const { return find_index(key) != _capacity; }
+
+			// Inserts if the key is not present, returns the entry and whether it was inserted
+			template <typename... arguments>
+			std::pair<iterator, bool> emplace(const K& key, arguments&&... args)
+			{
+				const auto h = hash(key);
+				const auto t = tag(h);
+				auto index = lookup(key, h, t);
+				if(index != _capacity)
+					return { iterator { this, index }, false };
+
+				if(over_loaded(_size + 1, _capacity))
+					rehash(_capacity == 0 ? min_capacity : 2 * _capacity);
+
+				// Linear probe for the first empty slot
+				index = h & (_capacity - 1);
+				while(_tags[index] != empty_tag)
+					index = (index + 1) & (_capacity - 1);
+
+				new (&_slots[index]) value_type(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<arguments>(args)...));
+				_tags[index] = t;
+				_size++;
+				return { iterator { this, index }, true };
+			}
+
+			V& operator[](const K& key) { return emplace(key).first->second; }
+
+			// Removes the key and returns true, or false if it was not present
+			bool erase(const K& key)
+			{
+				auto index = find_index(key);
+				if(index == _capacity)
+					return false;
+
+				erase_index(index);
+				return true;
+			}
+
+			void erase(iterator i) { erase_index(i._index); }
+
+			void clear()
+			{
+				for(std::size_t i = 0; i < _capacity; i++)
+				{
+					if(_tags[i] != empty_tag)
+					{
+						slot(i).~value_type();
+						_tags[i] = empty_tag;
+					}
+				}
+				_size = 0;
+			}
+
+			// Makes room for the given number of entries without rehashing
+			void reserve(std::size_t expected_size)
+			{
+				auto capacity = _capacity == 0 ? min_capacity : _capacity;
+				while(over_loaded(expected_size, capacity))
+					capacity *= 2;
+
+				if(expected_size > 0 && capacity != _capacity)
+					rehash(capacity);
+			}
+
+			void swap(flat_hash_map& m)
+			{
+				std::swap(_tags, m._tags);
+				std::swap(_slots, m._slots);
+				std::swap(_capacity, m._capacity);
+				std::swap(_size, m._size);
+			}
+
+		private:
+			value_type& slot(std::size_t i) { return *std::launder(reinterpret_cast<value_type*>(&_slots[i])); }
+			const value_type& slot(std::size_t i) const { return *std::launder(reinterpret_cast<const value_type*>(&_slots[i])); }
+
+			std::size_t hash(const K& key) const
+			{
+				// Fibonacci mixing, so that weak hashes (e.g. identity for integers) spread over the table
+				const uint64_t h = static_cast<uint64_t>(_hash(key)) * 0x9E3779B97F4A7C15ULL;
+				return static_cast<std::size_t>(h ^ (h >> 32));
+			}
+
+			static tag_type tag(std::size_t h) { return static_cast<tag_type>(0x80 | (h >> (8 * sizeof(std::size_t) - 7))); }
+
+			std::size_t lookup(const K& key, std::size_t h, tag_type t) const
+			{
+				if(_capacity == 0)
+					return _capacity;
+
+				for(auto index = h & (_capacity - 1); ; index = (index + 1) & (_capacity - 1))
+				{
+					const auto current = _tags[index];
+					if(current == empty_tag)
+						return _capacity;
+					if(current == t && _equal(slot(index).first, key))
+						return index;
+				}
+			}
+
+			std::size_t find_index(const K& key) const
+			{
+				const auto h = hash(key);
+				return lookup(key, h, tag(h));
+			}
+
+			// Removes the entry and shifts later entries of the probe sequence back, so no tombstones are needed
+			void erase_index(std::size_t hole)
+			{
+				slot(hole).~value_type();
+				_tags[hole] = empty_tag;
+				_size--;
+
+				const auto mask = _capacity - 1;
+				for(auto index = (hole + 1) & mask; _tags[index] != empty_tag; index = (index + 1) & mask)
+				{
+					// Entries whose home slot is cyclically in (hole, index] have to stay
+					const auto home = hash(slot(index).first) & mask;
+					if(((index - home) & mask) < ((index - hole) & mask))
+						continue;
+
+					new (&_slots[hole]) value_type(std::move(slot(index)));
+					_tags[hole] = _tags[index];
+					slot(index).~value_type();
+					_tags[index] = empty_tag;
+					hole = index;
+				}
+			}
+
+			void rehash(std::size_t capacity)
+			{
+				auto old_tags = std::move(_tags);
+				auto old_slots = std::move(_slots);
+				const auto old_capacity = _capacity;
+
+				_tags.assign(capacity, empty_tag);
+				_slots.reset(new slot_type[capacity]);
+				_capacity = capacity;
+
+				for(std::size_t i = 0; i < old_capacity; i++)
+				{
+					if(old_tags[i] == empty_tag)
+						continue;
+
+					auto& entry = *std::launder(reinterpret_cast<value_type*>(&old_slots[i]));
+					auto index = hash(entry.first) & (_capacity - 1);
+					while(_tags[index] != empty_tag)
+						index = (index + 1) & (_capacity - 1);
+
+					new (&_slots[index]) value_type(std::move(entry));
+					_tags[index] = old_tags[i];
+					entry.~value_type();
+				}
+			}
+
+		private:
+			std::vector<tag_type> _tags;
+			std::unique_ptr<slot_type[]> _slots;
+			std::size_t _capacity;
+			std::size_t _size;
+			hash_type _hash;
+			key_equal _equal;
+	};
+}
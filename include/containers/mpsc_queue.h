@@ -0,0 +1,106 @@
+/////////////////////////////////////////////////////////////////////////
+// Multi-producer single-consumer queue
+//
+// Lock-free for the producers: elements are pushed onto an atomic list,
+// which the consumer takes over as a whole whenever its own list runs
+// empty (reversing it, so elements are read in the order they were
+// pushed by each thread).
+//
+// Thread-safe when any number of threads push and one thread reads (the
+// same thread, which cannot change roles).
+//
+// Note: Every element is allocated separately.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace utility
+{
+	template <typename T>
+	class mpsc_queue
+	{
+		private:
+			struct node
+			{
+				T value;
+				node* next;
+			};
+
+		public:
+			// Constructor / destructor
+			mpsc_queue() : _head(nullptr), _taken(nullptr) {}
+
+			~mpsc_queue()
+			{
+				take();
+				while(_taken != nullptr)
+				{
+					auto* n = _taken;
+					_taken = n->next;
+					delete n;
+				}
+			}
+
+			// Disallow copying and moving (producers refer to the instance)
+			mpsc_queue(const mpsc_queue&) = delete;
+			mpsc_queue& operator=(const mpsc_queue&) = delete;
+			mpsc_queue(mpsc_queue&&) = delete;
+			mpsc_queue& operator=(mpsc_queue&&) = delete;
+
+			// Pushes an element (any thread), returns true if no other pushed element was waiting for the consumer
+			// to take it over, i.e. when the consumer may have to be woken up
+			bool push(T element)
+			{
+				auto* n = new node { std::move(element), nullptr };
+				auto head = _head.load(std::memory_order_relaxed);
+				do
+				{
+					n->next = head;
+				} while(!_head.compare_exchange_weak(head, n, std::memory_order_release, std::memory_order_relaxed));
+
+				return head == nullptr;
+			}
+
+			// Reads the next element (consumer thread only), returns false iff the queue is empty
+			bool read(T& result)
+			{
+				if(_taken == nullptr)
+					take();
+
+				if(_taken == nullptr)
+					return false;
+
+				auto* n = _taken;
+				_taken = n->next;
+				result = std::move(n->value);
+				delete n;
+				return true;
+			}
+
+			// Checks whether the queue has any elements (consumer thread only)
+			bool empty() const
+			{
+				return _taken == nullptr && _head.load(std::memory_order_acquire) == nullptr;
+			}
+
+		private:
+			// Takes over the pushed elements, restoring their order
+			void take()
+			{
+				auto* n = _head.exchange(nullptr, std::memory_order_acquire);
+				while(n != nullptr)
+				{
+					auto* next = n->next;
+					n->next = _taken;
+					_taken = n;
+					n = next;
+				}
+			}
+
+		private:
+			std::atomic<node*> _head;	// Most recently pushed first
+			node* _taken;				// Consumer's list, oldest first
+	};
+}
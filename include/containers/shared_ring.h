@@ -0,0 +1,128 @@
+/////////////////////////////////////////////////////////////////////////
+// Process-shared ring buffer of variable-length messages
+//
+// The counterpart of circular_buffer for exchanging messages between
+// processes: the indices and the storage live in a shared memory mapping
+// (a named shm_open object, or an anonymous memfd that is passed to the
+// other process), so nothing refers to process-local addresses.
+//
+// Messages are framed with an 8-byte record header and written in place.
+// Producers reserve space by advancing the write counter (a CAS loop in
+// multi-producer mode), copy the payload and then publish the record
+// header, so the consumer only sees complete messages, in reservation
+// order. A message that does not fit before the end of the storage is
+// preceded by a padding record, and is written from the start.
+//
+// A consumer may block in wait(), which sleeps on a futex in the shared
+// header; producers only make the wake-up call when a consumer sleeps.
+//
+// The creator initializes the header before any other process can map a
+// complete ring, and attach() checks the layout and registers the role:
+// there is exactly one consumer, and one producer in single-producer mode.
+//
+// Note: Attachments of processes that die are not cleaned up. The creator
+//       removes the name of a named ring when it is closed.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace utility
+{
+	enum class shared_ring_mode : uint32_t
+	{
+		single_producer = 1,
+		multi_producer = 2
+	};
+
+	enum class shared_ring_role
+	{
+		none,		// Maps the ring without producing or consuming (e.g. monitoring)
+		producer,
+		consumer
+	};
+
+	class shared_ring
+	{
+		public:
+			enum class status
+			{
+				open,
+				closed,
+				not_ready,	// The creator has not finished initializing the ring
+				invalid,	// Not a ring of this version
+				in_use,		// The role is already taken
+				error
+			};
+
+			constexpr static std::size_t min_capacity = 4096;
+
+		public:
+			// Creates a ring with at least the given capacity in bytes (rounded up to a power of two)
+			// An empty name creates an anonymous ring (memfd), to be attached through fd()
+			static shared_ring create(const std::string& name, std::size_t capacity, shared_ring_role, shared_ring_mode = shared_ring_mode::single_producer);
+
+			// Attaches to an existing ring, the file descriptor is duplicated
+			static shared_ring attach(const std::string& name, shared_ring_role);
+			static shared_ring attach(int fd, shared_ring_role);
+
+			// Constructor / destructor
+			shared_ring();
+			~shared_ring();
+
+			// Disallow copying
+			shared_ring(const shared_ring&) = delete;
+			shared_ring& operator=(const shared_ring&) = delete;
+
+			// Move construction/assignment
+			shared_ring(shared_ring&&);
+			shared_ring& operator=(shared_ring&&);
+
+			// Producer interface
+			bool push(const uint8_t* data, std::size_t size);	// False if full or too large
+
+			// Consumer interface, peek provides the next message in place until it is popped
+			const uint8_t* peek(std::size_t& size);				// nullptr iff empty
+			bool pop();
+			bool read(std::vector<uint8_t>& result);
+			bool wait(std::chrono::microseconds timeout);		// !! BLOCKING !! True if a message is available
+
+			// Public interface
+			void close();
+			bool empty() const;
+			std::size_t capacity() const;
+			std::size_t max_message_size() const;
+			std::size_t bytes_used() const;						// Including record headers and padding
+			std::size_t producers() const;						// Attached producers
+			bool consumer_attached() const;
+			int fd() const { return _fd; }
+			shared_ring_role role() const { return _role; }
+			status state() const { return _status; }
+			int error() const { return _error; }
+
+		private:
+			struct header;
+
+			shared_ring(status, int error);
+			bool map(int fd, std::size_t size);
+			bool join(shared_ring_role);
+			static shared_ring attach_descriptor(int fd, shared_ring_role);
+			void notify();
+			uint8_t* record(uint64_t position) const;
+
+		private:
+			header* _header;
+			uint8_t* _data;
+			std::size_t _mapped_size;
+			uint64_t _mask;
+			int _fd;
+			shared_ring_role _role;
+			std::string _name;		// Set for named rings created by this object
+			status _status;
+			int _error;
+	};
+}
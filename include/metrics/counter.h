@@ -0,0 +1,89 @@
+/////////////////////////////////////////////////////////////////////////
+// Sharded counters and gauges
+//
+// A counter is split into cache-line sized shards, and every thread adds
+// to its own shard (threads are assigned shards round-robin), so threads
+// counting the same event do not contend for one cache line. Reading
+// merges the shards.
+//
+// Note: Thread-safe. Reads are not a consistent snapshot of concurrent
+//       additions.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace metrics
+{
+	constexpr std::size_t shard_count = 16;
+
+	// Shard of the calling thread
+	std::size_t assign_shard();
+	inline std::size_t this_thread_shard()
+	{
+		static thread_local const std::size_t shard = assign_shard();
+		return shard;
+	}
+
+	class counter
+	{
+		public:
+			// Constructor / destructor
+			counter() : _shards{} {}
+
+			// Disallow copying and moving (metrics are referred to by the code they instrument)
+			counter(const counter&) = delete;
+			counter& operator=(const counter&) = delete;
+
+			// Public interface
+			void add(uint64_t value = 1)
+			{
+				_shards[this_thread_shard()].value.fetch_add(value, std::memory_order_relaxed);
+			}
+
+			uint64_t value() const
+			{
+				uint64_t result = 0;
+				for(const auto& s : _shards)
+					result += s.value.load(std::memory_order_relaxed);
+				return result;
+			}
+
+			void reset()
+			{
+				for(auto& s : _shards)
+					s.value.store(0, std::memory_order_relaxed);
+			}
+
+		private:
+			struct alignas(64) shard
+			{
+				std::atomic<uint64_t> value { 0 };
+			};
+
+			std::array<shard, shard_count> _shards;
+	};
+
+	// A value that is set rather than accumulated (e.g. a queue depth)
+	class gauge
+	{
+		public:
+			// Constructor / destructor
+			gauge() : _value(0) {}
+
+			// Disallow copying and moving
+			gauge(const gauge&) = delete;
+			gauge& operator=(const gauge&) = delete;
+
+			// Public interface
+			void set(int64_t value) { _value.store(value, std::memory_order_relaxed); }
+			void add(int64_t value) { _value.fetch_add(value, std::memory_order_relaxed); }
+			int64_t value() const { return _value.load(std::memory_order_relaxed); }
+
+		private:
+			std::atomic<int64_t> _value;
+	};
+}
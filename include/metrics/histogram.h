@@ -0,0 +1,111 @@
+/////////////////////////////////////////////////////////////////////////
+// Log-linear latency histogram (HDR-style)
+//
+// Values are counted in buckets whose width grows with the value: every
+// power of two is split into 2^sub_bucket_bits linear sub-buckets, so the
+// relative error stays below 1/2^sub_bucket_bits (about 3%) over the whole
+// 64-bit range, with a fixed number of buckets and no configuration.
+// Values below 2^sub_bucket_bits are counted exactly.
+//
+// Recording adds to the calling thread's shard (allocated on its first
+// record), and snapshot() merges the shards.
+//
+// Note: Thread-safe. Values are unitless, the library records nanoseconds.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <metrics/counter.h>
+
+namespace metrics
+{
+	// Merged histogram counts, with percentiles
+	struct histogram_snapshot
+	{
+		std::vector<uint64_t> buckets;
+		uint64_t count = 0;
+		uint64_t sum = 0;
+
+		uint64_t min() const;
+		uint64_t max() const;
+		double mean() const;
+		uint64_t percentile(double percent) const;	// Highest value equivalent to the one at the percentile
+		void merge(const histogram_snapshot&);
+	};
+
+	class histogram
+	{
+		public:
+			constexpr static unsigned sub_bucket_bits = 5;
+			constexpr static std::size_t sub_buckets = std::size_t(1) << sub_bucket_bits;
+			constexpr static std::size_t bucket_count = (65 - sub_bucket_bits) * sub_buckets;
+
+			// Bucket of a value, and the range of values in a bucket
+			static std::size_t bucket_index(uint64_t value)
+			{
+				if(value < sub_buckets)
+					return static_cast<std::size_t>(value);
+
+				const unsigned shift = most_significant_bit(value) - sub_bucket_bits;
+				return ((shift + 1) << sub_bucket_bits) + static_cast<std::size_t>((value >> shift) - sub_buckets);
+			}
+
+			static uint64_t bucket_lowest(std::size_t index);
+			static uint64_t bucket_highest(std::size_t index);
+
+		public:
+			// Constructor / destructor
+			histogram();
+			~histogram();
+
+			// Disallow copying and moving (metrics are referred to by the code they instrument)
+			histogram(const histogram&) = delete;
+			histogram& operator=(const histogram&) = delete;
+
+			// Public interface
+			void record(uint64_t value)
+			{
+				auto& s = local_shard();
+				s.buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+				s.sum.fetch_add(value, std::memory_order_relaxed);
+			}
+
+			histogram_snapshot snapshot() const;
+			void reset();
+
+		private:
+			struct shard
+			{
+				std::array<std::atomic<uint64_t>, bucket_count> buckets {};
+				std::atomic<uint64_t> sum { 0 };
+			};
+
+			static unsigned most_significant_bit(uint64_t value)
+			{
+#if defined(__GNUC__) || defined(__clang__)
+				return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#else
+				unsigned bit = 0;
+				while(value >>= 1)
+					bit++;
+				return bit;
+#endif
+			}
+
+			shard& local_shard()
+			{
+				auto* s = _shards[this_thread_shard()].load(std::memory_order_acquire);
+				return (s != nullptr) ? *s : allocate_shard();
+			}
+
+			shard& allocate_shard();
+
+		private:
+			std::array<std::atomic<shard*>, shard_count> _shards;
+	};
+}
@@ -0,0 +1,122 @@
+/////////////////////////////////////////////////////////////////////////
+// Probes built into the library
+//
+// The networking classes record into process-wide probes once they are
+// enabled; while disabled, a probe point costs one atomic load.
+//
+//   tcp.connection.receive_calls / send_calls     Receive and send calls
+//   tcp.connection.bytes_received / bytes_sent    Bytes transferred
+//   tcp.manager.poll_wait_ns                      Time spent in poll
+//   tcp.manager.events                            Ready handles per update
+//   tcp.manager.callback_ns                       Duration of each data callback
+//   net.packet.receive_delay_ns                   Time from the kernel receive
+//                                                 timestamp to the read returning
+//
+// Queues are instrumented per instance with instrumented_queue, which
+// tracks the depth and the pushes to a full / reads from an empty queue,
+// and traces every push and read (see trace.h).
+//
+// Note: Enabled probes stay allocated until the process ends, so that
+//       threads still holding them are safe when probes are disabled.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <utility>
+
+#include <metrics/counter.h>
+#include <metrics/histogram.h>
+#include <metrics/registry.h>
+#include <metrics/trace.h>
+
+namespace metrics
+{
+	struct connection_probes
+	{
+		counter& receive_calls;
+		counter& send_calls;
+		counter& bytes_received;
+		counter& bytes_sent;
+	};
+
+	struct manager_probes
+	{
+		histogram& poll_wait;
+		histogram& events;
+		histogram& callback;
+	};
+
+	struct packet_probes
+	{
+		histogram& receive_delay;
+	};
+
+	// Registers the probes in the registry and enables them (for all instances)
+	void enable_probes(registry& = default_registry());
+	void disable_probes();
+
+	namespace detail
+	{
+		extern std::atomic<const connection_probes*> enabled_connection_probes;
+		extern std::atomic<const manager_probes*> enabled_manager_probes;
+		extern std::atomic<const packet_probes*> enabled_packet_probes;
+	}
+
+	// The enabled probes, or nullptr
+	inline const connection_probes* connection_probes_enabled() { return detail::enabled_connection_probes.load(std::memory_order_acquire); }
+	inline const manager_probes* manager_probes_enabled() { return detail::enabled_manager_probes.load(std::memory_order_acquire); }
+	inline const packet_probes* packet_probes_enabled() { return detail::enabled_packet_probes.load(std::memory_order_acquire); }
+
+	// Queue metrics, named <name>.depth, <name>.full and <name>.empty
+	struct queue_probes
+	{
+		gauge& depth;
+		counter& full;		// Pushes that failed because the queue was full
+		counter& empty;		// Reads that failed because the queue was empty
+	};
+
+	queue_probes make_queue_probes(registry&, const std::string& name);
+
+	// Wraps a circular_buffer or safe_queue, recording into the probes on push and read
+	template <typename queue_type>
+	class instrumented_queue
+	{
+		public:
+			// Constructor, the arguments after the probes are passed to the queue
+			template <typename... arguments>
+			explicit instrumented_queue(const queue_probes& probes, arguments&&... args) :
+				_queue(std::forward<arguments>(args)...), _probes(probes) {}
+
+			template <typename T>
+			bool push(T&& element)
+			{
+				const bool pushed = _queue.push(std::forward<T>(element));
+				if(!pushed)
+					_probes.full.add();
+				const auto depth = static_cast<int64_t>(_queue.size());
+				_probes.depth.set(depth);
+				trace(trace_event::queue_push, trace_phase::instant, depth);
+				return pushed;
+			}
+
+			template <typename T>
+			bool read(T& result)
+			{
+				const bool read = _queue.read(result);
+				if(!read)
+					_probes.empty.add();
+				const auto depth = static_cast<int64_t>(_queue.size());
+				_probes.depth.set(depth);
+				trace(trace_event::queue_read, trace_phase::instant, depth);
+				return read;
+			}
+
+			queue_type& queue() { return _queue; }
+			const queue_type& queue() const { return _queue; }
+
+		private:
+			queue_type _queue;
+			queue_probes _probes;
+	};
+}
@@ -0,0 +1,80 @@
+/////////////////////////////////////////////////////////////////////////
+// Registry of named metrics
+//
+// Creates counters, gauges and histograms on first use of their name and
+// keeps them alive (at a stable address) for the lifetime of the
+// registry. Looking up a name takes a lock, so the instrumented code
+// should look its metrics up once and keep the references; recording on
+// them does not lock.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include <metrics/counter.h>
+#include <metrics/histogram.h>
+
+namespace metrics
+{
+	enum class metric_type
+	{
+		counter,
+		gauge,
+		histogram
+	};
+
+	struct metric_snapshot
+	{
+		std::string name;
+		metric_type type;
+		int64_t value;					// Counters and gauges
+		histogram_snapshot distribution;	// Histograms
+	};
+
+	class registry
+	{
+		public:
+			// Constructor / destructor
+			registry();
+			~registry();
+
+			// Disallow copying and moving (metrics are referred to by the code they instrument)
+			registry(const registry&) = delete;
+			registry& operator=(const registry&) = delete;
+
+			// Returns the metric with the name, creating it if needed
+			// Note: A name refers to one metric type, asking for another type returns a separate, unlisted metric.
+			counter& make_counter(const std::string& name);
+			gauge& make_gauge(const std::string& name);
+			histogram& make_histogram(const std::string& name);
+
+			std::vector<metric_snapshot> snapshot() const;	// Sorted by name
+			void write(std::ostream&) const;				// One line per metric, histograms with percentiles
+			std::size_t size() const;
+
+		private:
+			struct entry
+			{
+				metric_type type;
+				std::unique_ptr<counter> c;
+				std::unique_ptr<gauge> g;
+				std::unique_ptr<histogram> h;
+			};
+
+			entry& find_or_add(const std::string& name, metric_type);
+
+		private:
+			mutable std::mutex _mutex;
+			std::map<std::string, entry> _metrics;
+			std::deque<entry> _mismatched;		// Asked for under a name registered with another type
+	};
+
+	// Process-wide registry (e.g. for the probes built into the library)
+	registry& default_registry();
+}
@@ -0,0 +1,211 @@
+/////////////////////////////////////////////////////////////////////////
+// Binary event tracing
+//
+// Records timestamped events into a fixed-size ring per thread, for
+// following individual messages through the library (which the sampled
+// metrics cannot do). Recording an event takes no lock and allocates
+// nothing: the thread's ring is allocated when the thread records its
+// first event, and the oldest events are overwritten when it is full.
+// While tracing is disabled, a trace point costs one atomic load.
+//
+// Timestamps are raw ticks (the TSC on x86, nanoseconds elsewhere), which
+// are calibrated against steady_clock once and converted when the trace
+// is read. The library traces:
+//
+//   accept        instant    A connection was accepted (argument: socket)
+//   update        begin/end  connection_manager::update handling the
+//                            ready handles (end argument: ready handles)
+//   receive/send  instant    tcp::connection calls (argument: result)
+//   queue_push    instant    instrumented_queue (argument: depth)
+//   queue_read    instant
+//
+// write_trace dumps every thread's ring in a compact binary format
+// (native byte order), read_trace loads a dump and write_chrome_trace
+// converts it to the Chrome trace event JSON (chrome://tracing, Perfetto).
+//
+// Note: Rings are kept until the process ends, threads that exit leave
+//       their events behind. Dumping while threads record may lose the
+//       events that are overwritten during the dump.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <map>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <istream>
+#include <ostream>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace metrics
+{
+	enum class trace_phase : uint8_t
+	{
+		begin = 'B',
+		end = 'E',
+		instant = 'i'
+	};
+
+	// Events recorded by the library, applications name their own events from user upwards
+	enum class trace_event : uint16_t
+	{
+		accept = 1,
+		update,
+		receive,
+		send,
+		queue_push,
+		queue_read,
+		user = 256
+	};
+
+	struct trace_record
+	{
+		uint64_t ticks;
+		int64_t argument;
+		uint16_t event;
+		trace_phase phase;
+		uint8_t reserved[5];
+	};
+
+	static_assert(sizeof(trace_record) == 24, "Trace records are written to dumps as they are");
+
+	// Timestamp in ticks
+	inline uint64_t trace_ticks()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+	}
+
+	namespace detail
+	{
+		// Ring of one thread, only that thread records
+		class trace_buffer
+		{
+			public:
+				trace_buffer(std::size_t capacity, uint32_t thread);
+
+				void record(uint16_t event, trace_phase phase, int64_t argument)
+				{
+					const auto w = _written.load(std::memory_order_relaxed);
+					auto& r = _records[w & _mask];
+					r.ticks = trace_ticks();
+					r.argument = argument;
+					r.event = event;
+					r.phase = phase;
+					_written.store(w + 1, std::memory_order_release);
+				}
+
+				std::vector<trace_record> collect() const;	// Oldest first
+				void clear();
+				uint32_t thread() const { return _thread; }
+
+			private:
+				std::unique_ptr<trace_record[]> _records;
+				uint64_t _mask;
+				std::atomic<uint64_t> _written;
+				uint32_t _thread;
+		};
+
+		extern std::atomic<bool> tracing;
+		trace_buffer* register_trace_thread();
+		inline thread_local trace_buffer* thread_trace_buffer = nullptr;
+	}
+
+	// Starts / stops recording for all threads
+	// A thread's ring holds events_per_thread events (rounded up to a power of two), fixed when it first records
+	void enable_tracing(std::size_t events_per_thread = std::size_t(1) << 16);
+	void disable_tracing();
+	inline bool tracing_enabled() { return detail::tracing.load(std::memory_order_relaxed); }
+
+	// Records an event on the calling thread
+	inline void trace(uint16_t event, trace_phase phase, int64_t argument = 0)
+	{
+		if(!tracing_enabled())
+			return;
+
+		auto* buffer = detail::thread_trace_buffer;
+		if(buffer == nullptr)
+			buffer = detail::register_trace_thread();
+		buffer->record(event, phase, argument);
+	}
+
+	inline void trace(trace_event event, trace_phase phase, int64_t argument = 0)
+	{
+		trace(static_cast<uint16_t>(event), phase, argument);
+	}
+
+	// Records the begin and end of a scope (the end is recorded iff the begin was)
+	class trace_scope
+	{
+		public:
+			explicit trace_scope(trace_event event, int64_t argument = 0) :
+				_event(static_cast<uint16_t>(event)), _argument(0), _active(tracing_enabled())
+			{
+				if(_active)
+					trace(_event, trace_phase::begin, argument);
+			}
+
+			~trace_scope()
+			{
+				if(_active)
+				{
+					auto* buffer = detail::thread_trace_buffer;
+					if(buffer != nullptr)
+						buffer->record(_event, trace_phase::end, _argument);
+				}
+			}
+
+			trace_scope(const trace_scope&) = delete;
+			trace_scope& operator=(const trace_scope&) = delete;
+
+			void set_argument(int64_t argument) { _argument = argument; }	// Recorded with the end
+
+		private:
+			uint16_t _event;
+			int64_t _argument;
+			bool _active;
+	};
+
+	// Names an application event (written to dumps)
+	void name_trace_event(uint16_t event, const std::string& name);
+
+	// Ticks per second, measured on first use
+	double trace_ticks_per_second();
+
+	// Dumps the recorded events of all threads, returns false on stream errors
+	bool write_trace(std::ostream&);
+	bool write_trace(const std::string& path);
+
+	// Discards the recorded events (only while no thread records)
+	void clear_trace();
+
+	// Contents of a dump
+	struct trace_thread
+	{
+		uint32_t thread;
+		std::vector<trace_record> records;	// Oldest first
+	};
+
+	struct trace_file
+	{
+		double ticks_per_second = 0;
+		std::map<uint16_t, std::string> names;
+		std::vector<trace_thread> threads;
+	};
+
+	// Loads a dump, returns false if it is not a valid trace
+	bool read_trace(std::istream&, trace_file&);
+
+	// Writes the Chrome trace event JSON, timestamps relative to the earliest event
+	void write_chrome_trace(const trace_file&, std::ostream&);
+}
@@ -3,6 +3,9 @@
 /////////////////////////////////////////////////////////////////////////
 #pragma once
 
+#include <vector>
+#include <functional>
+
 #include "networking.h"
 
 namespace networking
@@ -11,9 +14,13 @@ namespace networking
 	{
 		public:
 			// Constructors
-			constexpr explicit address() : _valid(false), _address({}), _length(0), _family(AF_UNSPEC) {}
-			constexpr explicit address(const sockaddr& a, socklen_t length, sa_family_t family) :
-				_valid(true), _address(a), _length(length), _family(family) {}
+			constexpr explicit address() : _valid(false), _address(), _length(0), _family(AF_UNSPEC) {}
+			explicit address(const sockaddr& a, socklen_t length, sa_family_t family);
+			explicit address(const sockaddr_in& a);
+			explicit address(const sockaddr_in6& a);
+#ifdef USE_POSIX
+			explicit address(const sockaddr_un& a, socklen_t length);
+#endif
 
 			// Copy-construction / copy-assignment
 			address(const address&);
@@ -23,32 +30,65 @@ namespace networking
 			address(address&&);
 			address& operator=(address&&);
 
-			// Comparison operator
+			// Comparison operators (IP addresses compare equal if address, port and IPv6 scope id match)
+			bool operator==(const address&) const;
+			bool operator!=(const address& a) const { return !(*this == a); }
 
 			// Public interface
-			const sockaddr& get() const { return _address; }
+			const sockaddr& get() const { return _address.base; }
 			constexpr bool valid() const { return _valid; }
 			constexpr socklen_t length() const { return _length; }
 			constexpr sa_family_t family() const { return _family; }
-			constexpr ip_version ip_version_value() const { return _family == AF_INET6 ? ip_version::ipv6 : ip_version::ipv4; }
+			constexpr ip_version ip_version_value() const { return _family == AF_INET6 ? ip_version::ipv6 : (_family == AF_UNIX ? ip_version::local : ip_version::ipv4); }
 
 			result_string host(bool numeric_only = true) const;
 			result_string port() const;
 			result_string to_string(bool numeric_host_only = true) const;
 			port_number_t port_number() const;
 
+			// Allocation-free numeric formatting into a caller buffer (see numeric_address.h for sizes)
+			// Returns the number of characters written, or zero if invalid or the buffer is too small
+			std::size_t format_host(char* buffer, std::size_t buffer_size) const;
+			std::size_t format(char* buffer, std::size_t buffer_size) const;	// "host:port", "[host]:port" or "unix:path"
+
 			// Static definition of invalid address
 			static constexpr address invalid() { return address {}; }
 
 		private:
+			std::size_t format_local(char* buffer, std::size_t buffer_size) const;
+
+			// Large enough for IPv4, IPv6 and Unix domain socket addresses
+			union storage
+			{
+				constexpr storage() : v6() {}
+
+				sockaddr base;
+				sockaddr_in v4;
+				sockaddr_in6 v6;
+#ifdef USE_POSIX
+				sockaddr_un local;
+#endif
+			};
+
 			bool _valid;
-			sockaddr _address;
+			storage _address;
 			socklen_t _length;
-			sa_family_t _family;	// AF_INET / AF_INET6
+			sa_family_t _family;	// AF_INET / AF_INET6 / AF_UNIX
 	};
 
 	address create_address(std::string hostname, uint16_t port, protocol, bool resolve_hostname = false, ip_version = ip_version::any);
 	address create_host_address(uint16_t port, protocol, ip_version = ip_version::any);
+	int resolve_addresses(const std::string& hostname, uint16_t port, protocol, ip_version, std::vector<address>& result);	// !! BLOCKING !! Returns a getaddrinfo error code
+	address create_numeric_address(const std::string& hostname, uint16_t port, ip_version = ip_version::any);	// No getaddrinfo, literals only
+	address create_local_address(const std::string& path);	// Unix domain socket, a leading '@' selects the abstract namespace (Linux)
 
 	std::ostream& operator<<(std::ostream&, const address&);
 }
+
+namespace std
+{
+	template <> struct hash<networking::address>
+	{
+		std::size_t operator()(const networking::address&) const;
+	};
+}
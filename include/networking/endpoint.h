@@ -0,0 +1,100 @@
+/////////////////////////////////////////////////////////////////////////
+// Compact IP endpoint (address and port)
+//
+// A fixed-size (20 byte) value type for IPv4 and IPv6 endpoints, with
+// constant-time equality, ordering and hashing. IPv4 addresses are stored
+// as IPv4-mapped IPv6 addresses, so every endpoint has the same layout.
+// Intended as key for per-peer tables, e.g. on UDP servers.
+//
+// Note: The IPv6 flow information and scope id are not part of the
+//       endpoint and are lost when converting from an address.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <functional>
+
+#include "networking.h"
+
+namespace networking
+{
+	class endpoint
+	{
+		public:
+			using bytes_type = std::array<uint8_t, 16>;
+
+		public:
+			// Constructors
+			constexpr endpoint() : _bytes{}, _port(0), _family(family_type::none), _reserved(0) {}
+			explicit endpoint(const address&);
+			explicit endpoint(const sockaddr& a, socklen_t length);
+			explicit endpoint(const sockaddr_in&);
+			explicit endpoint(const sockaddr_in6&);
+
+			// Public interface
+			bool valid() const { return _family != family_type::none; }
+			ip_version ip_version_value() const { return _family == family_type::ipv6 ? ip_version::ipv6 : ip_version::ipv4; }
+			port_number_t port_number() const { return _port; }
+			const bytes_type& bytes() const { return _bytes; }	// Network byte order, IPv4 as ::ffff:a.b.c.d
+
+			address to_address() const;
+			socklen_t to_sockaddr(sockaddr_storage&) const;		// Returns the length, or zero if invalid
+			std::size_t format(char* buffer, std::size_t buffer_size) const;
+
+			std::size_t hash() const
+			{
+				uint64_t a, b;
+				std::memcpy(&a, _bytes.data(), sizeof(a));
+				std::memcpy(&b, _bytes.data() + 8, sizeof(b));
+				const uint64_t c = (static_cast<uint64_t>(_port) << 8) | static_cast<uint64_t>(_family);
+
+				// Multiply-xorshift mixing of the three words
+				uint64_t h = (a ^ (c << 40)) * 0x9E3779B97F4A7C15ULL;
+				h = (h ^ (h >> 32) ^ b) * 0xC2B2AE3D27D4EB4FULL;
+				return static_cast<std::size_t>(h ^ (h >> 29));
+			}
+
+			// Comparison operators
+			friend bool operator==(const endpoint& a, const endpoint& b)
+			{
+				return a._port == b._port && a._family == b._family && a._bytes == b._bytes;
+			}
+
+			friend bool operator!=(const endpoint& a, const endpoint& b) { return !(a == b); }
+
+			// Orders by family, then address, then port
+			friend bool operator<(const endpoint& a, const endpoint& b)
+			{
+				if(a._family != b._family)
+					return a._family < b._family;
+				const auto c = std::memcmp(a._bytes.data(), b._bytes.data(), a._bytes.size());
+				if(c != 0)
+					return c < 0;
+				return a._port < b._port;
+			}
+
+		private:
+			enum class family_type : uint8_t
+			{
+				none,
+				ipv4,
+				ipv6,
+			};
+
+			bytes_type _bytes;
+			port_number_t _port;	// Host byte order
+			family_type _family;
+			uint8_t _reserved;		// Keeps the padding byte defined
+	};
+
+	std::ostream& operator<<(std::ostream&, const endpoint&);
+}
+
+namespace std
+{
+	template <> struct hash<networking::endpoint>
+	{
+		std::size_t operator()(const networking::endpoint& e) const { return e.hash(); }
+	};
+}
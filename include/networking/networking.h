@@ -18,6 +18,7 @@ namespace networking
 		tcp,
 		udp,
 		any,
+		seqpacket,	// Connection with message boundaries (Unix domain sockets)
 	};
 
 	enum class ip_version
@@ -25,6 +26,7 @@ namespace networking
 		ipv4,
 		ipv6,
 		any,
+		local,		// Unix domain sockets (AF_UNIX), not an IP version
 	};
 
 	struct result_string
@@ -0,0 +1,33 @@
+/////////////////////////////////////////////////////////////////////////
+// Allocation-free parsing and formatting of numeric IP addresses
+//
+// Handles dotted-quad IPv4 and RFC 4291 IPv6 literals (including an
+// embedded IPv4 suffix). Formatting follows RFC 5952 (lowercase, longest
+// zero run compressed) and writes into caller-provided buffers.
+//
+// Note: Scoped IPv6 literals ("fe80::1%eth0") are not handled here.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <cstddef>
+
+#include "networking.h"
+
+namespace networking
+{
+	// Buffer sizes sufficient for any formatted value (including the terminating null)
+	constexpr std::size_t max_ipv4_string_length = 16;		// 255.255.255.255
+	constexpr std::size_t max_ipv6_string_length = 46;		// ffff:ffff:ffff:ffff:ffff:ffff:255.255.255.255
+	constexpr std::size_t max_port_string_length = 6;		// 65535
+	constexpr std::size_t max_address_string_length = max_ipv6_string_length + 2 + 1 + max_port_string_length;	// [host]:port
+
+	// Parse a literal in [begin, end), returns false if it is not a valid literal
+	bool parse_ipv4(const char* begin, const char* end, in_addr& result);
+	bool parse_ipv6(const char* begin, const char* end, in6_addr& result);
+
+	// Format into buffer and null-terminate, returns the number of characters written (without the null),
+	// or zero if the buffer is too small
+	std::size_t format_ipv4(const in_addr&, char* buffer, std::size_t buffer_size);
+	std::size_t format_ipv6(const in6_addr&, char* buffer, std::size_t buffer_size);
+	std::size_t format_port(port_number_t, char* buffer, std::size_t buffer_size);
+}
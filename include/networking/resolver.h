@@ -0,0 +1,104 @@
+/////////////////////////////////////////////////////////////////////////
+// Asynchronous host name resolution with caching
+//
+// Lookups run on a small pool of worker threads. Results are cached for a
+// configurable time (separately for successful and failed lookups), and
+// concurrent lookups of the same name share one getaddrinfo call.
+//
+// Results are available through futures (ready on a worker thread) or
+// callbacks. Callbacks are run by dispatch() on the calling thread, e.g.
+// the thread running a connection_manager the resolver is attached to.
+// notification_handle() becomes readable while callbacks are waiting.
+//
+// Note: getaddrinfo does not report record TTLs, so the cache uses the
+//       configured times instead.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+
+#include <networking/address.h>
+
+namespace networking
+{
+	struct resolution
+	{
+		int code;	// Zero for success, otherwise a getaddrinfo error code
+		std::vector<address> addresses;
+	};
+
+	struct resolver_options
+	{
+		std::size_t workers = 2;
+		std::chrono::milliseconds positive_ttl { 60000 };
+		std::chrono::milliseconds negative_ttl { 5000 };
+		std::size_t max_cache_entries = 4096;
+	};
+
+	class resolver
+	{
+		public:
+			using callback_type = std::function<void(const resolution&)>;
+			using clock_type = std::chrono::steady_clock;
+
+		public:
+			// Constructor / destructor
+			explicit resolver(const resolver_options& = resolver_options {});
+			~resolver();
+
+			// Disallow copying and moving (worker threads refer to the instance)
+			resolver(const resolver&) = delete;
+			resolver& operator=(const resolver&) = delete;
+			resolver(resolver&&) = delete;
+			resolver& operator=(resolver&&) = delete;
+
+			// Public interface
+			std::shared_future<resolution> resolve(const std::string& hostname, port_number_t port, protocol = protocol::tcp, ip_version = ip_version::any);
+			void resolve(const std::string& hostname, port_number_t port, protocol, ip_version, callback_type);
+
+			std::size_t dispatch();		// Runs completed callbacks, returns the number of callbacks run
+			socket_type notification_handle() const { return _notification[0]; }
+
+			void clear_cache();
+			std::size_t cache_size() const;
+			std::size_t lookups() const;	// Number of getaddrinfo calls made
+
+		private:
+			struct lookup;
+
+			struct cache_entry
+			{
+				resolution result;
+				clock_type::time_point expiry;
+			};
+
+			std::shared_future<resolution> submit(const std::string& hostname, port_number_t, protocol, ip_version, callback_type*);
+			bool cached(const std::string& key, resolution& result);
+			void store(const std::string& key, const resolution& result);
+			void worker();
+			void notify();
+
+		private:
+			resolver_options _options;
+			mutable std::mutex _mutex;
+			std::condition_variable _condition;
+			std::deque<std::shared_ptr<lookup>> _jobs;
+			std::unordered_map<std::string, std::shared_ptr<lookup>> _pending;
+			std::unordered_map<std::string, cache_entry> _cache;
+			std::vector<std::function<void()>> _completions;
+			std::vector<std::thread> _workers;
+			std::size_t _lookups;
+			bool _stopping;
+			socket_type _notification[2];	// Pipe: read end, write end
+	};
+}
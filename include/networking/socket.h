@@ -4,6 +4,7 @@
 #pragma once
 
 #include "networking.h"
+#include "socket_options.h"
 
 namespace networking
 {
@@ -13,6 +14,7 @@ namespace networking
 			// Constructors / destructor
 			socket();
 			socket(protocol, ip_version);
+			socket(protocol, ip_version, const socket_options&, socket_error_information* error = nullptr);
 			explicit socket(socket_type);
 			~socket();
 
@@ -26,6 +28,7 @@ namespace networking
 
 			// Public interface
 			void close();
+			bool set_options(const socket_options&, socket_error_information* error = nullptr);
 			bool valid() const { return is_valid_socket(_socket); }
 			socket_type get() const { return _socket; }
 
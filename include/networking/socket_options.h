@@ -0,0 +1,47 @@
+/////////////////////////////////////////////////////////////////////////
+// Socket tuning options
+//
+// Only options that are set are applied. Options that the platform does
+// not support fail with ENOPROTOOPT. Most options are meant to be applied
+// when the socket is created (socket buffer sizes must be set before
+// connecting or listening to affect the window scale).
+//
+// TCP Fast Open also has to be enabled system-wide on Linux (bit 1 of
+// net.ipv4.tcp_fastopen for clients, bit 2 for servers); without a cookie
+// from the server, the data is sent after a regular handshake.
+//
+// Note: Linux copies socket- and TCP-level options from a listening socket
+//       to the sockets it accepts, except the file status flags
+//       (O_NONBLOCK) and the quick ACK mode.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <chrono>
+#include <optional>
+
+#include "networking.h"
+
+namespace networking
+{
+	struct socket_options
+	{
+		std::optional<bool> no_delay;		// TCP_NODELAY: Disable Nagle's algorithm
+		std::optional<bool> quick_ack;		// TCP_QUICKACK: Acknowledge immediately (Linux, reset by the kernel)
+		std::optional<bool> cork;			// TCP_CORK: Only send full segments until uncorked (Linux)
+		std::optional<int> receive_buffer;	// SO_RCVBUF in bytes
+		std::optional<int> send_buffer;		// SO_SNDBUF in bytes
+		std::optional<int> busy_poll;		// SO_BUSY_POLL in microseconds (Linux)
+		std::optional<int> incoming_cpu;	// SO_INCOMING_CPU (Linux)
+		std::optional<int> defer_accept;	// TCP_DEFER_ACCEPT in seconds, listening sockets only (Linux)
+		std::optional<std::chrono::milliseconds> user_timeout;	// TCP_USER_TIMEOUT (Linux)
+		std::optional<int> fast_open;		// TCP_FASTOPEN: Queue length for connections with SYN data, listening sockets only
+		std::optional<bool> fast_open_connect;	// TCP_FASTOPEN_CONNECT: The first send goes out with the SYN (Linux)
+		std::optional<bool> non_blocking;	// O_NONBLOCK
+
+		bool empty() const;
+		socket_options not_inherited() const;	// The options accepted sockets do not get from their listener
+	};
+
+	// Applies the options that are set, stops at the first failure
+	bool apply_socket_options(socket_type, const socket_options&, socket_error_information* error = nullptr);
+}
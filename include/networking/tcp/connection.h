@@ -5,12 +5,32 @@
 /////////////////////////////////////////////////////////////////////////
 #pragma once
 
+#include <chrono>
+
 #include <networking/socket.h>
 #include <networking/address.h>
+#include <networking/timestamping.h>
 #include <networking/tcp/tcp.h>
 
 namespace networking::tcp
 {
+	// Kernel state of a connection (TCP_INFO), fields the platform does not report are zero
+	struct connection_info
+	{
+		std::chrono::microseconds rtt { 0 };			// Smoothed round-trip time
+		std::chrono::microseconds rtt_variance { 0 };
+		uint32_t congestion_window = 0;		// Segments
+		uint32_t slow_start_threshold = 0;	// Segments
+		uint32_t mss = 0;					// Sending maximum segment size
+		uint32_t unacked = 0;				// Segments in flight
+		uint32_t lost = 0;					// Segments in flight considered lost
+		uint32_t retransmits = 0;			// Segments retransmitted since the connection opened
+		uint32_t not_sent = 0;				// Bytes queued but not sent yet (Linux 4.6)
+		uint64_t delivery_rate = 0;			// Bytes per second, measured over recent acknowledgements (Linux 4.9)
+
+		uint64_t unacked_bytes() const { return static_cast<uint64_t>(unacked) * mss; }	// Estimate
+	};
+
 	class connection
 	{
 		public:
@@ -19,6 +39,9 @@ namespace networking::tcp
 		public:
 			// Constructors / destructor
 			connection(const networking::address& target);
+			connection(const networking::address& target, bool non_blocking, const socket_options& = socket_options {});	// Non-blocking: state is "connecting" until finish_connect
+			connection(const networking::address& target, protocol, bool non_blocking = false, const socket_options& = socket_options {});	// E.g. protocol::seqpacket for Unix domain sockets
+			connection(const networking::address& target, const uint8_t* initial_data, std::size_t size, const socket_options& = socket_options {});	// !! BLOCKING !! TCP Fast Open
 			connection(networking::socket&&, const address&, status = status::open, const socket_error_information& = {0,"No error"});
 			~connection();
 
@@ -31,8 +54,12 @@ namespace networking::tcp
 			connection& operator=(connection&&);
 
 			// Public interface
+			bool finish_connect();	// Completes a non-blocking connect, returns false while still connecting or on error
 			void shutdown();
 			void close();
+			bool set_options(const socket_options&);
+			bool fast_open_accepted() const;	// Whether the server accepted data sent with the SYN
+			bool info(connection_info&) const;	// One getsockopt call, false where TCP_INFO is not available
 			status state() const { return _status; }
 			const address& connected_to() const { return _address; }
 			const networking::socket& socket() const { return _socket; }
@@ -40,13 +67,25 @@ namespace networking::tcp
 
 			// Note: Type ssize_t can be negative (indicating an error)
 			ssize_t receive(uint8_t* buffer, std::size_t buffer_size);
+			ssize_t receive_available(uint8_t* buffer, std::size_t buffer_size);	// Does not block, even on a blocking socket
 			ssize_t send(const uint8_t* buffer, std::size_t number_of_elements_to_send);
 
+			// Kernel timestamps (see timestamping.h)
+			bool enable_timestamping(const timestamp_options& = timestamp_options {});
+			ssize_t receive(uint8_t* buffer, std::size_t buffer_size, packet_timestamps&);
+			bool read_transmit_timestamp(transmit_timestamp&);	// Ids are offsets of the last byte sent since timestamping was enabled
+
+			// Passing sockets to another process (SCM_RIGHTS), on Unix domain connections only
+			// The socket arrives with the first received byte of the data; an invalid socket is received if none was sent.
+			ssize_t send_socket(const networking::socket&, const uint8_t* buffer, std::size_t number_of_elements_to_send);
+			ssize_t receive_socket(networking::socket& received, uint8_t* buffer, std::size_t buffer_size);
+
 		private:
 			networking::address _address;
 			networking::socket _socket;
 			status _status;
 			socket_error_information _error;
+			bool _non_blocking;		// Mode once connected (set through the options)
 	};
 
 	std::ostream& operator<<(std::ostream&, connection::status state);
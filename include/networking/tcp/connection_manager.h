@@ -1,23 +1,103 @@
 /////////////////////////////////////////////////////////////////////////
 // TCP connection manager
 //
-// Handles a collection of connections and listeners.
-// Note: Not thread-safe.
+// Handles a collection of connections and listeners. Connections closed
+// by the peer or by the callback are dropped by update().
+//
+// Note: Not thread-safe, except for the post functions and wake(): other
+//       threads hand over connections, sends and tasks through a lock-free
+//       inbox, which is emptied by update() on the thread running the
+//       manager. Posting wakes up a blocking update() right away.
 /////////////////////////////////////////////////////////////////////////
 #pragma once
 
 #include <vector>
+#include <chrono>
+#include <string>
+#include <memory>
+#include <functional>
 
 #include <networking/networking.h>
+#include <networking/socket_options.h>
 #include <networking/tcp/tcp.h>
+#include <networking/resolver.h>
+#include <metrics/histogram.h>
 
 namespace networking::tcp
 {
+	// Options for outgoing connections made through a connection manager
+	struct connect_options
+	{
+		std::chrono::milliseconds timeout { 10000 };		// For the whole attempt, over all addresses
+		std::chrono::milliseconds attempt_delay { 250 };	// Before racing the next address (RFC 8305 "Happy Eyeballs")
+		socket_options socket;								// Applied to every attempt before connecting
+	};
+
+	struct manager_options
+	{
+		std::size_t accept_budget = 64;	// Connections accepted per listener and update
+
+		// Reading on behalf of a data_read_callback (on_data instead of on_receive), with a budget per connection
+		// and update; connections with data left are continued in the next update.
+		std::size_t read_bytes_budget = 65536;
+		std::size_t read_messages_budget = 16;	// Reads (on_data calls)
+		std::size_t read_block_size = 16384;
+
+		// Adaptive busy polling: for spin_budget after activity, update() polls without a timeout (spinning)
+		// instead of blocking, and falls back to blocking polls once traffic goes quiet. Spinning never extends
+		// update() past its timeout or the next connect or sampling deadline. Zero disables spinning.
+		// Note: Busy polling of the device queues is enabled per socket with socket_options::busy_poll
+		//       (SO_BUSY_POLL), e.g. through the listener's options.
+		std::chrono::microseconds spin_budget { 0 };
+
+		// Sampling the TCP_INFO of every connection from update(), at most once per interval; a blocking update()
+		// returns in time for the next sample. Zero disables sampling.
+		std::chrono::milliseconds info_interval { 0 };
+	};
+
+	// Statistics of one update() call
+	struct update_stats
+	{
+		std::size_t events = 0;		// Ready descriptors reported by poll
+		std::size_t accepted = 0;
+		std::size_t serviced = 0;	// Connections read from (or passed to on_receive)
+		std::size_t messages = 0;	// Reads by the manager
+		std::size_t bytes = 0;		// Bytes read by the manager
+		std::size_t deferred = 0;	// Connections that used up their budget, continued next update
+		std::size_t posted = 0;		// Work taken from the inbox (posted connections, sends and tasks)
+		std::size_t spins = 0;		// Polls without timeout made while spinning
+		bool blocked = false;		// Whether poll waited with a timeout
+		std::chrono::nanoseconds busy { 0 };			// Time spent handling events after poll returned
+		std::chrono::nanoseconds max_service { 0 };	// Longest time spent on one connection
+	};
+
+	// Polling totals since the manager was created, for tuning the spin budget
+	struct poll_counters
+	{
+		uint64_t spins = 0;			// Polls without timeout while spinning
+		uint64_t spin_hits = 0;		// Spinning polls that found events
+		uint64_t sleeps = 0;		// Blocking polls
+		uint64_t sleep_hits = 0;	// Blocking polls that returned events (rather than timing out)
+	};
+
+	// Distributions of the connections' TCP_INFO over all samples, to tell congested or lossy paths
+	// (growing round-trip times, retransmits, small windows) from a slow application
+	struct connection_info_distributions
+	{
+		metrics::histogram rtt;					// Microseconds
+		metrics::histogram rtt_variance;		// Microseconds
+		metrics::histogram congestion_window;	// Segments
+		metrics::histogram unacked;				// Segments in flight
+		metrics::histogram retransmits;			// Per connection, since it opened
+		metrics::histogram delivery_rate;		// Bytes per second
+		uint64_t samples = 0;					// Sampling rounds
+	};
+
 	class connection_manager : public incoming_connection_callback
 	{
 		public:
 			// Constructor / destructor
-			explicit connection_manager(data_received_callback&);
+			explicit connection_manager(data_received_callback&, const manager_options& = manager_options {});
 			~connection_manager();
 
 			// Disallow copying
@@ -30,23 +110,102 @@ namespace networking::tcp
 
 			// incoming_connection_callback interface
 			void on_new_connection(connection&&) override;
+			void on_new_connections(std::vector<connection>&) override;
 
 			// Public interface
-			const listener& add_listener(port_number_t port, bool use_ipv6 = false);
+			const listener& add_listener(port_number_t port, bool use_ipv6 = false, const socket_options& = socket_options {});
 			const listener& add_listener(listener&&);
 
 			void add_connection(connection&& c) { on_new_connection(std::move(c)); };
+			std::size_t connection_count() const;
+
+			// Resolver callbacks are run from update(), which wakes up when lookups complete
+			void attach(resolver&);
+			void detach_resolver();		// Abandons the lookups in flight, their connects fail
+
+			// Non-blocking outgoing connections, completed from update() through the callback
+			// Every address is tried, alternating IPv6 and IPv4, starting a new attempt every attempt_delay
+			// (or as soon as the previous ones failed); the first established connection is kept and managed.
+			connect_id connect(const address& target, connect_callback&, const connect_options& = connect_options {});
+			connect_id connect(std::vector<address> candidates, connect_callback&, const connect_options& = connect_options {});
+			connect_id connect(const std::string& hostname, port_number_t port, connect_callback&, ip_version = ip_version::any, const connect_options& = connect_options {});
+			void cancel_connect(connect_id);
+			std::size_t pending_connects() const { return _connecting.size(); }
 
 			bool update(uint16_t timeout_ms = 500);		// !! BLOCKING, unless timeout is zero !!
+			const update_stats& last_update() const { return _stats; }
+			const poll_counters& counters() const { return _counters; }
+
+			// Samples the TCP_INFO of all open connections now, returns the number sampled
+			std::size_t sample_info();
+			const connection_info_distributions* info_distributions() const { return _info.get(); }	// nullptr until sampled
+
+			// Thread-safe: handled by the next update() on the manager's thread, in the order posted (per thread)
+			// Sends are addressed by the socket of the connection (connection::socket().get()).
+			using task_type = std::function<void(connection_manager&)>;
+			void post_connection(connection&&);
+			void post_send(socket_type, std::vector<uint8_t>&& data);
+			void post(task_type);
+			void wake();	// Interrupts a blocking update()
+
+			// Hot restart: passes the listeners and open connections to a successor process over a Unix domain
+			// connection (SCM_RIGHTS), with their addresses and the state saved by the callback. The listening
+			// sockets stay open throughout, so new connections queue up until the successor accepts them.
+			// On success, this manager holds no listeners or connections; pending connects are not passed on.
+			bool hand_over(connection& channel, handover_callback* = nullptr, socket_error_information* error = nullptr);	// !! BLOCKING !!
+			bool take_over(connection& channel, handover_callback* = nullptr, socket_error_information* error = nullptr);	// !! BLOCKING !!
 
 		private:
+			using clock_type = std::chrono::steady_clock;
+
+			struct pending_connect
+			{
+				connect_id id;
+				connect_callback* callback;
+				std::vector<address> candidates;	// In order of preference
+				std::size_t next_candidate;
+				std::vector<connection> attempts;	// Racing non-blocking connects
+				clock_type::time_point deadline;
+				clock_type::time_point next_attempt;
+				std::chrono::milliseconds attempt_delay;
+				socket_options options;
+				socket_error_information last_error;
+				bool resolving;
+			};
+
+			struct inbox;
+
+			void remove_closed();
 			void setup_pollfd();
+			int poll_timeout(uint16_t timeout_ms) const;
+			pending_connect* find_connect(connect_id);
+			void start_connect(pending_connect&, std::vector<address>&& candidates);
+			void advance_connects();
+			void service(std::size_t index);
+			void run_inbox();
+			int wait_for_events(uint16_t timeout_ms);
 
 		private:
 			std::vector<connection> _connections;
 			std::vector<listener> _listeners;
 			data_received_callback& _callback;
+			data_read_callback* _reader;		// The callback, if the manager reads for it
+			manager_options _options;
 			std::vector<struct pollfd> _pollfd;
+			resolver* _resolver;
+			std::vector<pending_connect> _connecting;
+			connect_id _next_connect_id;
+			std::size_t _polled_connections;		// Number of connections in _pollfd (after the listeners)
+			std::vector<connect_id> _polled_attempts;	// Owner of each attempt in _pollfd (after the connections)
+			std::vector<uint8_t> _read_buffer;
+			std::vector<uint8_t> _deferred;		// Per connection: budget used up with data left
+			std::size_t _deferred_count;
+			update_stats _stats;
+			poll_counters _counters;
+			clock_type::time_point _spin_until;	// End of the spinning period after the last activity
+			std::shared_ptr<inbox> _inbox;		// Stays in place when the manager is moved, pending lookups refer to it weakly
+			std::unique_ptr<connection_info_distributions> _info;
+			clock_type::time_point _next_info_sample;
 			bool _dirty;	// Dirty-flag for changes in _listeners and _connections
 	};
 }
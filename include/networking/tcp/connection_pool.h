@@ -0,0 +1,149 @@
+/////////////////////////////////////////////////////////////////////////
+// TCP client connection pool
+//
+// Keeps warm outgoing connections per backend address and pipelines
+// requests on them: up to max_in_flight requests are written back-to-back
+// on one connection, and responses are matched to requests in the order
+// they were sent. New requests go to the open connection with the fewest
+// requests in flight; another connection is opened while all are busy and
+// the per-address limit allows it, otherwise requests wait in a backlog.
+//
+// The pool runs its own poll loop in update(). Idle connections are
+// closed after idle_timeout, and can be probed with a health check request
+// (supplied by the framing) every health_check_interval.
+//
+// Note: Not thread-safe.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <deque>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <networking/address.h>
+#include <networking/tcp/connection.h>
+#include <containers/flat_hash_map.h>
+
+namespace networking::tcp
+{
+	using request_id = uint64_t;
+
+	// Protocol-specific splitting of the received byte stream into responses
+	class response_framing
+	{
+		public:
+			constexpr static std::size_t invalid_response = static_cast<std::size_t>(-1);
+
+			virtual ~response_framing() {}
+
+			// Length of the first complete response in data, zero if more data is needed, or invalid_response
+			virtual std::size_t response_length(const uint8_t* data, std::size_t size) = 0;
+
+			// Request sent on idle connections to check that the backend still responds (none by default)
+			virtual bool health_check_request(std::vector<uint8_t>&) { return false; }
+	};
+
+	// Callback interface for pooled requests, the response data is only valid during the call
+	class response_callback
+	{
+		public:
+			virtual ~response_callback() {}
+			virtual void on_response(request_id, const uint8_t* data, std::size_t size) = 0;
+			virtual void on_request_failed(request_id, const socket_error_information&) = 0;
+	};
+
+	struct pool_options
+	{
+		std::size_t max_connections_per_address = 4;
+		std::size_t max_in_flight = 16;						// Pipelined requests per connection
+		std::chrono::milliseconds connect_timeout { 5000 };
+		std::chrono::milliseconds idle_timeout { 60000 };		// Idle connections are closed after this
+		std::chrono::milliseconds health_check_interval { 0 };	// Zero disables health checks
+		std::size_t receive_block_size = 16384;
+		socket_options socket;									// Applied to new connections (always non-blocking)
+	};
+
+	class connection_pool
+	{
+		public:
+			using clock_type = std::chrono::steady_clock;
+
+		public:
+			// Constructor / destructor
+			explicit connection_pool(response_framing&, const pool_options& = pool_options {});
+			~connection_pool();
+
+			// Disallow copying and moving (requests refer to the connections)
+			connection_pool(const connection_pool&) = delete;
+			connection_pool& operator=(const connection_pool&) = delete;
+			connection_pool(connection_pool&&) = delete;
+			connection_pool& operator=(connection_pool&&) = delete;
+
+			// Public interface
+			request_id send(const address& target, const uint8_t* data, std::size_t size, response_callback&);
+			request_id send(const address& target, std::vector<uint8_t>&& data, response_callback&);
+
+			bool update(uint16_t timeout_ms = 500);		// !! BLOCKING, unless timeout is zero !!
+			void close(const address& target);			// Closes the connections, failing their requests
+			void clear();
+
+			std::size_t connections(const address& target) const;
+			std::size_t connections() const;
+			std::size_t in_flight() const;
+			std::size_t backlog() const;
+
+		private:
+			struct pending_request
+			{
+				request_id id;				// Zero for health checks
+				response_callback* callback;
+			};
+
+			struct queued_request
+			{
+				request_id id;
+				response_callback* callback;
+				std::vector<uint8_t> data;
+			};
+
+			struct pooled_connection
+			{
+				connection socket;
+				std::deque<pending_request> in_flight;
+				std::vector<uint8_t> outgoing;
+				std::size_t outgoing_offset;
+				std::vector<uint8_t> incoming;
+				clock_type::time_point deadline;	// Connect timeout, or health check response timeout
+				clock_type::time_point last_used;		// Last request
+				clock_type::time_point last_checked;	// Last response (or health check)
+				bool probing;
+				socket_error_information error;
+			};
+
+			struct backend
+			{
+				address target;
+				std::vector<std::unique_ptr<pooled_connection>> connections;
+				std::deque<queued_request> backlog;
+				std::size_t next;	// Round-robin start for picking a connection
+			};
+
+			backend& backend_for(const address&);
+			pooled_connection* pick(backend&);
+			void enqueue(pooled_connection&, request_id, response_callback*, const uint8_t* data, std::size_t size);
+			bool flush(pooled_connection&);
+			bool receive(pooled_connection&);
+			void mark_failed(pooled_connection&, const socket_error_information&);
+			void maintain(clock_type::time_point now);
+			int poll_timeout(uint16_t timeout_ms, clock_type::time_point now) const;
+
+		private:
+			response_framing& _framing;
+			pool_options _options;
+			utility::flat_hash_map<address, backend> _backends;	// Also Unix domain and scoped IPv6 targets
+			std::vector<pollfd> _pollfd;
+			std::vector<pooled_connection*> _polled;	// Connection of each entry in _pollfd
+			request_id _next_request_id;
+	};
+}
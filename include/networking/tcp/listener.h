@@ -5,6 +5,8 @@
 /////////////////////////////////////////////////////////////////////////
 #pragma once
 
+#include <vector>
+
 #include <networking/socket.h>
 #include <networking/address.h>
 #include <networking/tcp/tcp.h>
@@ -18,7 +20,9 @@ namespace networking::tcp
 
 		public:
 			// Constructors / destructor
-			listener(incoming_connection_callback&, port_number_t port, bool use_ipv6 = false);
+			listener(incoming_connection_callback&, port_number_t port, bool use_ipv6 = false, const socket_options& = socket_options {});
+			listener(incoming_connection_callback&, const address& local, protocol = protocol::tcp, const socket_options& = socket_options {});
+			listener(incoming_connection_callback&, networking::socket&&, const address& local, status, const socket_options& = socket_options {});	// Takes over a bound or listening socket
 			~listener();
 
 			// Disallow copying
@@ -32,13 +36,20 @@ namespace networking::tcp
 			// Public interface
 			bool start(uint16_t queue_length = 10);
 			void stop();
+			void release();		// Closes the socket, but leaves it listening elsewhere (e.g. after a hot restart hand-over)
 			bool accept();									// !! BLOCKING !!
 			bool poll_accept(uint16_t timeout_ms = 500);	// !! BLOCKING, unless timeout is zero !!
+			std::size_t accept_all(std::size_t budget = 64);	// Drains the accept queue, the socket should be non-blocking
 
 			status state() const { return _status; }
 			const networking::socket& socket() const { return _socket; }
 			const socket_error_information& error() const { return _error; }
-			const address& bound_address() const { return _address; }
+			const address& bound_address() const { return _address; }	// With the port chosen by the system when bound to port zero
+			const socket_options& options() const { return _options; }	// Also used for accepted connections
+
+		private:
+			void hand_over(socket_type client_socket, const address& client_address);
+			connection make_connection(socket_type client_socket, const address& client_address, const socket_options&);
 
 		private:
 			networking::socket _socket;
@@ -46,6 +57,9 @@ namespace networking::tcp
 			socket_error_information _error;
 			incoming_connection_callback& _callback;
 			address _address;
+			socket_options _options;
+			socket_options _accepted_options;	// Applied to accepted connections (not copied by the kernel)
+			std::vector<connection> _batch;		// Reused by accept_all
 	};
 
 	std::ostream& operator<<(std::ostream&, listener::status state);
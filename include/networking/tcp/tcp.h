@@ -3,8 +3,11 @@
 /////////////////////////////////////////////////////////////////////////
 #pragma once
 
+#include <vector>
 #include <cstdint>
 
+#include <networking/networking.h>
+
 namespace networking::tcp
 {
 	// Class prototypes
@@ -25,6 +28,7 @@ namespace networking::tcp
 	enum class connection_status
 	{
 		invalid,
+		connecting,	// Non-blocking connect in progress
 		open,
 		shutdown,
 		closed,
@@ -37,6 +41,19 @@ namespace networking::tcp
 		public:
 			virtual ~incoming_connection_callback() {}
 			virtual void on_new_connection(connection&&) = 0;
+			virtual void on_new_connections(std::vector<connection>& batch);	// Defaults to on_new_connection for each
+	};
+
+	// Identifies an outgoing connection attempt made through a connection manager
+	using connect_id = uint64_t;
+
+	// Callback interface for outgoing connection attempts
+	class connect_callback
+	{
+		public:
+			virtual ~connect_callback() {}
+			virtual void on_connected(connect_id, connection& established) = 0;
+			virtual void on_connect_failed(connect_id, const socket_error_information&) = 0;
 	};
 
 	// Callback interface for receiving data
@@ -44,6 +61,25 @@ namespace networking::tcp
 	{
 		public:
 			virtual ~data_received_callback() {}
-			virtual void on_receive(connection& ready) = 0;
+			virtual void on_receive(connection&) = 0;	// The connection is readable, the callback reads
+	};
+
+	// Callback interface for receiving data read by the connection manager, within its read budgets
+	// Note: A connection manager given this callback reads for it, on_receive is not called.
+	class data_read_callback : public data_received_callback
+	{
+		public:
+			void on_receive(connection&) final {}
+			virtual void on_data(connection&, const uint8_t*, std::size_t) = 0;
+			virtual void on_closed(connection&) {}		// Closed by the peer (or failed), the manager drops it afterwards
+	};
+
+	// Callback interface for hot restarts, carrying application state (e.g. partially received requests) with each connection
+	class handover_callback
+	{
+		public:
+			virtual ~handover_callback() {}
+			virtual void save_state(const connection&, std::vector<uint8_t>&) {}		// In the process handing over
+			virtual void restore_state(connection&, const uint8_t*, std::size_t) {}	// In the process taking over
 	};
 }
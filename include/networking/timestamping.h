@@ -0,0 +1,73 @@
+/////////////////////////////////////////////////////////////////////////
+// Packet timestamps
+//
+// The kernel can stamp packets when they arrive (before they are queued
+// on the socket) and when they leave, so the time data spends in socket
+// buffers can be measured. Receive timestamps are delivered with the data
+// as control messages; transmit timestamps are queued on the socket's
+// error queue and read separately, identified by a counter (datagrams
+// sent for UDP, the offset of the last byte of a send for TCP).
+//
+// Software timestamps (CLOCK_REALTIME) work on every interface, including
+// loopback; hardware timestamps require NIC support and configuring the
+// device (SIOCSHWTSTAMP), which is outside the scope of this library.
+//
+// Uses SO_TIMESTAMPING on Linux, and falls back to SO_TIMESTAMPNS (receive
+// timestamps only) where it is not available.
+//
+// Note: For TCP, a receive timestamp belongs to the last segment that
+//       contributed to the data read.
+// Note: Linux turns receive timestamping on asynchronously when the first
+//       socket asks for it, so the first packets may arrive without one.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "networking.h"
+
+namespace networking
+{
+	struct timestamp_options
+	{
+		bool receive = true;		// Stamp arriving packets
+		bool transmit = false;		// Report when data was passed to the device
+		bool acknowledged = false;	// Report when the peer acknowledged the data (TCP)
+		bool hardware = false;		// Also request NIC timestamps
+	};
+
+	// Timestamps of received data, zero where none was provided
+	struct packet_timestamps
+	{
+		std::chrono::nanoseconds software { 0 };	// CLOCK_REALTIME
+		std::chrono::nanoseconds hardware { 0 };	// NIC clock
+
+		bool valid() const { return software.count() != 0 || hardware.count() != 0; }
+		std::chrono::nanoseconds age() const;		// Time since the software timestamp
+	};
+
+	enum class transmit_stage
+	{
+		scheduled,		// Entered the packet scheduler
+		sent,			// Passed to the device
+		acknowledged	// Acknowledged by the peer (TCP)
+	};
+
+	struct transmit_timestamp
+	{
+		uint32_t id;			// Datagram number (UDP) or offset of the last byte (TCP), from 0
+		transmit_stage stage;
+		packet_timestamps time;
+	};
+
+	// Enables timestamping on a socket, fails with ENOPROTOOPT where unsupported
+	bool enable_timestamping(socket_type, const timestamp_options&, socket_error_information* error = nullptr);
+
+	// Receives data with its timestamps (recvmsg), the sender is provided if source is set
+	// The delay between the software timestamp and the return is recorded in the packet probes (see metrics/probes.h)
+	ssize_t receive_with_timestamps(socket_type, uint8_t* buffer, std::size_t buffer_size, int flags, packet_timestamps&, sockaddr_storage* source = nullptr, socklen_t* source_length = nullptr);
+
+	// Reads the next transmit timestamp from the error queue, returns false if there is none
+	bool read_transmit_timestamp(socket_type, transmit_timestamp&);
+}
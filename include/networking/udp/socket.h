@@ -5,6 +5,8 @@
 
 #include <networking/socket.h>
 #include <networking/address.h>
+#include <networking/endpoint.h>
+#include <networking/timestamping.h>
 #include <networking/udp/udp.h>
 
 namespace networking::udp
@@ -17,6 +19,7 @@ namespace networking::udp
 		public:
 			// Constructors / destructor
 			socket();
+			explicit socket(ip_version);	// ip_version::local for Unix domain datagram sockets
 			~socket();
 
 			// Disallow copying
@@ -30,7 +33,9 @@ namespace networking::udp
 			// Public interface
 			bool bind(const networking::address& target);
 			void close();
+			bool set_options(const socket_options&);	// E.g. non_blocking, records the error on failure
 			bool valid() { return _socket.valid(); }
+			socket_type handle() const { return _socket.get(); }	// For polling
 			const address& bound_to() const { return _boundAddress; }
 			status state() const { return _status; }
 			const socket_error_information& error() const { return _error; }
@@ -39,6 +44,15 @@ namespace networking::udp
 			ssize_t receive_from(uint8_t* buffer, std::size_t buffer_size, networking::address& target) const;
 			ssize_t send_to(const uint8_t* buffer, std::size_t number_of_elements_to_send, const networking::address& target) const;
 
+			// Variants using the compact endpoint type (e.g. for per-peer tables)
+			ssize_t receive_from(uint8_t* buffer, std::size_t buffer_size, networking::endpoint& target) const;
+			ssize_t send_to(const uint8_t* buffer, std::size_t number_of_elements_to_send, const networking::endpoint& target) const;
+
+			// Kernel timestamps (see timestamping.h)
+			bool enable_timestamping(const timestamp_options& = timestamp_options {});
+			ssize_t receive_from(uint8_t* buffer, std::size_t buffer_size, networking::address& target, packet_timestamps&) const;
+			bool read_transmit_timestamp(transmit_timestamp&) const;	// Ids count the datagrams sent since timestamping was enabled
+
 		private:
 			networking::socket _socket;
 			address _boundAddress;
@@ -13,6 +13,16 @@ namespace bytes
 	{
 	}
 
+	// Constructor (zero-filled)
+	buffer::buffer(std::size_t size) : _buffer(size)
+	{
+	}
+
+	// Constructor (adopts the vector)
+	buffer::buffer(std::vector<uint8_t>&& data) : _buffer(std::move(data))
+	{
+	}
+
 	// Destructor
 	buffer::~buffer()
 	{
@@ -56,4 +66,24 @@ namespace bytes
 	{
 		_buffer.reserve(size);
 	}
+
+	// Change the size, zero-filling new bytes
+	void buffer::resize(std::size_t size)
+	{
+		_buffer.resize(size);
+	}
+
+	// Append bytes at the end
+	void buffer::append(const uint8_t* data, std::size_t size)
+	{
+		_buffer.insert(_buffer.end(), data, data + size);
+	}
+
+	// Hand over the storage without copying
+	std::vector<uint8_t> buffer::release()
+	{
+		auto result = std::move(_buffer);
+		_buffer.clear();
+		return result;
+	}
 }
@@ -0,0 +1,312 @@
+/////////////////////////////////////////////////////////////////////////
+// Byte chain implementation
+/////////////////////////////////////////////////////////////////////////
+#include <bytes/chain.h>
+#include <bytes/buffer.h>
+
+#include <algorithm>
+
+namespace bytes
+{
+	// ----------------------------------------------------------------------
+	// Constructors / destructor
+	// ----------------------------------------------------------------------
+	// Constructor
+	chain::chain() : _segments(), _size(0), _origin(0)
+	{
+	}
+
+	// Constructor (copies the data)
+	chain::chain(const uint8_t* data, std::size_t size) : chain(std::vector<uint8_t>(data, data + size))
+	{
+	}
+
+	// Constructor (adopts the vector)
+	chain::chain(std::vector<uint8_t>&& data) : _segments(), _size(0), _origin(0)
+	{
+		const auto size = data.size();
+		if(size > 0)
+			_segments.push_back({ std::make_shared<const std::vector<uint8_t>>(std::move(data)), 0, size, 0 });
+		_size = size;
+	}
+
+	// Constructor (adopts the buffer storage)
+	chain::chain(buffer&& b) : chain(b.release())
+	{
+	}
+
+	// Constructor (view into an existing slab)
+	chain::chain(slab s, std::size_t offset, std::size_t length) : _segments(), _size(0), _origin(0)
+	{
+		if(s && offset < s->size() && length > 0)
+		{
+			length = std::min(length, s->size() - offset);
+			_segments.push_back({ std::move(s), offset, length, 0 });
+			_size = length;
+		}
+	}
+
+	// Destructor
+	chain::~chain()
+	{
+	}
+
+	// ----------------------------------------------------------------------
+	// Copy construction / assignment
+	// ----------------------------------------------------------------------
+	// Copy-construction
+	chain::chain(const chain& c) : _segments(c._segments), _size(c._size), _origin(c._origin)
+	{
+	}
+
+	// Copy-assignment
+	chain& chain::operator=(const chain& c)
+	{
+		_segments = c._segments;
+		_size = c._size;
+		_origin = c._origin;
+		return *this;
+	}
+
+	// ----------------------------------------------------------------------
+	// Move construction / assignment
+	// ----------------------------------------------------------------------
+	// Move-construction
+	chain::chain(chain&& c) : _segments(std::move(c._segments)), _size(c._size), _origin(c._origin)
+	{
+		c.clear();
+	}
+
+	// Move-assignment
+	chain& chain::operator=(chain&& c)
+	{
+		_segments = std::move(c._segments);
+		_size = c._size;
+		_origin = c._origin;
+		c.clear();
+		return *this;
+	}
+
+	// ----------------------------------------------------------------------
+	// Public interface
+	// ----------------------------------------------------------------------
+	// Append the segments of another chain, taking them over
+	void chain::append(chain&& c)
+	{
+		if(_segments.empty())
+		{
+			*this = std::move(c);
+			return;
+		}
+
+		for(auto& s : c._segments)
+			push_back(std::move(s));
+		c.clear();
+	}
+
+	// Append the segments of another chain, sharing the slabs
+	void chain::append(const chain& c)
+	{
+		for(const auto& s : c._segments)
+			push_back(s);
+	}
+
+	// Prepend the segments of another chain, taking them over
+	void chain::prepend(chain&& c)
+	{
+		if(_segments.empty())
+		{
+			*this = std::move(c);
+			return;
+		}
+
+		for(auto i = c._segments.rbegin(); i != c._segments.rend(); i++)
+			push_front(std::move(*i));
+		c.clear();
+	}
+
+	// Prepend the segments of another chain, sharing the slabs
+	void chain::prepend(const chain& c)
+	{
+		for(auto i = c._segments.crbegin(); i != c._segments.crend(); i++)
+			push_front(*i);
+	}
+
+	// Drop bytes from the front
+	void chain::trim_front(std::size_t n)
+	{
+		n = std::min(n, _size);
+		_size -= n;
+		_origin += n;
+
+		while(n > 0)
+		{
+			auto& front = _segments.front();
+			if(front.length > n)
+			{
+				front.offset += n;
+				front.length -= n;
+				front.position += n;
+				return;
+			}
+
+			n -= front.length;
+			_segments.pop_front();
+		}
+	}
+
+	// Drop bytes from the back
+	void chain::trim_back(std::size_t n)
+	{
+		n = std::min(n, _size);
+		_size -= n;
+
+		while(n > 0)
+		{
+			auto& back = _segments.back();
+			if(back.length > n)
+			{
+				back.length -= n;
+				return;
+			}
+
+			n -= back.length;
+			_segments.pop_back();
+		}
+	}
+
+	// Split the chain, returning the first part and keeping the rest
+	chain chain::split(std::size_t offset)
+	{
+		offset = std::min(offset, _size);
+		if(offset == _size)
+			return std::move(*this);
+
+		chain result;
+		if(offset == 0)
+			return result;
+
+		// The segments before the one containing offset move over whole (keeping their positions), that one is shared
+		const auto index = find_segment(offset);
+		auto& boundary = _segments[index];
+		const auto head = offset - (boundary.position - _origin);
+
+		result._segments.insert(result._segments.end(), std::make_move_iterator(_segments.begin()), std::make_move_iterator(_segments.begin() + static_cast<std::ptrdiff_t>(index)));
+		if(head > 0)
+		{
+			result._segments.push_back({ boundary.storage, boundary.offset, head, boundary.position });
+			boundary.offset += head;
+			boundary.length -= head;
+			boundary.position += head;
+		}
+		result._size = offset;
+		result._origin = _origin;
+
+		_segments.erase(_segments.begin(), _segments.begin() + static_cast<std::ptrdiff_t>(index));
+		_size -= offset;
+		_origin += offset;
+		return result;
+	}
+
+	// Provide a chain sharing a part of this chain's slabs
+	chain chain::slice(std::size_t offset, std::size_t length) const
+	{
+		chain result;
+		if(offset >= _size || length == 0)
+			return result;
+
+		length = std::min(length, _size - offset);
+		auto index = find_segment(offset);
+		offset -= _segments[index].position - _origin;
+		for( ; length > 0; index++)
+		{
+			const auto& s = _segments[index];
+			const auto part = std::min(length, s.length - offset);
+			result.push_back({ s.storage, s.offset + offset, part, 0 });
+			length -= part;
+			offset = 0;
+		}
+
+		return result;
+	}
+
+	// Release all segments
+	void chain::clear()
+	{
+		_segments.clear();
+		_size = 0;
+		_origin = 0;
+	}
+
+	// Copy the content to contiguous memory, returns the number of bytes copied
+	std::size_t chain::copy_to(uint8_t* destination, std::size_t destination_size) const
+	{
+		std::size_t copied = 0;
+		for(auto i = _segments.cbegin(); i != _segments.cend() && copied < destination_size; i++)
+		{
+			const auto part = std::min(i->length, destination_size - copied);
+			std::copy(i->data(), i->data() + part, destination + copied);
+			copied += part;
+		}
+
+		return copied;
+	}
+
+	// Copy the content to a new vector
+	std::vector<uint8_t> chain::flatten() const
+	{
+		std::vector<uint8_t> result(_size);
+		copy_to(result.data(), result.size());
+		return result;
+	}
+
+#ifdef USE_POSIX
+	// Export the segments for scatter-gather I/O (e.g. writev/sendmsg)
+	std::size_t chain::to_iovec(struct iovec* destination, std::size_t max_entries) const
+	{
+		std::size_t n = 0;
+		for(auto i = _segments.cbegin(); i != _segments.cend() && n < max_entries; i++, n++)
+		{
+			destination[n].iov_base = const_cast<uint8_t*>(i->data());
+			destination[n].iov_len = i->length;
+		}
+
+		return n;
+	}
+
+	std::vector<struct iovec> chain::to_iovec() const
+	{
+		std::vector<struct iovec> result(_segments.size());
+		to_iovec(result.data(), result.size());
+		return result;
+	}
+#endif
+
+	// ----------------------------------------------------------------------
+	// Private helpers
+	// ----------------------------------------------------------------------
+	// Binary search over the positions (relative to the origin, so wrapping around does not matter)
+	std::size_t chain::find_segment(std::size_t offset) const
+	{
+		const auto origin = _origin;
+		const auto after = std::upper_bound(_segments.cbegin(), _segments.cend(), offset, [origin](std::size_t o, const segment& s) { return o < s.position - origin; });
+		return static_cast<std::size_t>(after - _segments.cbegin()) - 1;
+	}
+
+	// Adds a segment at the end, positioned after the last byte
+	void chain::push_back(segment s)
+	{
+		s.position = _origin + _size;
+		_size += s.length;
+		_segments.push_back(std::move(s));
+	}
+
+	// Adds a segment at the front, positioned before the first byte
+	void chain::push_front(segment s)
+	{
+		_origin -= s.length;
+		s.position = _origin;
+		_size += s.length;
+		_segments.push_front(std::move(s));
+	}
+}
@@ -0,0 +1,392 @@
+/////////////////////////////////////////////////////////////////////////
+// LZ compression implementation
+/////////////////////////////////////////////////////////////////////////
+#include <bytes/compression.h>
+
+#include <vector>
+#include <cstring>
+
+namespace bytes
+{
+	namespace
+	{
+		constexpr std::size_t min_match = 4;
+		constexpr std::size_t last_literals = 5;		// The last bytes are always literals
+		constexpr std::size_t match_find_limit = 12;	// No match may start in the last bytes
+		constexpr std::size_t max_offset = 65535;
+		constexpr uint32_t max_hash_log = 12;
+		constexpr uint32_t min_hash_log = 8;
+		constexpr std::size_t wild_copy_length = 16;
+
+		enum class stream_format : uint8_t
+		{
+			stored = 0,
+			lz = 1,
+		};
+
+		inline uint32_t read32(const uint8_t* p)
+		{
+			uint32_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return value;
+		}
+
+		inline uint64_t read64(const uint8_t* p)
+		{
+			uint64_t value;
+			std::memcpy(&value, p, sizeof(value));
+			return value;
+		}
+
+		inline uint32_t hash(uint32_t sequence, uint32_t hash_log)
+		{
+			return (sequence * 2654435761U) >> (32 - hash_log);
+		}
+
+		// Number of equal bytes at a and b, not reading beyond limit (relative to a)
+		inline std::size_t count_match(const uint8_t* a, const uint8_t* b, const uint8_t* limit)
+		{
+			const auto start = a;
+			while(a + 8 <= limit)
+			{
+				const auto difference = read64(a) ^ read64(b);
+				if(difference != 0)
+				{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+					return (a - start) + (__builtin_clzll(difference) >> 3);
+#else
+					return (a - start) + (__builtin_ctzll(difference) >> 3);
+#endif
+				}
+				a += 8;
+				b += 8;
+			}
+
+			while(a < limit && *a == *b)
+			{
+				a++;
+				b++;
+			}
+			return a - start;
+		}
+
+		// Writes a length continuation (after the 15 in the token nibble)
+		inline uint8_t* write_length(uint8_t* op, std::size_t length)
+		{
+			for( ; length >= 255; length -= 255)
+				*op++ = 255;
+			*op++ = static_cast<uint8_t>(length);
+			return op;
+		}
+
+		// Writes a sequence of literals optionally followed by a match, returns nullptr if out of space
+		inline uint8_t* write_sequence(uint8_t* op, const uint8_t* oend, const uint8_t* literals, std::size_t literal_length, std::size_t offset, std::size_t match_length)
+		{
+			// Worst case: token + literal length + literals + offset + match length
+			if(static_cast<std::size_t>(oend - op) < 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1)
+				return nullptr;
+
+			auto token = op++;
+			if(literal_length >= 15)
+			{
+				*token = 15 << 4;
+				op = write_length(op, literal_length - 15);
+			}
+			else
+			{
+				*token = static_cast<uint8_t>(literal_length << 4);
+			}
+
+			std::memcpy(op, literals, literal_length);
+			op += literal_length;
+
+			if(offset == 0)
+				return op;
+
+			*op++ = static_cast<uint8_t>(offset);
+			*op++ = static_cast<uint8_t>(offset >> 8);
+
+			const auto ml = match_length - min_match;
+			if(ml >= 15)
+			{
+				*token |= 15;
+				op = write_length(op, ml - 15);
+			}
+			else
+			{
+				*token |= static_cast<uint8_t>(ml);
+			}
+
+			return op;
+		}
+
+		// Greedy single-probe matcher; position_type must hold every position in the input
+		template <typename position_type>
+		std::size_t compress_block(const uint8_t* source, std::size_t size, uint8_t* destination, std::size_t capacity, uint32_t hash_log)
+		{
+			position_type table[1U << max_hash_log];
+			std::memset(table, 0, sizeof(position_type) << hash_log);
+
+			const uint8_t* ip = source;
+			const uint8_t* anchor = source;
+			const uint8_t* const iend = source + size;
+			uint8_t* op = destination;
+			const uint8_t* const oend = destination + capacity;
+
+			if(size >= match_find_limit + 1)
+			{
+				const uint8_t* const mflimit = iend - match_find_limit;
+				const uint8_t* const matchlimit = iend - last_literals;
+
+				table[hash(read32(ip), hash_log)] = 0;
+				ip++;
+
+				while(ip <= mflimit)
+				{
+					// Find a match, skipping ahead faster the longer nothing is found
+					const uint8_t* match = nullptr;
+					std::size_t attempts = 1 << 6;
+					while(true)
+					{
+						const auto h = hash(read32(ip), hash_log);
+						match = source + table[h];
+						table[h] = static_cast<position_type>(ip - source);
+
+						if(match < ip && static_cast<std::size_t>(ip - match) <= max_offset && read32(match) == read32(ip))
+							break;
+
+						ip += attempts++ >> 6;
+						if(ip > mflimit)
+							goto literals_only;
+					}
+
+					// Extend the match backwards
+					while(ip > anchor && match > source && ip[-1] == match[-1])
+					{
+						ip--;
+						match--;
+					}
+
+					const auto match_length = min_match + count_match(ip + min_match, match + min_match, matchlimit);
+					op = write_sequence(op, oend, anchor, ip - anchor, ip - match, match_length);
+					if(op == nullptr)
+						return 0;
+
+					ip += match_length;
+					anchor = ip;
+
+					// Fill the table with a position inside the match
+					if(ip <= mflimit)
+						table[hash(read32(ip - 2), hash_log)] = static_cast<position_type>(ip - 2 - source);
+				}
+			}
+
+		literals_only:
+			op = write_sequence(op, oend, anchor, iend - anchor, 0, 0);
+			if(op == nullptr)
+				return 0;
+
+			return op - destination;
+		}
+
+		uint32_t select_hash_log(std::size_t size)
+		{
+			uint32_t log = min_hash_log;
+			while(log < max_hash_log && (std::size_t(1) << log) < size)
+				log++;
+			return log;
+		}
+
+		// Scratch storage swapped with the buffer storage to avoid allocations per message
+		std::vector<uint8_t>& scratch()
+		{
+			static thread_local std::vector<uint8_t> storage;
+			return storage;
+		}
+
+		void write_header(uint8_t* p, stream_format format, uint32_t size)
+		{
+			p[0] = static_cast<uint8_t>(format);
+			p[1] = static_cast<uint8_t>(size);
+			p[2] = static_cast<uint8_t>(size >> 8);
+			p[3] = static_cast<uint8_t>(size >> 16);
+			p[4] = static_cast<uint8_t>(size >> 24);
+		}
+	}
+
+	// ----------------------------------------------------------------------
+	// Compression functions
+	// ----------------------------------------------------------------------
+	std::size_t lz_compress(const uint8_t* source, std::size_t size, uint8_t* destination, std::size_t capacity)
+	{
+		const auto hash_log = select_hash_log(size);
+		if(size <= 0xFFFF)
+			return compress_block<uint16_t>(source, size, destination, capacity, hash_log);
+		return compress_block<uint32_t>(source, size, destination, capacity, hash_log);
+	}
+
+	bool lz_decompress(const uint8_t* source, std::size_t size, uint8_t* destination, std::size_t original_size)
+	{
+		const uint8_t* ip = source;
+		const uint8_t* const iend = source + size;
+		uint8_t* op = destination;
+		uint8_t* const oend = destination + original_size;
+
+		while(ip < iend)
+		{
+			const auto token = *ip++;
+
+			// Literals
+			std::size_t literal_length = token >> 4;
+			if(literal_length == 15)
+			{
+				uint8_t b;
+				do
+				{
+					if(ip >= iend)
+						return false;
+					b = *ip++;
+					literal_length += b;
+				} while(b == 255);
+			}
+
+			if(static_cast<std::size_t>(iend - ip) < literal_length || static_cast<std::size_t>(oend - op) < literal_length)
+				return false;
+
+			// Short literals are copied with a fixed-size (inlined) copy when there is room to overshoot
+			if(literal_length <= wild_copy_length && iend - ip >= static_cast<std::ptrdiff_t>(wild_copy_length) && oend - op >= static_cast<std::ptrdiff_t>(wild_copy_length))
+				std::memcpy(op, ip, wild_copy_length);
+			else
+				std::memcpy(op, ip, literal_length);
+			ip += literal_length;
+			op += literal_length;
+
+			// The last sequence has no match
+			if(ip == iend)
+				break;
+
+			// Match
+			if(iend - ip < 2)
+				return false;
+			const std::size_t offset = ip[0] | (ip[1] << 8);
+			ip += 2;
+			if(offset == 0 || offset > static_cast<std::size_t>(op - destination))
+				return false;
+
+			std::size_t match_length = token & 15;
+			if(match_length == 15)
+			{
+				uint8_t b;
+				do
+				{
+					if(ip >= iend)
+						return false;
+					b = *ip++;
+					match_length += b;
+				} while(b == 255);
+			}
+			match_length += min_match;
+
+			if(static_cast<std::size_t>(oend - op) < match_length)
+				return false;
+
+			const uint8_t* match = op - offset;
+			if(offset >= 8 && static_cast<std::size_t>(oend - op) >= match_length + 8)
+			{
+				// Copy in eight-byte steps (may overshoot), each step only reads bytes already written
+				const auto end = op + match_length;
+				for( ; op < end; op += 8, match += 8)
+					std::memcpy(op, match, 8);
+				op = end;
+			}
+			else if(offset >= match_length)
+			{
+				std::memcpy(op, match, match_length);
+				op += match_length;
+			}
+			else
+			{
+				// Overlapping copy (repeated pattern)
+				for(const auto end = op + match_length; op < end; )
+					*op++ = *match++;
+			}
+		}
+
+		return op == oend;
+	}
+
+	// ----------------------------------------------------------------------
+	// Byte strategies
+	// ----------------------------------------------------------------------
+	// The results are copied into the buffer's own storage, so neither the buffer nor the scratch space
+	// gives up its capacity: once both have grown to the message size, messages do not allocate
+	buffer& lz_compress_strategy::apply(buffer& b)
+	{
+		const auto size = b.size();
+		auto& output = scratch();
+		if(output.size() < lz_compress_bound(size))
+			output.resize(lz_compress_bound(size));
+
+		const auto compressed_size = lz_compress(b.get(), size, output.data(), output.size());
+		if(compressed_size == 0 || compressed_size >= size)
+		{
+			// Not worth it, store the input as it is (moved behind the header)
+			b.resize(lz_header_size + size);
+			std::memmove(b.get() + lz_header_size, b.get(), size);
+			write_header(b.get(), stream_format::stored, static_cast<uint32_t>(size));
+			return b;
+		}
+
+		b.resize(lz_header_size + compressed_size);
+		std::memcpy(b.get() + lz_header_size, output.data(), compressed_size);
+		write_header(b.get(), stream_format::lz, static_cast<uint32_t>(size));
+		return b;
+	}
+
+	buffer& lz_decompress_strategy::apply(buffer& b)
+	{
+		if(b.size() < lz_header_size)
+		{
+			b.resize(0);
+			return b;
+		}
+
+		const auto* input = b.get();
+		const auto format = static_cast<stream_format>(input[0]);
+		const std::size_t original_size = uint32_t(input[1]) | (uint32_t(input[2]) << 8) | (uint32_t(input[3]) << 16) | (uint32_t(input[4]) << 24);
+		const auto payload_size = b.size() - lz_header_size;
+
+		// Every payload byte expands to at most 255 output bytes, reject headers claiming more
+		bool valid = (original_size / 255 <= payload_size);
+		if(valid && format == stream_format::stored)
+		{
+			valid = (payload_size == original_size);
+			if(valid)
+			{
+				std::memmove(b.get(), b.get() + lz_header_size, payload_size);
+				b.resize(payload_size);
+			}
+		}
+		else if(valid && format == stream_format::lz)
+		{
+			auto& output = scratch();
+			if(output.size() < original_size)
+				output.resize(original_size);
+
+			valid = lz_decompress(input + lz_header_size, payload_size, output.data(), original_size);
+			if(valid)
+			{
+				b.resize(original_size);
+				std::memcpy(b.get(), output.data(), original_size);
+			}
+		}
+		else
+		{
+			valid = false;
+		}
+
+		if(!valid)
+			b.resize(0);
+		return b;
+	}
+}
@@ -0,0 +1,298 @@
+/////////////////////////////////////////////////////////////////////////
+// CRC32C implementation
+//
+// The hardware version follows the approach of Mark Adler's crc32c.c:
+// three crc32 instruction streams run in parallel on adjacent blocks, and
+// the partial results are combined by shifting them over the length of
+// the following blocks with precomputed "zeros" tables.
+/////////////////////////////////////////////////////////////////////////
+#include <bytes/crc32c.h>
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define UTILITYLIB_CRC32C_SSE42
+#include <nmmintrin.h>
+#endif
+
+namespace bytes
+{
+	namespace
+	{
+		// Reflected Castagnoli polynomial
+		constexpr uint32_t polynomial = 0x82F63B78;
+
+		using crc_table = std::array<std::array<uint32_t, 256>, 8>;
+
+		// Tables for slicing-by-8
+		constexpr crc_table make_slicing_table()
+		{
+			crc_table table {};
+			for(uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t crc = n;
+				for(int k = 0; k < 8; k++)
+					crc = (crc & 1) ? (crc >> 1) ^ polynomial : crc >> 1;
+				table[0][n] = crc;
+			}
+
+			for(uint32_t n = 0; n < 256; n++)
+			{
+				for(std::size_t k = 1; k < 8; k++)
+					table[k][n] = (table[k - 1][n] >> 8) ^ table[0][table[k - 1][n] & 0xFF];
+			}
+
+			return table;
+		}
+
+		constexpr crc_table slicing_table = make_slicing_table();
+
+		inline uint64_t load_little_endian(const uint8_t* p)
+		{
+			uint64_t value;
+			std::memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+			value = __builtin_bswap64(value);
+#endif
+			return value;
+		}
+
+#ifdef UTILITYLIB_CRC32C_SSE42
+		// Block lengths for the three-way interleaved hardware implementation
+		constexpr std::size_t long_block = 8192;
+		constexpr std::size_t short_block = 256;
+
+		// Operator (32x32 GF(2) matrix) application
+		uint32_t gf2_matrix_times(const uint32_t* matrix, uint32_t vector)
+		{
+			uint32_t sum = 0;
+			for( ; vector != 0; vector >>= 1, matrix++)
+			{
+				if(vector & 1)
+					sum ^= *matrix;
+			}
+			return sum;
+		}
+
+		void gf2_matrix_square(uint32_t* square, const uint32_t* matrix)
+		{
+			for(int n = 0; n < 32; n++)
+				square[n] = gf2_matrix_times(matrix, matrix[n]);
+		}
+
+		// Tables shifting a crc over "length" zero bytes, one table per byte of the crc
+		struct zeros_table
+		{
+			std::array<std::array<uint32_t, 256>, 4> table;
+
+			explicit zeros_table(std::size_t length) : table{}
+			{
+				// Build the operator for one zero bit, then square it up to "length" zero bytes (length must be a power of two)
+				uint32_t even[32];
+				uint32_t odd[32];
+
+				odd[0] = polynomial;
+				uint32_t row = 1;
+				for(int n = 1; n < 32; n++, row <<= 1)
+					odd[n] = row;
+
+				gf2_matrix_square(even, odd);	// 2 zero bits
+				gf2_matrix_square(odd, even);	// 4 zero bits
+
+				const uint32_t* op = nullptr;
+				while(true)
+				{
+					gf2_matrix_square(even, odd);
+					length >>= 1;
+					if(length == 0)
+					{
+						op = even;
+						break;
+					}
+
+					gf2_matrix_square(odd, even);
+					length >>= 1;
+					if(length == 0)
+					{
+						op = odd;
+						break;
+					}
+				}
+
+				for(uint32_t n = 0; n < 256; n++)
+				{
+					table[0][n] = gf2_matrix_times(op, n);
+					table[1][n] = gf2_matrix_times(op, n << 8);
+					table[2][n] = gf2_matrix_times(op, n << 16);
+					table[3][n] = gf2_matrix_times(op, n << 24);
+				}
+			}
+
+			uint32_t shift(uint32_t crc) const
+			{
+				return table[0][crc & 0xFF] ^ table[1][(crc >> 8) & 0xFF] ^ table[2][(crc >> 16) & 0xFF] ^ table[3][crc >> 24];
+			}
+		};
+
+		const zeros_table& long_zeros()
+		{
+			static const zeros_table table { long_block };
+			return table;
+		}
+
+		const zeros_table& short_zeros()
+		{
+			static const zeros_table table { short_block };
+			return table;
+		}
+
+		// Processes as many blocks of three times block_length bytes as possible
+		__attribute__((target("sse4.2")))
+		uint64_t crc32c_interleaved(uint64_t crc0, const uint8_t*& next, std::size_t& size, std::size_t block_length, const zeros_table& zeros)
+		{
+			while(size >= 3 * block_length)
+			{
+				uint64_t crc1 = 0;
+				uint64_t crc2 = 0;
+				const auto end = next + block_length;
+				do
+				{
+					crc0 = _mm_crc32_u64(crc0, load_little_endian(next));
+					crc1 = _mm_crc32_u64(crc1, load_little_endian(next + block_length));
+					crc2 = _mm_crc32_u64(crc2, load_little_endian(next + 2 * block_length));
+					next += 8;
+				} while(next < end);
+
+				crc0 = zeros.shift(static_cast<uint32_t>(crc0)) ^ crc1;
+				crc0 = zeros.shift(static_cast<uint32_t>(crc0)) ^ crc2;
+				next += 2 * block_length;
+				size -= 3 * block_length;
+			}
+
+			return crc0;
+		}
+#endif
+
+		using crc32c_function = uint32_t (*)(const uint8_t*, std::size_t, uint32_t);
+
+		crc32c_function select_implementation()
+		{
+			return crc32c_hardware_available() ? &crc32c_hardware : &crc32c_portable;
+		}
+	}
+
+	// ----------------------------------------------------------------------
+	// Checksum functions
+	// ----------------------------------------------------------------------
+	uint32_t crc32c(const uint8_t* data, std::size_t size, uint32_t crc)
+	{
+		static const crc32c_function implementation = select_implementation();
+		return implementation(data, size, crc);
+	}
+
+	// Slicing-by-8 software implementation
+	uint32_t crc32c_portable(const uint8_t* data, std::size_t size, uint32_t crc)
+	{
+		const auto& t = slicing_table;
+		uint64_t c = crc ^ 0xFFFFFFFF;
+
+		// Bytes up to an eight-byte boundary
+		for( ; size > 0 && (reinterpret_cast<uintptr_t>(data) & 7) != 0; size--)
+			c = t[0][(c ^ *data++) & 0xFF] ^ (c >> 8);
+
+		for( ; size >= 8; size -= 8, data += 8)
+		{
+			const uint64_t w = load_little_endian(data) ^ c;
+			c = t[7][w & 0xFF] ^ t[6][(w >> 8) & 0xFF] ^ t[5][(w >> 16) & 0xFF] ^ t[4][(w >> 24) & 0xFF] ^
+				t[3][(w >> 32) & 0xFF] ^ t[2][(w >> 40) & 0xFF] ^ t[1][(w >> 48) & 0xFF] ^ t[0][w >> 56];
+		}
+
+		for( ; size > 0; size--)
+			c = t[0][(c ^ *data++) & 0xFF] ^ (c >> 8);
+
+		return static_cast<uint32_t>(c) ^ 0xFFFFFFFF;
+	}
+
+#ifdef UTILITYLIB_CRC32C_SSE42
+	// SSE4.2 implementation
+	__attribute__((target("sse4.2")))
+	uint32_t crc32c_hardware(const uint8_t* data, std::size_t size, uint32_t crc)
+	{
+		uint64_t crc0 = crc ^ 0xFFFFFFFF;
+
+		// Bytes up to an eight-byte boundary
+		for( ; size > 0 && (reinterpret_cast<uintptr_t>(data) & 7) != 0; size--)
+			crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *data++);
+
+		// Three independent streams to hide the latency of the crc32 instruction
+		crc0 = crc32c_interleaved(crc0, data, size, long_block, long_zeros());
+		crc0 = crc32c_interleaved(crc0, data, size, short_block, short_zeros());
+
+		for( ; size >= 8; size -= 8, data += 8)
+			crc0 = _mm_crc32_u64(crc0, load_little_endian(data));
+
+		for( ; size > 0; size--)
+			crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *data++);
+
+		return static_cast<uint32_t>(crc0) ^ 0xFFFFFFFF;
+	}
+
+	bool crc32c_hardware_available()
+	{
+		return __builtin_cpu_supports("sse4.2");
+	}
+#else
+	uint32_t crc32c_hardware(const uint8_t* data, std::size_t size, uint32_t crc)
+	{
+		return crc32c_portable(data, size, crc);
+	}
+
+	bool crc32c_hardware_available()
+	{
+		return false;
+	}
+#endif
+
+	// ----------------------------------------------------------------------
+	// Byte strategies
+	// ----------------------------------------------------------------------
+	void crc32c_append::kernel::finish(buffer& b)
+	{
+		const uint8_t checksum[crc32c_size] = {
+			static_cast<uint8_t>(crc), static_cast<uint8_t>(crc >> 8),
+			static_cast<uint8_t>(crc >> 16), static_cast<uint8_t>(crc >> 24) };
+		b.append(checksum, crc32c_size);
+	}
+
+	buffer& crc32c_append::apply(buffer& b)
+	{
+		kernel k;
+		k.process(b.get(), b.size());
+		k.finish(b);
+		return b;
+	}
+
+	buffer& crc32c_verify::apply(buffer& b)
+	{
+		if(!verify_and_strip_crc32c(b))
+			b.resize(0);
+		return b;
+	}
+
+	bool verify_and_strip_crc32c(buffer& b)
+	{
+		if(b.size() < crc32c_size)
+			return false;
+
+		const auto payload_size = b.size() - crc32c_size;
+		const auto p = b.get() + payload_size;
+		const uint32_t expected = uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+
+		if(crc32c(b.get(), payload_size) != expected)
+			return false;
+
+		b.resize(payload_size);
+		return true;
+	}
+}
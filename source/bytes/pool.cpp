@@ -0,0 +1,131 @@
+/////////////////////////////////////////////////////////////////////////
+// Thread-local size-class memory pool implementation
+/////////////////////////////////////////////////////////////////////////
+#include <bytes/pool.h>
+
+#include <array>
+#include <new>
+
+namespace bytes
+{
+	namespace
+	{
+		// Free blocks are chained through their first bytes (every block is at least smallest_class_size)
+		struct free_block
+		{
+			free_block* next;
+		};
+
+		struct free_list
+		{
+			free_block* head = nullptr;
+			std::size_t count = 0;
+		};
+
+		class thread_cache
+		{
+			public:
+				thread_cache() : _lists{} {}
+				~thread_cache() { trim(); }
+
+				thread_cache(const thread_cache&) = delete;
+				thread_cache& operator=(const thread_cache&) = delete;
+
+				uint8_t* pop(std::size_t index)
+				{
+					auto& list = _lists[index];
+					if(list.head == nullptr)
+						return nullptr;
+
+					auto block = list.head;
+					list.head = block->next;
+					list.count--;
+					return reinterpret_cast<uint8_t*>(block);
+				}
+
+				bool push(std::size_t index, uint8_t* ptr)
+				{
+					auto& list = _lists[index];
+					if(list.count >= size_class_pool::max_cached_blocks)
+						return false;
+
+					auto block = reinterpret_cast<free_block*>(ptr);
+					block->next = list.head;
+					list.head = block;
+					list.count++;
+					return true;
+				}
+
+				std::size_t count() const
+				{
+					std::size_t total = 0;
+					for(const auto& list : _lists)
+						total += list.count;
+					return total;
+				}
+
+				void trim()
+				{
+					for(auto& list : _lists)
+					{
+						while(list.head != nullptr)
+						{
+							auto next = list.head->next;
+							::operator delete(list.head);
+							list.head = next;
+						}
+						list.count = 0;
+					}
+				}
+
+			private:
+				std::array<free_list, size_class_pool::number_of_classes> _lists;
+		};
+
+		thread_cache& local_cache()
+		{
+			static thread_local thread_cache cache;
+			return cache;
+		}
+	}
+
+	// ----------------------------------------------------------------------
+	// Public interface
+	// ----------------------------------------------------------------------
+	// Allocate a block from the calling thread's cache, or from the system if the cache is empty
+	uint8_t* size_class_pool::allocate(std::size_t size)
+	{
+		const auto index = size_class(size);
+		if(index < number_of_classes)
+		{
+			auto block = local_cache().pop(index);
+			if(block != nullptr)
+				return block;
+		}
+
+		return static_cast<uint8_t*>(::operator new(block_size(size)));
+	}
+
+	// Return a block to the calling thread's cache, or to the system if the cache is full
+	void size_class_pool::release(uint8_t* block, std::size_t size)
+	{
+		if(block == nullptr)
+			return;
+
+		const auto index = size_class(size);
+		if(index < number_of_classes && local_cache().push(index, block))
+			return;
+
+		::operator delete(block);
+	}
+
+	std::size_t size_class_pool::cached_blocks()
+	{
+		return local_cache().count();
+	}
+
+	void size_class_pool::trim()
+	{
+		local_cache().trim();
+	}
+}
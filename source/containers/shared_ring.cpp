@@ -0,0 +1,533 @@
+/////////////////////////////////////////////////////////////////////////
+// Process-shared ring buffer implementation
+/////////////////////////////////////////////////////////////////////////
+#include <containers/shared_ring.h>
+
+#ifdef USE_POSIX
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace utility
+{
+	namespace
+	{
+		constexpr uint32_t ring_magic = 0x676e6972;	// "ring"
+		constexpr uint32_t ring_version = 1;
+		constexpr std::size_t header_size = 4096;		// Keeps the storage page-aligned
+		constexpr uint64_t record_header_size = 8;
+
+		// Record types, the storage is zeroed when records are consumed
+		constexpr uint32_t record_free = 0;
+		constexpr uint32_t record_message = 1;
+		constexpr uint32_t record_padding = 2;
+
+		struct record_header
+		{
+			uint32_t length;				// Payload length
+			std::atomic<uint32_t> type;		// Published last
+		};
+
+		static_assert(sizeof(record_header) == record_header_size, "Record headers must be 8 bytes");
+		static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+			"The shared ring needs address-free atomics");
+
+		uint64_t record_size(std::size_t payload)
+		{
+			return (record_header_size + payload + 7) & ~uint64_t { 7 };
+		}
+
+#ifdef __linux__
+		void futex_wait(std::atomic<uint32_t>& word, uint32_t expected, std::chrono::microseconds timeout)
+		{
+			struct timespec t {};
+			t.tv_sec = static_cast<time_t>(timeout.count() / 1000000);
+			t.tv_nsec = static_cast<long>((timeout.count() % 1000000) * 1000);
+			::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &t, nullptr, 0);
+		}
+
+		void futex_wake(std::atomic<uint32_t>& word)
+		{
+			::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+		}
+#endif
+	}
+
+	// Shared header, at the start of the mapping
+	struct shared_ring::header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t capacity;
+		shared_ring_mode mode;
+		std::atomic<uint32_t> ready;		// Set last by the creator
+		std::atomic<uint32_t> producers;
+		std::atomic<uint32_t> consumers;
+
+		alignas(64) std::atomic<uint64_t> write;	// Reserved up to here
+		alignas(64) std::atomic<uint64_t> read;		// Consumed up to here
+
+		alignas(64) std::atomic<uint32_t> doorbell;	// Futex word, bumped to wake the consumer
+		std::atomic<uint32_t> sleeping;				// Set while the consumer waits
+	};
+
+	// ----------------------------------------------------------------------
+	// Creating and attaching
+	// ----------------------------------------------------------------------
+	shared_ring shared_ring::create(const std::string& name, std::size_t capacity, shared_ring_role role, shared_ring_mode mode)
+	{
+		std::size_t size = min_capacity;
+		while(size < capacity)
+			size <<= 1;
+
+		int fd = -1;
+		if(name.empty())
+		{
+#ifdef __linux__
+			fd = ::memfd_create("shared_ring", MFD_CLOEXEC);
+#else
+			return shared_ring { status::error, ENOSYS };
+#endif
+		}
+		else
+		{
+			fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+		}
+
+		if(fd < 0)
+			return shared_ring { status::error, errno };
+
+		// The ring owns the descriptor (and the name) from here, so close() cleans up on failure
+		shared_ring ring;
+		ring._fd = fd;
+		ring._name = name;
+
+		if(::ftruncate(fd, static_cast<off_t>(header_size + size)) != 0 || !ring.map(fd, header_size + size))
+		{
+			ring._error = errno;
+			ring.close();
+			ring._status = status::error;
+			return ring;
+		}
+
+		// The storage is zero-filled, so all records are free
+		static_assert(sizeof(header) <= header_size, "The shared header must fit before the storage");
+		auto* h = new (ring._header) header {};
+		h->magic = ring_magic;
+		h->version = ring_version;
+		h->capacity = size;
+		h->mode = mode;
+		h->ready.store(1, std::memory_order_release);
+
+		ring._mask = size - 1;
+		ring.join(role);
+		return ring;
+	}
+
+	shared_ring shared_ring::attach(const std::string& name, shared_ring_role role)
+	{
+		const int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+		if(fd < 0)
+			return shared_ring { status::error, errno };
+
+		return attach_descriptor(fd, role);
+	}
+
+	shared_ring shared_ring::attach(int fd, shared_ring_role role)
+	{
+		const int duplicate = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+		if(duplicate < 0)
+			return shared_ring { status::error, errno };
+
+		return attach_descriptor(duplicate, role);
+	}
+
+	// Validates the layout and registers the role, takes ownership of the descriptor
+	shared_ring shared_ring::attach_descriptor(int fd, shared_ring_role role)
+	{
+		shared_ring ring;
+		ring._fd = fd;
+
+		struct stat info {};
+		if(::fstat(fd, &info) != 0)
+		{
+			ring._error = errno;
+			ring.close();
+			ring._status = status::error;
+			return ring;
+		}
+
+		const auto size = static_cast<std::size_t>(info.st_size);
+		if(size <= header_size)
+		{
+			ring.close();
+			ring._status = status::not_ready;
+			return ring;
+		}
+
+		if(!ring.map(fd, size))
+		{
+			ring._error = errno;
+			ring.close();
+			ring._status = status::error;
+			return ring;
+		}
+
+		const auto* h = ring._header;
+		if(h->ready.load(std::memory_order_acquire) != 1)
+		{
+			ring.close();
+			ring._status = status::not_ready;
+			return ring;
+		}
+
+		const auto capacity = h->capacity;
+		if(h->magic != ring_magic || h->version != ring_version || capacity < min_capacity
+			|| (capacity & (capacity - 1)) != 0 || header_size + capacity != size)
+		{
+			ring.close();
+			ring._status = status::invalid;
+			return ring;
+		}
+
+		ring._mask = capacity - 1;
+		ring.join(role);
+		return ring;
+	}
+
+	bool shared_ring::map(int fd, std::size_t size)
+	{
+		void* mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if(mapping == MAP_FAILED)
+			return false;
+
+		_header = static_cast<header*>(mapping);
+		_data = static_cast<uint8_t*>(mapping) + header_size;
+		_mapped_size = size;
+		_status = status::open;
+		return true;
+	}
+
+	// Registers the role in the shared header
+	bool shared_ring::join(shared_ring_role role)
+	{
+		auto claim = [](std::atomic<uint32_t>& count)
+		{
+			uint32_t expected = 0;
+			return count.compare_exchange_strong(expected, 1);
+		};
+
+		bool joined = true;
+		if(role == shared_ring_role::consumer)
+			joined = claim(_header->consumers);
+		else if(role == shared_ring_role::producer && _header->mode == shared_ring_mode::single_producer)
+			joined = claim(_header->producers);
+		else if(role == shared_ring_role::producer)
+			_header->producers.fetch_add(1);
+
+		if(!joined)
+		{
+			close();
+			_status = status::in_use;
+			_error = EBUSY;
+			return false;
+		}
+
+		_role = role;
+		return true;
+	}
+
+	// ----------------------------------------------------------------------
+	// Constructors / destructor
+	// ----------------------------------------------------------------------
+	shared_ring::shared_ring() :
+		_header(nullptr), _data(nullptr), _mapped_size(0), _mask(0), _fd(-1),
+		_role(shared_ring_role::none), _name(), _status(status::closed), _error(0) {}
+
+	shared_ring::shared_ring(status s, int error) :
+		_header(nullptr), _data(nullptr), _mapped_size(0), _mask(0), _fd(-1),
+		_role(shared_ring_role::none), _name(), _status(s), _error(error) {}
+
+	shared_ring::~shared_ring()
+	{
+		close();
+	}
+
+	shared_ring::shared_ring(shared_ring&& r) :
+		_header(r._header), _data(r._data), _mapped_size(r._mapped_size), _mask(r._mask), _fd(r._fd),
+		_role(r._role), _name(std::move(r._name)), _status(r._status), _error(r._error)
+	{
+		r._header = nullptr;
+		r._data = nullptr;
+		r._mapped_size = 0;
+		r._fd = -1;
+		r._role = shared_ring_role::none;
+		r._name.clear();
+		r._status = status::closed;
+	}
+
+	shared_ring& shared_ring::operator=(shared_ring&& r)
+	{
+		if(this != &r)
+		{
+			close();
+			_header = r._header;
+			_data = r._data;
+			_mapped_size = r._mapped_size;
+			_mask = r._mask;
+			_fd = r._fd;
+			_role = r._role;
+			_name = std::move(r._name);
+			_status = r._status;
+			_error = r._error;
+
+			r._header = nullptr;
+			r._data = nullptr;
+			r._mapped_size = 0;
+			r._fd = -1;
+			r._role = shared_ring_role::none;
+			r._name.clear();
+			r._status = status::closed;
+		}
+		return *this;
+	}
+
+	// ----------------------------------------------------------------------
+	// Producer interface
+	// ----------------------------------------------------------------------
+	bool shared_ring::push(const uint8_t* data, std::size_t size)
+	{
+		if(_role != shared_ring_role::producer || size > max_message_size())
+			return false;
+
+		const uint64_t capacity = _mask + 1;
+		const uint64_t total = record_size(size);
+		const bool single = (_header->mode == shared_ring_mode::single_producer);
+		auto& write = _header->write;
+		uint64_t w = write.load(std::memory_order_relaxed);
+
+		for(;;)
+		{
+			// Records do not wrap: the rest of the storage is padded if the message does not fit
+			const uint64_t tail = capacity - (w & _mask);
+			const bool pad = (total > tail);
+			const uint64_t needed = pad ? tail : total;
+
+			// Acquire the consumer's index, so that its zeroing of the storage happens before our writes
+			if(w + needed - _header->read.load(std::memory_order_acquire) > capacity)
+				return false;
+
+			if(single)
+				write.store(w + needed, std::memory_order_relaxed);
+			else if(!write.compare_exchange_weak(w, w + needed, std::memory_order_relaxed))
+				continue;
+
+			auto* r = reinterpret_cast<record_header*>(record(w));
+			if(pad)
+			{
+				r->length = static_cast<uint32_t>(tail - record_header_size);
+				r->type.store(record_padding, std::memory_order_release);
+				w += tail;
+				continue;
+			}
+
+			r->length = static_cast<uint32_t>(size);
+			std::memcpy(record(w) + record_header_size, data, size);
+			r->type.store(record_message, std::memory_order_release);
+			notify();
+			return true;
+		}
+	}
+
+	// Wakes the consumer if it sleeps in wait()
+	void shared_ring::notify()
+	{
+		// Orders the published record before the check (pairs with the fence in wait)
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if(_header->sleeping.load(std::memory_order_relaxed) == 0)
+			return;
+
+		_header->doorbell.fetch_add(1, std::memory_order_release);
+#ifdef __linux__
+		futex_wake(_header->doorbell);
+#endif
+	}
+
+	// ----------------------------------------------------------------------
+	// Consumer interface
+	// ----------------------------------------------------------------------
+	const uint8_t* shared_ring::peek(std::size_t& size)
+	{
+		if(_role != shared_ring_role::consumer)
+			return nullptr;
+
+		for(;;)
+		{
+			const auto r = _header->read.load(std::memory_order_relaxed);
+			auto* h = reinterpret_cast<record_header*>(record(r));
+			const auto type = h->type.load(std::memory_order_acquire);
+			if(type == record_free)
+				return nullptr;
+
+			if(type == record_padding)
+			{
+				const auto total = record_header_size + h->length;
+				std::memset(record(r), 0, total);
+				_header->read.store(r + total, std::memory_order_release);
+				continue;
+			}
+
+			size = h->length;
+			return record(r) + record_header_size;
+		}
+	}
+
+	// Releases the next message, zeroing its storage for the producers
+	bool shared_ring::pop()
+	{
+		std::size_t size = 0;
+		if(peek(size) == nullptr)
+			return false;
+
+		const auto r = _header->read.load(std::memory_order_relaxed);
+		const auto total = record_size(size);
+		std::memset(record(r), 0, total);
+		_header->read.store(r + total, std::memory_order_release);
+		return true;
+	}
+
+	bool shared_ring::read(std::vector<uint8_t>& result)
+	{
+		std::size_t size = 0;
+		const auto* data = peek(size);
+		if(data == nullptr)
+			return false;
+
+		result.assign(data, data + size);
+		return pop();
+	}
+
+	bool shared_ring::wait(std::chrono::microseconds timeout)
+	{
+		if(_role != shared_ring_role::consumer)
+			return false;
+
+		if(!empty())
+			return true;
+
+#ifdef __linux__
+		// Announce the sleep before the last check, a producer publishing after it rings the doorbell
+		const auto ring = _header->doorbell.load(std::memory_order_acquire);
+		_header->sleeping.store(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if(empty())
+			futex_wait(_header->doorbell, ring, timeout);
+
+		_header->sleeping.store(0, std::memory_order_relaxed);
+#else
+		const auto deadline = std::chrono::steady_clock::now() + timeout;
+		while(empty() && std::chrono::steady_clock::now() < deadline)
+			std::this_thread::sleep_for(std::chrono::microseconds { 50 });
+#endif
+
+		return !empty();
+	}
+
+	// ----------------------------------------------------------------------
+	// Public interface
+	// ----------------------------------------------------------------------
+	void shared_ring::close()
+	{
+		if(_header != nullptr)
+		{
+			if(_role == shared_ring_role::producer)
+				_header->producers.fetch_sub(1);
+			else if(_role == shared_ring_role::consumer)
+				_header->consumers.store(0);
+
+			::munmap(_header, _mapped_size);
+		}
+
+		if(_fd >= 0)
+			::close(_fd);
+
+		if(!_name.empty())
+			::shm_unlink(_name.c_str());
+
+		_header = nullptr;
+		_data = nullptr;
+		_mapped_size = 0;
+		_fd = -1;
+		_role = shared_ring_role::none;
+		_name.clear();
+		_status = status::closed;
+	}
+
+	// Checks for a published message (a padding record is followed by one at the start)
+	bool shared_ring::empty() const
+	{
+		if(_header == nullptr)
+			return true;
+
+		auto r = _header->read.load(std::memory_order_acquire);
+		auto* h = reinterpret_cast<record_header*>(record(r));
+		auto type = h->type.load(std::memory_order_acquire);
+		if(type == record_padding)
+		{
+			r += record_header_size + h->length;
+			type = reinterpret_cast<record_header*>(record(r))->type.load(std::memory_order_acquire);
+		}
+
+		return type != record_message;
+	}
+
+	std::size_t shared_ring::capacity() const
+	{
+		return (_header != nullptr) ? static_cast<std::size_t>(_mask + 1) : 0;
+	}
+
+	// Messages up to half the capacity, so that a record after padding always fits
+	std::size_t shared_ring::max_message_size() const
+	{
+		return (_header != nullptr) ? static_cast<std::size_t>((_mask + 1) / 2 - record_header_size) : 0;
+	}
+
+	std::size_t shared_ring::bytes_used() const
+	{
+		if(_header == nullptr)
+			return 0;
+
+		const auto r = _header->read.load(std::memory_order_acquire);
+		const auto w = _header->write.load(std::memory_order_acquire);
+		return static_cast<std::size_t>(w - r);
+	}
+
+	std::size_t shared_ring::producers() const
+	{
+		return (_header != nullptr) ? _header->producers.load() : 0;
+	}
+
+	bool shared_ring::consumer_attached() const
+	{
+		return (_header != nullptr) && _header->consumers.load() != 0;
+	}
+
+	uint8_t* shared_ring::record(uint64_t position) const
+	{
+		return _data + (position & _mask);
+	}
+}
+#endif
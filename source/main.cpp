@@ -1,22 +1,212 @@
+/////////////////////////////////////////////////////////////////////////
+// utilitydev: load generator and echo server
+//
+// Capacity testing of the networking library on one machine: run the
+// echo server, then the load generator against it (see usage below).
+// Both stop early on Ctrl-C.
+/////////////////////////////////////////////////////////////////////////
+#include <csignal>
+#include <cstdlib>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <string>
+#include <utility>
 
-#include <networking/tcp/connection.h>
+#include <networking/address.h>
 
-int main(int argc, const char** argv)
+#include "utilitydev/echo_server.h"
+#include "utilitydev/load_generator.h"
+
+namespace
 {
-	auto a = networking::create_address("127.0.0.1", 4242, networking::protocol::tcp);
-	networking::tcp::connection c { a };
+	const char* usage =
+		"Usage:\n"
+		"  utilitydev server [--port 4242] [--ipv6] [--tcp-only | --udp-only] [--spin-us 0]\n"
+		"  utilitydev client [--host 127.0.0.1] [--port 4242] [--udp] [--connections 1] [--threads 1]\n"
+		"                    [--rate 0] [--open-loop] [--size 64] [--in-flight 0]\n"
+		"                    [--duration 10] [--warmup 1] [--timeout-ms 1000]\n"
+		"\n"
+		"  --rate       Requests per second over all connections (required with --open-loop)\n"
+		"  --in-flight  Requests in flight per connection (default 1, or 1024 with --open-loop)\n"
+		"  --duration   Measured seconds, after --warmup seconds that are not counted\n";
+
+	// "--name value" pairs and "--flag" switches
+	class arguments
+	{
+		public:
+			arguments(int argc, const char** argv, int first) : _values(), _valid(true)
+			{
+				for(int i = first; i < argc; i++)
+				{
+					const std::string name { argv[i] };
+					if(name.rfind("--", 0) != 0)
+					{
+						_valid = false;
+						continue;
+					}
+
+					const bool has_value = (i + 1 < argc) && std::string { argv[i + 1] }.rfind("--", 0) != 0;
+					_values[name.substr(2)] = has_value ? argv[++i] : "";
+				}
+			}
+
+			bool valid() const { return _valid; }
+			bool flag(const std::string& name) const { return _values.count(name) != 0; }
+
+			std::string text(const std::string& name, const std::string& fallback) const
+			{
+				const auto value = _values.find(name);
+				return (value != _values.end()) ? value->second : fallback;
+			}
+
+			// Fails the arguments on values that are not numbers
+			double number(const std::string& name, double fallback)
+			{
+				const auto value = _values.find(name);
+				if(value == _values.end())
+					return fallback;
+
+				char* end = nullptr;
+				const auto result = std::strtod(value->second.c_str(), &end);
+				if(value->second.empty() || *end != '\0' || result < 0)
+					_valid = false;
+				return result;
+			}
+
+		private:
+			std::map<std::string, std::string> _values;
+			bool _valid;
+	};
+
+	// Stopped from the signal handler
+	utilitydev::echo_server* running_server = nullptr;
+	utilitydev::load_generator* running_generator = nullptr;
+
+	void on_interrupt(int)
+	{
+		if(running_server != nullptr)
+			running_server->stop();
+		if(running_generator != nullptr)
+			running_generator->stop();
+	}
+
+	void print_distribution(const char* title, const metrics::histogram_snapshot& s)
+	{
+		const auto microseconds = [](uint64_t nanoseconds) { return static_cast<double>(nanoseconds) / 1000.0; };
 
-	std::cout << "Opened connection with state: " << c.state() << std::endl;
+		std::cout << title << " (us, " << s.count << " samples):\n  ";
+		if(s.count == 0)
+		{
+			std::cout << "none" << std::endl;
+			return;
+		}
 
-	if(c.state() == networking::tcp::connection::status::error)
+		const std::pair<const char*, double> percentiles[] = { { "p50", 50.0 }, { "p90", 90.0 }, { "p99", 99.0 }, { "p99.9", 99.9 }, { "p99.99", 99.99 } };
+		std::cout << std::fixed << std::setprecision(1) << "mean " << (s.mean() / 1000.0);
+		for(const auto& p : percentiles)
+			std::cout << ", " << p.first << " " << microseconds(s.percentile(p.second));
+		std::cout << ", max " << microseconds(s.max()) << std::defaultfloat << std::endl;
+	}
+
+	int run_server(arguments& args)
+	{
+		utilitydev::echo_options options;
+		options.port = static_cast<networking::port_number_t>(args.number("port", options.port));
+		options.use_ipv6 = args.flag("ipv6");
+		options.tcp = !args.flag("udp-only");
+		options.udp = !args.flag("tcp-only");
+		options.spin_budget = std::chrono::microseconds { static_cast<int64_t>(args.number("spin-us", 0)) };
+		if(!args.valid() || !(options.tcp || options.udp))
+		{
+			std::cerr << usage;
+			return 1;
+		}
+
+		utilitydev::echo_server server { options };
+		if(!server.start())
+		{
+			std::cerr << "Could not listen on port " << options.port << ": " << server.error().message << std::endl;
+			return 1;
+		}
+
+		std::cout << "Echoing on port " << options.port << (options.tcp ? " (TCP)" : "") << (options.udp ? " (UDP)" : "") << ", Ctrl-C to stop" << std::endl;
+		running_server = &server;
+		std::signal(SIGINT, on_interrupt);
+		std::signal(SIGTERM, on_interrupt);
+		server.run();
+		running_server = nullptr;
+
+		std::cout << "Echoed " << server.bytes_echoed() << " bytes over TCP and " << server.datagrams_echoed() << " datagrams" << std::endl;
+		return 0;
+	}
+
+	int run_client(arguments& args)
 	{
-		std::cout << "Error message: " << c.error().message << std::endl;
+		utilitydev::load_options options;
+		const auto host = args.text("host", "127.0.0.1");
+		const auto port = static_cast<networking::port_number_t>(args.number("port", 4242));
+		options.transport = args.flag("udp") ? networking::protocol::udp : networking::protocol::tcp;
+		options.target = networking::create_address(host, port, options.transport, true);
+		options.mode = args.flag("open-loop") ? utilitydev::load_mode::open_loop : utilitydev::load_mode::closed_loop;
+		options.connections = static_cast<std::size_t>(args.number("connections", 1));
+		options.threads = static_cast<std::size_t>(args.number("threads", 1));
+		options.rate = args.number("rate", 0);
+		options.message_size = static_cast<std::size_t>(args.number("size", 64));
+		options.in_flight = static_cast<std::size_t>(args.number("in-flight", 0));
+		options.duration = std::chrono::milliseconds { static_cast<int64_t>(args.number("duration", 10) * 1000) };
+		options.warmup = std::chrono::milliseconds { static_cast<int64_t>(args.number("warmup", 1) * 1000) };
+		options.timeout = std::chrono::milliseconds { static_cast<int64_t>(args.number("timeout-ms", 1000)) };
+
+		utilitydev::load_generator generator { options };
+		if(!args.valid() || !generator.valid())
+		{
+			if(args.valid() && !options.target.valid())
+				std::cerr << "Could not resolve " << host << std::endl;
+			std::cerr << usage;
+			return 1;
+		}
+
+		std::cout << (args.flag("udp") ? "UDP " : "TCP ") << options.target.to_string().value << ", " << options.connections << " connections on "
+			<< options.threads << " threads, " << (options.mode == utilitydev::load_mode::open_loop ? "open" : "closed") << " loop";
+		if(options.rate > 0)
+			std::cout << " at " << options.rate << " requests/s";
+		std::cout << ", " << options.message_size << " byte requests, " << options.in_flight_limit() << " in flight per connection" << std::endl;
+
+		running_generator = &generator;
+		std::signal(SIGINT, on_interrupt);
+		std::signal(SIGTERM, on_interrupt);
+		const auto report = generator.run(&std::cout);
+		running_generator = nullptr;
+		if(report.connected == 0)
+		{
+			std::cerr << "Could not connect to " << options.target.to_string().value << std::endl;
+			return 1;
+		}
+
+		const auto seconds = std::chrono::duration<double>(report.elapsed).count();
+		std::cout << "\nConnected:  " << report.connected << " of " << options.connections << "\n"
+			<< "Requests:   " << report.sent << " sent, " << report.received << " answered, " << report.lost << " lost, " << report.errors << " errors in " << seconds << " s\n"
+			<< "Throughput: " << std::fixed << std::setprecision(1) << report.throughput() << " requests/s, "
+			<< (report.throughput() * static_cast<double>(options.message_size) / 1e6) << " MB/s each way" << std::defaultfloat << std::endl;
+
+		// Without a target rate, the two are the same (every request is sent as soon as it is scheduled)
+		print_distribution("Latency from the scheduled send", report.latency);
+		print_distribution("Service time from the actual send", report.service_time);
+		return 0;
 	}
+}
 
-	c.close();
+int main(int argc, const char** argv)
+{
+	const std::string command { (argc > 1) ? argv[1] : "" };
+	arguments args { argc, argv, 2 };
 
-	std::cout << "State after close: " << c.state() << std::endl;
+	if(command == "server")
+		return run_server(args);
+	if(command == "client")
+		return run_client(args);
 
-	return 0;
+	std::cerr << usage;
+	return 1;
 }
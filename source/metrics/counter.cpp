@@ -0,0 +1,14 @@
+/////////////////////////////////////////////////////////////////////////
+// Sharded counters implementation
+/////////////////////////////////////////////////////////////////////////
+#include <metrics/counter.h>
+
+namespace metrics
+{
+	// Threads are spread over the shards in the order they first record
+	std::size_t assign_shard()
+	{
+		static std::atomic<std::size_t> next { 0 };
+		return next.fetch_add(1, std::memory_order_relaxed) % shard_count;
+	}
+}
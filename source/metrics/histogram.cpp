@@ -0,0 +1,156 @@
+/////////////////////////////////////////////////////////////////////////
+// Log-linear latency histogram implementation
+/////////////////////////////////////////////////////////////////////////
+#include <metrics/histogram.h>
+
+#include <cmath>
+#include <algorithm>
+
+namespace metrics
+{
+	// ----------------------------------------------------------------------
+	// Buckets
+	// ----------------------------------------------------------------------
+	uint64_t histogram::bucket_lowest(std::size_t index)
+	{
+		const auto group = index >> sub_bucket_bits;
+		if(group == 0)
+			return index;
+
+		return static_cast<uint64_t>(sub_buckets + (index & (sub_buckets - 1))) << (group - 1);
+	}
+
+	uint64_t histogram::bucket_highest(std::size_t index)
+	{
+		const auto group = index >> sub_bucket_bits;
+		if(group == 0)
+			return index;
+
+		return bucket_lowest(index) + ((uint64_t { 1 } << (group - 1)) - 1);
+	}
+
+	// ----------------------------------------------------------------------
+	// Constructors / destructor
+	// ----------------------------------------------------------------------
+	histogram::histogram() :
+		_shards{}
+	{
+	}
+
+	histogram::~histogram()
+	{
+		for(auto& s : _shards)
+			delete s.load();
+	}
+
+	// ----------------------------------------------------------------------
+	// Public interface
+	// ----------------------------------------------------------------------
+	histogram_snapshot histogram::snapshot() const
+	{
+		histogram_snapshot result;
+		result.buckets.assign(bucket_count, 0);
+
+		for(const auto& entry : _shards)
+		{
+			const auto* s = entry.load(std::memory_order_acquire);
+			if(s == nullptr)
+				continue;
+
+			for(std::size_t i = 0; i < bucket_count; i++)
+			{
+				const auto n = s->buckets[i].load(std::memory_order_relaxed);
+				result.buckets[i] += n;
+				result.count += n;
+			}
+			result.sum += s->sum.load(std::memory_order_relaxed);
+		}
+
+		return result;
+	}
+
+	void histogram::reset()
+	{
+		for(auto& entry : _shards)
+		{
+			auto* s = entry.load(std::memory_order_acquire);
+			if(s == nullptr)
+				continue;
+
+			for(auto& b : s->buckets)
+				b.store(0, std::memory_order_relaxed);
+			s->sum.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	// Shards are allocated by the first thread recording to them, a thread losing the race uses the winner's
+	histogram::shard& histogram::allocate_shard()
+	{
+		auto& entry = _shards[this_thread_shard()];
+		auto* created = new shard {};
+		shard* expected = nullptr;
+		if(entry.compare_exchange_strong(expected, created, std::memory_order_acq_rel))
+			return *created;
+
+		delete created;
+		return *expected;
+	}
+
+	// ----------------------------------------------------------------------
+	// Snapshots
+	// ----------------------------------------------------------------------
+	uint64_t histogram_snapshot::min() const
+	{
+		for(std::size_t i = 0; i < buckets.size(); i++)
+		{
+			if(buckets[i] != 0)
+				return histogram::bucket_lowest(i);
+		}
+		return 0;
+	}
+
+	uint64_t histogram_snapshot::max() const
+	{
+		for(std::size_t i = buckets.size(); i > 0; i--)
+		{
+			if(buckets[i - 1] != 0)
+				return histogram::bucket_highest(i - 1);
+		}
+		return 0;
+	}
+
+	double histogram_snapshot::mean() const
+	{
+		return (count == 0) ? 0.0 : static_cast<double>(sum) / static_cast<double>(count);
+	}
+
+	uint64_t histogram_snapshot::percentile(double percent) const
+	{
+		if(count == 0)
+			return 0;
+
+		// Rank of the value at the percentile (at least the first value)
+		const auto clamped = std::min(std::max(percent, 0.0), 100.0);
+		const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * static_cast<double>(count))));
+
+		uint64_t seen = 0;
+		for(std::size_t i = 0; i < buckets.size(); i++)
+		{
+			seen += buckets[i];
+			if(seen >= rank)
+				return histogram::bucket_highest(i);
+		}
+		return max();
+	}
+
+	void histogram_snapshot::merge(const histogram_snapshot& other)
+	{
+		if(buckets.size() < other.buckets.size())
+			buckets.resize(other.buckets.size(), 0);
+
+		for(std::size_t i = 0; i < other.buckets.size(); i++)
+			buckets[i] += other.buckets[i];
+		count += other.count;
+		sum += other.sum;
+	}
+}
@@ -0,0 +1,51 @@
+/////////////////////////////////////////////////////////////////////////
+// Library probes implementation
+/////////////////////////////////////////////////////////////////////////
+#include <metrics/probes.h>
+
+namespace metrics
+{
+	namespace detail
+	{
+		std::atomic<const connection_probes*> enabled_connection_probes { nullptr };
+		std::atomic<const manager_probes*> enabled_manager_probes { nullptr };
+		std::atomic<const packet_probes*> enabled_packet_probes { nullptr };
+	}
+
+	// The probe sets are never freed, see the note in the header
+	void enable_probes(registry& r)
+	{
+		const auto* connection = new connection_probes {
+			r.make_counter("tcp.connection.receive_calls"),
+			r.make_counter("tcp.connection.send_calls"),
+			r.make_counter("tcp.connection.bytes_received"),
+			r.make_counter("tcp.connection.bytes_sent")
+		};
+
+		const auto* manager = new manager_probes {
+			r.make_histogram("tcp.manager.poll_wait_ns"),
+			r.make_histogram("tcp.manager.events"),
+			r.make_histogram("tcp.manager.callback_ns")
+		};
+
+		const auto* packet = new packet_probes {
+			r.make_histogram("net.packet.receive_delay_ns")
+		};
+
+		detail::enabled_connection_probes.store(connection, std::memory_order_release);
+		detail::enabled_manager_probes.store(manager, std::memory_order_release);
+		detail::enabled_packet_probes.store(packet, std::memory_order_release);
+	}
+
+	void disable_probes()
+	{
+		detail::enabled_connection_probes.store(nullptr, std::memory_order_release);
+		detail::enabled_manager_probes.store(nullptr, std::memory_order_release);
+		detail::enabled_packet_probes.store(nullptr, std::memory_order_release);
+	}
+
+	queue_probes make_queue_probes(registry& r, const std::string& name)
+	{
+		return { r.make_gauge(name + ".depth"), r.make_counter(name + ".full"), r.make_counter(name + ".empty") };
+	}
+}
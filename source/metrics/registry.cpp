@@ -0,0 +1,121 @@
+/////////////////////////////////////////////////////////////////////////
+// Registry of named metrics implementation
+/////////////////////////////////////////////////////////////////////////
+#include <metrics/registry.h>
+
+namespace metrics
+{
+	// ----------------------------------------------------------------------
+	// Constructors / destructor
+	// ----------------------------------------------------------------------
+	registry::registry() :
+		_mutex(),
+		_metrics(),
+		_mismatched()
+	{
+	}
+
+	registry::~registry()
+	{
+	}
+
+	// ----------------------------------------------------------------------
+	// Public interface
+	// ----------------------------------------------------------------------
+	counter& registry::make_counter(const std::string& name)
+	{
+		return *find_or_add(name, metric_type::counter).c;
+	}
+
+	gauge& registry::make_gauge(const std::string& name)
+	{
+		return *find_or_add(name, metric_type::gauge).g;
+	}
+
+	histogram& registry::make_histogram(const std::string& name)
+	{
+		return *find_or_add(name, metric_type::histogram).h;
+	}
+
+	std::vector<metric_snapshot> registry::snapshot() const
+	{
+		std::lock_guard<std::mutex> lock { _mutex };
+
+		std::vector<metric_snapshot> result;
+		result.reserve(_metrics.size());
+		for(const auto& [name, e] : _metrics)
+		{
+			metric_snapshot s { name, e.type, 0, {} };
+			switch(e.type)
+			{
+				case metric_type::counter: s.value = static_cast<int64_t>(e.c->value()); break;
+				case metric_type::gauge: s.value = e.g->value(); break;
+				case metric_type::histogram: s.distribution = e.h->snapshot(); break;
+			}
+			result.push_back(std::move(s));
+		}
+
+		return result;
+	}
+
+	void registry::write(std::ostream& s) const
+	{
+		for(const auto& m : snapshot())
+		{
+			s << m.name;
+			if(m.type != metric_type::histogram)
+			{
+				s << " " << m.value << "\n";
+				continue;
+			}
+
+			const auto& d = m.distribution;
+			s << " count=" << d.count << " mean=" << d.mean() << " min=" << d.min()
+				<< " p50=" << d.percentile(50) << " p90=" << d.percentile(90) << " p99=" << d.percentile(99)
+				<< " p999=" << d.percentile(99.9) << " max=" << d.max() << "\n";
+		}
+	}
+
+	std::size_t registry::size() const
+	{
+		std::lock_guard<std::mutex> lock { _mutex };
+		return _metrics.size();
+	}
+
+	// ----------------------------------------------------------------------
+	// Private helpers
+	// ----------------------------------------------------------------------
+	registry::entry& registry::find_or_add(const std::string& name, metric_type type)
+	{
+		std::lock_guard<std::mutex> lock { _mutex };
+
+		auto i = _metrics.find(name);
+		if(i != _metrics.end() && i->second.type == type)
+			return i->second;
+
+		entry created { type, nullptr, nullptr, nullptr };
+		switch(type)
+		{
+			case metric_type::counter: created.c = std::make_unique<counter>(); break;
+			case metric_type::gauge: created.g = std::make_unique<gauge>(); break;
+			case metric_type::histogram: created.h = std::make_unique<histogram>(); break;
+		}
+
+		if(i != _metrics.end())
+		{
+			_mismatched.push_back(std::move(created));
+			return _mismatched.back();
+		}
+
+		return _metrics.emplace(name, std::move(created)).first->second;
+	}
+
+	// ----------------------------------------------------------------------
+	// Non-member non-friend functions
+	// ----------------------------------------------------------------------
+	registry& default_registry()
+	{
+		static registry instance;
+		return instance;
+	}
+}
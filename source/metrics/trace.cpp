@@ -0,0 +1,330 @@
+/////////////////////////////////////////////////////////////////////////
+// Binary event tracing implementation
+/////////////////////////////////////////////////////////////////////////
+#include <metrics/trace.h>
+
+#include <mutex>
+#include <thread>
+#include <limits>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+namespace metrics
+{
+	namespace
+	{
+		// Dump format: header, names, then per thread a header and its records
+		constexpr char trace_magic[4] = { 'U', 'T', 'R', 'C' };
+		constexpr uint32_t trace_version = 1;
+
+		struct file_header
+		{
+			char magic[4];
+			uint32_t version;
+			double ticks_per_second;
+			uint32_t names;
+			uint32_t threads;
+		};
+
+		struct name_header
+		{
+			uint16_t event;
+			uint16_t length;
+		};
+
+		struct thread_header
+		{
+			uint32_t thread;
+			uint32_t reserved;
+			uint64_t records;
+		};
+
+		// Rings and names of the process
+		struct trace_state
+		{
+			std::mutex mutex;
+			std::vector<std::unique_ptr<detail::trace_buffer>> buffers;
+			std::map<uint16_t, std::string> names {
+				{ static_cast<uint16_t>(trace_event::accept), "accept" },
+				{ static_cast<uint16_t>(trace_event::update), "update" },
+				{ static_cast<uint16_t>(trace_event::receive), "receive" },
+				{ static_cast<uint16_t>(trace_event::send), "send" },
+				{ static_cast<uint16_t>(trace_event::queue_push), "queue_push" },
+				{ static_cast<uint16_t>(trace_event::queue_read), "queue_read" }
+			};
+			std::size_t capacity = std::size_t(1) << 16;
+		};
+
+		trace_state& state()
+		{
+			static trace_state instance;
+			return instance;
+		}
+
+		template <typename T>
+		void write_value(std::ostream& s, const T& value)
+		{
+			s.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		template <typename T>
+		bool read_value(std::istream& s, T& value)
+		{
+			return static_cast<bool>(s.read(reinterpret_cast<char*>(&value), sizeof(T)));
+		}
+
+		void write_json_string(std::ostream& s, const std::string& text)
+		{
+			s << '"';
+			for(const char c : text)
+			{
+				if(c == '"' || c == '\\')
+					s << '\\' << c;
+				else if(static_cast<unsigned char>(c) < 0x20)
+					s << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec << std::setfill(' ');
+				else
+					s << c;
+			}
+			s << '"';
+		}
+
+		// Measures the tick rate against steady_clock
+		double calibrate()
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			using clock_type = std::chrono::steady_clock;
+			const auto start = clock_type::now();
+			const auto start_ticks = trace_ticks();
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			const auto end_ticks = trace_ticks();
+			const auto end = clock_type::now();
+
+			const auto seconds = std::chrono::duration<double>(end - start).count();
+			return static_cast<double>(end_ticks - start_ticks) / seconds;
+#else
+			return 1e9;
+#endif
+		}
+	}
+
+	namespace detail
+	{
+		std::atomic<bool> tracing { false };
+
+		// ----------------------------------------------------------------------
+		// Thread rings
+		// ----------------------------------------------------------------------
+		trace_buffer::trace_buffer(std::size_t capacity, uint32_t thread) :
+			_records(),
+			_mask(0),
+			_written(0),
+			_thread(thread)
+		{
+			std::size_t size = 1;
+			while(size < capacity)
+				size <<= 1;
+
+			_records = std::make_unique<trace_record[]>(size);
+			_mask = size - 1;
+		}
+
+		// Copies the ring, dropping records that were overwritten while copying
+		std::vector<trace_record> trace_buffer::collect() const
+		{
+			const auto size = _mask + 1;
+			const auto before = _written.load(std::memory_order_acquire);
+			const auto first = (before > size) ? before - size : 0;
+
+			std::vector<trace_record> result;
+			result.reserve(static_cast<std::size_t>(before - first));
+			for(auto i = first; i < before; i++)
+				result.push_back(_records[i & _mask]);
+
+			const auto after = _written.load(std::memory_order_acquire);
+			const auto overwritten = (after > size) ? after - size : 0;
+			if(overwritten > first)
+				result.erase(result.begin(), result.begin() + static_cast<std::ptrdiff_t>(std::min(overwritten - first, before - first)));
+
+			return result;
+		}
+
+		void trace_buffer::clear()
+		{
+			_written.store(0, std::memory_order_release);
+		}
+
+		trace_buffer* register_trace_thread()
+		{
+			auto& s = state();
+			std::lock_guard<std::mutex> lock { s.mutex };
+
+			s.buffers.push_back(std::make_unique<trace_buffer>(s.capacity, static_cast<uint32_t>(s.buffers.size() + 1)));
+			thread_trace_buffer = s.buffers.back().get();
+			return thread_trace_buffer;
+		}
+	}
+
+	// ----------------------------------------------------------------------
+	// Recording
+	// ----------------------------------------------------------------------
+	void enable_tracing(std::size_t events_per_thread)
+	{
+		trace_ticks_per_second();
+
+		auto& s = state();
+		{
+			std::lock_guard<std::mutex> lock { s.mutex };
+			s.capacity = std::max<std::size_t>(events_per_thread, 1);
+		}
+
+		detail::tracing.store(true, std::memory_order_relaxed);
+	}
+
+	void disable_tracing()
+	{
+		detail::tracing.store(false, std::memory_order_relaxed);
+	}
+
+	void name_trace_event(uint16_t event, const std::string& name)
+	{
+		auto& s = state();
+		std::lock_guard<std::mutex> lock { s.mutex };
+		s.names[event] = name.substr(0, std::numeric_limits<uint16_t>::max());
+	}
+
+	double trace_ticks_per_second()
+	{
+		static const double ticks_per_second = calibrate();
+		return ticks_per_second;
+	}
+
+	void clear_trace()
+	{
+		auto& s = state();
+		std::lock_guard<std::mutex> lock { s.mutex };
+		for(auto& b : s.buffers)
+			b->clear();
+	}
+
+	// ----------------------------------------------------------------------
+	// Dumps
+	// ----------------------------------------------------------------------
+	bool write_trace(std::ostream& stream)
+	{
+		const auto ticks_per_second = trace_ticks_per_second();
+
+		auto& s = state();
+		std::lock_guard<std::mutex> lock { s.mutex };
+
+		file_header header {};
+		std::copy(std::begin(trace_magic), std::end(trace_magic), header.magic);
+		header.version = trace_version;
+		header.ticks_per_second = ticks_per_second;
+		header.names = static_cast<uint32_t>(s.names.size());
+		header.threads = static_cast<uint32_t>(s.buffers.size());
+		write_value(stream, header);
+
+		for(const auto& [event, name] : s.names)
+		{
+			write_value(stream, name_header { event, static_cast<uint16_t>(name.size()) });
+			stream.write(name.data(), static_cast<std::streamsize>(name.size()));
+		}
+
+		for(const auto& b : s.buffers)
+		{
+			const auto records = b->collect();
+			write_value(stream, thread_header { b->thread(), 0, records.size() });
+			stream.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(trace_record)));
+		}
+
+		return static_cast<bool>(stream);
+	}
+
+	bool write_trace(const std::string& path)
+	{
+		std::ofstream file { path, std::ios::binary | std::ios::trunc };
+		return file && write_trace(file);
+	}
+
+	bool read_trace(std::istream& stream, trace_file& result)
+	{
+		file_header header;
+		if(!read_value(stream, header) || !std::equal(std::begin(trace_magic), std::end(trace_magic), header.magic) || header.version != trace_version)
+			return false;
+
+		trace_file file;
+		file.ticks_per_second = header.ticks_per_second;
+
+		for(uint32_t i = 0; i < header.names; i++)
+		{
+			name_header name;
+			if(!read_value(stream, name))
+				return false;
+
+			std::string text(name.length, '\0');
+			if(!stream.read(text.data(), name.length))
+				return false;
+			file.names[name.event] = std::move(text);
+		}
+
+		for(uint32_t i = 0; i < header.threads; i++)
+		{
+			thread_header thread;
+			if(!read_value(stream, thread))
+				return false;
+
+			// Grow as records arrive rather than trusting the count of a damaged file
+			trace_thread t { thread.thread, {} };
+			for(uint64_t r = 0; r < thread.records; r++)
+			{
+				trace_record record;
+				if(!read_value(stream, record))
+					return false;
+				t.records.push_back(record);
+			}
+			file.threads.push_back(std::move(t));
+		}
+
+		result = std::move(file);
+		return true;
+	}
+
+	void write_chrome_trace(const trace_file& file, std::ostream& s)
+	{
+		uint64_t origin = std::numeric_limits<uint64_t>::max();
+		for(const auto& t : file.threads)
+		{
+			if(!t.records.empty())
+				origin = std::min(origin, t.records.front().ticks);
+		}
+
+		const auto microseconds_per_tick = (file.ticks_per_second > 0) ? 1e6 / file.ticks_per_second : 0.0;
+		const auto flags = s.flags();
+		s << std::fixed << std::setprecision(3);
+
+		s << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+		bool first = true;
+		for(const auto& t : file.threads)
+		{
+			for(const auto& r : t.records)
+			{
+				s << (first ? "\n" : ",\n");
+				first = false;
+
+				const auto name = file.names.find(r.event);
+				s << "{\"name\":";
+				write_json_string(s, (name != file.names.end()) ? name->second : "event " + std::to_string(r.event));
+				s << ",\"ph\":\"" << static_cast<char>(r.phase) << "\"";
+				if(r.phase == trace_phase::instant)
+					s << ",\"s\":\"t\"";
+				s << ",\"ts\":" << static_cast<double>(r.ticks - origin) * microseconds_per_tick
+					<< ",\"pid\":1,\"tid\":" << t.thread
+					<< ",\"args\":{\"argument\":" << r.argument << "}}";
+			}
+		}
+		s << "\n]}\n";
+
+		s.flags(flags);
+	}
+}
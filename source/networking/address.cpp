@@ -3,10 +3,64 @@
 /////////////////////////////////////////////////////////////////////////
 #include <networking/address.h>
 
-#include <stdexcept>
+#include <networking/numeric_address.h>
+#include <networking/endpoint.h>
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <string_view>
 
 namespace networking
 {
+	// ----------------------------------------------------------------------
+	// Constructors
+	// ----------------------------------------------------------------------
+	// Constructor (copies at most the size of the storage)
+	address::address(const sockaddr& a, socklen_t length, sa_family_t family) :
+		_valid(true),
+		_address(),
+		_length(length),
+		_family(family)
+	{
+		// The union only holds C socket address structs, which are trivially copyable (its constexpr
+		// constructor is what makes the compiler consider it non-trivial), so copying the bytes is valid
+		const auto size = std::min<std::size_t>(length, sizeof(_address));
+		std::memcpy(static_cast<void*>(&_address), &a, size);
+	}
+
+	// Constructor (IPv4)
+	address::address(const sockaddr_in& a) :
+		_valid(true),
+		_address(),
+		_length(sizeof(sockaddr_in)),
+		_family(AF_INET)
+	{
+		_address.v4 = a;
+	}
+
+	// Constructor (IPv6)
+	address::address(const sockaddr_in6& a) :
+		_valid(true),
+		_address(),
+		_length(sizeof(sockaddr_in6)),
+		_family(AF_INET6)
+	{
+		_address.v6 = a;
+	}
+
+#ifdef USE_POSIX
+	// Constructor (Unix domain socket)
+	address::address(const sockaddr_un& a, socklen_t length) :
+		_valid(true),
+		_address(),
+		_length(std::min<socklen_t>(length, sizeof(sockaddr_un))),
+		_family(AF_UNIX)
+	{
+		_address.local = a;
+	}
+#endif
+
 	// ----------------------------------------------------------------------
 	// Copy/move construction/assignment
 	// ----------------------------------------------------------------------
@@ -51,17 +105,47 @@ namespace networking
 	// ----------------------------------------------------------------------
 	// Public interface
 	// ----------------------------------------------------------------------
+	bool address::operator==(const address& a) const
+	{
+		if(_valid != a._valid || _family != a._family)
+			return false;
+		if(!_valid)
+			return true;
+
+		// Link-local IPv6 addresses on different interfaces are different peers
+		if(_family == AF_INET6 && _address.v6.sin6_scope_id != a._address.v6.sin6_scope_id)
+			return false;
+		if(_family == AF_INET || _family == AF_INET6)
+			return endpoint { *this } == endpoint { a };
+
+		return _length == a._length && std::memcmp(&_address, &a._address, std::min<std::size_t>(_length, sizeof(_address))) == 0;
+	}
+
 	result_string address::host(bool numeric_only) const
 	{
 		if(!_valid)
 			return { EAI_FAMILY, "invalid" };
 
+		if(_family == AF_UNIX)
+		{
+			char path[sizeof(_address) + 1];
+			const auto length = format_local(path, sizeof(path));
+			return { 0, std::string(path, length) };
+		}
+
+		if(numeric_only)
+		{
+			char numeric[max_ipv6_string_length];
+			if(format_host(numeric, sizeof(numeric)) > 0)
+				return { 0, std::string(numeric) };
+		}
+
 		constexpr uint32_t hostname_size = 256;
 		char hostname[hostname_size];
 
 		auto flags = numeric_only ? NI_NUMERICHOST : 0;
 
-		int result = getnameinfo(&(_address), _length, hostname, hostname_size, 0, 0, flags);
+		int result = getnameinfo(&(_address.base), _length, hostname, hostname_size, 0, 0, flags);
 		return { result, result == 0 ? std::string(hostname) : gai_strerror(result) };
 	}
 
@@ -70,13 +154,9 @@ namespace networking
 		if(!_valid)
 			return { EAI_FAMILY, "invalid" };
 
-		constexpr uint32_t service_size = 16;
-		char service[service_size];
-
-		auto flags = NI_NUMERICSERV;
-
-		int result = getnameinfo(&(_address), _length, 0, 0, service, service_size, flags);
-		return { result, result == 0 ? std::string(service) : gai_strerror(result) };
+		char service[max_port_string_length];
+		format_port(port_number(), service, sizeof(service));
+		return { 0, std::string(service) };
 	}
 
 	result_string address::to_string(bool numeric_host_only) const
@@ -84,36 +164,126 @@ namespace networking
 		if(!_valid)
 			return { EAI_FAMILY, "invalid" };
 
+		if(_family == AF_UNIX)
+			return { 0, "unix:" + host().value };
+
+		if(numeric_host_only)
+		{
+			char numeric[max_address_string_length];
+			if(format(numeric, sizeof(numeric)) > 0)
+				return { 0, std::string(numeric) };
+		}
+
 		constexpr uint32_t hostname_size = 256;
 		char hostname[hostname_size];
 		constexpr uint32_t service_size = 16;
 		char service[service_size];
 
-		auto flags = NI_NUMERICSERV | (numeric_host_only ? 0 : NI_NUMERICHOST);
+		auto flags = NI_NUMERICSERV | (numeric_host_only ? NI_NUMERICHOST : 0);
 
-		int result = getnameinfo(&(_address), _length, hostname, hostname_size, service, service_size, flags);
+		int result = getnameinfo(&(_address.base), _length, hostname, hostname_size, service, service_size, flags);
 		return { result, result == 0 ? (std::string(hostname) + ':' + std::string(service)) : gai_strerror(result) };
 	}
 
 	port_number_t address::port_number() const
 	{
-		auto p = port();
-		if(p.code != 0)
+		if(!_valid)
 			return 0;
 
-		uint32_t port_number = 0;
-		try
+		switch(_family)
 		{
-			port_number = std::stoul(p.value);
+			case AF_INET: return ntohs(_address.v4.sin_port);
+			case AF_INET6: return ntohs(_address.v6.sin6_port);
+			default: return 0;
 		}
-		catch(std::invalid_argument&)	// Throw message? For now just keep value 0
+	}
+
+	std::size_t address::format_host(char* buffer, std::size_t buffer_size) const
+	{
+		if(!_valid)
+			return 0;
+
+		switch(_family)
 		{
+			case AF_INET: return format_ipv4(_address.v4.sin_addr, buffer, buffer_size);
+			case AF_INET6: return format_ipv6(_address.v6.sin6_addr, buffer, buffer_size);
+			case AF_UNIX: return format_local(buffer, buffer_size);
+			default: return 0;
 		}
-		catch(std::out_of_range&)	// Throw message? For now just keep value 0
+	}
+
+	// Unix domain socket path, abstract names are shown with a leading '@' (empty for unnamed sockets)
+	std::size_t address::format_local(char* buffer, std::size_t buffer_size) const
+	{
+#ifdef USE_POSIX
+		const auto header = offsetof(sockaddr_un, sun_path);
+		if(buffer_size == 0 || _length <= header)
 		{
+			if(buffer_size > 0)
+				buffer[0] = '\0';
+			return 0;
 		}
 
-		return port_number;
+		const char* path = _address.local.sun_path;
+		std::size_t length = _length - header;
+		if(path[0] != '\0')
+			length = strnlen(path, length);
+
+		if(length + 1 > buffer_size)
+			return 0;
+
+		std::memcpy(buffer, path, length);
+		if(path[0] == '\0')
+			buffer[0] = '@';
+		buffer[length] = '\0';
+		return length;
+#else
+		(void)buffer;
+		(void)buffer_size;
+		return 0;
+#endif
+	}
+
+	std::size_t address::format(char* buffer, std::size_t buffer_size) const
+	{
+		if(_family == AF_UNIX)
+		{
+			constexpr char prefix[] = "unix:";
+			if(buffer_size < sizeof(prefix))
+				return 0;
+
+			const auto length = format_local(buffer + sizeof(prefix) - 1, buffer_size - sizeof(prefix) + 1);
+			if(length == 0 && _length > offsetof(sockaddr_un, sun_path))
+				return 0;
+
+			std::memcpy(buffer, prefix, sizeof(prefix) - 1);
+			return sizeof(prefix) - 1 + length;
+		}
+
+		// Format into a local buffer first, so the caller buffer is only touched on success
+		char scratch[max_address_string_length];
+		char* p = scratch;
+
+		const bool brackets = (_family == AF_INET6);
+		if(brackets)
+			*p++ = '[';
+
+		const auto host_length = format_host(p, sizeof(scratch) - (p - scratch));
+		if(host_length == 0)
+			return 0;
+		p += host_length;
+
+		if(brackets)
+			*p++ = ']';
+		*p++ = ':';
+		p += format_port(port_number(), p, sizeof(scratch) - (p - scratch));
+
+		const auto length = static_cast<std::size_t>(p - scratch);
+		if(length + 1 > buffer_size)
+			return 0;
+
+		std::memcpy(buffer, scratch, length + 1);
+		return length;
 	}
 
 	// ----------------------------------------------------------------------
@@ -162,6 +332,17 @@ namespace networking
 				return address { *(ptr->ai_addr), ptr->ai_addrlen, static_cast<sa_family_t>(ptr->ai_family) };
 			}
 
+			std::vector<address> retrieve_all()
+			{
+				std::vector<address> result;
+				for(auto ptr = _result; ptr != nullptr; ptr = ptr->ai_next)
+				{
+					if(ptr->ai_addr != nullptr)
+						result.emplace_back(*(ptr->ai_addr), ptr->ai_addrlen, static_cast<sa_family_t>(ptr->ai_family));
+				}
+				return result;
+			}
+
 		private:
 			struct addrinfo* _result;
 			int _error_code;
@@ -200,8 +381,69 @@ namespace networking
 		hints.ai_protocol = 0;
 	}
 
+	// Builds a Unix domain socket address, a leading '@' is replaced by a zero byte (abstract namespace)
+	address create_local_address(const std::string& path)
+	{
+#ifdef USE_POSIX
+		sockaddr_un a {};
+		if(path.empty() || path.size() > sizeof(a.sun_path) - (path[0] == '@' ? 0 : 1))
+			return address::invalid();
+
+		a.sun_family = AF_UNIX;
+		std::memcpy(a.sun_path, path.data(), path.size());
+
+		// Abstract names are not terminated, their length is part of the address
+		auto length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + path.size());
+		if(path[0] == '@')
+			a.sun_path[0] = '\0';
+		else
+			length++;
+
+		return address { a, length };
+#else
+		(void)path;
+		return address::invalid();
+#endif
+	}
+
+	// Builds an address directly from a numeric literal, returns an invalid address if it is not one
+	address create_numeric_address(const std::string& hostname, uint16_t port, ip_version ipv)
+	{
+		const auto begin = hostname.data();
+		const auto end = begin + hostname.size();
+
+		if(ipv != ip_version::ipv6)
+		{
+			sockaddr_in a {};
+			if(parse_ipv4(begin, end, a.sin_addr))
+			{
+				a.sin_family = AF_INET;
+				a.sin_port = htons(port);
+				return address { a };
+			}
+		}
+
+		if(ipv != ip_version::ipv4)
+		{
+			sockaddr_in6 a {};
+			if(parse_ipv6(begin, end, a.sin6_addr))
+			{
+				a.sin6_family = AF_INET6;
+				a.sin6_port = htons(port);
+				return address { a };
+			}
+		}
+
+		return address::invalid();
+	}
+
 	address create_address(std::string hostname, uint16_t port, protocol proto, bool resolve_hostname, ip_version ipv)
 	{
+		// Literal addresses do not need getaddrinfo
+		auto numeric = create_numeric_address(hostname, port, ipv);
+		if(numeric.valid())
+			return numeric;
+
 		// Prepare hints struct
 		struct addrinfo hints;
 		memset(&hints, 0, sizeof(hints));
@@ -217,6 +459,34 @@ namespace networking
 		return helper.retrieve();
 	}
 
+	int resolve_addresses(const std::string& hostname, uint16_t port, protocol proto, ip_version ipv, std::vector<address>& result)
+	{
+		result.clear();
+
+		auto numeric = create_numeric_address(hostname, port, ipv);
+		if(numeric.valid())
+		{
+			result.push_back(numeric);
+			return 0;
+		}
+
+		// Prepare hints struct
+		struct addrinfo hints;
+		memset(&hints, 0, sizeof(hints));
+
+		hints.ai_flags |= AI_ADDRCONFIG;	// Only check available addresses (i.e. only IPv4 if IPv6 is not supported)
+		hints.ai_flags |= AI_NUMERICSERV;	// Do not resolve service name to port number
+
+		set_hints(hints, proto, ipv);
+
+		address_info_helper helper { hostname, std::to_string(port), hints };
+		if(!helper.valid())
+			return helper.error_code();
+
+		result = helper.retrieve_all();
+		return 0;
+	}
+
 	address create_host_address(uint16_t port, protocol proto, ip_version ipv)
 	{
 		// Prepare hints struct
@@ -239,3 +509,11 @@ namespace networking
 		return s;
 	}
 }
+
+std::size_t std::hash<networking::address>::operator()(const networking::address& a) const
+{
+	if(a.family() == AF_UNIX)
+		return std::hash<std::string_view> {}(std::string_view { reinterpret_cast<const char*>(&a.get()), a.length() });
+
+	return networking::endpoint { a }.hash();
+}
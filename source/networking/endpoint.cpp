@@ -0,0 +1,113 @@
+/////////////////////////////////////////////////////////////////////////
+// Compact IP endpoint implementation
+/////////////////////////////////////////////////////////////////////////
+#include <networking/endpoint.h>
+#include <networking/address.h>
+#include <networking/numeric_address.h>
+
+#include <ostream>
+
+namespace networking
+{
+	namespace
+	{
+		constexpr uint8_t ipv4_mapped_prefix[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+	}
+
+	// ----------------------------------------------------------------------
+	// Constructors
+	// ----------------------------------------------------------------------
+	// Constructor (from an address object)
+	endpoint::endpoint(const address& a) : endpoint()
+	{
+		if(a.valid())
+			*this = endpoint { a.get(), a.length() };
+	}
+
+	// Constructor (from a generic socket address)
+	endpoint::endpoint(const sockaddr& a, socklen_t length) : endpoint()
+	{
+		if(a.sa_family == AF_INET && length >= static_cast<socklen_t>(sizeof(sockaddr_in)))
+			*this = endpoint { reinterpret_cast<const sockaddr_in&>(a) };
+		else if(a.sa_family == AF_INET6 && length >= static_cast<socklen_t>(sizeof(sockaddr_in6)))
+			*this = endpoint { reinterpret_cast<const sockaddr_in6&>(a) };
+	}
+
+	// Constructor (IPv4)
+	endpoint::endpoint(const sockaddr_in& a) :
+		_bytes{},
+		_port(ntohs(a.sin_port)),
+		_family(family_type::ipv4),
+		_reserved(0)
+	{
+		std::memcpy(_bytes.data(), ipv4_mapped_prefix, sizeof(ipv4_mapped_prefix));
+		std::memcpy(_bytes.data() + 12, &a.sin_addr, 4);
+	}
+
+	// Constructor (IPv6)
+	endpoint::endpoint(const sockaddr_in6& a) :
+		_bytes{},
+		_port(ntohs(a.sin6_port)),
+		_family(family_type::ipv6),
+		_reserved(0)
+	{
+		std::memcpy(_bytes.data(), &a.sin6_addr, 16);
+	}
+
+	// ----------------------------------------------------------------------
+	// Public interface
+	// ----------------------------------------------------------------------
+	// Fills a socket address and returns its length (zero for an invalid endpoint)
+	socklen_t endpoint::to_sockaddr(sockaddr_storage& storage) const
+	{
+		std::memset(&storage, 0, sizeof(storage));
+
+		if(_family == family_type::ipv4)
+		{
+			auto& a = reinterpret_cast<sockaddr_in&>(storage);
+			a.sin_family = AF_INET;
+			a.sin_port = htons(_port);
+			std::memcpy(&a.sin_addr, _bytes.data() + 12, 4);
+			return sizeof(sockaddr_in);
+		}
+
+		if(_family == family_type::ipv6)
+		{
+			auto& a = reinterpret_cast<sockaddr_in6&>(storage);
+			a.sin6_family = AF_INET6;
+			a.sin6_port = htons(_port);
+			std::memcpy(&a.sin6_addr, _bytes.data(), 16);
+			return sizeof(sockaddr_in6);
+		}
+
+		return 0;
+	}
+
+	address endpoint::to_address() const
+	{
+		sockaddr_storage storage;
+		const auto length = to_sockaddr(storage);
+		if(length == 0)
+			return address::invalid();
+
+		return address { *reinterpret_cast<const sockaddr*>(&storage), length, storage.ss_family };
+	}
+
+	std::size_t endpoint::format(char* buffer, std::size_t buffer_size) const
+	{
+		return to_address().format(buffer, buffer_size);
+	}
+
+	// ----------------------------------------------------------------------
+	// Non-member non-friend functions
+	// ----------------------------------------------------------------------
+	std::ostream& operator<<(std::ostream& s, const endpoint& e)
+	{
+		char buffer[max_address_string_length];
+		if(e.format(buffer, sizeof(buffer)) > 0)
+			s << buffer;
+		else
+			s << "invalid";
+		return s;
+	}
+}
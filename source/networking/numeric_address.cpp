@@ -0,0 +1,265 @@
+/////////////////////////////////////////////////////////////////////////
+// Numeric IP address parsing and formatting implementation
+/////////////////////////////////////////////////////////////////////////
+#include <networking/numeric_address.h>
+
+#include <cstring>
+
+namespace networking
+{
+	namespace
+	{
+		constexpr char hex_digits[] = "0123456789abcdef";
+
+		inline int hex_value(char c)
+		{
+			if(c >= '0' && c <= '9') return c - '0';
+			if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+			if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+			return -1;
+		}
+
+		// Writes a decimal number (at most five digits) and returns the new position
+		inline char* write_decimal(char* p, uint32_t value)
+		{
+			char digits[5];
+			int n = 0;
+			do
+			{
+				digits[n++] = static_cast<char>('0' + value % 10);
+				value /= 10;
+			} while(value != 0);
+
+			while(n > 0)
+				*p++ = digits[--n];
+			return p;
+		}
+
+		// Writes a 16-bit group in lowercase hex without leading zeros
+		inline char* write_hex_group(char* p, uint16_t value)
+		{
+			bool started = false;
+			for(int shift = 12; shift >= 0; shift -= 4)
+			{
+				const auto digit = (value >> shift) & 0xF;
+				if(digit != 0 || started || shift == 0)
+				{
+					*p++ = hex_digits[digit];
+					started = true;
+				}
+			}
+			return p;
+		}
+
+		inline char* write_ipv4(char* p, const uint8_t* octets)
+		{
+			for(int i = 0; i < 4; i++)
+			{
+				if(i > 0)
+					*p++ = '.';
+				p = write_decimal(p, octets[i]);
+			}
+			return p;
+		}
+
+		inline std::size_t terminate(char* buffer, char* end, std::size_t buffer_size, const char* scratch)
+		{
+			const auto length = static_cast<std::size_t>(end - scratch);
+			if(length + 1 > buffer_size)
+				return 0;
+
+			std::memcpy(buffer, scratch, length);
+			buffer[length] = 0;
+			return length;
+		}
+	}
+
+	// ----------------------------------------------------------------------
+	// Parsing
+	// ----------------------------------------------------------------------
+	bool parse_ipv4(const char* p, const char* end, in_addr& result)
+	{
+		uint8_t octets[4];
+		for(int i = 0; i < 4; i++)
+		{
+			if(i > 0)
+			{
+				if(p == end || *p != '.')
+					return false;
+				p++;
+			}
+
+			// One to three digits, no leading zeros (to avoid octal ambiguity), at most 255
+			uint32_t value = 0;
+			int digits = 0;
+			for( ; p != end && *p >= '0' && *p <= '9' && digits < 3; p++, digits++)
+				value = value * 10 + static_cast<uint32_t>(*p - '0');
+
+			if(digits == 0 || value > 255 || (digits > 1 && p[-digits] == '0'))
+				return false;
+			octets[i] = static_cast<uint8_t>(value);
+		}
+
+		if(p != end)
+			return false;
+
+		std::memcpy(&result, octets, sizeof(octets));
+		return true;
+	}
+
+	bool parse_ipv6(const char* p, const char* end, in6_addr& result)
+	{
+		uint8_t bytes[16] = {};
+		int groups = 0;		// Number of 16-bit groups parsed
+		int gap = -1;		// Group index of "::", if present
+
+		if(end - p >= 2 && p[0] == ':' && p[1] == ':')
+		{
+			gap = 0;
+			p += 2;
+		}
+
+		while(p != end)
+		{
+			if(groups == 8)
+				return false;
+
+			// Hex group of one to four digits
+			const auto start = p;
+			uint32_t value = 0;
+			for( ; p != end && hex_value(*p) >= 0 && p - start < 4; p++)
+				value = (value << 4) | static_cast<uint32_t>(hex_value(*p));
+
+			// Embedded IPv4 address in the last 32 bits
+			if(p != end && *p == '.')
+			{
+				in_addr v4;
+				if(groups > 6 || !parse_ipv4(start, end, v4))
+					return false;
+
+				std::memcpy(bytes + 2 * groups, &v4, sizeof(v4));
+				groups += 2;
+				p = end;
+				break;
+			}
+
+			if(p == start)
+				return false;
+
+			bytes[2 * groups] = static_cast<uint8_t>(value >> 8);
+			bytes[2 * groups + 1] = static_cast<uint8_t>(value);
+			groups++;
+
+			if(p == end)
+				break;
+			if(*p++ != ':')
+				return false;
+
+			if(p != end && *p == ':')
+			{
+				if(gap >= 0)
+					return false;
+				gap = groups;
+				p++;
+			}
+			else if(p == end)
+			{
+				return false;	// Trailing single colon
+			}
+		}
+
+		if(gap < 0)
+		{
+			if(groups != 8)
+				return false;
+		}
+		else
+		{
+			// "::" stands for at least one zero group
+			if(groups > 7)
+				return false;
+
+			const auto tail = groups - gap;
+			std::memmove(bytes + 16 - 2 * tail, bytes + 2 * gap, 2 * tail);
+			std::memset(bytes + 2 * gap, 0, 16 - 2 * groups);
+		}
+
+		std::memcpy(&result, bytes, sizeof(bytes));
+		return true;
+	}
+
+	// ----------------------------------------------------------------------
+	// Formatting
+	// ----------------------------------------------------------------------
+	std::size_t format_ipv4(const in_addr& a, char* buffer, std::size_t buffer_size)
+	{
+		char scratch[max_ipv4_string_length];
+		auto end = write_ipv4(scratch, reinterpret_cast<const uint8_t*>(&a));
+		return terminate(buffer, end, buffer_size, scratch);
+	}
+
+	std::size_t format_ipv6(const in6_addr& a, char* buffer, std::size_t buffer_size)
+	{
+		const auto bytes = reinterpret_cast<const uint8_t*>(&a);
+		uint16_t groups[8];
+		for(int i = 0; i < 8; i++)
+			groups[i] = static_cast<uint16_t>((bytes[2 * i] << 8) | bytes[2 * i + 1]);
+
+		// Find the longest run of at least two zero groups (the first one on ties)
+		int best_start = -1, best_length = 0;
+		for(int i = 0; i < 8; )
+		{
+			if(groups[i] != 0)
+			{
+				i++;
+				continue;
+			}
+
+			int j = i;
+			while(j < 8 && groups[j] == 0)
+				j++;
+			if(j - i > best_length && j - i >= 2)
+			{
+				best_start = i;
+				best_length = j - i;
+			}
+			i = j;
+		}
+
+		char scratch[max_ipv6_string_length];
+		char* p = scratch;
+
+		// IPv4-mapped addresses (::ffff:a.b.c.d)
+		const bool mapped = (best_start == 0 && best_length == 5 && groups[5] == 0xFFFF);
+		const int last_group = mapped ? 6 : 8;
+
+		for(int i = 0; i < last_group; )
+		{
+			if(i == best_start)
+			{
+				*p++ = ':';
+				if(i == 0)
+					*p++ = ':';
+				i += best_length;
+				continue;
+			}
+
+			p = write_hex_group(p, groups[i]);
+			i++;
+			if(i < last_group || mapped)
+				*p++ = ':';
+		}
+
+		if(mapped)
+			p = write_ipv4(p, bytes + 12);
+
+		return terminate(buffer, p, buffer_size, scratch);
+	}
+
+	std::size_t format_port(port_number_t port, char* buffer, std::size_t buffer_size)
+	{
+		char scratch[max_port_string_length];
+		auto end = write_decimal(scratch, port);
+		return terminate(buffer, end, buffer_size, scratch);
+	}
+}
@@ -5,10 +5,12 @@
 #ifdef USE_POSIX
 
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <sys/types.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <string>
 #include <cstring>
 #include <cerrno>
@@ -28,6 +30,16 @@ namespace networking
 	inline bool is_valid_socket(socket_type s) { return (s >= 0); }
 	inline void close_socket(socket_type s) { close(s); }
 
+	// Switches a socket between blocking and non-blocking mode
+	inline bool set_blocking(socket_type s, bool blocking)
+	{
+		auto flags = fcntl(s, F_GETFL, 0);
+		if(flags < 0)
+			return false;
+		flags = blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+		return fcntl(s, F_SETFL, flags) == 0;
+	}
+
 	struct socket_error_information
 	{
 		int error_code;
@@ -40,6 +52,9 @@ namespace networking
 		auto code = errno;
 		return { code, strerror(code) };
 	}
+
+	// True for errors from non-blocking sockets that just have to wait
+	inline bool would_block(const socket_error_information& e) { return e.error_code == EAGAIN || e.error_code == EWOULDBLOCK; }
 }
 
 #endif
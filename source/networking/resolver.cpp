@@ -0,0 +1,274 @@
+/////////////////////////////////////////////////////////////////////////
+// Asynchronous resolver implementation
+/////////////////////////////////////////////////////////////////////////
+#include <networking/resolver.h>
+
+namespace networking
+{
+	struct resolver::lookup
+	{
+		std::string key;
+		std::string hostname;
+		port_number_t port;
+		protocol proto;
+		ip_version ipv;
+		std::promise<resolution> promise;
+		std::shared_future<resolution> future;
+		std::vector<callback_type> callbacks;
+	};
+
+	namespace
+	{
+		std::string make_key(const std::string& hostname, port_number_t port, protocol proto, ip_version ipv)
+		{
+			auto key = hostname;
+			key += '\0';
+			key += std::to_string(port);
+			key += static_cast<char>('0' + static_cast<int>(proto));
+			key += static_cast<char>('0' + static_cast<int>(ipv));
+			return key;
+		}
+
+		std::shared_future<resolution> ready_future(const resolution& result)
+		{
+			std::promise<resolution> p;
+			p.set_value(result);
+			return p.get_future().share();
+		}
+	}
+
+	// ----------------------------------------------------------------------
+	// Constructor / destructor
+	// ----------------------------------------------------------------------
+	resolver::resolver(const resolver_options& options) :
+		_options(options),
+		_mutex(),
+		_condition(),
+		_jobs(),
+		_pending(),
+		_cache(),
+		_completions(),
+		_workers(),
+		_lookups(0),
+		_stopping(false),
+		_notification{ uninitialized_socket, uninitialized_socket }
+	{
+		if(::pipe(_notification) == 0)
+		{
+			set_blocking(_notification[0], false);
+			set_blocking(_notification[1], false);
+		}
+
+		const auto workers = _options.workers > 0 ? _options.workers : 1;
+		for(std::size_t i = 0; i < workers; i++)
+			_workers.emplace_back(&resolver::worker, this);
+	}
+
+	resolver::~resolver()
+	{
+		{
+			std::lock_guard<std::mutex> lock { _mutex };
+			_stopping = true;
+		}
+		_condition.notify_all();
+
+		for(auto& t : _workers)
+			t.join();
+
+		// Complete lookups that never ran
+		for(auto& job : _jobs)
+			job->promise.set_value({ EAI_AGAIN, {} });
+
+		for(auto fd : _notification)
+		{
+			if(is_valid_socket(fd))
+				::close(fd);
+		}
+	}
+
+	// ----------------------------------------------------------------------
+	// Public interface
+	// ----------------------------------------------------------------------
+	// Resolve and provide the result through a future
+	std::shared_future<resolution> resolver::resolve(const std::string& hostname, port_number_t port, protocol proto, ip_version ipv)
+	{
+		return submit(hostname, port, proto, ipv, nullptr);
+	}
+
+	// Resolve and provide the result through a callback run by dispatch()
+	void resolver::resolve(const std::string& hostname, port_number_t port, protocol proto, ip_version ipv, callback_type callback)
+	{
+		submit(hostname, port, proto, ipv, &callback);
+	}
+
+	// Runs the callbacks of completed lookups on the calling thread
+	std::size_t resolver::dispatch()
+	{
+		// Drain the notification pipe before taking the completions, so no notification is lost
+		char drain[64];
+		while(::read(_notification[0], drain, sizeof(drain)) > 0)
+			;
+
+		std::vector<std::function<void()>> completions;
+		{
+			std::lock_guard<std::mutex> lock { _mutex };
+			completions.swap(_completions);
+		}
+
+		for(auto& c : completions)
+			c();
+
+		return completions.size();
+	}
+
+	void resolver::clear_cache()
+	{
+		std::lock_guard<std::mutex> lock { _mutex };
+		_cache.clear();
+	}
+
+	std::size_t resolver::cache_size() const
+	{
+		std::lock_guard<std::mutex> lock { _mutex };
+		return _cache.size();
+	}
+
+	std::size_t resolver::lookups() const
+	{
+		std::lock_guard<std::mutex> lock { _mutex };
+		return _lookups;
+	}
+
+	// ----------------------------------------------------------------------
+	// Private helpers
+	// ----------------------------------------------------------------------
+	std::shared_future<resolution> resolver::submit(const std::string& hostname, port_number_t port, protocol proto, ip_version ipv, callback_type* callback)
+	{
+		const auto key = make_key(hostname, port, proto, ipv);
+		std::shared_future<resolution> result;
+		bool notify_now = false;
+
+		{
+			std::lock_guard<std::mutex> lock { _mutex };
+
+			resolution cached_result;
+			if(cached(key, cached_result))
+			{
+				if(callback != nullptr)
+				{
+					_completions.push_back([c = std::move(*callback), r = cached_result]() { c(r); });
+					notify_now = true;
+				}
+				result = ready_future(cached_result);
+			}
+			else
+			{
+				// Join an identical lookup in progress, or start a new one
+				auto& pending = _pending[key];
+				if(!pending)
+				{
+					pending = std::make_shared<lookup>();
+					pending->key = key;
+					pending->hostname = hostname;
+					pending->port = port;
+					pending->proto = proto;
+					pending->ipv = ipv;
+					pending->future = pending->promise.get_future().share();
+					_jobs.push_back(pending);
+					_condition.notify_one();
+				}
+
+				if(callback != nullptr)
+					pending->callbacks.push_back(std::move(*callback));
+				result = pending->future;
+			}
+		}
+
+		if(notify_now)
+			notify();
+
+		return result;
+	}
+
+	// Looks up a cache entry, removing it if expired (call with the mutex locked)
+	bool resolver::cached(const std::string& key, resolution& result)
+	{
+		auto i = _cache.find(key);
+		if(i == _cache.end())
+			return false;
+
+		if(i->second.expiry <= clock_type::now())
+		{
+			_cache.erase(i);
+			return false;
+		}
+
+		result = i->second.result;
+		return true;
+	}
+
+	// Adds a cache entry, evicting expired (or if necessary arbitrary) entries when full (call with the mutex locked)
+	void resolver::store(const std::string& key, const resolution& result)
+	{
+		const auto now = clock_type::now();
+		const auto ttl = (result.code == 0) ? _options.positive_ttl : _options.negative_ttl;
+		if(ttl.count() <= 0 || _options.max_cache_entries == 0)
+			return;
+
+		if(_cache.size() >= _options.max_cache_entries)
+		{
+			for(auto i = _cache.begin(); i != _cache.end(); )
+				i = (i->second.expiry <= now) ? _cache.erase(i) : std::next(i);
+
+			if(_cache.size() >= _options.max_cache_entries)
+				_cache.erase(_cache.begin());
+		}
+
+		_cache[key] = cache_entry { result, now + ttl };
+	}
+
+	void resolver::worker()
+	{
+		while(true)
+		{
+			std::shared_ptr<lookup> job;
+			{
+				std::unique_lock<std::mutex> lock { _mutex };
+				_condition.wait(lock, [this]() { return _stopping || !_jobs.empty(); });
+				if(_stopping)
+					return;
+
+				job = _jobs.front();
+				_jobs.pop_front();
+				_lookups++;
+			}
+
+			// !! BLOCKING !!
+			resolution result;
+			result.code = resolve_addresses(job->hostname, job->port, job->proto, job->ipv, result.addresses);
+
+			bool has_callbacks = false;
+			{
+				std::lock_guard<std::mutex> lock { _mutex };
+				store(job->key, result);
+				_pending.erase(job->key);
+
+				for(auto& c : job->callbacks)
+					_completions.push_back([c = std::move(c), result]() { c(result); });
+				has_callbacks = !job->callbacks.empty();
+			}
+
+			job->promise.set_value(result);
+			if(has_callbacks)
+				notify();
+		}
+	}
+
+	// Wakes up whoever polls the notification handle
+	void resolver::notify()
+	{
+		const char signal = 1;
+		auto result = ::write(_notification[1], &signal, 1);
+		(void)result;	// A full pipe means a wakeup is pending anyway
+	}
+}
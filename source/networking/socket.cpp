@@ -7,6 +7,29 @@
 
 namespace networking
 {
+	namespace
+	{
+		int address_family(ip_version ipv)
+		{
+			switch(ipv)
+			{
+				case ip_version::ipv6: return AF_INET6;
+				case ip_version::local: return AF_UNIX;
+				default: return AF_INET;
+			}
+		}
+
+		int socket_type_for(protocol p)
+		{
+			switch(p)
+			{
+				case protocol::tcp: return SOCK_STREAM;
+				case protocol::seqpacket: return SOCK_SEQPACKET;
+				default: return SOCK_DGRAM;
+			}
+		}
+	}
+
 	// ----------------------------------------------------------------------
 	// Constructors / destructor
 	// ----------------------------------------------------------------------
@@ -18,8 +41,8 @@ namespace networking
 	// Constructor
 	socket::socket(protocol p, ip_version ipv) : _socket(uninitialized_socket)
 	{
-		auto inet_protocol = (ipv == ip_version::ipv6 ? AF_INET6 : AF_INET);
-		auto protocol_type = (p == protocol::tcp ? SOCK_STREAM : SOCK_DGRAM);
+		auto inet_protocol = address_family(ipv);
+		auto protocol_type = socket_type_for(p);
 		auto specific_protocol = 0;
 		auto s = ::socket(inet_protocol, protocol_type, specific_protocol);
 
@@ -27,6 +50,34 @@ namespace networking
 			_socket = s;
 	}
 
+	// Constructor applying options at creation (non-blocking mode without an extra call where supported)
+	socket::socket(protocol p, ip_version ipv, const socket_options& options, socket_error_information* error) : _socket(uninitialized_socket)
+	{
+		auto inet_protocol = address_family(ipv);
+		int protocol_type = socket_type_for(p);
+		auto remaining = options;
+
+#ifdef SOCK_NONBLOCK
+		if(options.non_blocking.value_or(false))
+		{
+			protocol_type |= SOCK_NONBLOCK;
+			remaining.non_blocking.reset();
+		}
+#endif
+
+		auto s = ::socket(inet_protocol, protocol_type, 0);
+		if(!is_valid_socket(s))
+		{
+			if(error != nullptr)
+				*error = get_error_information();
+			return;
+		}
+
+		_socket = s;
+		if(!remaining.empty())
+			set_options(remaining, error);
+	}
+
 	// Constructor
 	socket::socket(socket_type s) : _socket(s)
 	{
@@ -54,6 +105,13 @@ namespace networking
 	// Move-assignment
 	socket& socket::operator=(socket&& s)
 	{
+		if(this == &s)
+			return *this;
+
+		// The socket held so far is closed
+		if(valid())
+			close_socket(_socket);
+
 		// Make a proper swap such that two socket objects never hold the same socket
 		auto temp = s._socket;
 		s._socket = uninitialized_socket;
@@ -70,4 +128,9 @@ namespace networking
 		close_socket(_socket);
 		_socket = uninitialized_socket;
 	}
+
+	bool socket::set_options(const socket_options& options, socket_error_information* error)
+	{
+		return apply_socket_options(_socket, options, error);
+	}
 }
@@ -0,0 +1,144 @@
+/////////////////////////////////////////////////////////////////////////
+// Socket tuning options implementation
+/////////////////////////////////////////////////////////////////////////
+#include <networking/socket_options.h>
+
+#ifdef USE_POSIX
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+namespace networking
+{
+	namespace
+	{
+		bool set_option(socket_type s, int level, int name, int value, socket_error_information* error)
+		{
+			if(::setsockopt(s, level, name, reinterpret_cast<const char*>(&value), sizeof(value)) == 0)
+				return true;
+
+			if(error != nullptr)
+				*error = get_error_information();
+			return false;
+		}
+
+		// Unused where the platform supports every option
+		[[maybe_unused]] bool unsupported(socket_error_information* error)
+		{
+			if(error != nullptr)
+				*error = { ENOPROTOOPT, "Socket option not supported on this platform" };
+			return false;
+		}
+	}
+
+	// ----------------------------------------------------------------------
+	// Public interface
+	// ----------------------------------------------------------------------
+	bool socket_options::empty() const
+	{
+		return !no_delay && !quick_ack && !cork && !receive_buffer && !send_buffer && !busy_poll
+			&& !incoming_cpu && !defer_accept && !user_timeout && !fast_open && !fast_open_connect && !non_blocking;
+	}
+
+	socket_options socket_options::not_inherited() const
+	{
+#ifdef __linux__
+		socket_options result;
+		result.quick_ack = quick_ack;
+		result.non_blocking = non_blocking;
+		return result;
+#else
+		auto result = *this;
+		result.defer_accept.reset();
+		result.fast_open.reset();
+		result.fast_open_connect.reset();
+		return result;
+#endif
+	}
+
+	// Applies the options that are set, stops at the first failure
+	bool apply_socket_options(socket_type s, const socket_options& options, socket_error_information* error)
+	{
+		if(options.no_delay && !set_option(s, IPPROTO_TCP, TCP_NODELAY, *options.no_delay ? 1 : 0, error))
+			return false;
+
+		if(options.receive_buffer && !set_option(s, SOL_SOCKET, SO_RCVBUF, *options.receive_buffer, error))
+			return false;
+
+		if(options.send_buffer && !set_option(s, SOL_SOCKET, SO_SNDBUF, *options.send_buffer, error))
+			return false;
+
+#ifdef TCP_QUICKACK
+		if(options.quick_ack && !set_option(s, IPPROTO_TCP, TCP_QUICKACK, *options.quick_ack ? 1 : 0, error))
+			return false;
+#else
+		if(options.quick_ack)
+			return unsupported(error);
+#endif
+
+#ifdef TCP_CORK
+		if(options.cork && !set_option(s, IPPROTO_TCP, TCP_CORK, *options.cork ? 1 : 0, error))
+			return false;
+#else
+		if(options.cork)
+			return unsupported(error);
+#endif
+
+#ifdef SO_BUSY_POLL
+		if(options.busy_poll && !set_option(s, SOL_SOCKET, SO_BUSY_POLL, *options.busy_poll, error))
+			return false;
+#else
+		if(options.busy_poll)
+			return unsupported(error);
+#endif
+
+#ifdef SO_INCOMING_CPU
+		if(options.incoming_cpu && !set_option(s, SOL_SOCKET, SO_INCOMING_CPU, *options.incoming_cpu, error))
+			return false;
+#else
+		if(options.incoming_cpu)
+			return unsupported(error);
+#endif
+
+#ifdef TCP_DEFER_ACCEPT
+		if(options.defer_accept && !set_option(s, IPPROTO_TCP, TCP_DEFER_ACCEPT, *options.defer_accept, error))
+			return false;
+#else
+		if(options.defer_accept)
+			return unsupported(error);
+#endif
+
+#ifdef TCP_USER_TIMEOUT
+		if(options.user_timeout && !set_option(s, IPPROTO_TCP, TCP_USER_TIMEOUT, static_cast<int>(options.user_timeout->count()), error))
+			return false;
+#else
+		if(options.user_timeout)
+			return unsupported(error);
+#endif
+
+#ifdef TCP_FASTOPEN
+		if(options.fast_open && !set_option(s, IPPROTO_TCP, TCP_FASTOPEN, *options.fast_open, error))
+			return false;
+#else
+		if(options.fast_open)
+			return unsupported(error);
+#endif
+
+#ifdef TCP_FASTOPEN_CONNECT
+		if(options.fast_open_connect && !set_option(s, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, *options.fast_open_connect ? 1 : 0, error))
+			return false;
+#else
+		if(options.fast_open_connect)
+			return unsupported(error);
+#endif
+
+		if(options.non_blocking && !set_blocking(s, !*options.non_blocking))
+		{
+			if(error != nullptr)
+				*error = get_error_information();
+			return false;
+		}
+
+		return true;
+	}
+}
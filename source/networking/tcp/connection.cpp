@@ -2,9 +2,65 @@
 // TCP connection implementation
 /////////////////////////////////////////////////////////////////////////
 #include <networking/tcp/connection.h>
+#include <metrics/probes.h>
+#include <metrics/trace.h>
+
+#include <cstddef>
+#include <cstring>
+
+#ifdef USE_POSIX
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
 
 namespace networking::tcp
 {
+	namespace
+	{
+#ifdef __linux__
+		// Offsets of the TCP_INFO fields in the kernel's struct tcp_info (linux/tcp.h), which only grows at the end
+		// Note: Read from raw bytes, as the C libraries' struct tcp_info ends after different fields.
+		namespace tcp_info_offset
+		{
+			constexpr std::size_t snd_mss = 16;
+			constexpr std::size_t unacked = 24;
+			constexpr std::size_t lost = 32;
+			constexpr std::size_t rtt = 68;
+			constexpr std::size_t rttvar = 72;
+			constexpr std::size_t snd_ssthresh = 76;
+			constexpr std::size_t snd_cwnd = 80;
+			constexpr std::size_t total_retrans = 100;
+			constexpr std::size_t notsent_bytes = 144;
+			constexpr std::size_t delivery_rate = 160;
+			constexpr std::size_t end = 168;		// Up to tcpi_delivery_rate
+		}
+#endif
+
+		ssize_t probe_received(ssize_t result)
+		{
+			if(const auto* probes = metrics::connection_probes_enabled())
+			{
+				probes->receive_calls.add();
+				if(result > 0)
+					probes->bytes_received.add(static_cast<uint64_t>(result));
+			}
+			metrics::trace(metrics::trace_event::receive, metrics::trace_phase::instant, result);
+			return result;
+		}
+
+		ssize_t probe_sent(ssize_t result)
+		{
+			if(const auto* probes = metrics::connection_probes_enabled())
+			{
+				probes->send_calls.add();
+				if(result > 0)
+					probes->bytes_sent.add(static_cast<uint64_t>(result));
+			}
+			metrics::trace(metrics::trace_event::send, metrics::trace_phase::instant, result);
+			return result;
+		}
+	}
+
 	// ----------------------------------------------------------------------
 	// Constructors / destructor
 	// ----------------------------------------------------------------------
@@ -13,7 +69,8 @@ namespace networking::tcp
 		_address(target),
 		_socket(protocol::tcp, target.ip_version_value()),
 		_status(status::invalid),
-		_error({0, "No error"})
+		_error({0, "No error"}),
+		_non_blocking(false)
 	{
 		if(_socket.valid())
 		{
@@ -30,12 +87,122 @@ namespace networking::tcp
 		}
 	}
 
+	// Constructor (optionally non-blocking, completed by finish_connect once the socket is writable)
+	// The options are applied before connecting, their non-blocking mode takes effect once connected.
+	connection::connection(const networking::address& target, bool non_blocking, const socket_options& options) :
+		connection(target, protocol::tcp, non_blocking, options)
+	{
+	}
+
+	// Constructor for other stream-like protocols (protocol::tcp also covers Unix domain stream sockets)
+	connection::connection(const networking::address& target, protocol p, bool non_blocking, const socket_options& options) :
+		_address(target),
+		_socket(),
+		_status(status::invalid),
+		_error({0, "No error"}),
+		_non_blocking(options.non_blocking.value_or(false))
+	{
+		auto creation_options = options;
+		creation_options.non_blocking.reset();
+		if(non_blocking)
+			creation_options.non_blocking = true;
+
+		networking::socket s { p, target.ip_version_value(), creation_options, &_error };
+		_socket = std::move(s);
+		if(!_socket.valid() || _error.error_code != 0)
+		{
+			_status = _socket.valid() ? status::error : status::invalid;
+			return;
+		}
+
+		auto result = ::connect(_socket.get(), &(target.get()), target.length());
+		if(result == 0)
+		{
+			_status = status::open;
+			if(non_blocking != _non_blocking)
+				set_blocking(_socket.get(), !_non_blocking);
+		}
+		else if(non_blocking && errno == EINPROGRESS)
+		{
+			_status = status::connecting;
+		}
+		else
+		{
+			_error = get_error_information();
+			_status = status::error;
+		}
+	}
+
+	// Constructor connecting with initial data, which is sent with the SYN if the server has given us a
+	// TCP Fast Open cookie before (otherwise after the handshake, as with connect and send).
+	// Falls back to a regular connect where Fast Open is not available.
+	connection::connection(const networking::address& target, const uint8_t* initial_data, std::size_t size, const socket_options& options) :
+		_address(target),
+		_socket(),
+		_status(status::invalid),
+		_error({0, "No error"}),
+		_non_blocking(options.non_blocking.value_or(false))
+	{
+		auto creation_options = options;
+		creation_options.non_blocking.reset();
+
+		networking::socket s { protocol::tcp, target.ip_version_value(), creation_options, &_error };
+		_socket = std::move(s);
+		if(!_socket.valid() || _error.error_code != 0)
+		{
+			_status = _socket.valid() ? status::error : status::invalid;
+			return;
+		}
+
+		ssize_t sent = -1;
+		bool connected = false;
+#ifdef MSG_FASTOPEN
+		sent = ::sendto(_socket.get(), initial_data, size, MSG_FASTOPEN, &(target.get()), target.length());
+		connected = (sent >= 0);
+		if(sent < 0 && errno != EOPNOTSUPP)
+		{
+			_error = get_error_information();
+			_status = status::error;
+			return;
+		}
+#endif
+
+		// Fast Open is disabled (or unknown), connect first
+		if(!connected)
+		{
+			if(::connect(_socket.get(), &(target.get()), target.length()) != 0)
+			{
+				_error = get_error_information();
+				_status = status::error;
+				return;
+			}
+			sent = 0;
+		}
+
+		_status = status::open;
+		for(auto offset = static_cast<std::size_t>(sent); offset < size; )
+		{
+			auto result = send(initial_data + offset, size - offset);
+			if(result < 0)
+			{
+				_error = get_error_information();
+				_status = status::error;
+				return;
+			}
+			offset += static_cast<std::size_t>(result);
+		}
+
+		if(_non_blocking)
+			set_blocking(_socket.get(), false);
+	}
+
 	// Constructor
 	connection::connection(networking::socket&& s, const address& a, status state, const socket_error_information& e) :
 		_address(a),
 		_socket(std::move(s)),
 		_status(_socket.valid() ? state : status::invalid),
-		_error(e)
+		_error(e),
+		_non_blocking(false)
 	{
 	}
 
@@ -52,7 +219,8 @@ namespace networking::tcp
 		  _address(std::move(s._address)),
 		  _socket(std::move(s._socket)),
 		  _status(std::move(s._status)),
-		  _error(std::move(s._error))
+		  _error(std::move(s._error)),
+		  _non_blocking(s._non_blocking)
 	{
 	}
 
@@ -63,6 +231,7 @@ namespace networking::tcp
 		_socket = std::move(s._socket);
 		_status = std::move(s._status);
 		_error = std::move(s._error);
+		_non_blocking = s._non_blocking;
 
 		return *this;
 	}
@@ -70,6 +239,34 @@ namespace networking::tcp
 	// ----------------------------------------------------------------------
 	// Public interface
 	// ----------------------------------------------------------------------
+	// Checks the outcome of a non-blocking connect (call when the socket becomes writable)
+	bool connection::finish_connect()
+	{
+		if(_status != status::connecting)
+			return _status == status::open;
+
+		int error = 0;
+		socklen_t length = sizeof(error);
+		if(::getsockopt(_socket.get(), SOL_SOCKET, SO_ERROR, &error, &length) != 0)
+			error = errno;
+
+		if(error == 0)
+		{
+			_status = status::open;
+			if(!_non_blocking)
+				set_blocking(_socket.get(), true);
+			return true;
+		}
+
+		if(error != EINPROGRESS && error != EALREADY)
+		{
+			_error = { error, strerror(error) };
+			_status = status::error;
+		}
+
+		return false;
+	}
+
 	// Shutdown further communication, but not closing the socket (there may still be data to process in send/receive buffers)
 	// Note: Call shutdown and make sure that buffers become empty before closing.
 	void connection::shutdown()
@@ -86,18 +283,186 @@ namespace networking::tcp
 		_status = status::closed;
 	}
 
+	// Applies further options to the connected socket
+	bool connection::set_options(const socket_options& options)
+	{
+		if(!_socket.set_options(options, &_error))
+			return false;
+
+		if(options.non_blocking)
+			_non_blocking = *options.non_blocking;
+		return true;
+	}
+
+	// Whether the data sent by the Fast Open constructor went out with the SYN and was accepted
+	bool connection::fast_open_accepted() const
+	{
+#if defined(TCP_INFO) && defined(TCPI_OPT_SYN_DATA)
+		struct tcp_info info;
+		socklen_t length = sizeof(info);
+		if(::getsockopt(_socket.get(), IPPROTO_TCP, TCP_INFO, &info, &length) != 0)
+			return false;
+		return (info.tcpi_options & TCPI_OPT_SYN_DATA) != 0;
+#else
+		return false;
+#endif
+	}
+
+	// Snapshot of the kernel's connection state
+	// Note: Older kernels return a shorter structure, the fields they do not fill in are left at zero.
+	bool connection::info(connection_info& result) const
+	{
+#ifdef __linux__
+		uint8_t info[tcp_info_offset::end] {};
+		socklen_t length = sizeof(info);
+		if(::getsockopt(_socket.get(), IPPROTO_TCP, TCP_INFO, info, &length) != 0)
+			return false;
+
+		// Fields the kernel did not fill in (older kernels return less) read as zero
+		const auto reported = [length](std::size_t offset, std::size_t size) { return static_cast<std::size_t>(length) >= offset + size; };
+		const auto field = [&](auto& value, std::size_t offset)
+		{
+			if(reported(offset, sizeof(value)))
+				std::memcpy(&value, info + offset, sizeof(value));
+		};
+
+		uint32_t rtt = 0;
+		uint32_t rtt_variance = 0;
+		field(rtt, tcp_info_offset::rtt);
+		field(rtt_variance, tcp_info_offset::rttvar);
+
+		result = connection_info {};
+		result.rtt = std::chrono::microseconds(rtt);
+		result.rtt_variance = std::chrono::microseconds(rtt_variance);
+		field(result.congestion_window, tcp_info_offset::snd_cwnd);
+		field(result.slow_start_threshold, tcp_info_offset::snd_ssthresh);
+		field(result.mss, tcp_info_offset::snd_mss);
+		field(result.unacked, tcp_info_offset::unacked);
+		field(result.lost, tcp_info_offset::lost);
+		field(result.retransmits, tcp_info_offset::total_retrans);
+		field(result.not_sent, tcp_info_offset::notsent_bytes);
+		field(result.delivery_rate, tcp_info_offset::delivery_rate);
+		return true;
+#else
+		(void)result;
+		return false;
+#endif
+	}
+
 	// Receive data from connection
 	ssize_t connection::receive(uint8_t* buffer, std::size_t buffer_size)
 	{
 		// Returns -1 on error, otherwise number of bytes received
-		return ::recv(_socket.get(), buffer, buffer_size, 0);
+		return probe_received(::recv(_socket.get(), buffer, buffer_size, 0));
+	}
+
+	// Receive data from connection without waiting (returns -1 with EWOULDBLOCK when nothing is available)
+	// Note: Without MSG_DONTWAIT, this only avoids blocking on non-blocking sockets.
+	ssize_t connection::receive_available(uint8_t* buffer, std::size_t buffer_size)
+	{
+#ifdef MSG_DONTWAIT
+		return probe_received(::recv(_socket.get(), buffer, buffer_size, MSG_DONTWAIT));
+#else
+		return probe_received(::recv(_socket.get(), buffer, buffer_size, 0));
+#endif
 	}
 
 	// Send data through connection
 	ssize_t connection::send(const uint8_t* buffer, std::size_t number_of_elements_to_send)
 	{
 		// Returns -1 on error, otherwise number of bytes sent
-		return ::send(_socket.get(), buffer, number_of_elements_to_send, 0);
+		return probe_sent(::send(_socket.get(), buffer, number_of_elements_to_send, 0));
+	}
+
+	// Enables kernel timestamps, records the error on failure
+	bool connection::enable_timestamping(const timestamp_options& options)
+	{
+		return networking::enable_timestamping(_socket.get(), options, &_error);
+	}
+
+	// Receive data with the kernel timestamps of the last segment read
+	ssize_t connection::receive(uint8_t* buffer, std::size_t buffer_size, packet_timestamps& timestamps)
+	{
+		return probe_received(receive_with_timestamps(_socket.get(), buffer, buffer_size, 0, timestamps));
+	}
+
+	bool connection::read_transmit_timestamp(transmit_timestamp& result)
+	{
+		return networking::read_transmit_timestamp(_socket.get(), result);
+	}
+
+	// Send data together with a socket (a duplicate descriptor arrives at the other end)
+	ssize_t connection::send_socket(const networking::socket& passed, const uint8_t* buffer, std::size_t number_of_elements_to_send)
+	{
+#ifdef USE_POSIX
+		struct iovec data { const_cast<uint8_t*>(buffer), number_of_elements_to_send };
+		alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+		struct msghdr message {};
+		message.msg_iov = &data;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+
+		auto* header = CMSG_FIRSTHDR(&message);
+		header->cmsg_level = SOL_SOCKET;
+		header->cmsg_type = SCM_RIGHTS;
+		header->cmsg_len = CMSG_LEN(sizeof(int));
+		const int descriptor = passed.get();
+		std::memcpy(CMSG_DATA(header), &descriptor, sizeof(descriptor));
+
+		// Returns -1 on error, otherwise number of bytes sent
+		return ::sendmsg(_socket.get(), &message, MSG_NOSIGNAL);
+#else
+		errno = ENOTSUP;
+		return -1;
+#endif
+	}
+
+	// Receive data, and the socket sent with it (if any)
+	ssize_t connection::receive_socket(networking::socket& received, uint8_t* buffer, std::size_t buffer_size)
+	{
+		received = networking::socket {};
+#ifdef USE_POSIX
+		struct iovec data { buffer, buffer_size };
+		alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+
+		struct msghdr message {};
+		message.msg_iov = &data;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+
+#ifdef MSG_CMSG_CLOEXEC
+		auto result = ::recvmsg(_socket.get(), &message, MSG_CMSG_CLOEXEC);
+#else
+		auto result = ::recvmsg(_socket.get(), &message, 0);
+#endif
+		if(result < 0)
+			return result;
+
+		for(auto* header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header))
+		{
+			if(header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS && header->cmsg_len >= CMSG_LEN(sizeof(int)))
+			{
+				int descriptor = -1;
+				std::memcpy(&descriptor, CMSG_DATA(header), sizeof(descriptor));
+				received = networking::socket { descriptor };
+			}
+		}
+
+		// More descriptors were sent than fit (and were closed by the kernel)
+		if(message.msg_flags & MSG_CTRUNC)
+		{
+			errno = EMSGSIZE;
+			return -1;
+		}
+
+		return result;
+#else
+		errno = ENOTSUP;
+		return -1;
+#endif
 	}
 
 	// ----------------------------------------------------------------------
@@ -108,6 +473,7 @@ namespace networking::tcp
 		switch(state)
 		{
 			case connection::status::invalid: s << std::string("invalid");break;
+			case connection::status::connecting: s << std::string("connecting");break;
 			case connection::status::open: s << std::string("open");break;
 			case connection::status::closed: s << std::string("closed");break;
 			case connection::status::shutdown: s << std::string("shutdown");break;
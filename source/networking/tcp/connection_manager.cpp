@@ -7,18 +7,195 @@
 #include <networking/tcp/listener.h>
 #include <networking/tcp/connection.h>
 
+#include <containers/mpsc_queue.h>
+#include <metrics/probes.h>
+#include <metrics/trace.h>
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
 namespace networking::tcp
 {
+	namespace
+	{
+		// Hot restart records, one per listener or connection (sent with its socket), followed by an end record
+		// Note: Both processes are expected to run the same build on the same host.
+		constexpr uint32_t handover_magic = 0x686f7401;	// "hot", version 1
+
+		enum class handover_kind : uint8_t
+		{
+			listener = 1,
+			connection = 2,
+			end = 3
+		};
+
+		// Listener options that accepted sockets do not inherit from the listening socket
+		constexpr uint8_t handover_non_blocking_set = 1;
+		constexpr uint8_t handover_non_blocking = 2;
+		constexpr uint8_t handover_quick_ack_set = 4;
+		constexpr uint8_t handover_quick_ack = 8;
+
+		struct handover_record
+		{
+			uint32_t magic;
+			handover_kind kind;
+			uint8_t status;
+			uint8_t flags;
+			uint8_t reserved;
+			uint32_t address_length;
+			uint32_t state_length;			// Application state following the record (connections)
+			sockaddr_storage address;
+		};
+
+		uint64_t nanoseconds_since(std::chrono::steady_clock::time_point start)
+		{
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		// Closed by the peer or the callback, or failed (dropped by the next update)
+		bool is_closed(const connection& c)
+		{
+			const auto state = c.state();
+			return state == connection::status::closed || state == connection::status::error || state == connection::status::invalid;
+		}
+
+		bool report(socket_error_information* error, const socket_error_information& e)
+		{
+			if(error != nullptr)
+				*error = e;
+			return false;
+		}
+
+		bool send_all(connection& channel, const uint8_t* data, std::size_t size)
+		{
+			while(size > 0)
+			{
+				auto sent = channel.send(data, size);
+				if(sent <= 0)
+					return false;
+				data += sent;
+				size -= static_cast<std::size_t>(sent);
+			}
+			return true;
+		}
+
+		bool receive_all(connection& channel, uint8_t* data, std::size_t size, socket_error_information& e)
+		{
+			while(size > 0)
+			{
+				auto received = channel.receive(data, size);
+				if(received <= 0)
+				{
+					e = (received == 0) ? socket_error_information { ECONNRESET, strerror(ECONNRESET) } : get_error_information();
+					return false;
+				}
+				data += received;
+				size -= static_cast<std::size_t>(received);
+			}
+			return true;
+		}
+	}
+
+	// Work posted by other threads, with the handle that wakes up poll
+	struct connection_manager::inbox
+	{
+		struct work
+		{
+			std::unique_ptr<connection> new_connection;
+			socket_type target = uninitialized_socket;	// Send
+			std::vector<uint8_t> data;
+			task_type task;
+		};
+
+		inbox();
+		~inbox();
+		void post(work&&);
+		void notify();
+		void drain();
+
+		utility::mpsc_queue<work> queue;
+		socket_type wakeup[2];	// An eventfd (in both entries), or a pipe: read end, write end
+	};
+
+	connection_manager::inbox::inbox() :
+		queue(),
+		wakeup{ uninitialized_socket, uninitialized_socket }
+	{
+#ifdef __linux__
+		wakeup[0] = wakeup[1] = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+		if(::pipe(wakeup) == 0)
+		{
+			set_blocking(wakeup[0], false);
+			set_blocking(wakeup[1], false);
+		}
+#endif
+	}
+
+	connection_manager::inbox::~inbox()
+	{
+		if(is_valid_socket(wakeup[0]))
+			close_socket(wakeup[0]);
+		if(wakeup[1] != wakeup[0] && is_valid_socket(wakeup[1]))
+			close_socket(wakeup[1]);
+	}
+
+	void connection_manager::inbox::post(work&& w)
+	{
+		if(queue.push(std::move(w)))
+			notify();
+	}
+
+	void connection_manager::inbox::notify()
+	{
+#ifdef __linux__
+		const uint64_t one = 1;
+		auto result = ::write(wakeup[1], &one, sizeof(one));
+#else
+		const char signal = 1;
+		auto result = ::write(wakeup[1], &signal, 1);
+#endif
+		(void)result;	// A full pipe (or counter) means a wakeup is pending anyway
+	}
+
+	void connection_manager::inbox::drain()
+	{
+		uint64_t drained[8];
+		while(::read(wakeup[0], drained, sizeof(drained)) > 0)
+		{
+		}
+	}
+
 	// ----------------------------------------------------------------------
 	// Constructors / destructor
 	// ----------------------------------------------------------------------
-	connection_manager::connection_manager(data_received_callback& callback) :
+	connection_manager::connection_manager(data_received_callback& callback, const manager_options& options) :
 		_connections(),
 		_listeners(),
 		_callback(callback),
+		_reader(dynamic_cast<data_read_callback*>(&callback)),
+		_options(options),
 		_pollfd(),
+		_resolver(nullptr),
+		_connecting(),
+		_next_connect_id(1),
+		_polled_connections(0),
+		_polled_attempts(),
+		_read_buffer(),
+		_deferred(),
+		_deferred_count(0),
+		_stats(),
+		_counters(),
+		_spin_until(),
+		_inbox(std::make_shared<inbox>()),
+		_info(),
+		_next_info_sample(),
 		_dirty(true)
 	{
+		_options.read_block_size = std::max<std::size_t>(_options.read_block_size, 1);
 	}
 
 	// Destructor
@@ -34,7 +211,23 @@ namespace networking::tcp
 		_connections(std::move(cm._connections)),
 		_listeners(std::move(cm._listeners)),
 		_callback(cm._callback),
+		_reader(cm._reader),
+		_options(cm._options),
 		_pollfd(std::move(cm._pollfd)),
+		_resolver(cm._resolver),
+		_connecting(std::move(cm._connecting)),
+		_next_connect_id(cm._next_connect_id),
+		_polled_connections(0),
+		_polled_attempts(),
+		_read_buffer(),
+		_deferred(std::move(cm._deferred)),
+		_deferred_count(cm._deferred_count),
+		_stats(cm._stats),
+		_counters(cm._counters),
+		_spin_until(cm._spin_until),
+		_inbox(std::move(cm._inbox)),
+		_info(std::move(cm._info)),
+		_next_info_sample(cm._next_info_sample),
 		_dirty(true)
 	{
 	}
@@ -45,7 +238,20 @@ namespace networking::tcp
 		_connections = std::move(cm._connections);
 		_listeners = std::move(cm._listeners);
 		_callback = cm._callback;
+		_reader = cm._reader;
+		_options = cm._options;
 		_pollfd = std::move(cm._pollfd);
+		_resolver = cm._resolver;
+		_connecting = std::move(cm._connecting);
+		_next_connect_id = cm._next_connect_id;
+		_deferred = std::move(cm._deferred);
+		_deferred_count = cm._deferred_count;
+		_stats = cm._stats;
+		_counters = cm._counters;
+		_spin_until = cm._spin_until;
+		_inbox = std::move(cm._inbox);
+		_info = std::move(cm._info);
+		_next_info_sample = cm._next_info_sample;
 		_dirty = true;
 
 		return *this;
@@ -58,12 +264,28 @@ namespace networking::tcp
 	void connection_manager::on_new_connection(connection&& new_connection)
 	{
 		_connections.push_back(std::move(new_connection));
+		_dirty = true;
+	}
+
+	// Accept a batch of new connections, the poll set is rebuilt once for all of them
+	void connection_manager::on_new_connections(std::vector<connection>& batch)
+	{
+		_connections.reserve(_connections.size() + batch.size());
+		for(auto& c : batch)
+			_connections.push_back(std::move(c));
+		_dirty = true;
+	}
+
+	std::size_t connection_manager::connection_count() const
+	{
+		return _connections.size();
 	}
 
 	// Creates a new listener that lets the same connection manager instance handle new connections
-	const listener& connection_manager::add_listener(port_number_t port, bool use_ipv6)
+	const listener& connection_manager::add_listener(port_number_t port, bool use_ipv6, const socket_options& options)
 	{
-		listener new_listener { *this, port, use_ipv6 };
+		listener new_listener { *this, port, use_ipv6, options };
+		set_blocking(new_listener.socket().get(), false);	// Accept queues are drained without blocking
 		_listeners.push_back(std::move(new_listener));
 		_dirty = true;
 		return _listeners.back();
@@ -72,39 +294,418 @@ namespace networking::tcp
 	// Add an already constructed listener, which does not have to use this connection manager instance for handling new connections
 	const listener& connection_manager::add_listener(listener&& l)
 	{
+		set_blocking(l.socket().get(), false);
 		_listeners.push_back(std::move(l));
 		_dirty = true;
 		return _listeners.back();
 	}
 
+	// Attach a resolver, whose callbacks will then be run from update()
+	void connection_manager::attach(resolver& r)
+	{
+		_resolver = &r;
+		_dirty = true;
+	}
+
+	// Lookups in flight are abandoned, their connects fail from the next update()
+	void connection_manager::detach_resolver()
+	{
+		for(auto& pending : _connecting)
+		{
+			if(pending.resolving)
+			{
+				pending.resolving = false;
+				pending.last_error = { ECANCELED, strerror(ECANCELED) };
+			}
+		}
+
+		_resolver = nullptr;
+		_dirty = true;
+	}
+
+	// Start connecting to a single address
+	connect_id connection_manager::connect(const address& target, connect_callback& callback, const connect_options& options)
+	{
+		return connect(std::vector<address> { target }, callback, options);
+	}
+
+	// Start racing connections to a list of addresses
+	connect_id connection_manager::connect(std::vector<address> candidates, connect_callback& callback, const connect_options& options)
+	{
+		const auto now = clock_type::now();
+		const auto id = _next_connect_id++;
+		_connecting.push_back({ id, &callback, {}, 0, {}, now + options.timeout, now, options.attempt_delay, options.socket, { EHOSTUNREACH, strerror(EHOSTUNREACH) }, false });
+		start_connect(_connecting.back(), std::move(candidates));
+		return id;
+	}
+
+	// Resolve the host name (asynchronously if a resolver is attached) and connect
+	connect_id connection_manager::connect(const std::string& hostname, port_number_t port, connect_callback& callback, ip_version ipv, const connect_options& options)
+	{
+		if(_resolver == nullptr)
+		{
+			std::vector<address> candidates;
+			resolve_addresses(hostname, port, protocol::tcp, ipv, candidates);	// !! BLOCKING !!
+			return connect(std::move(candidates), callback, options);
+		}
+
+		const auto now = clock_type::now();
+		const auto id = _next_connect_id++;
+		_connecting.push_back({ id, &callback, {}, 0, {}, now + options.timeout, now, options.attempt_delay, options.socket, { EHOSTUNREACH, strerror(EHOSTUNREACH) }, true });
+
+		// The resolver callback may be run by another manager sharing the resolver, so the result is posted to
+		// this manager's inbox. The inbox moves with the manager; once the manager is gone, the result is dropped.
+		std::weak_ptr<inbox> target = _inbox;
+		_resolver->resolve(hostname, port, protocol::tcp, ipv, [target, id](const resolution& result)
+		{
+			const auto destination = target.lock();
+			if(!destination)
+				return;
+
+			inbox::work w;
+			w.task = [id, result](connection_manager& manager)
+			{
+				auto pending = manager.find_connect(id);
+				if(pending == nullptr || !pending->resolving)
+					return;
+
+				pending->resolving = false;
+				if(result.code != 0)
+					pending->last_error = { result.code, gai_strerror(result.code) };
+				manager.start_connect(*pending, std::vector<address>(result.addresses));
+			};
+			destination->post(std::move(w));
+		});
+
+		return id;
+	}
+
+	// Abandon a connection attempt (the callback is not invoked)
+	void connection_manager::cancel_connect(connect_id id)
+	{
+		auto i = std::find_if(_connecting.begin(), _connecting.end(), [id](const pending_connect& p) { return p.id == id; });
+		if(i != _connecting.end())
+		{
+			_connecting.erase(i);
+			_dirty = true;
+		}
+	}
+
 	// Note: For more on poll, see https://beej.us/guide/bgnet/html/split/slightly-advanced-techniques.html#poll
 	bool connection_manager::update(uint16_t timeout_ms)
 	{
 		// Check whether the collections have changed
 		if(_dirty)
+		{
+			remove_closed();
 			setup_pollfd();
+		}
+
+		_stats = update_stats {};
+		const auto* probes = metrics::manager_probes_enabled();
+		const auto poll_start = (probes != nullptr) ? clock_type::now() : clock_type::time_point {};
+		int number_of_events = wait_for_events(timeout_ms);
+		if (number_of_events < 0)
+			return false;
 
-		int number_of_events = ::poll(&(_pollfd[0]), _pollfd.size(), static_cast<int>(timeout_ms));
-		if (number_of_events > 0)
+		const auto start = clock_type::now();
+		metrics::trace_scope trace { metrics::trace_event::update };
+		trace.set_argument(number_of_events);
+		_stats.events = static_cast<std::size_t>(number_of_events);
+		if (probes != nullptr)
+		{
+			probes->poll_wait.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(start - poll_start).count()));
+			probes->events.record(static_cast<uint64_t>(number_of_events));
+		}
+
+		if (number_of_events > 0 || _deferred_count > 0)
 		{
 			// Check for new connections
-			unsigned int i = 0;
+			std::size_t i = 0;
 			for ( ; i < _listeners.size(); i++)
 			{
 				if (_pollfd[i].revents & POLLIN)
-					_listeners[i].accept();
+					_stats.accepted += _listeners[i].accept_all(_options.accept_budget);
 			}
 
 			// Check for available data in an active connection
-			for ( ; i < _pollfd.size(); i++)
+			if (_reader != nullptr)
+				_deferred.resize(std::max(_deferred.size(), _polled_connections), 0);
+
+			const auto connections_end = i + _polled_connections;
+			for ( ; i < connections_end; i++)
 			{
-				if (_pollfd[i].revents & POLLIN)
-					_callback.on_receive(_connections[i - _listeners.size()]);
+				const auto index = i - _listeners.size();
+				if (_reader != nullptr)
+				{
+					if ((_pollfd[i].revents & (POLLIN | POLLHUP | POLLERR)) || _deferred[index])
+						service(index);
+				}
+				else if (_pollfd[i].revents & POLLIN)
+				{
+					_stats.serviced++;
+					const auto callback_start = (probes != nullptr) ? clock_type::now() : clock_type::time_point {};
+					_callback.on_receive(_connections[index]);
+					if (probes != nullptr)
+						probes->callback.record(nanoseconds_since(callback_start));
+
+					if (is_closed(_connections[index]))
+						_dirty = true;
+				}
 			}
+
+			// Check for completed connection attempts
+			for (const auto id : _polled_attempts)
+			{
+				const auto& handle = _pollfd[i++];
+				if (!(handle.revents & (POLLOUT | POLLERR | POLLHUP)))
+					continue;
+
+				auto pending = find_connect(id);
+				if (pending == nullptr)
+					continue;
+
+				for (auto& attempt : pending->attempts)
+				{
+					if (attempt.socket().get() == handle.fd)
+						attempt.finish_connect();
+				}
+			}
+
+			// Completed name lookups (the notification handle is polled last)
+			if (_resolver != nullptr && i < _pollfd.size() && (_pollfd[i].revents & POLLIN))
+				_resolver->dispatch();
 		}
-		else if (number_of_events < 0)
+
+		// Posted work (the wakeup handle is polled last)
+		if (_pollfd.back().revents & POLLIN)
+			_inbox->drain();
+		run_inbox();
+
+		if (!_connecting.empty())
+			advance_connects();
+
+		// Periodic TCP_INFO samples of the open connections
+		const auto end = clock_type::now();
+		if (_options.info_interval.count() > 0 && end >= _next_info_sample)
 		{
-			return false;
+			sample_info();
+			_next_info_sample = end + _options.info_interval;
+		}
+
+		// Activity extends the spinning period
+		if (_options.spin_budget.count() > 0 && (number_of_events > 0 || _stats.posted > 0 || _deferred_count > 0))
+			_spin_until = end + _options.spin_budget;
+
+		_stats.busy = end - start;
+		return true;
+	}
+
+	// Records the kernel state of every open connection into the distributions
+	std::size_t connection_manager::sample_info()
+	{
+		if (!_info)
+			_info = std::make_unique<connection_info_distributions>();
+
+		std::size_t sampled = 0;
+		connection_info info;
+		for (const auto& c : _connections)
+		{
+			if (c.state() != connection::status::open || !c.info(info))
+				continue;
+
+			_info->rtt.record(static_cast<uint64_t>(info.rtt.count()));
+			_info->rtt_variance.record(static_cast<uint64_t>(info.rtt_variance.count()));
+			_info->congestion_window.record(info.congestion_window);
+			_info->unacked.record(info.unacked);
+			_info->retransmits.record(info.retransmits);
+			_info->delivery_rate.record(info.delivery_rate);
+			sampled++;
+		}
+
+		_info->samples++;
+		return sampled;
+	}
+
+	// Hand over a connection from another thread (e.g. an acceptor thread balancing connections across managers)
+	void connection_manager::post_connection(connection&& c)
+	{
+		inbox::work w;
+		w.new_connection = std::make_unique<connection>(std::move(c));
+		_inbox->post(std::move(w));
+	}
+
+	// Send from another thread, the data is sent as with connection::send (no partial sends are retried)
+	void connection_manager::post_send(socket_type target, std::vector<uint8_t>&& data)
+	{
+		inbox::work w;
+		w.target = target;
+		w.data = std::move(data);
+		_inbox->post(std::move(w));
+	}
+
+	// Run a task on the thread running the manager
+	void connection_manager::post(task_type task)
+	{
+		inbox::work w;
+		w.task = std::move(task);
+		_inbox->post(std::move(w));
+	}
+
+	void connection_manager::wake()
+	{
+		_inbox->notify();
+	}
+
+	// ----------------------------------------------------------------------
+	// Hot restart
+	// ----------------------------------------------------------------------
+	// Sends every listener and open connection, and releases them once all were sent
+	// Note: On failure, nothing is released, and the successor discards what it received.
+	bool connection_manager::hand_over(connection& channel, handover_callback* callback, socket_error_information* error)
+	{
+		auto send_record = [&](handover_kind kind, const networking::socket* s, const address* a, uint8_t state, uint8_t flags, const std::vector<uint8_t>& application_state)
+		{
+			handover_record record {};
+			record.magic = handover_magic;
+			record.kind = kind;
+			record.status = state;
+			record.flags = flags;
+			record.state_length = static_cast<uint32_t>(application_state.size());
+			if(a != nullptr)
+			{
+				record.address_length = static_cast<uint32_t>(std::min<std::size_t>(a->length(), sizeof(record.address)));
+				std::memcpy(&record.address, &a->get(), record.address_length);
+			}
+
+			const auto* data = reinterpret_cast<const uint8_t*>(&record);
+			auto sent = (s != nullptr) ? channel.send_socket(*s, data, sizeof(record)) : channel.send(data, sizeof(record));
+			if(sent <= 0)
+				return false;
+
+			return send_all(channel, data + sent, sizeof(record) - static_cast<std::size_t>(sent))
+				&& send_all(channel, application_state.data(), application_state.size());
+		};
+
+		std::vector<uint8_t> state;
+		for(const auto& l : _listeners)
+		{
+			if(!l.socket().valid())
+				continue;
+
+			const auto& o = l.options();
+			uint8_t flags = 0;
+			if(o.non_blocking)
+				flags |= handover_non_blocking_set | (*o.non_blocking ? handover_non_blocking : 0);
+			if(o.quick_ack)
+				flags |= handover_quick_ack_set | (*o.quick_ack ? handover_quick_ack : 0);
+
+			if(!send_record(handover_kind::listener, &l.socket(), &l.bound_address(), static_cast<uint8_t>(l.state()), flags, state))
+				return report(error, get_error_information());
+		}
+
+		for(const auto& c : _connections)
+		{
+			if(!c.socket().valid() || (c.state() != connection::status::open && c.state() != connection::status::shutdown))
+				continue;
+
+			state.clear();
+			if(callback != nullptr)
+				callback->save_state(c, state);
+
+			if(!send_record(handover_kind::connection, &c.socket(), &c.connected_to(), static_cast<uint8_t>(c.state()), 0, state))
+				return report(error, get_error_information());
+		}
+
+		state.clear();
+		if(!send_record(handover_kind::end, nullptr, nullptr, 0, 0, state))
+			return report(error, get_error_information());
+
+		// The successor holds duplicates of the sockets now, closing ours does not affect them
+		for(auto& l : _listeners)
+			l.release();
+		_listeners.clear();
+		_connections.clear();
+		_deferred.clear();
+		_deferred_count = 0;
+		_dirty = true;
+		return true;
+	}
+
+	// Receives the listeners and connections of a predecessor, they are only added once all were received
+	bool connection_manager::take_over(connection& channel, handover_callback* callback, socket_error_information* error)
+	{
+		std::vector<listener> listeners;
+		std::vector<connection> connections;
+		std::vector<std::vector<uint8_t>> states;
+
+		// Received listeners are released, so that their Unix domain socket files are not removed
+		auto fail = [&](const socket_error_information& e)
+		{
+			for(auto& l : listeners)
+				l.release();
+			return report(error, e);
+		};
+		const socket_error_information malformed { EPROTO, strerror(EPROTO) };
+
+		for(;;)
+		{
+			handover_record record {};
+			networking::socket received;
+			auto* data = reinterpret_cast<uint8_t*>(&record);
+			auto result = channel.receive_socket(received, data, sizeof(record));
+			if(result <= 0)
+				return fail((result == 0) ? socket_error_information { ECONNRESET, strerror(ECONNRESET) } : get_error_information());
+
+			socket_error_information e { 0, "No error" };
+			if(!receive_all(channel, data + result, sizeof(record) - static_cast<std::size_t>(result), e))
+				return fail(e);
+
+			if(record.magic != handover_magic || record.address_length > sizeof(record.address))
+				return fail(malformed);
+
+			if(record.kind == handover_kind::end)
+				break;
+
+			if(!received.valid())
+				return fail(malformed);
+
+			const address a { reinterpret_cast<const sockaddr&>(record.address), static_cast<socklen_t>(record.address_length), record.address.ss_family };
+			if(record.kind == handover_kind::listener)
+			{
+				socket_options options;
+				if(record.flags & handover_non_blocking_set)
+					options.non_blocking = (record.flags & handover_non_blocking) != 0;
+				if(record.flags & handover_quick_ack_set)
+					options.quick_ack = (record.flags & handover_quick_ack) != 0;
+				listeners.emplace_back(*this, std::move(received), a, static_cast<listener::status>(record.status), options);
+			}
+			else if(record.kind == handover_kind::connection)
+			{
+				std::vector<uint8_t> state(record.state_length);
+				if(!receive_all(channel, state.data(), state.size(), e))
+					return fail(e);
+				connections.emplace_back(std::move(received), a, static_cast<connection::status>(record.status));
+				states.push_back(std::move(state));
+			}
+			else
+			{
+				return fail(malformed);
+			}
+		}
+
+		for(auto& l : listeners)
+			add_listener(std::move(l));
+
+		const auto first = _connections.size();
+		for(auto& c : connections)
+			_connections.push_back(std::move(c));
+		_dirty = true;
+
+		if(callback != nullptr)
+		{
+			for(std::size_t i = 0; i < states.size(); i++)
+				callback->restore_state(_connections[first + i], states[i].data(), states[i].size());
 		}
 
 		return true;
@@ -113,15 +714,363 @@ namespace networking::tcp
 	// ----------------------------------------------------------------------
 	// Private helpers
 	// ----------------------------------------------------------------------
+	// Drops the closed connections, with their deferred flags (the poll set is rebuilt afterwards)
+	void connection_manager::remove_closed()
+	{
+		std::size_t kept = 0;
+		for(std::size_t i = 0; i < _connections.size(); i++)
+		{
+			const bool deferred = (i < _deferred.size()) && _deferred[i];
+			if(is_closed(_connections[i]))
+			{
+				_deferred_count -= deferred ? 1 : 0;
+				continue;
+			}
+
+			if(kept != i)
+			{
+				_connections[kept] = std::move(_connections[i]);
+				if(kept < _deferred.size())
+					_deferred[kept] = deferred ? 1 : 0;
+			}
+			kept++;
+		}
+
+		_connections.erase(_connections.begin() + static_cast<std::ptrdiff_t>(kept), _connections.end());
+		_deferred.resize(std::min(_deferred.size(), kept));
+	}
+
 	void connection_manager::setup_pollfd()
 	{
 		_dirty = false;
 		_pollfd.clear();
+		_polled_attempts.clear();
 
 		for(auto i = _listeners.cbegin(); i != _listeners.cend(); i++)
 			_pollfd.push_back({ i->socket().get(), POLLIN, 0 });
 
 		for(auto i = _connections.cbegin(); i != _connections.cend(); i++)
 			_pollfd.push_back({ i->socket().get(), POLLIN, 0 });
+		_polled_connections = _connections.size();
+
+		for(const auto& pending : _connecting)
+		{
+			for(const auto& attempt : pending.attempts)
+			{
+				_pollfd.push_back({ attempt.socket().get(), POLLOUT, 0 });
+				_polled_attempts.push_back(pending.id);
+			}
+		}
+
+		if(_resolver != nullptr)
+			_pollfd.push_back({ _resolver->notification_handle(), POLLIN, 0 });
+
+		_pollfd.push_back({ _inbox->wakeup[0], POLLIN, 0 });
+	}
+
+	// Polls the handles: without timeout while work is left or while spinning, otherwise blocking
+	int connection_manager::wait_for_events(uint16_t timeout_ms)
+	{
+		// Connections with unread data left from the last update (or posted work) do not wait for poll
+		if (_deferred_count > 0 || !_inbox->queue.empty())
+			return ::poll(_pollfd.data(), _pollfd.size(), 0);
+
+		// Nothing waits past the timeout, or the next connect or sampling deadline, spinning or not
+		const auto deadline = clock_type::now() + std::chrono::milliseconds { poll_timeout(timeout_ms) };
+
+		// Spin until events arrive or the spinning period is over
+		if (_options.spin_budget.count() > 0 && timeout_ms > 0)
+		{
+			const auto spin_end = std::min(_spin_until, deadline);
+			while (clock_type::now() < spin_end)
+			{
+				const int number_of_events = ::poll(_pollfd.data(), _pollfd.size(), 0);
+				_stats.spins++;
+				_counters.spins++;
+				if (number_of_events != 0)
+				{
+					_counters.spin_hits += (number_of_events > 0) ? 1 : 0;
+					return number_of_events;
+				}
+			}
+		}
+
+		const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - clock_type::now());
+		const int timeout = static_cast<int>(std::max(remaining, std::chrono::milliseconds { 0 }).count());
+		const int number_of_events = ::poll(_pollfd.data(), _pollfd.size(), timeout);
+		if (timeout > 0)
+		{
+			_stats.blocked = true;
+			_counters.sleeps++;
+			_counters.sleep_hits += (number_of_events > 0) ? 1 : 0;
+		}
+		return number_of_events;
+	}
+
+	// Shortens the poll timeout to the next connect deadline, staggered attempt or TCP_INFO sample
+	int connection_manager::poll_timeout(uint16_t timeout_ms) const
+	{
+		auto timeout = std::chrono::milliseconds { timeout_ms };
+		const auto now = clock_type::now();
+
+		if (_options.info_interval.count() > 0)
+		{
+			const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(_next_info_sample - now);
+			timeout = std::min(timeout, std::max(remaining, std::chrono::milliseconds { 0 }));
+		}
+
+		for(const auto& pending : _connecting)
+		{
+			if(!pending.resolving && pending.attempts.empty())
+				return 0;
+
+			auto next = pending.deadline;
+			if(!pending.resolving && pending.next_candidate < pending.candidates.size())
+				next = std::min(next, pending.next_attempt);
+
+			const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(next - now);
+			timeout = std::min(timeout, std::max(remaining, std::chrono::milliseconds { 0 }));
+		}
+
+		return static_cast<int>(timeout.count());
+	}
+
+	connection_manager::pending_connect* connection_manager::find_connect(connect_id id)
+	{
+		for(auto& pending : _connecting)
+		{
+			if(pending.id == id)
+				return &pending;
+		}
+		return nullptr;
+	}
+
+	// Reads from a connection for the callback, until it would block or the budget is used up
+	void connection_manager::service(std::size_t index)
+	{
+		const auto start = clock_type::now();
+		if (_read_buffer.size() < _options.read_block_size)
+			_read_buffer.resize(_options.read_block_size);
+
+		std::size_t bytes = 0;
+		std::size_t messages = 0;
+		bool drained = false;
+
+		// Note: The callbacks may add connections, so the connection is looked up by index after each call
+		while (messages < _options.read_messages_budget && bytes < _options.read_bytes_budget)
+		{
+			auto& c = _connections[index];
+			if (c.state() != connection::status::open)
+			{
+				drained = true;
+				break;
+			}
+
+			const auto wanted = std::min(_read_buffer.size(), _options.read_bytes_budget - bytes);
+			auto received = c.receive_available(_read_buffer.data(), wanted);
+			if (received > 0)
+			{
+				messages++;
+				bytes += static_cast<std::size_t>(received);
+				const auto* probes = metrics::manager_probes_enabled();
+				const auto callback_start = (probes != nullptr) ? clock_type::now() : clock_type::time_point {};
+				_reader->on_data(c, _read_buffer.data(), static_cast<std::size_t>(received));
+				if (probes != nullptr)
+					probes->callback.record(nanoseconds_since(callback_start));
+
+				if (static_cast<std::size_t>(received) < wanted)
+				{
+					drained = true;
+					break;
+				}
+				continue;
+			}
+
+			// Closed by the peer, or failed
+			if (received == 0 || !would_block(get_error_information()))
+			{
+				c.close();
+				_dirty = true;
+				_reader->on_closed(_connections[index]);
+			}
+
+			drained = true;
+			break;
+		}
+
+		const bool deferred = !drained;
+		if (deferred != static_cast<bool>(_deferred[index]))
+		{
+			_deferred[index] = deferred ? 1 : 0;
+			_deferred_count += deferred ? 1 : static_cast<std::size_t>(-1);
+		}
+
+		const auto elapsed = clock_type::now() - start;
+		_stats.serviced++;
+		_stats.messages += messages;
+		_stats.bytes += bytes;
+		_stats.deferred += deferred ? 1 : 0;
+		_stats.max_service = std::max(_stats.max_service, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
+	}
+
+	// Handles the posted work (work posted by the tasks is handled too)
+	void connection_manager::run_inbox()
+	{
+		inbox::work w;
+		while (_inbox->queue.read(w))
+		{
+			_stats.posted++;
+			if (w.new_connection)
+			{
+				on_new_connection(std::move(*w.new_connection));
+			}
+			else if (w.task)
+			{
+				w.task(*this);
+			}
+			else
+			{
+				for (auto& c : _connections)
+				{
+					if (c.socket().get() == w.target && c.state() == connection::status::open)
+					{
+						c.send(w.data.data(), w.data.size());
+						break;
+					}
+				}
+			}
+
+			w = inbox::work {};
+		}
+	}
+
+	// Orders the candidates alternating between address families (keeping the family of the first one first)
+	void connection_manager::start_connect(pending_connect& pending, std::vector<address>&& candidates)
+	{
+		std::vector<address> first, second;
+		for(const auto& a : candidates)
+		{
+			if(a.family() == candidates.front().family())
+				first.push_back(a);
+			else
+				second.push_back(a);
+		}
+
+		pending.candidates.clear();
+		for(std::size_t i = 0; i < first.size() || i < second.size(); i++)
+		{
+			if(i < first.size())
+				pending.candidates.push_back(first[i]);
+			if(i < second.size())
+				pending.candidates.push_back(second[i]);
+		}
+
+		// The first attempt is started by the next update(), so callbacks never run from within connect()
+		pending.next_candidate = 0;
+		pending.next_attempt = clock_type::now();
+		_dirty = true;
+	}
+
+	// Checks the racing attempts, starts new ones when due and reports completed connects
+	void connection_manager::advance_connects()
+	{
+		struct completion
+		{
+			connect_id id;
+			connect_callback* callback;
+			std::size_t connection_index;	// Index in _connections, or none for failure
+			socket_error_information error;
+		};
+		constexpr auto none = static_cast<std::size_t>(-1);
+
+		std::vector<completion> completed;
+		const auto now = clock_type::now();
+
+		for(auto i = _connecting.begin(); i != _connecting.end(); )
+		{
+			auto& pending = *i;
+			bool done = false;
+
+			// Drop failed attempts and look for an established connection
+			for(auto a = pending.attempts.begin(); a != pending.attempts.end(); )
+			{
+				if(a->state() == connection::status::open || a->state() == connection::status::connecting)
+				{
+					a++;
+					continue;
+				}
+
+				pending.last_error = a->error();
+				a = pending.attempts.erase(a);
+				_dirty = true;
+			}
+
+			auto winner = std::find_if(pending.attempts.begin(), pending.attempts.end(), [](const connection& a) { return a.state() == connection::status::open; });
+			if(winner != pending.attempts.end())
+			{
+				// Keep the first established connection, the other attempts are closed when dropped
+				_connections.push_back(std::move(*winner));
+				completed.push_back({ pending.id, pending.callback, _connections.size() - 1, { 0, "No error" } });
+				done = true;
+			}
+			else if(now >= pending.deadline)
+			{
+				completed.push_back({ pending.id, pending.callback, none, { ETIMEDOUT, strerror(ETIMEDOUT) } });
+				done = true;
+			}
+			else if(!pending.resolving)
+			{
+				// Start the next address when due, or right away if nothing is in flight
+				while(pending.next_candidate < pending.candidates.size() && (pending.attempts.empty() || now >= pending.next_attempt))
+				{
+					connection attempt { pending.candidates[pending.next_candidate++], true, pending.options };
+					pending.next_attempt = now + pending.attempt_delay;
+					_dirty = true;
+
+					if(attempt.state() == connection::status::connecting || attempt.state() == connection::status::open)
+					{
+						pending.attempts.push_back(std::move(attempt));
+						if(pending.attempts.back().state() == connection::status::open)
+							break;
+					}
+					else
+					{
+						pending.last_error = attempt.error();
+					}
+				}
+
+				if(!pending.attempts.empty() && pending.attempts.back().state() == connection::status::open)
+				{
+					_connections.push_back(std::move(pending.attempts.back()));
+					completed.push_back({ pending.id, pending.callback, _connections.size() - 1, { 0, "No error" } });
+					done = true;
+				}
+				else if(pending.attempts.empty())
+				{
+					// Every address failed
+					completed.push_back({ pending.id, pending.callback, none, pending.last_error });
+					done = true;
+				}
+			}
+
+			if(done)
+			{
+				i = _connecting.erase(i);
+				_dirty = true;
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		// Report after the bookkeeping, callbacks may start new connects
+		for(const auto& c : completed)
+		{
+			if(c.connection_index != none)
+				c.callback->on_connected(c.id, _connections[c.connection_index]);
+			else
+				c.callback->on_connect_failed(c.id, c.error);
+		}
 	}
 }
@@ -0,0 +1,461 @@
+/////////////////////////////////////////////////////////////////////////
+// TCP client connection pool implementation
+/////////////////////////////////////////////////////////////////////////
+#include <networking/tcp/connection_pool.h>
+
+#include <algorithm>
+
+namespace networking::tcp
+{
+	namespace
+	{
+		struct failed_request
+		{
+			request_id id;
+			response_callback* callback;
+			socket_error_information error;
+		};
+
+		// Milliseconds until a point in time, clamped to [0, limit]
+		std::chrono::milliseconds until(std::chrono::steady_clock::time_point t, std::chrono::steady_clock::time_point now, std::chrono::milliseconds limit)
+		{
+			auto remaining = std::chrono::ceil<std::chrono::milliseconds>(t - now);
+			return std::clamp(remaining, std::chrono::milliseconds { 0 }, limit);
+		}
+	}
+
+	// ----------------------------------------------------------------------
+	// Constructors / destructor
+	// ----------------------------------------------------------------------
+	connection_pool::connection_pool(response_framing& framing, const pool_options& options) :
+		_framing(framing),
+		_options(options),
+		_backends(),
+		_pollfd(),
+		_polled(),
+		_next_request_id(1)
+	{
+		_options.max_connections_per_address = std::max<std::size_t>(_options.max_connections_per_address, 1);
+		_options.max_in_flight = std::max<std::size_t>(_options.max_in_flight, 1);
+		_options.receive_block_size = std::max<std::size_t>(_options.receive_block_size, 64);
+	}
+
+	// Destructor (outstanding requests are dropped without callbacks)
+	connection_pool::~connection_pool()
+	{
+	}
+
+	// ----------------------------------------------------------------------
+	// Public interface
+	// ----------------------------------------------------------------------
+	// Sends a request on a pooled connection to the target, the response is delivered from update()
+	request_id connection_pool::send(const address& target, const uint8_t* data, std::size_t size, response_callback& callback)
+	{
+		const auto id = _next_request_id++;
+		auto& b = backend_for(target);
+
+		auto c = b.backlog.empty() ? pick(b) : nullptr;
+		if(c != nullptr)
+			enqueue(*c, id, &callback, data, size);
+		else
+			b.backlog.push_back({ id, &callback, std::vector<uint8_t>(data, data + size) });
+
+		return id;
+	}
+
+	request_id connection_pool::send(const address& target, std::vector<uint8_t>&& data, response_callback& callback)
+	{
+		const auto id = _next_request_id++;
+		auto& b = backend_for(target);
+
+		auto c = b.backlog.empty() ? pick(b) : nullptr;
+		if(c != nullptr)
+			enqueue(*c, id, &callback, data.data(), data.size());
+		else
+			b.backlog.push_back({ id, &callback, std::move(data) });
+
+		return id;
+	}
+
+	// Note: For more on poll, see https://beej.us/guide/bgnet/html/split/slightly-advanced-techniques.html#poll
+	bool connection_pool::update(uint16_t timeout_ms)
+	{
+		_pollfd.clear();
+		_polled.clear();
+
+		for(auto& entry : _backends)
+		{
+			for(auto& c : entry.second.connections)
+			{
+				short events = 0;
+				if(c->socket.state() == connection::status::connecting)
+					events = POLLOUT;
+				else if(c->socket.state() == connection::status::open)
+					events = POLLIN | (c->outgoing_offset < c->outgoing.size() ? POLLOUT : 0);
+				else
+					continue;
+
+				_pollfd.push_back({ c->socket.socket().get(), events, 0 });
+				_polled.push_back(c.get());
+			}
+		}
+
+		int number_of_events = ::poll(_pollfd.data(), _pollfd.size(), poll_timeout(timeout_ms, clock_type::now()));
+		if(number_of_events < 0)
+			return false;
+
+		for(std::size_t i = 0; number_of_events > 0 && i < _pollfd.size(); i++)
+		{
+			const auto revents = _pollfd[i].revents;
+			if(revents == 0)
+				continue;
+
+			auto& c = *_polled[i];
+			if(c.socket.state() == connection::status::connecting)
+			{
+				if(c.socket.finish_connect())
+				{
+					c.last_checked = clock_type::now();
+					flush(c);
+				}
+				else if(c.socket.state() == connection::status::error)
+				{
+					mark_failed(c, c.socket.error());
+				}
+				continue;
+			}
+
+			if((revents & POLLOUT) && !flush(c))
+				continue;
+
+			if(revents & (POLLIN | POLLHUP | POLLERR))
+				receive(c);
+		}
+
+		maintain(clock_type::now());
+		return true;
+	}
+
+	// Closes the connections to a target, their requests fail from the next update()
+	void connection_pool::close(const address& target)
+	{
+		auto i = _backends.find(target);
+		if(i == _backends.end())
+			return;
+
+		for(auto& c : i->second.connections)
+			mark_failed(*c, { ECONNABORTED, strerror(ECONNABORTED) });
+	}
+
+	void connection_pool::clear()
+	{
+		for(auto& entry : _backends)
+		{
+			for(auto& c : entry.second.connections)
+				mark_failed(*c, { ECONNABORTED, strerror(ECONNABORTED) });
+		}
+	}
+
+	std::size_t connection_pool::connections(const address& target) const
+	{
+		auto i = _backends.find(target);
+		return (i == _backends.end()) ? 0 : i->second.connections.size();
+	}
+
+	std::size_t connection_pool::connections() const
+	{
+		std::size_t count = 0;
+		for(const auto& entry : _backends)
+			count += entry.second.connections.size();
+		return count;
+	}
+
+	// Number of requests sent (or being sent) that wait for a response
+	std::size_t connection_pool::in_flight() const
+	{
+		std::size_t count = 0;
+		for(const auto& entry : _backends)
+		{
+			for(const auto& c : entry.second.connections)
+				count += c->in_flight.size();
+		}
+		return count;
+	}
+
+	// Number of requests waiting for a free connection
+	std::size_t connection_pool::backlog() const
+	{
+		std::size_t count = 0;
+		for(const auto& entry : _backends)
+			count += entry.second.backlog.size();
+		return count;
+	}
+
+	// ----------------------------------------------------------------------
+	// Private helpers
+	// ----------------------------------------------------------------------
+	connection_pool::backend& connection_pool::backend_for(const address& target)
+	{
+		auto result = _backends.emplace(target, backend { target, {}, {}, 0 });
+		return result.first->second;
+	}
+
+	// Picks the live connection with the fewest requests in flight (starting round-robin, so ties are spread),
+	// opening another connection if every one is busy and the limit allows it.
+	connection_pool::pooled_connection* connection_pool::pick(backend& b)
+	{
+		pooled_connection* best = nullptr;
+		const auto count = b.connections.size();
+		for(std::size_t k = 0; k < count; k++)
+		{
+			auto c = b.connections[(b.next + k) % count].get();
+			const auto state = c->socket.state();
+			if(state != connection::status::open && state != connection::status::connecting)
+				continue;
+			if(c->in_flight.size() >= _options.max_in_flight)
+				continue;
+			if(best == nullptr || c->in_flight.size() < best->in_flight.size())
+				best = c;
+		}
+		b.next++;
+
+		if((best == nullptr || !best->in_flight.empty()) && count < _options.max_connections_per_address)
+		{
+			const auto now = clock_type::now();
+			auto options = _options.socket;
+			options.non_blocking = true;
+			b.connections.push_back(std::make_unique<pooled_connection>(pooled_connection {
+				connection { b.target, true, options }, {}, {}, 0, {}, now + _options.connect_timeout, now, now, false, { 0, "No error" } }));
+
+			auto& c = *b.connections.back();
+			if(c.socket.state() != connection::status::open && c.socket.state() != connection::status::connecting)
+				mark_failed(c, c.socket.error());
+
+			// A failed connect is removed (failing its requests) by the next update()
+			return &c;
+		}
+
+		return best;
+	}
+
+	// Queues a request on a connection and writes as much of it as possible
+	void connection_pool::enqueue(pooled_connection& c, request_id id, response_callback* callback, const uint8_t* data, std::size_t size)
+	{
+		c.outgoing.insert(c.outgoing.end(), data, data + size);
+		c.in_flight.push_back({ id, callback });
+
+		if(callback != nullptr)
+			c.last_used = clock_type::now();
+
+		if(c.socket.state() == connection::status::open)
+			flush(c);
+	}
+
+	// Writes pending requests until the socket buffer is full
+	bool connection_pool::flush(pooled_connection& c)
+	{
+		while(c.outgoing_offset < c.outgoing.size())
+		{
+			auto sent = c.socket.send(c.outgoing.data() + c.outgoing_offset, c.outgoing.size() - c.outgoing_offset);
+			if(sent < 0)
+			{
+				auto error = get_error_information();
+				if(would_block(error))
+					return true;
+
+				mark_failed(c, error);
+				return false;
+			}
+			c.outgoing_offset += static_cast<std::size_t>(sent);
+		}
+
+		c.outgoing.clear();
+		c.outgoing_offset = 0;
+		return true;
+	}
+
+	// Reads what is available and delivers complete responses in request order
+	bool connection_pool::receive(pooled_connection& c)
+	{
+		bool closed = false;
+		for(;;)
+		{
+			const auto used = c.incoming.size();
+			c.incoming.resize(used + _options.receive_block_size);
+			auto received = c.socket.receive(c.incoming.data() + used, _options.receive_block_size);
+			c.incoming.resize(used + static_cast<std::size_t>(std::max<ssize_t>(received, 0)));
+
+			if(received == 0)
+			{
+				closed = true;
+				break;
+			}
+
+			if(received < 0)
+			{
+				auto error = get_error_information();
+				if(would_block(error))
+					break;
+
+				mark_failed(c, error);
+				return false;
+			}
+
+			if(static_cast<std::size_t>(received) < _options.receive_block_size)
+				break;
+		}
+
+		std::size_t consumed = 0;
+		while(consumed < c.incoming.size() && c.socket.state() == connection::status::open)
+		{
+			const auto remaining = c.incoming.size() - consumed;
+			const auto length = _framing.response_length(c.incoming.data() + consumed, remaining);
+			if(length == 0)
+				break;
+
+			// Malformed data, or a response nobody asked for: the stream cannot be trusted anymore
+			if(length == response_framing::invalid_response || length > remaining || c.in_flight.empty())
+			{
+				mark_failed(c, { EPROTO, strerror(EPROTO) });
+				return false;
+			}
+
+			const auto request = c.in_flight.front();
+			c.in_flight.pop_front();
+			c.last_checked = clock_type::now();
+
+			if(request.callback != nullptr)
+				request.callback->on_response(request.id, c.incoming.data() + consumed, length);
+			else
+				c.probing = false;
+
+			consumed += length;
+		}
+		c.incoming.erase(c.incoming.begin(), c.incoming.begin() + static_cast<std::ptrdiff_t>(consumed));
+
+		if(closed && c.socket.state() == connection::status::open)
+		{
+			mark_failed(c, { ECONNRESET, strerror(ECONNRESET) });
+			return false;
+		}
+
+		return true;
+	}
+
+	// Closes the connection, the requests on it are failed by maintain()
+	void connection_pool::mark_failed(pooled_connection& c, const socket_error_information& error)
+	{
+		if(c.error.error_code == 0)
+			c.error = error;
+		c.socket.close();
+	}
+
+	// Handles timeouts, idle connections and health checks, removes dead connections and drains backlogs
+	void connection_pool::maintain(clock_type::time_point now)
+	{
+		std::vector<failed_request> failed;
+		std::vector<uint8_t> probe;
+
+		for(auto& entry : _backends)
+		{
+			auto& b = entry.second;
+			for(auto& c : b.connections)
+			{
+				const auto state = c->socket.state();
+				const bool idle = c->in_flight.empty() && c->outgoing.empty();
+
+				if(state == connection::status::connecting && now >= c->deadline)
+				{
+					mark_failed(*c, { ETIMEDOUT, strerror(ETIMEDOUT) });
+				}
+				else if(state == connection::status::open && c->probing && now >= c->deadline)
+				{
+					mark_failed(*c, { ETIMEDOUT, strerror(ETIMEDOUT) });
+				}
+				else if(state == connection::status::open && idle)
+				{
+					if(now - c->last_used >= _options.idle_timeout)
+					{
+						c->socket.close();
+					}
+					else if(_options.health_check_interval.count() > 0 && now - std::max(c->last_used, c->last_checked) >= _options.health_check_interval)
+					{
+						probe.clear();
+						if(_framing.health_check_request(probe))
+						{
+							c->probing = true;
+							c->deadline = now + _options.health_check_interval;
+							enqueue(*c, 0, nullptr, probe.data(), probe.size());
+						}
+						c->last_checked = now;
+					}
+				}
+			}
+
+			// Remove dead connections, failing the requests that were on them
+			auto dead = std::stable_partition(b.connections.begin(), b.connections.end(), [](const std::unique_ptr<pooled_connection>& c)
+			{
+				return c->socket.state() == connection::status::open || c->socket.state() == connection::status::connecting;
+			});
+
+			for(auto i = dead; i != b.connections.end(); i++)
+			{
+				for(const auto& request : (*i)->in_flight)
+				{
+					if(request.callback != nullptr)
+						failed.push_back({ request.id, request.callback, (*i)->error });
+				}
+			}
+			b.connections.erase(dead, b.connections.end());
+
+			// Move waiting requests to connections with room in their windows
+			while(!b.backlog.empty())
+			{
+				auto c = pick(b);
+				if(c == nullptr)
+					break;
+
+				auto& request = b.backlog.front();
+				enqueue(*c, request.id, request.callback, request.data.data(), request.data.size());
+				b.backlog.pop_front();
+			}
+		}
+
+		// Report after the bookkeeping, callbacks may send new requests
+		for(const auto& f : failed)
+			f.callback->on_request_failed(f.id, f.error);
+	}
+
+	// Shortens the poll timeout to the next connect, health check or idle deadline
+	int connection_pool::poll_timeout(uint16_t timeout_ms, clock_type::time_point now) const
+	{
+		auto timeout = std::chrono::milliseconds { timeout_ms };
+
+		for(const auto& entry : _backends)
+		{
+			for(const auto& c : entry.second.connections)
+			{
+				const auto state = c->socket.state();
+				if(state == connection::status::connecting || c->probing)
+				{
+					timeout = until(c->deadline, now, timeout);
+				}
+				else if(state == connection::status::open && c->in_flight.empty())
+				{
+					timeout = until(c->last_used + _options.idle_timeout, now, timeout);
+					if(_options.health_check_interval.count() > 0)
+						timeout = until(std::max(c->last_used, c->last_checked) + _options.health_check_interval, now, timeout);
+				}
+				else if(state != connection::status::open)
+				{
+					timeout = std::chrono::milliseconds { 0 };	// Dead connection waiting for removal
+				}
+			}
+
+			if(!entry.second.backlog.empty() && entry.second.connections.size() < _options.max_connections_per_address)
+				timeout = std::chrono::milliseconds { 0 };
+		}
+
+		return static_cast<int>(timeout.count());
+	}
+}
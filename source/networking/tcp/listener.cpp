@@ -3,27 +3,54 @@
 /////////////////////////////////////////////////////////////////////////
 #include <networking/tcp/listener.h>
 #include <networking/tcp/connection.h>
+#include <metrics/trace.h>
+
+#include <cstddef>
 
 namespace networking::tcp
 {
 	// ----------------------------------------------------------------------
 	// Constructors / destructor
 	// ----------------------------------------------------------------------
-	listener::listener(incoming_connection_callback& callback, port_number_t port, bool use_ipv6) :
+	listener::listener(incoming_connection_callback& callback, port_number_t port, bool use_ipv6, const socket_options& options) :
+		listener(callback, create_host_address(port, protocol::tcp, use_ipv6 ? ip_version::ipv6 : ip_version::ipv4), protocol::tcp, options)
+	{
+	}
+
+	// Constructor binding to a given address, e.g. a Unix domain socket path (with protocol::tcp or protocol::seqpacket)
+	listener::listener(incoming_connection_callback& callback, const address& local, protocol p, const socket_options& options) :
 		_socket(),
 		_status(status::invalid),
 		_error({0, "No error"}),
 		_callback(callback),
-		_address()
+		_address(local),
+		_options(options),
+		_accepted_options(options.not_inherited()),
+		_batch()
 	{
-		_address = create_host_address(port, protocol::tcp, use_ipv6 ? ip_version::ipv6 : ip_version::ipv4);
-		networking::socket s { protocol::tcp, _address.ip_version_value() };
+		// The listening socket itself is always blocking, non-blocking mode only applies to accepted connections
+		auto listening_options = options;
+		listening_options.non_blocking.reset();
+		listening_options.quick_ack.reset();
+
+		networking::socket s { p, _address.ip_version_value(), listening_options, &_error };
 		_socket = std::move(s);
+		if(_error.error_code != 0)
+		{
+			_status = status::error;
+			return;
+		}
 
 		auto result = ::bind(_socket.get(), &(_address.get()), _address.length());
 		if(result == 0)
 		{
 			_status = status::bound;
+
+			// Reads back the port chosen by the system when binding to port zero
+			sockaddr_storage bound {};
+			socklen_t length = sizeof(bound);
+			if(_address.family() != AF_UNIX && ::getsockname(_socket.get(), reinterpret_cast<sockaddr*>(&bound), &length) == 0)
+				_address = address { reinterpret_cast<const sockaddr&>(bound), length, bound.ss_family };
 		}
 		else
 		{
@@ -32,6 +59,21 @@ namespace networking::tcp
 		}
 	}
 
+	// Constructor taking over a socket that is already bound (or listening), e.g. received from another process
+	listener::listener(incoming_connection_callback& callback, networking::socket&& s, const address& local, status state, const socket_options& options) :
+		_socket(std::move(s)),
+		_status(state),
+		_error({0, "No error"}),
+		_callback(callback),
+		_address(local),
+		_options(options),
+		_accepted_options(options.not_inherited()),
+		_batch()
+	{
+		if(!_socket.valid())
+			_status = status::invalid;
+	}
+
 	// Destructor
 	listener::~listener()
 	{
@@ -47,7 +89,10 @@ namespace networking::tcp
 		_status(std::move(l._status)),
 		_error(std::move(l._error)),
 		_callback(l._callback),
-		_address(std::move(l._address))
+		_address(std::move(l._address)),
+		_options(std::move(l._options)),
+		_accepted_options(std::move(l._accepted_options)),
+		_batch()
 	{
 	}
 
@@ -59,6 +104,8 @@ namespace networking::tcp
 		_error = std::move(l._error);
 		_callback = l._callback;
 		_address = std::move(l._address);
+		_options = std::move(l._options);
+		_accepted_options = std::move(l._accepted_options);
 
 		return *this;
 	}
@@ -87,13 +134,31 @@ namespace networking::tcp
 	// Stops listening for connections
 	void listener::stop()
 	{
-		if(_status == status::bound || _status == status::listening)
+		if((_status == status::bound || _status == status::listening) && _socket.valid())
 		{
 			_socket.close();
 			_status = status::stopped;
+
+#ifdef USE_POSIX
+			// Remove the file created by binding to a Unix domain socket path (abstract names have none)
+			if(_address.family() == AF_UNIX)
+			{
+				const auto& local = reinterpret_cast<const sockaddr_un&>(_address.get());
+				if(_address.length() > offsetof(sockaddr_un, sun_path) && local.sun_path[0] != '\0')
+					::unlink(local.sun_path);
+			}
+#endif
 		}
 	}
 
+	// Closes this process' descriptor only: the socket keeps listening if another process holds it,
+	// and the file of a Unix domain socket path is kept
+	void listener::release()
+	{
+		_socket.close();
+		_status = status::stopped;
+	}
+
 	// Accepts a connection
 	// Note: This is a BLOCKING function!
 	bool listener::accept()
@@ -105,8 +170,7 @@ namespace networking::tcp
 
 		if(is_valid_socket(client_socket))
 		{
-			tcp::connection client_connection { networking::socket(client_socket), client_address };
-			_callback.on_new_connection(std::move(client_connection));
+			hand_over(client_socket, client_address);
 			return true;
 		}
 
@@ -132,8 +196,7 @@ namespace networking::tcp
 
 			if(is_valid_socket(client_socket))
 			{
-				tcp::connection client_connection { networking::socket(client_socket), client_address };
-				_callback.on_new_connection(std::move(client_connection));
+				hand_over(client_socket, client_address);
 			}
 			else
 			{
@@ -148,6 +211,83 @@ namespace networking::tcp
 		return false;
 	}
 
+	// Accepts every queued connection (at most budget of them) and passes them on in one batch
+	// Note: Blocks when the queue runs empty, unless the listening socket is non-blocking.
+	std::size_t listener::accept_all(std::size_t budget)
+	{
+		auto options = _accepted_options;
+#if defined(__linux__) && defined(SOCK_NONBLOCK)
+		// Set the flags of the new socket in the same call
+		int flags = SOCK_CLOEXEC;
+		if(options.non_blocking.value_or(false))
+			flags |= SOCK_NONBLOCK;
+		options.non_blocking.reset();
+#endif
+
+		_batch.clear();
+		while(_batch.size() < budget)
+		{
+			struct sockaddr_storage client;
+			socklen_t length = sizeof(client);
+#if defined(__linux__) && defined(SOCK_NONBLOCK)
+			socket_type client_socket = ::accept4(_socket.get(), reinterpret_cast<struct sockaddr*>(&client), &length, flags);
+#else
+			socket_type client_socket = ::accept(_socket.get(), reinterpret_cast<struct sockaddr*>(&client), &length);
+#endif
+
+			if(!is_valid_socket(client_socket))
+			{
+				auto error = get_error_information();
+				if(error.error_code == ECONNABORTED || error.error_code == EINTR)
+					continue;
+
+				// An empty queue ends the batch, other errors (e.g. out of descriptors) are recorded
+				if(!would_block(error))
+					_error = error;
+				break;
+			}
+
+			address client_address { *reinterpret_cast<sockaddr*>(&client), length, client.ss_family };
+			_batch.push_back(make_connection(client_socket, client_address, options));
+		}
+
+		const auto accepted = _batch.size();
+		if(accepted > 0)
+			_callback.on_new_connections(_batch);
+		_batch.clear();
+
+		return accepted;
+	}
+
+	// ----------------------------------------------------------------------
+	// Private helpers
+	// ----------------------------------------------------------------------
+	// Applies the options accepted sockets do not inherit and passes the connection on
+	void listener::hand_over(socket_type client_socket, const address& client_address)
+	{
+		_callback.on_new_connection(make_connection(client_socket, client_address, _accepted_options));
+	}
+
+	connection listener::make_connection(socket_type client_socket, const address& client_address, const socket_options& options)
+	{
+		metrics::trace(metrics::trace_event::accept, metrics::trace_phase::instant, static_cast<int64_t>(client_socket));
+
+		networking::socket client { client_socket };
+		socket_error_information error { 0, "No error" };
+
+		if(!options.empty() && !client.set_options(options, &error))
+			return tcp::connection { std::move(client), client_address, tcp::connection::status::error, error };
+
+		return tcp::connection { std::move(client), client_address };
+	}
+
+	// Default batch handling of the callback interface
+	void incoming_connection_callback::on_new_connections(std::vector<connection>& batch)
+	{
+		for(auto& c : batch)
+			on_new_connection(std::move(c));
+	}
+
 	// ----------------------------------------------------------------------
 	// Non-member non-friend functions
 	// ----------------------------------------------------------------------
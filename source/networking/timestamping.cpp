@@ -0,0 +1,218 @@
+/////////////////////////////////////////////////////////////////////////
+// Packet timestamps implementation
+/////////////////////////////////////////////////////////////////////////
+#include <networking/timestamping.h>
+#include <metrics/probes.h>
+
+#include <algorithm>
+
+#ifdef USE_POSIX
+#include <time.h>
+#include <netinet/in.h>
+#endif
+
+#ifdef __linux__
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+#endif
+
+namespace networking
+{
+	namespace
+	{
+#if !(defined(__linux__) && defined(SO_TIMESTAMPING))
+		bool unsupported(socket_error_information* error)
+		{
+			if(error != nullptr)
+				*error = { ENOPROTOOPT, "Timestamping not supported on this platform" };
+			return false;
+		}
+#endif
+
+#ifdef USE_POSIX
+		std::chrono::nanoseconds to_duration(const struct timespec& t)
+		{
+			return std::chrono::seconds(t.tv_sec) + std::chrono::nanoseconds(t.tv_nsec);
+		}
+
+		std::chrono::nanoseconds realtime_now()
+		{
+			struct timespec now;
+			::clock_gettime(CLOCK_REALTIME, &now);
+			return to_duration(now);
+		}
+
+		// Collects the timestamps from the control messages
+		void parse_timestamps(struct msghdr& message, packet_timestamps& result)
+		{
+			for(auto* header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header))
+			{
+				if(header->cmsg_level != SOL_SOCKET)
+					continue;
+
+#ifdef SCM_TIMESTAMPING
+				if(header->cmsg_type == SCM_TIMESTAMPING)
+				{
+					// Software, (deprecated), raw hardware
+					struct timespec stamps[3];
+					std::memcpy(stamps, CMSG_DATA(header), sizeof(stamps));
+					result.software = to_duration(stamps[0]);
+					result.hardware = to_duration(stamps[2]);
+				}
+#endif
+#ifdef SCM_TIMESTAMPNS
+				if(header->cmsg_type == SCM_TIMESTAMPNS)
+				{
+					struct timespec stamp;
+					std::memcpy(&stamp, CMSG_DATA(header), sizeof(stamp));
+					result.software = to_duration(stamp);
+				}
+#endif
+			}
+		}
+#endif
+	}
+
+	// ----------------------------------------------------------------------
+	// Public interface
+	// ----------------------------------------------------------------------
+	std::chrono::nanoseconds packet_timestamps::age() const
+	{
+#ifdef USE_POSIX
+		return (software.count() != 0) ? realtime_now() - software : std::chrono::nanoseconds { 0 };
+#else
+		return std::chrono::nanoseconds { 0 };
+#endif
+	}
+
+	bool enable_timestamping(socket_type s, const timestamp_options& options, socket_error_information* error)
+	{
+#if defined(__linux__) && defined(SO_TIMESTAMPING)
+		int flags = SOF_TIMESTAMPING_SOFTWARE;
+		if(options.receive)
+			flags |= SOF_TIMESTAMPING_RX_SOFTWARE;
+		if(options.transmit || options.acknowledged)
+			flags |= SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+		if(options.transmit)
+			flags |= SOF_TIMESTAMPING_TX_SOFTWARE;
+		if(options.acknowledged)
+			flags |= SOF_TIMESTAMPING_TX_ACK;
+		if(options.hardware)
+		{
+			flags |= SOF_TIMESTAMPING_RAW_HARDWARE;
+			if(options.receive)
+				flags |= SOF_TIMESTAMPING_RX_HARDWARE;
+			if(options.transmit)
+				flags |= SOF_TIMESTAMPING_TX_HARDWARE;
+		}
+
+		if(::setsockopt(s, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0)
+			return true;
+
+		if(error != nullptr)
+			*error = get_error_information();
+		return false;
+#elif defined(SO_TIMESTAMPNS)
+		if(options.transmit || options.acknowledged || options.hardware)
+			return unsupported(error);
+
+		int enabled = options.receive ? 1 : 0;
+		if(::setsockopt(s, SOL_SOCKET, SO_TIMESTAMPNS, &enabled, sizeof(enabled)) == 0)
+			return true;
+
+		if(error != nullptr)
+			*error = get_error_information();
+		return false;
+#else
+		(void)s;
+		(void)options;
+		return unsupported(error);
+#endif
+	}
+
+	ssize_t receive_with_timestamps(socket_type s, uint8_t* buffer, std::size_t buffer_size, int flags, packet_timestamps& timestamps, sockaddr_storage* source, socklen_t* source_length)
+	{
+		timestamps = packet_timestamps {};
+#ifdef USE_POSIX
+		struct iovec data { buffer, buffer_size };
+		alignas(struct cmsghdr) char control[256];
+
+		struct msghdr message {};
+		message.msg_name = source;
+		message.msg_namelen = (source != nullptr) ? sizeof(sockaddr_storage) : 0;
+		message.msg_iov = &data;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+
+		const auto result = ::recvmsg(s, &message, flags);
+		if(result < 0)
+			return result;
+
+		if(source_length != nullptr)
+			*source_length = message.msg_namelen;
+
+		parse_timestamps(message, timestamps);
+		if(timestamps.software.count() != 0)
+		{
+			if(const auto* probes = metrics::packet_probes_enabled())
+				probes->receive_delay.record(static_cast<uint64_t>(std::max<int64_t>(timestamps.age().count(), 0)));
+		}
+
+		return result;
+#else
+		(void)timestamps;
+		return ::recvfrom(s, reinterpret_cast<char*>(buffer), static_cast<int>(buffer_size), flags, reinterpret_cast<sockaddr*>(source), source_length);
+#endif
+	}
+
+	bool read_transmit_timestamp(socket_type s, transmit_timestamp& result)
+	{
+#if defined(__linux__) && defined(SO_TIMESTAMPING)
+		alignas(struct cmsghdr) char control[256];
+
+		// Timestamps are reported without the packet (SOF_TIMESTAMPING_OPT_TSONLY)
+		struct msghdr message {};
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+
+		if(::recvmsg(s, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+			return false;
+
+		transmit_timestamp stamp { 0, transmit_stage::sent, {} };
+		bool found = false;
+		for(auto* header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header))
+		{
+			const bool extended_error = (header->cmsg_level == SOL_IP && header->cmsg_type == IP_RECVERR)
+				|| (header->cmsg_level == SOL_IPV6 && header->cmsg_type == IPV6_RECVERR);
+			if(!extended_error)
+				continue;
+
+			struct sock_extended_err error;
+			std::memcpy(&error, CMSG_DATA(header), sizeof(error));
+			if(error.ee_errno != ENOMSG || error.ee_origin != SO_EE_ORIGIN_TIMESTAMPING)
+				continue;
+
+			stamp.id = error.ee_data;
+			switch(error.ee_info)
+			{
+				case SCM_TSTAMP_SCHED: stamp.stage = transmit_stage::scheduled; break;
+				case SCM_TSTAMP_ACK: stamp.stage = transmit_stage::acknowledged; break;
+				default: stamp.stage = transmit_stage::sent; break;
+			}
+			found = true;
+		}
+
+		parse_timestamps(message, stamp.time);
+		if(!found)
+			return false;
+
+		result = stamp;
+		return true;
+#else
+		(void)s;
+		(void)result;
+		return false;
+#endif
+	}
+}
@@ -19,6 +19,17 @@ namespace networking::udp
 			_status = status::open;
 	}
 
+	// Constructor for a specific address family
+	socket::socket(ip_version ipv) :
+		_socket(protocol::udp, ipv),
+		_boundAddress(),
+		_status(status::invalid),
+		_error({0, "No error"})
+	{
+		if(_socket.valid())
+			_status = status::open;
+	}
+
 	// Destructor
 	socket::~socket()
 	{
@@ -56,6 +67,13 @@ namespace networking::udp
 		auto result = ::bind(_socket.get(), &(target.get()), target.length());
 		if(result == 0)
 		{
+			// Read the address back, so that ephemeral ports are known
+			struct sockaddr_storage local;
+			socklen_t length = sizeof(local);
+			if(::getsockname(_socket.get(), reinterpret_cast<struct sockaddr*>(&local), &length) == 0)
+				_boundAddress = networking::address { *reinterpret_cast<sockaddr*>(&local), length, local.ss_family };
+			else
+				_boundAddress = target;
 			_status = status::bound;
 		}
 		else
@@ -75,6 +93,12 @@ namespace networking::udp
 		_status = status::closed;
 	}
 
+	// Applies socket options, records the error on failure
+	bool socket::set_options(const socket_options& options)
+	{
+		return _socket.set_options(options, &_error);
+	}
+
 	// Receive data from connection
 	ssize_t socket::receive_from(uint8_t* buffer, std::size_t buffer_size, networking::address& target) const
 	{
@@ -93,4 +117,51 @@ namespace networking::udp
 		// Returns -1 on error, otherwise number of bytes sent
 		return ::sendto(_socket.get(), buffer, number_of_elements_to_send, 0, &(target.get()), target.length());
 	}
+
+	// Receive data, providing the sender as an endpoint
+	ssize_t socket::receive_from(uint8_t* buffer, std::size_t buffer_size, networking::endpoint& target) const
+	{
+		struct sockaddr_storage client;
+		socklen_t length = sizeof(client);
+		auto result = ::recvfrom(_socket.get(), buffer, buffer_size, 0, reinterpret_cast<struct sockaddr*>(&client), &length);
+		if(result >= 0)
+			target = networking::endpoint { *reinterpret_cast<sockaddr*>(&client), length };
+
+		// Returns -1 on error, otherwise number of bytes received
+		return result;
+	}
+
+	// Send data to an endpoint
+	ssize_t socket::send_to(const uint8_t* buffer, std::size_t number_of_elements_to_send, const networking::endpoint& target) const
+	{
+		struct sockaddr_storage destination;
+		const auto length = target.to_sockaddr(destination);
+
+		// Returns -1 on error, otherwise number of bytes sent
+		return ::sendto(_socket.get(), buffer, number_of_elements_to_send, 0, reinterpret_cast<const sockaddr*>(&destination), length);
+	}
+
+	// Enables kernel timestamps, records the error on failure
+	bool socket::enable_timestamping(const timestamp_options& options)
+	{
+		return networking::enable_timestamping(_socket.get(), options, &_error);
+	}
+
+	// Receive data with its kernel timestamps
+	ssize_t socket::receive_from(uint8_t* buffer, std::size_t buffer_size, networking::address& target, packet_timestamps& timestamps) const
+	{
+		struct sockaddr_storage client;
+		socklen_t length = sizeof(client);
+		auto result = receive_with_timestamps(_socket.get(), buffer, buffer_size, 0, timestamps, &client, &length);
+		if(result >= 0)
+			target = networking::address { *reinterpret_cast<sockaddr*>(&client), length, client.ss_family };
+
+		// Returns -1 on error, otherwise number of bytes received
+		return result;
+	}
+
+	bool socket::read_transmit_timestamp(transmit_timestamp& result) const
+	{
+		return networking::read_transmit_timestamp(_socket.get(), result);
+	}
 }
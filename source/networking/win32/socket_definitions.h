@@ -33,6 +33,13 @@ namespace networking
 	bool is_valid_socket(socket_type s) { return (s == INVALID_SOCKET); }
 	void close_socket(socket_type s) { closesocket(s); }
 
+	// Switches a socket between blocking and non-blocking mode
+	bool set_blocking(socket_type s, bool blocking)
+	{
+		u_long mode = blocking ? 0 : 1;
+		return ioctlsocket(s, FIONBIO, &mode) == 0;
+	}
+
 	struct socket_error_information
 	{
 		int error_code;
@@ -46,6 +53,9 @@ namespace networking
 		auto code = WSAGetLastError();
 		return { code, "Error message not retrieved" };
 	}
+
+	// True for errors from non-blocking sockets that just have to wait
+	bool would_block(const socket_error_information& e) { return e.error_code == WSAEWOULDBLOCK; }
 }
 
 #endif
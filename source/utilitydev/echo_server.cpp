@@ -0,0 +1,145 @@
+/////////////////////////////////////////////////////////////////////////
+// Echo server implementation
+/////////////////////////////////////////////////////////////////////////
+#include "echo_server.h"
+
+#include <thread>
+#include <vector>
+
+#include <networking/address.h>
+#include <networking/tcp/connection.h>
+#include <networking/socket_options.h>
+
+namespace utilitydev
+{
+	namespace
+	{
+		constexpr uint16_t update_timeout_ms = 100;	// For checking the stop flag
+		constexpr std::size_t largest_datagram = 65536;
+
+		networking::tcp::manager_options echo_manager_options(const echo_options& options)
+		{
+			networking::tcp::manager_options result;
+			result.spin_budget = options.spin_budget;
+			return result;
+		}
+	}
+
+	// ----------------------------------------------------------------------
+	// Constructor / destructor
+	// ----------------------------------------------------------------------
+	echo_server::echo_server(const echo_options& options) :
+		_options(options),
+		_manager(*this, echo_manager_options(options)),
+		_datagrams_socket(options.use_ipv6 ? networking::ip_version::ipv6 : networking::ip_version::ipv4),
+		_error({0, "No error"}),
+		_bytes(),
+		_datagrams(),
+		_running(false)
+	{
+	}
+
+	echo_server::~echo_server()
+	{
+	}
+
+	// ----------------------------------------------------------------------
+	// data_read_callback interface
+	// ----------------------------------------------------------------------
+	void echo_server::on_data(networking::tcp::connection& c, const uint8_t* data, std::size_t size)
+	{
+		// Accepted connections are blocking, so this only returns early on errors (the manager closes the connection on its next read)
+		std::size_t offset = 0;
+		while(offset < size)
+		{
+			const auto result = c.send(data + offset, size - offset);
+			if(result <= 0)
+				return;
+			offset += static_cast<std::size_t>(result);
+		}
+		_bytes.add(size);
+	}
+
+	// ----------------------------------------------------------------------
+	// Public interface
+	// ----------------------------------------------------------------------
+	bool echo_server::start()
+	{
+		const auto ipv = _options.use_ipv6 ? networking::ip_version::ipv6 : networking::ip_version::ipv4;
+		if(_options.tcp)
+		{
+			networking::socket_options options;
+			options.no_delay = true;
+
+			networking::tcp::listener l { _manager, _options.port, _options.use_ipv6, options };
+			if(!l.start(128))
+			{
+				_error = l.error();
+				return false;
+			}
+			_manager.add_listener(std::move(l));
+		}
+
+		if(_options.udp)
+		{
+			networking::socket_options options;
+			options.non_blocking = true;
+
+			if(!_datagrams_socket.bind(networking::create_host_address(_options.port, networking::protocol::udp, ipv)) || !_datagrams_socket.set_options(options))
+			{
+				_error = _datagrams_socket.error();
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void echo_server::run()
+	{
+		_running = true;
+		std::thread datagrams;
+		if(_options.udp)
+			datagrams = std::thread { [this]() { run_udp(); } };
+
+		while(_running.load())
+		{
+			if(_options.tcp)
+				_manager.update(update_timeout_ms);
+			else
+				std::this_thread::sleep_for(std::chrono::milliseconds { update_timeout_ms });
+		}
+
+		if(datagrams.joinable())
+			datagrams.join();
+	}
+
+	void echo_server::stop()
+	{
+		_running = false;
+		_manager.wake();
+	}
+
+	// ----------------------------------------------------------------------
+	// Private functions
+	// ----------------------------------------------------------------------
+	void echo_server::run_udp()
+	{
+		std::vector<uint8_t> buffer(largest_datagram);
+		struct pollfd readable { _datagrams_socket.handle(), POLLIN, 0 };
+		while(_running.load())
+		{
+			if(::poll(&readable, 1, update_timeout_ms) <= 0)
+				continue;
+
+			// Drains the socket (non-blocking), replies that do not fit into the send buffer are dropped
+			networking::address sender;
+			ssize_t received;
+			while((received = _datagrams_socket.receive_from(buffer.data(), buffer.size(), sender)) >= 0)
+			{
+				if(_datagrams_socket.send_to(buffer.data(), static_cast<std::size_t>(received), sender) >= 0)
+					_datagrams.add();
+			}
+		}
+	}
+}
@@ -0,0 +1,69 @@
+/////////////////////////////////////////////////////////////////////////
+// Echo server
+//
+// Sends back everything it receives, over TCP on a connection manager
+// and over UDP on a socket bound to the same port, each on its own
+// thread. The counterpart of the load generator.
+//
+// Note: The TCP echo blocks on a full send buffer, so a client that does
+//       not read its responses holds up the other connections.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <metrics/counter.h>
+#include <networking/tcp/connection_manager.h>
+#include <networking/tcp/listener.h>
+#include <networking/udp/socket.h>
+
+namespace utilitydev
+{
+	struct echo_options
+	{
+		networking::port_number_t port = 4242;
+		bool use_ipv6 = false;
+		bool tcp = true;
+		bool udp = true;
+		std::chrono::microseconds spin_budget { 0 };	// Busy polling of the connection manager after activity
+	};
+
+	class echo_server : public networking::tcp::data_read_callback
+	{
+		public:
+			// Constructor / destructor
+			explicit echo_server(const echo_options&);
+			~echo_server();
+
+			// Disallow copying
+			echo_server(const echo_server&) = delete;
+			echo_server& operator=(const echo_server&) = delete;
+
+			// data_read_callback interface
+			void on_data(networking::tcp::connection&, const uint8_t*, std::size_t) override;
+
+			// Public interface
+			bool start();		// Binds and listens, records the error on failure
+			void run();			// !! BLOCKING !! Until stopped
+			void stop();		// Thread-safe
+			std::size_t connection_count() const { return _manager.connection_count(); }
+			const networking::socket_error_information& error() const { return _error; }
+
+			uint64_t bytes_echoed() const { return _bytes.value(); }
+			uint64_t datagrams_echoed() const { return _datagrams.value(); }
+
+		private:
+			void run_udp();
+
+		private:
+			echo_options _options;
+			networking::tcp::connection_manager _manager;
+			networking::udp::socket _datagrams_socket;
+			networking::socket_error_information _error;
+			metrics::counter _bytes;
+			metrics::counter _datagrams;
+			std::atomic<bool> _running;
+	};
+}
@@ -0,0 +1,472 @@
+/////////////////////////////////////////////////////////////////////////
+// Load generator implementation
+/////////////////////////////////////////////////////////////////////////
+#include "load_generator.h"
+
+#include <deque>
+#include <thread>
+#include <optional>
+#include <algorithm>
+
+#include <bytes/serialize.h>
+#include <metrics/counter.h>
+#include <networking/socket_options.h>
+#include <networking/tcp/connection.h>
+#include <networking/udp/socket.h>
+
+namespace utilitydev
+{
+	namespace
+	{
+		using clock_type = std::chrono::steady_clock;
+
+		constexpr auto progress_interval = std::chrono::seconds { 1 };
+		constexpr int longest_poll_ms = 100;	// For checking the stop flag and the UDP timeouts
+		constexpr uint8_t filler = 0x5a;
+
+		uint64_t nanoseconds_between(clock_type::time_point from, clock_type::time_point to)
+		{
+			return (to > from) ? static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count()) : 0;
+		}
+
+		struct request
+		{
+			uint64_t sequence;
+			clock_type::time_point intended;	// Scheduled send time (the queueing time without a target rate)
+			clock_type::time_point queued;		// When it was queued for sending
+		};
+
+		// A TCP connection or UDP socket, with its requests in flight
+		struct channel
+		{
+			std::optional<networking::tcp::connection> stream;
+			std::optional<networking::udp::socket> datagram;
+			std::deque<request> in_flight;		// In the order sent
+			std::vector<uint8_t> outgoing;		// Requests not sent yet
+			std::size_t outgoing_offset = 0;
+			std::vector<uint8_t> incoming;		// Partially received responses (TCP)
+			clock_type::time_point next_send;	// With a target rate
+			uint64_t next_sequence = 0;
+			bool open = false;
+
+			networking::socket_type handle() const { return stream ? stream->socket().get() : datagram->handle(); }
+			bool sending() const { return outgoing_offset < outgoing.size(); }
+		};
+
+		bool open_channel(channel& c, const load_options& options)
+		{
+			networking::socket_options socket_options;
+			socket_options.non_blocking = true;
+
+			if(options.transport == networking::protocol::udp)
+			{
+				c.datagram.emplace(options.target.ip_version_value());
+				c.open = c.datagram->valid() && c.datagram->set_options(socket_options);
+				return c.open;
+			}
+
+			// Connects blocking, then switches to non-blocking mode
+			socket_options.no_delay = true;
+			c.stream.emplace(options.target, false, socket_options);
+			c.open = (c.stream->state() == networking::tcp::connection::status::open);
+			return c.open;
+		}
+	}
+
+	struct load_generator::shared_state
+	{
+		metrics::histogram latency;
+		metrics::histogram service_time;
+		metrics::counter sent;			// Measured requests
+		metrics::counter received;		// Responses to measured requests
+		metrics::counter lost;
+		metrics::counter errors;
+		metrics::counter responses;		// All responses, for the progress reports
+		std::atomic<std::size_t> running_workers { 0 };
+
+		// Set before the workers start
+		clock_type::time_point measure_start;
+		clock_type::time_point send_end;
+		clock_type::duration interval { 0 };	// Between the requests of one connection, zero without a target rate
+
+		bool measured(const request& r) const { return r.intended >= measure_start; }
+	};
+
+	// Runs a share of the connections on its own thread, with one poll over all of them
+	struct load_generator::worker
+	{
+		worker(const load_options& o, shared_state& s, const std::atomic<bool>& stopped) :
+			options(o),
+			shared(s),
+			stopped(stopped),
+			channels(),
+			pollfd(),
+			buffer(std::max<std::size_t>(o.message_size, 65536)),
+			thread()
+		{
+		}
+
+		void run();
+		clock_type::time_point queue_requests(channel&, clock_type::time_point now);
+		void flush(channel&);
+		void receive(channel&);
+		void complete(channel&, uint64_t sequence, clock_type::time_point now);
+		void expire(channel&, clock_type::time_point now);
+		void close(channel&);
+
+		const load_options& options;
+		shared_state& shared;
+		const std::atomic<bool>& stopped;
+		std::vector<channel> channels;
+		std::vector<struct pollfd> pollfd;	// One per channel
+		std::vector<uint8_t> buffer;		// For receiving
+		std::thread thread;
+	};
+
+	// ----------------------------------------------------------------------
+	// Constructor / destructor
+	// ----------------------------------------------------------------------
+	load_generator::load_generator(const load_options& options) :
+		_options(options),
+		_shared(std::make_unique<shared_state>()),
+		_stopped(false)
+	{
+	}
+
+	load_generator::~load_generator()
+	{
+	}
+
+	// ----------------------------------------------------------------------
+	// Public interface
+	// ----------------------------------------------------------------------
+	double load_report::throughput() const
+	{
+		const auto seconds = std::chrono::duration<double>(elapsed).count();
+		return (seconds > 0) ? static_cast<double>(received) / seconds : 0;
+	}
+
+	bool load_generator::valid() const
+	{
+		const bool transport = (_options.transport == networking::protocol::tcp || _options.transport == networking::protocol::udp);
+		const bool scheduled = (_options.mode == load_mode::closed_loop) || (_options.rate > 0);
+		return _options.target.valid() && transport && scheduled && _options.rate >= 0
+			&& _options.connections > 0 && _options.message_size >= request_header_size && _options.duration.count() > 0;
+	}
+
+	load_report load_generator::run(std::ostream* progress)
+	{
+		load_report report;
+		if(!valid())
+			return report;
+
+		// Connections are opened up front, and spread over the workers round-robin
+		auto& shared = *_shared;
+		const auto thread_count = std::clamp<std::size_t>(_options.threads, 1, _options.connections);
+		std::vector<std::unique_ptr<worker>> workers;
+		for(std::size_t i = 0; i < thread_count; i++)
+			workers.push_back(std::make_unique<worker>(_options, shared, _stopped));
+
+		for(std::size_t i = 0; i < _options.connections; i++)
+		{
+			channel c;
+			if(!open_channel(c, _options))
+			{
+				shared.errors.add();
+				continue;
+			}
+
+			workers[report.connected % thread_count]->channels.push_back(std::move(c));
+			report.connected++;
+		}
+
+		if(report.connected == 0)
+		{
+			report.errors = shared.errors.value();
+			return report;
+		}
+
+		// The connections' schedules are staggered, so the requests are evenly spaced overall
+		const auto start = clock_type::now();
+		shared.measure_start = start + _options.warmup;
+		shared.send_end = shared.measure_start + _options.duration;
+		if(_options.rate > 0)
+		{
+			const std::chrono::duration<double> spacing { 1.0 / _options.rate };
+			shared.interval = std::chrono::duration_cast<clock_type::duration>(spacing * static_cast<double>(report.connected));
+
+			for(std::size_t i = 0; i < report.connected; i++)
+			{
+				auto& c = workers[i % thread_count]->channels[i / thread_count];
+				c.next_send = start + std::chrono::duration_cast<clock_type::duration>(spacing * static_cast<double>(i));
+			}
+		}
+
+		workers.erase(std::remove_if(workers.begin(), workers.end(), [](const std::unique_ptr<worker>& w) { return w->channels.empty(); }), workers.end());
+		shared.running_workers = workers.size();
+		for(auto& w : workers)
+			w->thread = std::thread { [&w]() { w->run(); } };
+
+		// Progress reports, until the workers have received the last responses
+		auto next_progress = start + progress_interval;
+		uint64_t last_responses = 0;
+		std::optional<clock_type::time_point> stopped_at;
+		while(shared.running_workers.load() > 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds { 10 });
+			const auto now = clock_type::now();
+			if(!stopped_at && _stopped.load())
+				stopped_at = now;
+
+			if(now < next_progress)
+				continue;
+
+			const auto responses = shared.responses.value();
+			if(progress != nullptr)
+			{
+				const auto second = std::chrono::duration_cast<std::chrono::seconds>(next_progress - start).count();
+				*progress << "[" << second << " s] " << (responses - last_responses) << " responses"
+					<< ((next_progress <= shared.measure_start) ? " (warm-up)" : "")
+					<< ", " << shared.lost.value() << " lost, " << shared.errors.value() << " errors" << std::endl;
+			}
+			last_responses = responses;
+			next_progress += progress_interval;
+		}
+
+		for(auto& w : workers)
+			w->thread.join();
+
+		const auto end = stopped_at ? std::min(*stopped_at, shared.send_end) : shared.send_end;
+		report.elapsed = (end > shared.measure_start) ? std::chrono::duration_cast<std::chrono::nanoseconds>(end - shared.measure_start) : std::chrono::nanoseconds { 0 };
+		report.sent = shared.sent.value();
+		report.received = shared.received.value();
+		report.lost = shared.lost.value();
+		report.errors = shared.errors.value();
+		report.latency = shared.latency.snapshot();
+		report.service_time = shared.service_time.snapshot();
+		return report;
+	}
+
+	void load_generator::stop()
+	{
+		_stopped = true;
+	}
+
+	// ----------------------------------------------------------------------
+	// Workers
+	// ----------------------------------------------------------------------
+	void load_generator::worker::run()
+	{
+		pollfd.resize(channels.size());
+		for(std::size_t i = 0; i < channels.size(); i++)
+			pollfd[i] = { channels[i].handle(), POLLIN, 0 };
+
+		std::optional<clock_type::time_point> drain_end;
+		while(true)
+		{
+			const auto now = clock_type::now();
+			const bool sending = (now < shared.send_end) && !stopped.load(std::memory_order_relaxed);
+			if(!sending && !drain_end)
+				drain_end = now + options.timeout;
+
+			auto next_due = clock_type::time_point::max();
+			bool waiting = false;
+			for(std::size_t i = 0; i < channels.size(); i++)
+			{
+				auto& c = channels[i];
+				if(c.open)
+				{
+					if(sending)
+						next_due = std::min(next_due, queue_requests(c, now));
+					if(c.datagram)
+						expire(c, now);
+					flush(c);
+				}
+
+				pollfd[i].fd = c.open ? c.handle() : networking::uninitialized_socket;
+				pollfd[i].events = POLLIN | (c.sending() ? POLLOUT : 0);
+				waiting |= !c.in_flight.empty();
+			}
+
+			if(!sending && (!waiting || now >= *drain_end))
+				break;
+
+			// Waits shorter than a millisecond spin, so requests leave on schedule
+			auto wake_up = sending ? std::min(next_due, shared.send_end) : *drain_end;
+			const auto timeout = (wake_up <= now) ? 0 : std::min<int64_t>(longest_poll_ms, std::chrono::duration_cast<std::chrono::milliseconds>(wake_up - now).count());
+			if(::poll(pollfd.data(), pollfd.size(), static_cast<int>(timeout)) <= 0)
+				continue;
+
+			for(std::size_t i = 0; i < channels.size(); i++)
+			{
+				if(channels[i].open && (pollfd[i].revents & (POLLIN | POLLERR | POLLHUP)) != 0)
+					receive(channels[i]);
+			}
+		}
+
+		// Requests without a response are lost
+		for(auto& c : channels)
+		{
+			if(c.open)
+				close(c);
+		}
+		shared.running_workers--;
+	}
+
+	// Queues the requests that are due, returns when the next one is due (max() while waiting for responses)
+	clock_type::time_point load_generator::worker::queue_requests(channel& c, clock_type::time_point now)
+	{
+		const auto limit = options.in_flight_limit();
+		while(c.in_flight.size() < limit)
+		{
+			auto intended = now;
+			if(shared.interval.count() != 0)
+			{
+				if(c.next_send > now)
+					return c.next_send;
+
+				// Late requests keep their scheduled time, so the delay counts towards their latency
+				intended = c.next_send;
+				c.next_send += shared.interval;
+			}
+
+			const auto offset = c.outgoing.size();
+			c.outgoing.resize(offset + options.message_size, filler);
+			bytes::serializer<uint64_t>::serialize_at(c.next_sequence, c.outgoing.data() + offset);
+			c.in_flight.push_back({ c.next_sequence++, intended, now });
+			if(shared.measured(c.in_flight.back()))
+				shared.sent.add();
+		}
+
+		return clock_type::time_point::max();
+	}
+
+	// Sends the queued requests, as far as the socket buffer takes them
+	void load_generator::worker::flush(channel& c)
+	{
+		while(c.sending())
+		{
+			ssize_t result;
+			if(c.stream)
+				result = c.stream->send(c.outgoing.data() + c.outgoing_offset, c.outgoing.size() - c.outgoing_offset);
+			else
+				result = c.datagram->send_to(c.outgoing.data() + c.outgoing_offset, options.message_size, options.target);
+
+			if(result >= 0)
+			{
+				c.outgoing_offset += c.stream ? static_cast<std::size_t>(result) : options.message_size;
+				continue;
+			}
+
+			const auto error = networking::get_error_information();
+			if(networking::would_block(error))
+				return;
+
+			// A datagram that could not be sent times out as lost
+			shared.errors.add();
+			if(c.stream)
+			{
+				close(c);
+				return;
+			}
+			c.outgoing_offset += options.message_size;
+		}
+
+		c.outgoing.clear();
+		c.outgoing_offset = 0;
+	}
+
+	// Reads the available responses
+	void load_generator::worker::receive(channel& c)
+	{
+		while(c.open)
+		{
+			ssize_t result;
+			if(c.stream)
+			{
+				result = c.stream->receive_available(buffer.data(), buffer.size());
+			}
+			else
+			{
+				networking::address sender;
+				result = c.datagram->receive_from(buffer.data(), buffer.size(), sender);
+			}
+
+			const auto now = clock_type::now();
+			if(result > 0 && c.datagram)
+			{
+				if(static_cast<std::size_t>(result) >= request_header_size)
+					complete(c, bytes::serializer<uint64_t>::deserialize(*reinterpret_cast<const bytes::serializer<uint64_t>::buffer_type*>(buffer.data())), now);
+				continue;
+			}
+
+			if(result > 0)
+			{
+				// Responses are in order, and may be split over reads
+				c.incoming.insert(c.incoming.end(), buffer.data(), buffer.data() + result);
+				std::size_t offset = 0;
+				for(; c.incoming.size() - offset >= options.message_size; offset += options.message_size)
+					complete(c, bytes::serializer<uint64_t>::deserialize(*reinterpret_cast<const bytes::serializer<uint64_t>::buffer_type*>(c.incoming.data() + offset)), now);
+				c.incoming.erase(c.incoming.begin(), c.incoming.begin() + static_cast<std::ptrdiff_t>(offset));
+				continue;
+			}
+
+			if(result < 0 && networking::would_block(networking::get_error_information()))
+				return;
+
+			// Closed by the server, or failed
+			if(c.stream || result < 0)
+			{
+				shared.errors.add();
+				if(c.stream)
+					close(c);
+				return;
+			}
+		}
+	}
+
+	void load_generator::worker::complete(channel& c, uint64_t sequence, clock_type::time_point now)
+	{
+		// Usually the oldest request; datagrams may be reordered, or arrive after they timed out
+		const auto r = std::find_if(c.in_flight.begin(), c.in_flight.end(), [sequence](const request& q) { return q.sequence == sequence; });
+		if(r == c.in_flight.end())
+			return;
+
+		shared.responses.add();
+		if(shared.measured(*r))
+		{
+			shared.received.add();
+			shared.latency.record(nanoseconds_between(r->intended, now));
+			shared.service_time.record(nanoseconds_between(r->queued, now));
+		}
+		c.in_flight.erase(r);
+	}
+
+	// Counts UDP requests without a response within the timeout as lost
+	void load_generator::worker::expire(channel& c, clock_type::time_point now)
+	{
+		while(!c.in_flight.empty() && now - c.in_flight.front().queued > options.timeout)
+		{
+			if(shared.measured(c.in_flight.front()))
+				shared.lost.add();
+			c.in_flight.pop_front();
+		}
+	}
+
+	// Counts the requests in flight as lost
+	void load_generator::worker::close(channel& c)
+	{
+		for(const auto& r : c.in_flight)
+		{
+			if(shared.measured(r))
+				shared.lost.add();
+		}
+
+		c.in_flight.clear();
+		c.open = false;
+		if(c.stream)
+			c.stream->close();
+		else
+			c.datagram->close();
+	}
+}
@@ -0,0 +1,104 @@
+/////////////////////////////////////////////////////////////////////////
+// Load generator
+//
+// Drives a number of TCP connections or UDP sockets against an echo
+// server and measures the round trip of every request. Each request
+// starts with a sequence number, which the server echoes back with the
+// rest of the bytes, and is matched with the requests in flight on its
+// connection. UDP requests without a response within the timeout are
+// counted as lost.
+//
+// Closed loop: every connection keeps a fixed number of requests in
+// flight (one by default), sending the next when a response arrives.
+// Open loop: requests are sent on a fixed schedule at the target rate,
+// whether or not the earlier ones were answered (up to a limit on the
+// requests in flight per connection).
+//
+// With a target rate, latencies are measured from the scheduled send
+// time, so a stalled server is charged for the requests that should have
+// been sent while it stalled, not just the one that was waiting ("coordi-
+// nated omission"). The time from the actual send is reported as the
+// service time.
+//
+// Note: Requests scheduled during the warm-up are sent but not counted.
+/////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+
+#include <networking/address.h>
+#include <metrics/histogram.h>
+
+namespace utilitydev
+{
+	enum class load_mode
+	{
+		closed_loop,
+		open_loop,
+	};
+
+	// Sequence number of a request
+	constexpr std::size_t request_header_size = 8;
+
+	struct load_options
+	{
+		networking::protocol transport = networking::protocol::tcp;	// tcp or udp
+		networking::address target;
+		load_mode mode = load_mode::closed_loop;
+		std::size_t connections = 1;		// TCP connections or UDP sockets
+		std::size_t threads = 1;			// Connections are spread over the threads
+		double rate = 0;					// Requests per second over all connections, zero for as fast as possible (closed loop)
+		std::size_t message_size = 64;		// Bytes per request (and response), at least request_header_size
+		std::size_t in_flight = 0;			// Requests in flight per connection, zero for the mode's default
+		std::chrono::milliseconds duration { 10000 };
+		std::chrono::milliseconds warmup { 1000 };
+		std::chrono::milliseconds timeout { 1000 };	// For UDP responses, and for the responses after the last request
+
+		std::size_t in_flight_limit() const { return (in_flight != 0) ? in_flight : (mode == load_mode::open_loop ? 1024 : 1); }
+	};
+
+	struct load_report
+	{
+		std::chrono::nanoseconds elapsed { 0 };	// Measured period, without the warm-up and drain
+		std::size_t connected = 0;
+		uint64_t sent = 0;
+		uint64_t received = 0;
+		uint64_t lost = 0;		// Sent but not answered (dropped datagrams, or closed connections)
+		uint64_t errors = 0;	// Failed connects, sends and receives
+		metrics::histogram_snapshot latency;		// Nanoseconds from the intended send time
+		metrics::histogram_snapshot service_time;	// Nanoseconds from the actual send
+
+		double throughput() const;	// Responses per second
+	};
+
+	class load_generator
+	{
+		public:
+			// Constructor / destructor
+			explicit load_generator(const load_options&);
+			~load_generator();
+
+			// Disallow copying
+			load_generator(const load_generator&) = delete;
+			load_generator& operator=(const load_generator&) = delete;
+
+			// Public interface
+			bool valid() const;		// Whether the options can be run
+			load_report run(std::ostream* progress = nullptr);	// !! BLOCKING !! Progress is written every second
+			void stop();			// Thread-safe, ends the measured period early
+
+		private:
+			struct shared_state;
+			struct worker;
+
+		private:
+			load_options _options;
+			std::unique_ptr<shared_state> _shared;
+			std::atomic<bool> _stopped;
+	};
+}
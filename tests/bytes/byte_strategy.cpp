@@ -0,0 +1,99 @@
+///////////////////////////////////////////////////////////////////////
+// Tests of byte_strategy pipelines (fused and sequential)
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <bytes/byte_strategy.h>
+
+namespace
+{
+	// Appends a 32-bit sum of all bytes
+	struct sum_checksum
+	{
+		struct kernel
+		{
+			uint32_t sum = 0;
+			void process(uint8_t* block, std::size_t size) { for(std::size_t i = 0; i < size; i++) sum += block[i]; }
+			void finish(bytes::buffer& b) { b.append(reinterpret_cast<const uint8_t*>(&sum), sizeof(sum)); }
+		};
+
+		static bytes::buffer& apply(bytes::buffer& b)
+		{
+			kernel k;
+			k.process(b.get(), b.size());
+			k.finish(b);
+			return b;
+		}
+	};
+
+	// Position-dependent in-place encoding
+	struct xor_encode
+	{
+		struct kernel
+		{
+			uint8_t key = 0x5A;
+			void process(uint8_t* block, std::size_t size) { for(std::size_t i = 0; i < size; i++) block[i] ^= key++; }
+			void finish(bytes::buffer&) {}
+		};
+
+		static bytes::buffer& apply(bytes::buffer& b)
+		{
+			kernel k;
+			k.process(b.get(), b.size());
+			return b;
+		}
+	};
+
+	// Prepends a one-byte length (no kernel, always applied to the whole buffer)
+	struct length_frame
+	{
+		static bytes::buffer& apply(bytes::buffer& b)
+		{
+			bytes::buffer framed { 1 };
+			framed.get()[0] = static_cast<uint8_t>(b.size());
+			framed.append(b.get(), b.size());
+			b = std::move(framed);
+			return b;
+		}
+	};
+
+	bytes::buffer make_buffer(std::size_t size)
+	{
+		bytes::buffer b { size };
+		for(std::size_t i = 0; i < size; i++)
+			b.get()[i] = static_cast<uint8_t>(i * 7);
+		return b;
+	}
+}
+
+TEST(bytes_byte_strategy, kernel_detection)
+{
+	EXPECT_TRUE(bytes::has_kernel_v<sum_checksum>);
+	EXPECT_TRUE(bytes::has_kernel_v<xor_encode>);
+	EXPECT_FALSE(bytes::has_kernel_v<length_frame>);
+}
+
+TEST(bytes_byte_strategy, fused_equals_sequential)
+{
+	// Small block size so that the buffer spans several blocks
+	using pipeline = bytes::basic_byte_strategy<16, sum_checksum, xor_encode, length_frame, xor_encode, sum_checksum>;
+
+	auto fused = make_buffer(100);
+	auto sequential = make_buffer(100);
+
+	pipeline::apply(fused);
+	pipeline::apply_sequential(sequential);
+
+	ASSERT_EQ(fused.size(), 1U + 100U + 4U + 4U);
+	ASSERT_EQ(fused.size(), sequential.size());
+	EXPECT_TRUE(std::equal(fused.get(), fused.get() + fused.size(), sequential.get()));
+}
+
+TEST(bytes_byte_strategy, single_strategy)
+{
+	auto b = make_buffer(3);
+	bytes::byte_strategy<length_frame>::apply(b);
+
+	ASSERT_EQ(b.size(), 4U);
+	EXPECT_EQ(b.get()[0], 3);
+}
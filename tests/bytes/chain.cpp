@@ -0,0 +1,127 @@
+///////////////////////////////////////////////////////////////////////
+// Tests of the byte chain (zero-copy rope of slabs)
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <bytes/chain.h>
+
+namespace
+{
+	bytes::chain make_chain(const std::string& s)
+	{
+		return bytes::chain { reinterpret_cast<const uint8_t*>(s.data()), s.size() };
+	}
+
+	std::string to_string(const bytes::chain& c)
+	{
+		auto v = c.flatten();
+		return std::string(v.begin(), v.end());
+	}
+}
+
+TEST(bytes_chain, append_and_prepend)
+{
+	auto c = make_chain("payload");
+	auto header = make_chain("header:");
+	auto trailer = make_chain(":trailer");
+
+	c.prepend(std::move(header));
+	c.append(std::move(trailer));
+
+	EXPECT_EQ(to_string(c), "header:payload:trailer");
+	EXPECT_EQ(c.size(), 22U);
+	EXPECT_EQ(c.number_of_segments(), 3U);
+	EXPECT_TRUE(header.empty());
+	EXPECT_TRUE(trailer.empty());
+}
+
+TEST(bytes_chain, split_and_slice_share_slabs)
+{
+	auto a = make_chain("0123456789");
+	const auto* original = a.begin()->data();
+	a.append(make_chain("abcdef"));
+
+	auto suffix = a.suffix(4);
+	EXPECT_EQ(to_string(suffix), "cdef");
+
+	auto slice = a.slice(8, 4);
+	EXPECT_EQ(to_string(slice), "89ab");
+	EXPECT_EQ(slice.number_of_segments(), 2U);
+	EXPECT_EQ(slice.begin()->data(), original + 8);
+
+	auto head = a.split(5);
+	EXPECT_EQ(to_string(head), "01234");
+	EXPECT_EQ(to_string(a), "56789abcdef");
+	EXPECT_EQ(head.begin()->data(), original);
+	EXPECT_EQ(a.begin()->data(), original + 5);
+}
+
+TEST(bytes_chain, offsets_across_many_segments)
+{
+	// Segments of varying length, added at both ends, so the positions start below zero and wrap around
+	bytes::chain c;
+	std::string expected;
+	for(int i = 0; i < 40; i++)
+	{
+		const std::string part(static_cast<std::size_t>(i % 7 + 1), static_cast<char>('a' + i % 26));
+		if(i % 2 == 0)
+		{
+			c.append(make_chain(part));
+			expected += part;
+		}
+		else
+		{
+			c.prepend(make_chain(part));
+			expected = part + expected;
+		}
+	}
+	c.trim_front(3);
+	c.trim_back(2);
+	expected = expected.substr(3, expected.size() - 5);
+	ASSERT_EQ(to_string(c), expected);
+
+	for(std::size_t offset = 0; offset <= expected.size(); offset += 3)
+	{
+		for(std::size_t length : { std::size_t(1), std::size_t(5), std::size_t(17), expected.size() })
+			EXPECT_EQ(to_string(c.slice(offset, length)), expected.substr(offset, length)) << offset << "+" << length;
+	}
+
+	// Splitting repeatedly, the remainder keeps working
+	while(!c.empty())
+	{
+		auto head = c.split(11);
+		EXPECT_EQ(to_string(head), expected.substr(0, 11));
+		expected.erase(0, std::min<std::size_t>(11, expected.size()));
+		EXPECT_EQ(to_string(c), expected);
+		EXPECT_EQ(to_string(c.suffix(4)), expected.substr(expected.size() > 4 ? expected.size() - 4 : 0));
+	}
+}
+
+TEST(bytes_chain, trim)
+{
+	auto c = make_chain("abc");
+	c.append(make_chain("defg"));
+	c.append(make_chain("hi"));
+
+	c.trim_front(4);
+	c.trim_back(3);
+	EXPECT_EQ(to_string(c), "ef");
+	EXPECT_EQ(c.number_of_segments(), 1U);
+
+	c.trim_back(10);
+	EXPECT_TRUE(c.empty());
+	EXPECT_EQ(c.number_of_segments(), 0U);
+}
+
+TEST(bytes_chain, iovec_export)
+{
+	auto c = make_chain("hello ");
+	c.append(make_chain("world"));
+
+	auto iov = c.to_iovec();
+	ASSERT_EQ(iov.size(), 2U);
+	EXPECT_EQ(std::string(static_cast<const char*>(iov[0].iov_base), iov[0].iov_len), "hello ");
+	EXPECT_EQ(std::string(static_cast<const char*>(iov[1].iov_base), iov[1].iov_len), "world");
+}
@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////
+// Tests of the LZ compression and strategies
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <bytes/compression.h>
+#include <bytes/byte_strategy.h>
+#include <bytes/crc32c.h>
+
+namespace
+{
+	std::vector<uint8_t> make_text(std::size_t size)
+	{
+		const std::string words[] = { "order ", "price=", "1024.50 ", "qty=", "300 ", "symbol=", "ABC ", "side=buy\n" };
+		std::vector<uint8_t> data;
+		uint32_t state = 7;
+		while(data.size() < size)
+		{
+			state = state * 1103515245 + 12345;
+			const auto& w = words[(state >> 16) % 8];
+			data.insert(data.end(), w.begin(), w.end());
+		}
+		data.resize(size);
+		return data;
+	}
+
+	std::vector<uint8_t> make_random(std::size_t size)
+	{
+		std::vector<uint8_t> data(size);
+		uint32_t state = 99;
+		for(auto& d : data)
+		{
+			state = state * 1103515245 + 12345;
+			d = static_cast<uint8_t>(state >> 16);
+		}
+		return data;
+	}
+
+	void expect_roundtrip(const std::vector<uint8_t>& input)
+	{
+		std::vector<uint8_t> compressed(bytes::lz_compress_bound(input.size()));
+		const auto compressed_size = bytes::lz_compress(input.data(), input.size(), compressed.data(), compressed.size());
+		ASSERT_GT(compressed_size, 0U);
+
+		std::vector<uint8_t> output(input.size());
+		ASSERT_TRUE(bytes::lz_decompress(compressed.data(), compressed_size, output.data(), output.size()));
+		EXPECT_EQ(input, output);
+	}
+}
+
+TEST(bytes_compression, roundtrip)
+{
+	for(std::size_t size : { 0UL, 1UL, 12UL, 13UL, 200UL, 1000UL, 4096UL, 70000UL })
+	{
+		expect_roundtrip(make_text(size));
+		expect_roundtrip(make_random(size));
+		expect_roundtrip(std::vector<uint8_t>(size, 0xAB));
+	}
+}
+
+TEST(bytes_compression, compresses_text)
+{
+	const auto input = make_text(4096);
+	std::vector<uint8_t> compressed(bytes::lz_compress_bound(input.size()));
+	const auto compressed_size = bytes::lz_compress(input.data(), input.size(), compressed.data(), compressed.size());
+
+	EXPECT_LT(compressed_size, input.size() / 2);
+}
+
+TEST(bytes_compression, strategy_roundtrip)
+{
+	using send_pipeline = bytes::byte_strategy<bytes::lz_compress_strategy, bytes::crc32c_append>;
+	using receive_pipeline = bytes::byte_strategy<bytes::crc32c_verify, bytes::lz_decompress_strategy>;
+
+	for(const auto& input : { make_text(300), make_random(300) })
+	{
+		bytes::buffer b { std::vector<uint8_t>(input) };
+		send_pipeline::apply(b);
+		receive_pipeline::apply(b);
+
+		ASSERT_EQ(b.size(), input.size());
+		EXPECT_TRUE(std::equal(input.begin(), input.end(), b.get()));
+	}
+}
+
+TEST(bytes_compression, rejects_malformed_input)
+{
+	const auto input = make_text(1000);
+	bytes::buffer b { std::vector<uint8_t>(input) };
+	bytes::lz_compress_strategy::apply(b);
+
+	// Truncated payload
+	bytes::buffer truncated { std::vector<uint8_t>(b.get(), b.get() + b.size() - 3) };
+	bytes::lz_decompress_strategy::apply(truncated);
+	EXPECT_TRUE(truncated.empty());
+
+	// Offset pointing before the start of the output
+	const uint8_t bad[] = { 0x10, 'a', 0x05, 0x00 };
+	std::vector<uint8_t> output(5);
+	EXPECT_FALSE(bytes::lz_decompress(bad, sizeof(bad), output.data(), output.size()));
+}
@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////
+// Tests of the CRC32C checksum and strategies
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <bytes/crc32c.h>
+#include <bytes/byte_strategy.h>
+
+namespace
+{
+	std::vector<uint8_t> make_data(std::size_t size)
+	{
+		std::vector<uint8_t> data(size);
+		uint32_t state = 12345;
+		for(auto& d : data)
+		{
+			state = state * 1103515245 + 12345;
+			d = static_cast<uint8_t>(state >> 16);
+		}
+		return data;
+	}
+}
+
+TEST(bytes_crc32c, check_value)
+{
+	const std::string input { "123456789" };
+	const auto data = reinterpret_cast<const uint8_t*>(input.data());
+
+	EXPECT_EQ(bytes::crc32c(data, input.size()), 0xE3069283U);
+	EXPECT_EQ(bytes::crc32c_portable(data, input.size()), 0xE3069283U);
+	EXPECT_EQ(bytes::crc32c_hardware(data, input.size()), 0xE3069283U);
+}
+
+TEST(bytes_crc32c, implementations_agree)
+{
+	// Sizes cover the byte, word, short block and long block paths, with unaligned starts
+	const auto data = make_data(3 * 8192 * 2 + 3 * 256 + 77);
+	for(std::size_t size : { 0UL, 1UL, 7UL, 8UL, 100UL, 3UL * 256, 3UL * 256 + 13, 3UL * 8192, data.size() - 1 })
+	{
+		const auto portable = bytes::crc32c_portable(data.data() + 1, size);
+		EXPECT_EQ(bytes::crc32c_hardware(data.data() + 1, size), portable) << "size " << size;
+		EXPECT_EQ(bytes::crc32c(data.data() + 1, size), portable) << "size " << size;
+	}
+}
+
+TEST(bytes_crc32c, chaining)
+{
+	const auto data = make_data(1000);
+	const auto first = bytes::crc32c(data.data(), 333);
+	EXPECT_EQ(bytes::crc32c(data.data() + 333, data.size() - 333, first), bytes::crc32c(data.data(), data.size()));
+}
+
+TEST(bytes_crc32c, append_and_verify)
+{
+	using pipeline = bytes::basic_byte_strategy<64, bytes::crc32c_append, bytes::crc32c_append>;
+
+	bytes::buffer b { make_data(1000) };
+	pipeline::apply(b);
+	ASSERT_EQ(b.size(), 1000U + 2 * bytes::crc32c_size);
+
+	bytes::crc32c_verify::apply(b);
+	ASSERT_EQ(b.size(), 1000U + bytes::crc32c_size);
+	bytes::crc32c_verify::apply(b);
+	ASSERT_EQ(b.size(), 1000U);
+
+	const auto reference = make_data(1000);
+	EXPECT_TRUE(std::equal(reference.begin(), reference.end(), b.get()));
+}
+
+TEST(bytes_crc32c, verify_detects_corruption)
+{
+	bytes::buffer b { make_data(100) };
+	bytes::crc32c_append::apply(b);
+	b.get()[50] ^= 1;
+
+	EXPECT_FALSE(bytes::verify_and_strip_crc32c(b));
+	EXPECT_EQ(b.size(), 100U + bytes::crc32c_size);
+
+	bytes::crc32c_verify::apply(b);
+	EXPECT_TRUE(b.empty());
+}
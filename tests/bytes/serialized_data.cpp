@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////
+// Tests of the serialized_data storage (inline and pooled)
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <bytes/serialize.h>
+
+namespace
+{
+	struct large_entity
+	{
+		std::array<bytes::byte, 200> payload;
+	};
+}
+
+template <> struct bytes::serialized_size<large_entity> { static constexpr std::size_t value = 200; };
+
+template <> auto bytes::serializer<large_entity>::serialize(const large_entity& value) -> typename bytes::serializer<large_entity>::buffer_type
+{
+	return value.payload;
+}
+
+TEST(bytes_serialized_data, small_payload_is_inline)
+{
+	uint32_t value = 0xDEADBEEF;
+	bytes::serialized_data data { value };
+
+	EXPECT_TRUE(data.is_inline());
+	ASSERT_EQ(data.size(), sizeof(value));
+	EXPECT_EQ(bytes::deserialize<uint32_t>(*reinterpret_cast<const std::array<bytes::byte, 4>*>(data.get())), value);
+}
+
+TEST(bytes_serialized_data, large_payload_is_pooled_and_reused)
+{
+	large_entity entity {};
+	for(std::size_t i = 0; i < entity.payload.size(); i++)
+		entity.payload[i] = static_cast<bytes::byte>(i);
+
+	bytes::size_class_pool::trim();
+	const bytes::byte* first_block = nullptr;
+	{
+		bytes::serialized_data data { entity };
+		EXPECT_FALSE(data.is_inline());
+		ASSERT_EQ(data.size(), entity.payload.size());
+		EXPECT_TRUE(std::equal(entity.payload.begin(), entity.payload.end(), data.get()));
+		first_block = data.get();
+	}
+	EXPECT_EQ(bytes::size_class_pool::cached_blocks(), 1U);
+
+	bytes::serialized_data data { entity };
+	EXPECT_EQ(data.get(), first_block);
+	EXPECT_EQ(bytes::size_class_pool::cached_blocks(), 0U);
+}
+
+TEST(bytes_serialized_data, copy_and_move)
+{
+	large_entity entity {};
+	entity.payload[0] = 42;
+	entity.payload[199] = 24;
+
+	bytes::serialized_data original { entity };
+	bytes::serialized_data copy { original };
+	EXPECT_NE(copy.get(), original.get());
+	EXPECT_TRUE(std::equal(copy.get(), copy.get() + copy.size(), original.get()));
+
+	const auto block = copy.get();
+	bytes::serialized_data moved { std::move(copy) };
+	EXPECT_EQ(moved.get(), block);
+	EXPECT_EQ(copy.size(), 0U);
+
+	bytes::serialized_data small { uint16_t(7) };
+	small = std::move(moved);
+	EXPECT_EQ(small.get(), block);
+	EXPECT_EQ(small.get()[199], 24);
+
+	// Vectors move (rather than copy) the elements when growing
+	static_assert(std::is_nothrow_move_constructible_v<bytes::serialized_data>);
+	static_assert(std::is_nothrow_move_assignable_v<bytes::serialized_data>);
+}
@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////
+// Tests of the open-addressing hash map
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <containers/flat_hash_map.h>
+
+TEST(containers_flat_hash_map, insert_find_erase)
+{
+	utility::flat_hash_map<int, std::string> map;
+
+	EXPECT_TRUE(map.emplace(1, "one").second);
+	EXPECT_FALSE(map.emplace(1, "uno").second);
+	map[2] = "two";
+
+	EXPECT_EQ(map.size(), 2U);
+	EXPECT_EQ(map.find(1)->second, "one");
+	EXPECT_EQ(map[2], "two");
+	EXPECT_TRUE(map.find(3) == map.end());
+
+	EXPECT_TRUE(map.erase(1));
+	EXPECT_FALSE(map.erase(1));
+	EXPECT_FALSE(map.contains(1));
+	EXPECT_EQ(map.size(), 1U);
+}
+
+TEST(containers_flat_hash_map, matches_unordered_map)
+{
+	utility::flat_hash_map<uint64_t, uint64_t> map;
+	std::unordered_map<uint64_t, uint64_t> reference;
+
+	// Keys from a small range so that inserts, overwrites and erases mix
+	uint64_t state = 1;
+	for(int i = 0; i < 200000; i++)
+	{
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		const auto key = (state >> 33) % 5000;
+		if((state >> 20) & 1)
+		{
+			map[key] = i;
+			reference[key] = i;
+		}
+		else
+		{
+			EXPECT_EQ(map.erase(key), reference.erase(key) == 1);
+		}
+	}
+
+	ASSERT_EQ(map.size(), reference.size());
+	for(const auto& entry : reference)
+	{
+		auto i = map.find(entry.first);
+		ASSERT_TRUE(i != map.end());
+		EXPECT_EQ(i->second, entry.second);
+	}
+
+	std::size_t iterated = 0;
+	for(const auto& entry : map)
+	{
+		EXPECT_EQ(reference.at(entry.first), entry.second);
+		iterated++;
+	}
+	EXPECT_EQ(iterated, reference.size());
+}
+
+TEST(containers_flat_hash_map, non_default_constructible_values)
+{
+	utility::flat_hash_map<int, std::unique_ptr<int>> map { 100 };
+	const auto capacity = map.capacity();
+
+	for(int i = 0; i < 100; i++)
+		map.emplace(i, std::make_unique<int>(i * i));
+
+	EXPECT_EQ(map.capacity(), capacity);
+	EXPECT_EQ(*map.find(9)->second, 81);
+
+	auto moved = std::move(map);
+	EXPECT_EQ(moved.size(), 100U);
+	EXPECT_EQ(*moved.find(99)->second, 99 * 99);
+}
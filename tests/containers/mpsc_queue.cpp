@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////
+// Tests of the multi-producer single-consumer queue
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <containers/mpsc_queue.h>
+
+TEST(containers_mpsc_queue, keeps_order)
+{
+	utility::mpsc_queue<std::unique_ptr<int>> queue;
+	EXPECT_TRUE(queue.empty());
+
+	// Only the first push finds the queue without waiting elements
+	EXPECT_TRUE(queue.push(std::make_unique<int>(1)));
+	EXPECT_FALSE(queue.push(std::make_unique<int>(2)));
+	EXPECT_FALSE(queue.empty());
+
+	std::unique_ptr<int> value;
+	ASSERT_TRUE(queue.read(value));
+	EXPECT_EQ(*value, 1);
+
+	// Taken over by the consumer, so the next push may need to wake it
+	EXPECT_TRUE(queue.push(std::make_unique<int>(3)));
+	ASSERT_TRUE(queue.read(value));
+	EXPECT_EQ(*value, 2);
+	ASSERT_TRUE(queue.read(value));
+	EXPECT_EQ(*value, 3);
+	EXPECT_FALSE(queue.read(value));
+	EXPECT_TRUE(queue.empty());
+
+	// Elements left in the queue are released by the destructor
+	queue.push(std::make_unique<int>(4));
+}
+
+TEST(containers_mpsc_queue, multiple_producers)
+{
+	constexpr uint32_t producers = 4;
+	constexpr uint32_t count = 100000;
+	utility::mpsc_queue<uint64_t> queue;
+
+	std::vector<std::thread> threads;
+	for(uint32_t p = 0; p < producers; p++)
+	{
+		threads.emplace_back([&queue, p]()
+		{
+			for(uint32_t i = 0; i < count; i++)
+				queue.push((static_cast<uint64_t>(p) << 32) | i);
+		});
+	}
+
+	// Elements of each producer arrive in order
+	std::vector<uint32_t> next(producers, 0);
+	uint64_t value = 0;
+	for(uint32_t received = 0; received < producers * count; )
+	{
+		if(!queue.read(value))
+			continue;
+
+		const auto p = static_cast<uint32_t>(value >> 32);
+		ASSERT_LT(p, producers);
+		ASSERT_EQ(static_cast<uint32_t>(value), next[p]);
+		next[p]++;
+		received++;
+	}
+
+	for(auto& t : threads)
+		t.join();
+	EXPECT_TRUE(queue.empty());
+}
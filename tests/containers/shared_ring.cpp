@@ -0,0 +1,249 @@
+///////////////////////////////////////////////////////////////////////
+// Tests of the process-shared ring buffer
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <string>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include <containers/shared_ring.h>
+
+namespace
+{
+	std::vector<uint8_t> message(uint32_t sequence, std::size_t size)
+	{
+		std::vector<uint8_t> result(size);
+		for(std::size_t i = 0; i < size; i++)
+			result[i] = static_cast<uint8_t>(sequence + i);
+		return result;
+	}
+
+	bool push(utility::shared_ring& ring, const std::vector<uint8_t>& data)
+	{
+		return ring.push(data.data(), data.size());
+	}
+}
+
+TEST(containers_shared_ring, push_and_read)
+{
+	auto consumer = utility::shared_ring::create("", 4096, utility::shared_ring_role::consumer);
+	ASSERT_EQ(consumer.state(), utility::shared_ring::status::open) << consumer.error();
+	EXPECT_EQ(consumer.capacity(), 4096U);
+	EXPECT_TRUE(consumer.empty());
+
+	auto producer = utility::shared_ring::attach(consumer.fd(), utility::shared_ring_role::producer);
+	ASSERT_EQ(producer.state(), utility::shared_ring::status::open) << producer.error();
+	EXPECT_EQ(producer.producers(), 1U);
+	EXPECT_TRUE(producer.consumer_attached());
+
+	// Variable-length messages, including empty ones
+	EXPECT_TRUE(push(producer, message(1, 5)));
+	EXPECT_TRUE(push(producer, message(2, 0)));
+	EXPECT_TRUE(push(producer, message(3, 100)));
+	EXPECT_FALSE(consumer.empty());
+	EXPECT_EQ(consumer.bytes_used(), 16U + 8U + 112U);
+
+	std::vector<uint8_t> result;
+	ASSERT_TRUE(consumer.read(result));
+	EXPECT_EQ(result, message(1, 5));
+
+	std::size_t size = 1;
+	ASSERT_NE(consumer.peek(size), nullptr);
+	EXPECT_EQ(size, 0U);
+	EXPECT_TRUE(consumer.pop());
+
+	ASSERT_TRUE(consumer.read(result));
+	EXPECT_EQ(result, message(3, 100));
+	EXPECT_FALSE(consumer.read(result));
+	EXPECT_TRUE(consumer.empty());
+	EXPECT_EQ(consumer.bytes_used(), 0U);
+
+	// Only producers push and only the consumer reads
+	EXPECT_FALSE(push(consumer, message(4, 1)));
+	EXPECT_FALSE(producer.read(result));
+}
+
+TEST(containers_shared_ring, full_and_wrap_around)
+{
+	auto consumer = utility::shared_ring::create("", 4096, utility::shared_ring_role::consumer);
+	auto producer = utility::shared_ring::attach(consumer.fd(), utility::shared_ring_role::producer);
+	ASSERT_EQ(producer.state(), utility::shared_ring::status::open);
+
+	EXPECT_EQ(producer.max_message_size(), 2048U - 8U);
+	EXPECT_FALSE(push(producer, message(0, 2048)));
+
+	// Fill the ring, then drain it
+	uint32_t pushed = 0;
+	while(push(producer, message(pushed, 300)))
+		pushed++;
+	EXPECT_EQ(pushed, 4096U / 312U);
+
+	std::vector<uint8_t> result;
+	for(uint32_t i = 0; i < pushed; i++)
+	{
+		ASSERT_TRUE(consumer.read(result));
+		EXPECT_EQ(result, message(i, 300));
+	}
+
+	// Sizes that do not divide the capacity, so records are regularly preceded by padding
+	uint32_t read = 0;
+	pushed = 0;
+	for(int round = 0; round < 2000; round++)
+	{
+		while(push(producer, message(pushed, (pushed * 37) % 1500)))
+			pushed++;
+
+		ASSERT_TRUE(consumer.read(result));
+		ASSERT_EQ(result, message(read, (read * 37) % 1500));
+		read++;
+	}
+}
+
+TEST(containers_shared_ring, attach_handshake)
+{
+	const std::string name = "/utilitylib_ring_" + std::to_string(::getpid());
+	{
+		auto creator = utility::shared_ring::create(name, 8192, utility::shared_ring_role::producer);
+		ASSERT_EQ(creator.state(), utility::shared_ring::status::open) << creator.error();
+
+		// The name is taken
+		auto duplicate = utility::shared_ring::create(name, 8192, utility::shared_ring_role::none);
+		EXPECT_EQ(duplicate.state(), utility::shared_ring::status::error);
+		EXPECT_EQ(duplicate.error(), EEXIST);
+
+		auto consumer = utility::shared_ring::attach(name, utility::shared_ring_role::consumer);
+		ASSERT_EQ(consumer.state(), utility::shared_ring::status::open);
+		EXPECT_EQ(consumer.capacity(), 8192U);
+
+		// One consumer, and one producer in single-producer mode
+		auto second_consumer = utility::shared_ring::attach(name, utility::shared_ring_role::consumer);
+		EXPECT_EQ(second_consumer.state(), utility::shared_ring::status::in_use);
+		auto second_producer = utility::shared_ring::attach(name, utility::shared_ring_role::producer);
+		EXPECT_EQ(second_producer.state(), utility::shared_ring::status::in_use);
+
+		// A monitor can always attach
+		auto monitor = utility::shared_ring::attach(name, utility::shared_ring_role::none);
+		EXPECT_EQ(monitor.state(), utility::shared_ring::status::open);
+
+		// The role is free again after detaching
+		consumer.close();
+		EXPECT_FALSE(creator.consumer_attached());
+		consumer = utility::shared_ring::attach(name, utility::shared_ring_role::consumer);
+		EXPECT_EQ(consumer.state(), utility::shared_ring::status::open);
+	}
+
+	// The creator removed the name
+	auto gone = utility::shared_ring::attach(name, utility::shared_ring_role::consumer);
+	EXPECT_EQ(gone.state(), utility::shared_ring::status::error);
+	EXPECT_EQ(gone.error(), ENOENT);
+}
+
+TEST(containers_shared_ring, rejects_other_files)
+{
+	auto ring = utility::shared_ring::create("", 4096, utility::shared_ring_role::none);
+	ASSERT_EQ(ring.state(), utility::shared_ring::status::open);
+
+	// A descriptor that is not a ring
+	int pipe_fds[2];
+	ASSERT_EQ(::pipe(pipe_fds), 0);
+	auto pipe = utility::shared_ring::attach(pipe_fds[0], utility::shared_ring_role::consumer);
+	EXPECT_NE(pipe.state(), utility::shared_ring::status::open);
+	::close(pipe_fds[0]);
+	::close(pipe_fds[1]);
+
+	// A file that is still empty (the creator has not initialized it)
+	const int empty = ::memfd_create("empty", MFD_CLOEXEC);
+	auto not_ready = utility::shared_ring::attach(empty, utility::shared_ring_role::consumer);
+	EXPECT_EQ(not_ready.state(), utility::shared_ring::status::not_ready);
+	::close(empty);
+}
+
+TEST(containers_shared_ring, multiple_producers)
+{
+	constexpr int producer_count = 4;
+	constexpr uint32_t messages = 20000;
+
+	auto consumer = utility::shared_ring::create("", 16384, utility::shared_ring_role::consumer, utility::shared_ring_mode::multi_producer);
+	ASSERT_EQ(consumer.state(), utility::shared_ring::status::open);
+
+	std::vector<std::thread> threads;
+	for(int p = 0; p < producer_count; p++)
+	{
+		threads.emplace_back([&consumer, p]()
+		{
+			auto producer = utility::shared_ring::attach(consumer.fd(), utility::shared_ring_role::producer);
+			for(uint32_t i = 0; i < messages; i++)
+			{
+				// Every other message drops the high byte of the sequence, to vary the record size
+				const uint32_t value[2] = { static_cast<uint32_t>(p), i };
+				while(!producer.push(reinterpret_cast<const uint8_t*>(value), sizeof(value) - (i % 2)))
+					std::this_thread::yield();
+			}
+		});
+	}
+
+	// Messages of each producer arrive in order
+	std::vector<uint32_t> next(producer_count, 0);
+	for(uint32_t received = 0; received < producer_count * messages;)
+	{
+		if(!consumer.wait(std::chrono::milliseconds { 100 }))
+			continue;
+
+		std::size_t size = 0;
+		const auto* data = consumer.peek(size);
+		ASSERT_NE(data, nullptr);
+		uint32_t value[2] = { 0, 0 };
+		std::memcpy(value, data, size);
+		ASSERT_LT(value[0], static_cast<uint32_t>(producer_count));
+		ASSERT_EQ(value[1] & 0xffffff, next[value[0]] & 0xffffff);
+		next[value[0]]++;
+		consumer.pop();
+		received++;
+	}
+
+	for(auto& t : threads)
+		t.join();
+	EXPECT_TRUE(consumer.empty());
+}
+
+TEST(containers_shared_ring, wait_across_processes)
+{
+	auto consumer = utility::shared_ring::create("", 4096, utility::shared_ring_role::consumer);
+	ASSERT_EQ(consumer.state(), utility::shared_ring::status::open);
+
+	// Nothing arrives
+	EXPECT_FALSE(consumer.wait(std::chrono::milliseconds { 5 }));
+
+	const pid_t child = ::fork();
+	ASSERT_GE(child, 0);
+	if(child == 0)
+	{
+		// The forked child attaches through the inherited descriptor and produces
+		auto producer = utility::shared_ring::attach(consumer.fd(), utility::shared_ring_role::producer);
+		for(uint32_t i = 0; i < 1000; i++)
+		{
+			while(!push(producer, message(i, 64)))
+				std::this_thread::yield();
+			if(i % 100 == 0)
+				std::this_thread::sleep_for(std::chrono::milliseconds { 1 });
+		}
+		::_exit(producer.state() == utility::shared_ring::status::open ? 0 : 1);
+	}
+
+	std::vector<uint8_t> result;
+	for(uint32_t i = 0; i < 1000; i++)
+	{
+		ASSERT_TRUE(consumer.wait(std::chrono::seconds { 5 }));
+		ASSERT_TRUE(consumer.read(result));
+		ASSERT_EQ(result, message(i, 64));
+	}
+
+	int child_status = 0;
+	::waitpid(child, &child_status, 0);
+	EXPECT_TRUE(WIFEXITED(child_status) && WEXITSTATUS(child_status) == 0);
+}
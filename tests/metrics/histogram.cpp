@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////
+// Tests of the log-linear histogram
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+#include <limits>
+
+#include <metrics/histogram.h>
+
+TEST(metrics_histogram, buckets_cover_all_values)
+{
+	// Small values are exact
+	for(uint64_t v = 0; v < metrics::histogram::sub_buckets; v++)
+	{
+		EXPECT_EQ(metrics::histogram::bucket_index(v), v);
+		EXPECT_EQ(metrics::histogram::bucket_lowest(v), v);
+		EXPECT_EQ(metrics::histogram::bucket_highest(v), v);
+	}
+
+	// Buckets are contiguous, and every value lies in its bucket
+	for(std::size_t i = 1; i < metrics::histogram::bucket_count; i++)
+		ASSERT_EQ(metrics::histogram::bucket_lowest(i), metrics::histogram::bucket_highest(i - 1) + 1) << i;
+
+	const auto last = metrics::histogram::bucket_count - 1;
+	EXPECT_EQ(metrics::histogram::bucket_index(std::numeric_limits<uint64_t>::max()), last);
+	EXPECT_EQ(metrics::histogram::bucket_highest(last), std::numeric_limits<uint64_t>::max());
+
+	for(uint64_t v : { 32ULL, 33ULL, 63ULL, 64ULL, 1000ULL, 123456789ULL, 1ULL << 40 })
+	{
+		const auto i = metrics::histogram::bucket_index(v);
+		EXPECT_LE(metrics::histogram::bucket_lowest(i), v);
+		EXPECT_GE(metrics::histogram::bucket_highest(i), v);
+
+		// Relative bucket width within 1/32
+		const auto width = metrics::histogram::bucket_highest(i) - metrics::histogram::bucket_lowest(i) + 1;
+		EXPECT_LE(width * 32, metrics::histogram::bucket_lowest(i));
+	}
+}
+
+TEST(metrics_histogram, percentiles)
+{
+	metrics::histogram h;
+	for(uint64_t v = 1; v <= 10000; v++)
+		h.record(v);
+
+	const auto s = h.snapshot();
+	EXPECT_EQ(s.count, 10000U);
+	EXPECT_EQ(s.sum, 10000U * 10001U / 2);
+	EXPECT_DOUBLE_EQ(s.mean(), 5000.5);
+	EXPECT_EQ(s.min(), 1U);
+	EXPECT_GE(s.max(), 10000U);
+	EXPECT_LE(s.max(), 10000U + 10000U / 32);
+
+	// Within the bucket precision
+	for(double p : { 50.0, 90.0, 99.0, 99.9 })
+	{
+		const auto expected = static_cast<double>(p * 100);
+		EXPECT_NEAR(static_cast<double>(s.percentile(p)), expected, expected / 32 + 1) << p;
+	}
+	EXPECT_EQ(s.percentile(0), 1U);
+
+	h.reset();
+	EXPECT_EQ(h.snapshot().count, 0U);
+	EXPECT_EQ(h.snapshot().percentile(50), 0U);
+}
+
+TEST(metrics_histogram, shards_are_merged)
+{
+	metrics::histogram h;
+	std::vector<std::thread> threads;
+	for(int t = 0; t < 8; t++)
+	{
+		threads.emplace_back([&h, t]()
+		{
+			for(int i = 0; i < 10000; i++)
+				h.record(static_cast<uint64_t>(t));
+		});
+	}
+	for(auto& t : threads)
+		t.join();
+
+	const auto s = h.snapshot();
+	EXPECT_EQ(s.count, 80000U);
+	for(uint64_t t = 0; t < 8; t++)
+		EXPECT_EQ(s.buckets[t], 10000U);
+
+	// Merging snapshots adds the counts
+	auto merged = s;
+	merged.merge(s);
+	EXPECT_EQ(merged.count, 160000U);
+	EXPECT_EQ(merged.percentile(100), 7U);
+}
@@ -0,0 +1,139 @@
+///////////////////////////////////////////////////////////////////////
+// Tests of counters, gauges, the metrics registry and the library probes
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <metrics/registry.h>
+#include <metrics/probes.h>
+#include <containers/circular_buffer.h>
+#include <networking/tcp/connection_manager.h>
+#include <networking/tcp/connection.h>
+#include <networking/tcp/listener.h>
+
+TEST(metrics_registry, counters_and_gauges)
+{
+	metrics::registry r;
+	auto& c = r.make_counter("requests");
+	EXPECT_EQ(&c, &r.make_counter("requests"));
+
+	std::vector<std::thread> threads;
+	for(int t = 0; t < 8; t++)
+		threads.emplace_back([&c]() { for(int i = 0; i < 100000; i++) c.add(); });
+	for(auto& t : threads)
+		t.join();
+	EXPECT_EQ(c.value(), 800000U);
+
+	auto& g = r.make_gauge("depth");
+	g.set(10);
+	g.add(-3);
+	EXPECT_EQ(g.value(), 7);
+
+	r.make_histogram("latency").record(100);
+	EXPECT_EQ(r.size(), 3U);
+
+	// A name keeps its type
+	auto& other = r.make_gauge("requests");
+	other.set(1);
+	EXPECT_EQ(r.size(), 3U);
+
+	const auto s = r.snapshot();
+	ASSERT_EQ(s.size(), 3U);
+	EXPECT_EQ(s[0].name, "depth");
+	EXPECT_EQ(s[0].value, 7);
+	EXPECT_EQ(s[1].name, "latency");
+	EXPECT_EQ(s[1].type, metrics::metric_type::histogram);
+	EXPECT_EQ(s[1].distribution.count, 1U);
+	EXPECT_EQ(s[2].name, "requests");
+	EXPECT_EQ(s[2].value, 800000);
+
+	std::ostringstream text;
+	r.write(text);
+	EXPECT_NE(text.str().find("requests 800000\n"), std::string::npos);
+	EXPECT_NE(text.str().find("latency count=1 "), std::string::npos);
+}
+
+TEST(metrics_registry, queue_probes)
+{
+	metrics::registry r;
+	metrics::instrumented_queue<utility::circular_buffer<int, 4>> queue { metrics::make_queue_probes(r, "inbox") };
+
+	int value = 0;
+	EXPECT_FALSE(queue.read(value));
+	EXPECT_TRUE(queue.push(1));
+	EXPECT_TRUE(queue.push(2));
+	EXPECT_EQ(r.make_gauge("inbox.depth").value(), 2);
+	EXPECT_EQ(r.make_counter("inbox.empty").value(), 1U);
+
+	EXPECT_TRUE(queue.read(value));
+	EXPECT_EQ(value, 1);
+	EXPECT_EQ(r.make_gauge("inbox.depth").value(), 1);
+	EXPECT_EQ(queue.queue().size(), 1U);
+}
+
+TEST(metrics_registry, queue_probes_count_full_pushes)
+{
+	// A queue that holds a single element
+	struct single
+	{
+		bool push(int element) { if(held) return false; value = element; held = true; return true; }
+		bool read(int& result) { if(!held) return false; result = value; held = false; return true; }
+		std::size_t size() const { return held ? 1 : 0; }
+
+		int value = 0;
+		bool held = false;
+	};
+
+	metrics::registry r;
+	metrics::instrumented_queue<single> queue { metrics::make_queue_probes(r, "single") };
+	EXPECT_TRUE(queue.push(1));
+	EXPECT_FALSE(queue.push(2));
+	EXPECT_FALSE(queue.push(3));
+	EXPECT_EQ(r.make_counter("single.full").value(), 2U);
+	EXPECT_EQ(r.make_gauge("single.depth").value(), 1);
+}
+
+TEST(metrics_registry, networking_probes)
+{
+	class echo : public networking::tcp::data_read_callback
+	{
+		public:
+			void on_data(networking::tcp::connection& c, const uint8_t* data, std::size_t size) override { c.send(data, size); }
+	};
+
+	metrics::registry r;
+	metrics::enable_probes(r);
+
+	echo data;
+	networking::tcp::connection_manager manager { data };
+	networking::tcp::listener l { manager, 0 };
+	ASSERT_TRUE(l.start());
+	const auto port = l.bound_address().port_number();
+	manager.add_listener(std::move(l));
+
+	networking::tcp::connection client { networking::create_numeric_address("127.0.0.1", port, networking::ip_version::ipv4) };
+	const uint8_t message[] = { 1, 2, 3, 4 };
+	client.send(message, sizeof(message));
+	for(int i = 0; i < 10; i++)
+		manager.update(10);
+
+	uint8_t received[4];
+	EXPECT_EQ(client.receive(received, sizeof(received)), 4);
+	metrics::disable_probes();
+
+	// Both ends sent and received four bytes
+	EXPECT_EQ(r.make_counter("tcp.connection.bytes_sent").value(), 8U);
+	EXPECT_GE(r.make_counter("tcp.connection.bytes_received").value(), 8U);
+	EXPECT_GE(r.make_counter("tcp.connection.receive_calls").value(), 2U);
+	EXPECT_EQ(r.make_counter("tcp.connection.send_calls").value(), 2U);
+	EXPECT_EQ(r.make_histogram("tcp.manager.poll_wait_ns").snapshot().count, 10U);
+	EXPECT_EQ(r.make_histogram("tcp.manager.events").snapshot().count, 10U);
+	EXPECT_EQ(r.make_histogram("tcp.manager.callback_ns").snapshot().count, 1U);
+
+	// Disabled probes record nothing
+	client.send(message, sizeof(message));
+	EXPECT_EQ(r.make_counter("tcp.connection.send_calls").value(), 2U);
+}
@@ -0,0 +1,149 @@
+///////////////////////////////////////////////////////////////////////
+// Tests of the binary event trace
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <sstream>
+#include <algorithm>
+
+#include <metrics/trace.h>
+#include <networking/tcp/connection_manager.h>
+#include <networking/tcp/connection.h>
+#include <networking/tcp/listener.h>
+
+namespace
+{
+	metrics::trace_file dump()
+	{
+		std::stringstream binary;
+		EXPECT_TRUE(metrics::write_trace(binary));
+
+		metrics::trace_file file;
+		EXPECT_TRUE(metrics::read_trace(binary, file));
+		return file;
+	}
+
+	std::size_t count(const metrics::trace_file& file, metrics::trace_event event)
+	{
+		std::size_t result = 0;
+		for(const auto& t : file.threads)
+			result += static_cast<std::size_t>(std::count_if(t.records.begin(), t.records.end(), [event](const metrics::trace_record& r) { return r.event == static_cast<uint16_t>(event); }));
+		return result;
+	}
+}
+
+TEST(metrics_trace, records_per_thread)
+{
+	const auto user = static_cast<uint16_t>(metrics::trace_event::user);
+	metrics::name_trace_event(user, "work \"quoted\"");
+	metrics::clear_trace();
+
+	// Nothing is recorded while disabled
+	metrics::trace(user, metrics::trace_phase::instant, 1);
+
+	metrics::enable_tracing(64);
+	std::thread worker { [user]()
+	{
+		for(int i = 0; i < 100; i++)
+			metrics::trace(user, metrics::trace_phase::instant, i);
+	} };
+	worker.join();
+
+	{
+		metrics::trace_scope scope { metrics::trace_event::update };
+		scope.set_argument(7);
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+	metrics::disable_tracing();
+
+	const auto file = dump();
+	EXPECT_GT(file.ticks_per_second, 0);
+	EXPECT_EQ(file.names.at(user), "work \"quoted\"");
+
+	// The worker's ring kept its newest events
+	auto worker_records = std::find_if(file.threads.begin(), file.threads.end(), [](const metrics::trace_thread& t) { return t.records.size() == 64; });
+	ASSERT_NE(worker_records, file.threads.end());
+	EXPECT_EQ(worker_records->records.front().argument, 36);
+	EXPECT_EQ(worker_records->records.back().argument, 99);
+
+	// The scope took at least the sleep
+	const metrics::trace_record* begin = nullptr;
+	const metrics::trace_record* end = nullptr;
+	for(const auto& t : file.threads)
+	{
+		for(const auto& r : t.records)
+		{
+			if(r.event == static_cast<uint16_t>(metrics::trace_event::update))
+				(r.phase == metrics::trace_phase::begin ? begin : end) = &r;
+		}
+	}
+	ASSERT_NE(begin, nullptr);
+	ASSERT_NE(end, nullptr);
+	EXPECT_EQ(end->argument, 7);
+	const auto seconds = static_cast<double>(end->ticks - begin->ticks) / file.ticks_per_second;
+	EXPECT_GE(seconds, 0.0019);
+	EXPECT_LT(seconds, 1.0);
+
+	// Chrome trace JSON
+	std::ostringstream json;
+	metrics::write_chrome_trace(file, json);
+	EXPECT_EQ(json.str().rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0U);
+	EXPECT_NE(json.str().find("\"name\":\"work \\\"quoted\\\"\",\"ph\":\"i\""), std::string::npos);
+	EXPECT_NE(json.str().find("\"name\":\"update\",\"ph\":\"B\""), std::string::npos);
+	EXPECT_NE(json.str().find("\"args\":{\"argument\":7}"), std::string::npos);
+
+	metrics::clear_trace();
+}
+
+TEST(metrics_trace, rejects_invalid_dumps)
+{
+	metrics::trace_file file;
+	std::istringstream empty { "" };
+	EXPECT_FALSE(metrics::read_trace(empty, file));
+	std::istringstream other { std::string(64, 'x') };
+	EXPECT_FALSE(metrics::read_trace(other, file));
+
+	// Truncated
+	std::stringstream binary;
+	metrics::write_trace(binary);
+	const auto text = binary.str();
+	std::istringstream truncated { text.substr(0, text.size() - 1) };
+	EXPECT_FALSE(metrics::read_trace(truncated, file));
+}
+
+TEST(metrics_trace, networking_trace_points)
+{
+	class echo : public networking::tcp::data_read_callback
+	{
+		public:
+			void on_data(networking::tcp::connection& c, const uint8_t* data, std::size_t size) override { c.send(data, size); }
+	};
+
+	echo data;
+	networking::tcp::connection_manager manager { data };
+	networking::tcp::listener l { manager, 0 };
+	ASSERT_TRUE(l.start());
+	const auto port = l.bound_address().port_number();
+	manager.add_listener(std::move(l));
+
+	metrics::clear_trace();
+	metrics::enable_tracing();
+	networking::tcp::connection client { networking::create_numeric_address("127.0.0.1", port, networking::ip_version::ipv4) };
+	const uint8_t message[] = { 1, 2, 3, 4 };
+	client.send(message, sizeof(message));
+	for(int i = 0; i < 5; i++)
+		manager.update(10);
+
+	uint8_t received[4];
+	EXPECT_EQ(client.receive(received, sizeof(received)), 4);
+	metrics::disable_tracing();
+
+	const auto file = dump();
+	EXPECT_EQ(count(file, metrics::trace_event::accept), 1U);
+	EXPECT_EQ(count(file, metrics::trace_event::update), 10U);
+	EXPECT_EQ(count(file, metrics::trace_event::send), 2U);
+	EXPECT_GE(count(file, metrics::trace_event::receive), 2U);
+
+	metrics::clear_trace();
+}
@@ -3,7 +3,10 @@
 ///////////////////////////////////////////////////////////////////////
 #include <gtest/gtest.h>
 
+#include <cstring>
+
 #include <networking/address.h>
+#include <networking/numeric_address.h>
 
 TEST(networking_address, create_address_tcp_ipv4)
 {
@@ -38,3 +41,85 @@ TEST(networking_address, create_address_tcp_ipv4_localhost)
 	EXPECT_EQ(addr.host(false).code, 0);
 	EXPECT_EQ(addr.host(false).value, hostname);
 }
+
+TEST(networking_address, create_address_ipv6_literal)
+{
+	constexpr uint16_t port = 4242;
+	std::string hostname { "2001:db8::ff00:42:8329" };
+
+	auto addr = networking::create_address(hostname, port, networking::protocol::udp, false, networking::ip_version::ipv6);
+
+	EXPECT_TRUE(addr.valid());
+	EXPECT_EQ(addr.family(), AF_INET6);
+	EXPECT_EQ(addr.length(), sizeof(sockaddr_in6));
+	EXPECT_EQ(addr.port_number(), port);
+	EXPECT_EQ(addr.host(true).value, hostname);
+	EXPECT_EQ(addr.to_string().value, "[2001:db8::ff00:42:8329]:4242");
+}
+
+TEST(networking_address, create_address_literal_version_mismatch)
+{
+	EXPECT_FALSE(networking::create_address("::1", 80, networking::protocol::tcp, false, networking::ip_version::ipv4).valid());
+	EXPECT_FALSE(networking::create_address("127.0.0.1", 80, networking::protocol::tcp, false, networking::ip_version::ipv6).valid());
+	EXPECT_TRUE(networking::create_address("::1", 80, networking::protocol::tcp, false, networking::ip_version::any).valid());
+}
+
+TEST(networking_address, format_into_buffer)
+{
+	auto addr = networking::create_numeric_address("10.0.0.255", 65535);
+
+	char buffer[networking::max_address_string_length];
+	EXPECT_EQ(addr.format(buffer, sizeof(buffer)), 16U);
+	EXPECT_STREQ(buffer, "10.0.0.255:65535");
+
+	char small[8];
+	EXPECT_EQ(addr.format(small, sizeof(small)), 0U);
+	EXPECT_EQ(addr.format_host(small, sizeof(small)), 0U);
+	EXPECT_EQ(networking::address::invalid().format(buffer, sizeof(buffer)), 0U);
+}
+
+TEST(networking_address, parse_literals_like_inet_pton)
+{
+	const char* inputs[] = {
+		"0.0.0.0", "255.255.255.255", "1.2.3.4", "256.1.1.1", "1.2.3", "1.2.3.4.5", "01.2.3.4", "1..2.3", "",
+		"::", "::1", "1::", "1:2:3:4:5:6:7:8", "1:2:3:4:5:6:7::", "::2:3:4:5:6:7:8", "1:2:3:4:5:6:7:8:9",
+		"1::2::3", ":1", "1:", "12345::", "::ffff:1.2.3.4", "::1.2.3.4", "1:2:3:4:5:6:1.2.3.4", "1:2:3:4:5:6:7:1.2.3.4",
+		"fe80::1%eth0", "ABCD:ef01::", "1:2:3:4:5:6:7:8:", "::ffff:1.2.3", "g::1" };
+
+	for(auto input : inputs)
+	{
+		const auto end = input + std::strlen(input);
+
+		in_addr v4, reference_v4;
+		EXPECT_EQ(networking::parse_ipv4(input, end, v4), inet_pton(AF_INET, input, &reference_v4) == 1) << input;
+
+		in6_addr v6, reference_v6;
+		const bool parsed = networking::parse_ipv6(input, end, v6);
+		const bool reference = inet_pton(AF_INET6, input, &reference_v6) == 1;
+		EXPECT_EQ(parsed, reference) << input;
+		if(parsed && reference)
+		{
+			EXPECT_EQ(std::memcmp(&v6, &reference_v6, sizeof(v6)), 0) << input;
+		}
+	}
+}
+
+TEST(networking_address, format_ipv6_like_inet_ntop)
+{
+	const char* inputs[] = {
+		"::", "::1", "1::", "2001:db8::1", "2001:db8:0:0:1:0:0:1", "2001:0:0:1:0:0:0:1", "1:0:2:0:3:0:4:0",
+		"1:2:3:4:5:6:7:8", "::ffff:192.168.0.1", "fe80::abcd:0:0:1", "0:1:0:0:0:1:0:0" };
+
+	for(auto input : inputs)
+	{
+		in6_addr a;
+		ASSERT_EQ(inet_pton(AF_INET6, input, &a), 1) << input;
+
+		char reference[INET6_ADDRSTRLEN];
+		inet_ntop(AF_INET6, &a, reference, sizeof(reference));
+
+		char formatted[networking::max_ipv6_string_length];
+		EXPECT_GT(networking::format_ipv6(a, formatted, sizeof(formatted)), 0U);
+		EXPECT_STREQ(formatted, reference) << input;
+	}
+}
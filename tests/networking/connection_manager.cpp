@@ -0,0 +1,584 @@
+///////////////////////////////////////////////////////////////////////
+// Tests for non-blocking connects through the connection manager (loopback only)
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <networking/tcp/connection_manager.h>
+#include <networking/tcp/connection.h>
+#include <networking/tcp/listener.h>
+
+#include <map>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+
+namespace
+{
+	class no_data : public networking::tcp::data_received_callback
+	{
+		public:
+			void on_receive(networking::tcp::connection&) override {}
+	};
+
+	class connect_result : public networking::tcp::connect_callback
+	{
+		public:
+			void on_connected(networking::tcp::connect_id id, networking::tcp::connection& c) override
+			{
+				connected_id = id;
+				state = c.state();
+			}
+
+			void on_connect_failed(networking::tcp::connect_id id, const networking::socket_error_information& error) override
+			{
+				failed_id = id;
+				error_code = error.error_code;
+			}
+
+			networking::tcp::connect_id connected_id = 0;
+			networking::tcp::connect_id failed_id = 0;
+			networking::tcp::connection::status state = networking::tcp::connection::status::invalid;
+			int error_code = 0;
+	};
+
+	class count_batches : public networking::tcp::incoming_connection_callback
+	{
+		public:
+			void on_new_connection(networking::tcp::connection&& c) override { connections.push_back(std::move(c)); }
+			void on_new_connections(std::vector<networking::tcp::connection>& batch) override
+			{
+				batches.push_back(batch.size());
+				networking::tcp::incoming_connection_callback::on_new_connections(batch);
+			}
+
+			std::vector<networking::tcp::connection> connections;
+			std::vector<std::size_t> batches;
+	};
+
+	// Listens on an ephemeral port, which is returned
+	networking::port_number_t add_local_listener(networking::tcp::connection_manager& manager, uint16_t queue_length = 10)
+	{
+		networking::tcp::listener l { manager, 0 };
+		if(!l.start(queue_length))
+			return 0;
+
+		const auto port = l.bound_address().port_number();
+		manager.add_listener(std::move(l));
+		return port;
+	}
+
+	// Completed (blocking) connects to a local port
+	std::vector<networking::tcp::connection> connect_clients(networking::port_number_t port, std::size_t count)
+	{
+		std::vector<networking::tcp::connection> clients;
+		auto target = networking::create_numeric_address("127.0.0.1", port, networking::ip_version::ipv4);
+		for(std::size_t i = 0; i < count; i++)
+			clients.emplace_back(target);
+		return clients;
+	}
+
+	// Port 9 (discard) is not expected to be open on loopback
+	constexpr networking::port_number_t closed_port = 9;
+
+	void update_until_done(networking::tcp::connection_manager& manager, int max_updates = 100)
+	{
+		for(int i = 0; i < max_updates && manager.pending_connects() > 0; i++)
+			manager.update(50);
+	}
+}
+
+TEST(networking_connection_manager, connect_to_local_listener)
+{
+	no_data data;
+	networking::tcp::connection_manager manager { data };
+
+	const auto test_port = add_local_listener(manager);
+	ASSERT_NE(test_port, 0);
+
+	connect_result result;
+	auto target = networking::create_numeric_address("127.0.0.1", test_port, networking::ip_version::ipv4);
+	auto id = manager.connect(target, result);
+	EXPECT_EQ(manager.pending_connects(), 1U);
+
+	update_until_done(manager);
+	EXPECT_EQ(result.connected_id, id);
+	EXPECT_EQ(result.failed_id, 0U);
+	EXPECT_EQ(result.state, networking::tcp::connection::status::open);
+
+	// Accept the other end as well
+	manager.update(50);
+	EXPECT_EQ(manager.connection_count(), 2U);
+}
+
+TEST(networking_connection_manager, falls_back_to_next_address)
+{
+	no_data data;
+	networking::tcp::connection_manager manager { data };
+
+	const auto test_port = add_local_listener(manager);
+	ASSERT_NE(test_port, 0);
+
+	// The refused address is tried first, the attempt to the open port must still win
+	connect_result result;
+	std::vector<networking::address> candidates {
+		networking::create_numeric_address("127.0.0.1", closed_port, networking::ip_version::ipv4),
+		networking::create_numeric_address("127.0.0.1", test_port, networking::ip_version::ipv4) };
+	networking::tcp::connect_options options;
+	options.timeout = std::chrono::milliseconds { 2000 };
+	options.attempt_delay = std::chrono::milliseconds { 1000 };
+	auto id = manager.connect(std::move(candidates), result, options);
+
+	update_until_done(manager);
+	EXPECT_EQ(result.connected_id, id);
+	EXPECT_EQ(result.failed_id, 0U);
+}
+
+TEST(networking_connection_manager, connect_refused)
+{
+	no_data data;
+	networking::tcp::connection_manager manager { data };
+
+	connect_result result;
+	auto target = networking::create_numeric_address("127.0.0.1", closed_port, networking::ip_version::ipv4);
+	auto id = manager.connect(target, result);
+
+	update_until_done(manager);
+	EXPECT_EQ(result.failed_id, id);
+	EXPECT_EQ(result.error_code, ECONNREFUSED);
+	EXPECT_EQ(manager.connection_count(), 0U);
+}
+
+TEST(networking_connection_manager, connect_without_addresses_fails)
+{
+	no_data data;
+	networking::tcp::connection_manager manager { data };
+
+	connect_result result;
+	auto id = manager.connect(std::vector<networking::address> {}, result);
+	EXPECT_EQ(result.failed_id, 0U);	// Never reported from within connect()
+
+	manager.update(0);
+	EXPECT_EQ(result.failed_id, id);
+	EXPECT_EQ(manager.pending_connects(), 0U);
+}
+
+TEST(networking_connection_manager, cancel_connect)
+{
+	no_data data;
+	networking::tcp::connection_manager manager { data };
+
+	connect_result result;
+	auto target = networking::create_numeric_address("127.0.0.1", closed_port, networking::ip_version::ipv4);
+	auto id = manager.connect(target, result);
+	manager.cancel_connect(id);
+
+	manager.update(0);
+	EXPECT_EQ(manager.pending_connects(), 0U);
+	EXPECT_EQ(result.failed_id, 0U);
+	EXPECT_EQ(result.connected_id, 0U);
+}
+
+TEST(networking_connection_manager, accept_all_drains_queue_in_batches)
+{
+	count_batches accepted;
+	networking::socket_options options;
+	options.non_blocking = true;
+	networking::tcp::listener l { accepted, 0, false, options };
+	ASSERT_TRUE(l.start(256));
+	ASSERT_TRUE(networking::set_blocking(l.socket().get(), false));
+
+	auto clients = connect_clients(l.bound_address().port_number(), 100);
+
+	EXPECT_EQ(l.accept_all(64), 64U);
+	EXPECT_EQ(l.accept_all(64), 36U);
+	EXPECT_EQ(l.accept_all(64), 0U);	// Empty queue, does not block
+
+	ASSERT_EQ(accepted.batches, (std::vector<std::size_t> { 64, 36 }));
+	ASSERT_EQ(accepted.connections.size(), 100U);
+	for(const auto& c : accepted.connections)
+	{
+		EXPECT_EQ(c.state(), networking::tcp::connection::status::open);
+		EXPECT_NE(fcntl(c.socket().get(), F_GETFL, 0) & O_NONBLOCK, 0);
+	}
+}
+
+TEST(networking_connection_manager, connection_burst_within_budget)
+{
+	no_data data;
+	networking::tcp::manager_options options;
+	options.accept_budget = 32;
+	networking::tcp::connection_manager manager { data, options };
+
+	const auto port = add_local_listener(manager, 256);
+	ASSERT_NE(port, 0);
+
+	auto clients = connect_clients(port, 100);
+
+	// One batch of at most accept_budget connections per update
+	int updates = 0;
+	for( ; updates < 20 && manager.connection_count() < 100; updates++)
+		manager.update(50);
+
+	EXPECT_EQ(manager.connection_count(), 100U);
+	EXPECT_EQ(updates, 4);
+}
+
+namespace
+{
+	class collect_data : public networking::tcp::data_read_callback
+	{
+		public:
+			void on_data(networking::tcp::connection& c, const uint8_t*, std::size_t size) override { received[c.socket().get()] += size; }
+			void on_closed(networking::tcp::connection&) override { closed++; }
+
+			std::map<networking::socket_type, std::size_t> received;
+			int closed = 0;
+	};
+}
+
+TEST(networking_connection_manager, read_budget_is_fair)
+{
+	collect_data data;
+	networking::tcp::manager_options options;
+	options.read_bytes_budget = 16384;
+	options.read_messages_budget = 4;
+	options.read_block_size = 4096;
+	networking::tcp::connection_manager manager { data, options };
+
+	const auto port = add_local_listener(manager);
+	ASSERT_NE(port, 0);
+
+	auto clients = connect_clients(port, 2);
+	while(manager.connection_count() < 2)
+		manager.update(50);
+
+	// One chatty peer (from another thread, so it can block on a full buffer) and one quiet peer
+	constexpr std::size_t chatty_size = 262144;
+	std::thread chatty([&clients]()
+	{
+		std::vector<uint8_t> payload(chatty_size, 0x5a);
+		std::size_t sent = 0;
+		while(sent < payload.size())
+		{
+			auto result = clients[0].send(payload.data() + sent, payload.size() - sent);
+			if(result <= 0)
+				break;
+			sent += static_cast<std::size_t>(result);
+		}
+	});
+
+	const uint8_t hello[] = { 'h', 'i' };
+	clients[1].send(hello, sizeof(hello));
+
+	std::size_t total = 0;
+	bool quiet_served = false;
+	int updates = 0;
+	for( ; updates < 1000 && total < chatty_size + sizeof(hello); updates++)
+	{
+		manager.update(50);
+		const auto& stats = manager.last_update();
+		EXPECT_LE(stats.bytes, 2 * options.read_bytes_budget);
+		EXPECT_LE(stats.messages, 2 * options.read_messages_budget);
+
+		total = 0;
+		for(const auto& entry : data.received)
+			total += entry.second;
+
+		// The quiet peer is served while the chatty one still has data queued
+		for(const auto& entry : data.received)
+		{
+			if(entry.second == sizeof(hello) && total < chatty_size + sizeof(hello))
+				quiet_served = true;
+		}
+	}
+
+	chatty.join();
+	EXPECT_TRUE(quiet_served);
+	EXPECT_EQ(total, chatty_size + sizeof(hello));
+	EXPECT_GE(updates, static_cast<int>(chatty_size / options.read_bytes_budget));
+
+	// Closing is reported
+	clients.clear();
+	for(int i = 0; i < 10 && data.closed < 2; i++)
+		manager.update(50);
+	EXPECT_EQ(data.closed, 2);
+}
+
+TEST(networking_connection_manager, closed_connections_are_dropped)
+{
+	collect_data data;
+	networking::tcp::connection_manager manager { data };
+	const auto port = add_local_listener(manager);
+	ASSERT_NE(port, 0);
+
+	const auto initial = manager.connection_count();
+	int closed = 0;
+	for(int round = 0; round < 20; round++)
+	{
+		auto clients = connect_clients(port, 5);
+		for(int i = 0; i < 100 && manager.connection_count() < initial + clients.size(); i++)
+			manager.update(50);
+		ASSERT_EQ(manager.connection_count(), initial + clients.size());
+
+		clients.clear();
+		closed += 5;
+		for(int i = 0; i < 100 && (data.closed < closed || manager.connection_count() != initial); i++)
+			manager.update(50);
+		ASSERT_EQ(data.closed, closed);
+		EXPECT_EQ(manager.connection_count(), initial);
+	}
+}
+
+TEST(networking_connection_manager, posted_work_wakes_update)
+{
+	no_data data;
+	networking::tcp::connection_manager manager { data };
+	manager.update(0);
+
+	std::atomic<int> ran { 0 };
+	std::thread poster { [&manager, &ran]()
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds { 20 });
+		manager.post([&ran](networking::tcp::connection_manager&) { ran++; });
+	} };
+
+	// Returns long before the timeout
+	const auto start = std::chrono::steady_clock::now();
+	while(ran == 0)
+		manager.update(10000);
+	EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds { 5 });
+	EXPECT_EQ(manager.last_update().posted, 1U);
+	poster.join();
+
+	// wake() interrupts without work
+	std::thread waker { [&manager]()
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds { 20 });
+		manager.wake();
+	} };
+	const auto woken = std::chrono::steady_clock::now();
+	manager.update(10000);
+	EXPECT_LT(std::chrono::steady_clock::now() - woken, std::chrono::seconds { 5 });
+	waker.join();
+}
+
+TEST(networking_connection_manager, acceptor_thread_balances_connections)
+{
+	// Reactor shards read on behalf of their callbacks, the acceptor thread hands out connections
+	class echo : public networking::tcp::data_read_callback
+	{
+		public:
+			void on_data(networking::tcp::connection& c, const uint8_t* data, std::size_t size) override { c.send(data, size); }
+	};
+
+	class balance : public networking::tcp::incoming_connection_callback
+	{
+		public:
+			explicit balance(std::vector<networking::tcp::connection_manager*> shards) : _shards(std::move(shards)), _next(0) {}
+			void on_new_connection(networking::tcp::connection&& c) override { _shards[_next++ % _shards.size()]->post_connection(std::move(c)); }
+
+		private:
+			std::vector<networking::tcp::connection_manager*> _shards;
+			std::size_t _next;
+	};
+
+	echo data;
+	networking::tcp::connection_manager first { data };
+	networking::tcp::connection_manager second { data };
+
+	balance acceptor_callback { { &first, &second } };
+	networking::tcp::listener acceptor { acceptor_callback, 0 };
+	ASSERT_TRUE(acceptor.start());
+	const auto port = acceptor.bound_address().port_number();
+
+	std::atomic<bool> running { true };
+	std::thread acceptor_thread { [&]() { while(running) acceptor.poll_accept(10); } };
+	std::thread first_thread { [&]() { while(running) first.update(1000); } };
+	std::thread second_thread { [&]() { while(running) second.update(1000); } };
+
+	auto target = networking::create_numeric_address("127.0.0.1", port, networking::ip_version::ipv4);
+	std::vector<networking::tcp::connection> clients;
+	for(int i = 0; i < 4; i++)
+		clients.emplace_back(target);
+
+	// Every client is served by one of the shards
+	for(auto& c : clients)
+	{
+		const uint8_t message[] = { 'h', 'i' };
+		ASSERT_EQ(c.send(message, sizeof(message)), 2);
+		uint8_t received[2] = {};
+		ASSERT_EQ(c.receive(received, sizeof(received)), 2);
+		EXPECT_EQ(received[1], 'i');
+	}
+
+	running = false;
+	first.wake();
+	second.wake();
+	acceptor_thread.join();
+	first_thread.join();
+	second_thread.join();
+
+	EXPECT_EQ(first.connection_count(), 2U);
+	EXPECT_EQ(second.connection_count(), 2U);
+}
+
+TEST(networking_connection_manager, posted_sends)
+{
+	class remember_socket : public networking::tcp::data_read_callback
+	{
+		public:
+			void on_data(networking::tcp::connection& c, const uint8_t*, std::size_t) override { server_socket = c.socket().get(); }
+			networking::socket_type server_socket = -1;
+	};
+
+	remember_socket data;
+	networking::tcp::connection_manager manager { data };
+	const auto port = add_local_listener(manager);
+
+	networking::tcp::connection client { networking::create_numeric_address("127.0.0.1", port, networking::ip_version::ipv4) };
+	const uint8_t hello[] = { 'h' };
+	client.send(hello, sizeof(hello));
+	for(int i = 0; i < 100 && data.server_socket < 0; i++)
+		manager.update(10);
+	ASSERT_GE(data.server_socket, 0);
+
+	// Posted from another thread, sent by update()
+	std::thread poster { [&]() { manager.post_send(data.server_socket, std::vector<uint8_t> { 'o', 'k' }); } };
+	poster.join();
+	manager.update(1000);
+
+	uint8_t received[2] = {};
+	ASSERT_EQ(client.receive(received, sizeof(received)), 2);
+	EXPECT_EQ(received[0], 'o');
+	EXPECT_EQ(received[1], 'k');
+	EXPECT_EQ(manager.last_update().posted, 1U);
+}
+
+TEST(networking_connection_manager, adaptive_busy_polling)
+{
+	class echo : public networking::tcp::data_read_callback
+	{
+		public:
+			void on_data(networking::tcp::connection& c, const uint8_t* data, std::size_t size) override { c.send(data, size); }
+	};
+
+	echo data;
+	networking::tcp::manager_options options;
+	options.spin_budget = std::chrono::milliseconds { 100 };
+	networking::tcp::connection_manager manager { data, options };
+	const auto port = add_local_listener(manager);
+
+	// Quiet from the start: blocking polls only
+	manager.update(1);
+	EXPECT_EQ(manager.last_update().spins, 0U);
+	EXPECT_TRUE(manager.last_update().blocked);
+
+	networking::tcp::connection client { networking::create_numeric_address("127.0.0.1", port, networking::ip_version::ipv4) };
+	while(manager.connection_count() == 0)
+		manager.update(100);
+
+	// Activity starts the spinning period, a message arriving during it is found by spinning
+	std::thread sender { [&client]()
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds { 10 });
+		const uint8_t message[] = { 'x' };
+		client.send(message, sizeof(message));
+	} };
+	manager.update(1000);
+	sender.join();
+	EXPECT_GT(manager.last_update().spins, 0U);
+	EXPECT_FALSE(manager.last_update().blocked);
+	EXPECT_GT(manager.counters().spin_hits, 0U);
+
+	uint8_t received[1] = {};
+	EXPECT_EQ(client.receive(received, sizeof(received)), 1);
+
+	// Spinning ends with the timeout, long before the period
+	const auto start = std::chrono::steady_clock::now();
+	manager.update(1);
+	EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds { 20 });
+	EXPECT_GT(manager.last_update().spins, 0U);
+	EXPECT_FALSE(manager.last_update().blocked);
+
+	// Spins through the rest of the period, then blocks for the rest of the timeout
+	const auto sleeps = manager.counters().sleeps;
+	manager.update(150);
+	EXPECT_GT(manager.last_update().spins, 0U);
+	EXPECT_TRUE(manager.last_update().blocked);
+	EXPECT_EQ(manager.counters().sleeps, sleeps + 1);
+
+	// Quiet again
+	manager.update(1);
+	EXPECT_EQ(manager.last_update().spins, 0U);
+}
+
+TEST(networking_connection_manager, samples_connection_info)
+{
+	class echo : public networking::tcp::data_read_callback
+	{
+		public:
+			void on_data(networking::tcp::connection& c, const uint8_t* data, std::size_t size) override { c.send(data, size); }
+	};
+
+	echo data;
+	networking::tcp::manager_options options;
+	options.info_interval = std::chrono::milliseconds { 1 };
+	networking::tcp::connection_manager manager { data, options };
+	const auto port = add_local_listener(manager);
+	EXPECT_EQ(manager.info_distributions(), nullptr);
+
+	std::vector<networking::tcp::connection> clients;
+	for(int i = 0; i < 3; i++)
+		clients.emplace_back(networking::create_numeric_address("127.0.0.1", port, networking::ip_version::ipv4));
+	while(manager.connection_count() < clients.size())
+		manager.update(100);
+
+	// Exchange some data, so the kernel has measured round trips
+	const uint8_t message[1000] = {};
+	uint8_t received[1000];
+	for(auto& c : clients)
+	{
+		ASSERT_EQ(c.send(message, sizeof(message)), 1000);
+		std::size_t total = 0;
+		while(total < sizeof(received))
+		{
+			manager.update(10);
+			const auto r = c.receive_available(received, sizeof(received));
+			if(r > 0)
+				total += static_cast<std::size_t>(r);
+		}
+	}
+
+	networking::tcp::connection_info info;
+	ASSERT_TRUE(clients.front().info(info));
+	EXPECT_GT(info.rtt.count(), 0);
+	EXPECT_GT(info.congestion_window, 0U);
+	EXPECT_GT(info.mss, 0U);
+	EXPECT_EQ(info.unacked, 0U);
+
+	// Sampled by update at most once per interval, and on demand
+	std::this_thread::sleep_for(std::chrono::milliseconds { 2 });
+	manager.update(0);
+	const auto* distributions = manager.info_distributions();
+	ASSERT_NE(distributions, nullptr);
+	const auto samples = distributions->samples;
+	EXPECT_GE(samples, 1U);
+	manager.update(0);
+	EXPECT_LE(distributions->samples, samples + 1);
+
+	EXPECT_EQ(manager.sample_info(), 3U);
+	const auto rtt = distributions->rtt.snapshot();
+	EXPECT_EQ(rtt.count % 3, 0U);
+	EXPECT_GE(rtt.count, 6U);
+	EXPECT_GT(rtt.min(), 0U);
+	EXPECT_GT(distributions->congestion_window.snapshot().min(), 0U);
+	EXPECT_EQ(distributions->retransmits.snapshot().max(), 0U);
+
+	// An idle blocking update returns in time for the next sample
+	const auto before = distributions->samples;
+	const auto start = std::chrono::steady_clock::now();
+	manager.update(10000);
+	EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds { 5 });
+	EXPECT_EQ(distributions->samples, before + 1);
+}
@@ -0,0 +1,283 @@
+///////////////////////////////////////////////////////////////////////
+// Tests for the client connection pool (loopback echo server)
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <networking/tcp/connection_pool.h>
+#include <networking/tcp/connection_manager.h>
+#include <networking/tcp/listener.h>
+
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace
+{
+	// Echoes everything back, optionally closing connections instead
+	class echo : public networking::tcp::data_received_callback
+	{
+		public:
+			void on_receive(networking::tcp::connection& c) override
+			{
+				uint8_t buffer[4096];
+				auto received = c.receive(buffer, sizeof(buffer));
+				if(received <= 0 || drop)
+				{
+					c.close();
+					return;
+				}
+				c.send(buffer, static_cast<std::size_t>(received));
+			}
+
+			bool drop = false;
+	};
+
+	// Newline-terminated responses
+	class lines : public networking::tcp::response_framing
+	{
+		public:
+			std::size_t response_length(const uint8_t* data, std::size_t size) override
+			{
+				for(std::size_t i = 0; i < size; i++)
+				{
+					if(data[i] == '\n')
+						return i + 1;
+				}
+				return 0;
+			}
+
+			bool health_check_request(std::vector<uint8_t>& request) override
+			{
+				if(!probe)
+					return false;
+				request.assign({ 'p', 'i', 'n', 'g', '\n' });
+				probes++;
+				return true;
+			}
+
+			bool probe = false;
+			int probes = 0;
+	};
+
+	class responses : public networking::tcp::response_callback
+	{
+		public:
+			void on_response(networking::tcp::request_id id, const uint8_t* data, std::size_t size) override
+			{
+				ids.push_back(id);
+				values.emplace_back(reinterpret_cast<const char*>(data), size);
+			}
+
+			void on_request_failed(networking::tcp::request_id id, const networking::socket_error_information& error) override
+			{
+				failed.push_back(id);
+				error_code = error.error_code;
+			}
+
+			std::vector<networking::tcp::request_id> ids;
+			std::vector<std::string> values;
+			std::vector<networking::tcp::request_id> failed;
+			int error_code = 0;
+	};
+
+	struct echo_server
+	{
+		echo data;
+		networking::tcp::connection_manager manager { data };
+		networking::port_number_t port = 0;
+
+		echo_server()
+		{
+			networking::tcp::listener l { manager, 0 };
+			if(!l.start())
+				return;
+
+			port = l.bound_address().port_number();
+			manager.add_listener(std::move(l));
+		}
+
+		// On a Unix domain address instead
+		explicit echo_server(const networking::address& local_address) : local(local_address)
+		{
+			networking::tcp::listener l { manager, local };
+			if(l.start())
+				manager.add_listener(std::move(l));
+		}
+
+		networking::address local;
+
+		networking::address target() const { return local.valid() ? local : networking::create_numeric_address("127.0.0.1", port, networking::ip_version::ipv4); }
+	};
+
+	// Runs both ends until the callback counts reach the expected number
+	void run(echo_server& server, networking::tcp::connection_pool& pool, const responses& r, std::size_t expected, int max_updates = 200)
+	{
+		for(int i = 0; i < max_updates && r.ids.size() + r.failed.size() < expected; i++)
+		{
+			server.manager.update(1);
+			pool.update(1);
+		}
+	}
+
+	void send_line(networking::tcp::connection_pool& pool, const networking::address& target, const std::string& line, responses& r)
+	{
+		pool.send(target, reinterpret_cast<const uint8_t*>(line.data()), line.size(), r);
+	}
+}
+
+TEST(networking_connection_pool, pipelined_responses_match_requests)
+{
+	echo_server server;
+	ASSERT_NE(server.port, 0);
+
+	lines framing;
+	networking::tcp::pool_options options;
+	options.max_connections_per_address = 1;
+	networking::tcp::connection_pool pool { framing, options };
+
+	std::vector<networking::tcp::request_id> sent;
+	responses r;
+	for(int i = 0; i < 10; i++)
+		sent.push_back(pool.send(server.target(), std::vector<uint8_t> { static_cast<uint8_t>('0' + i), '\n' }, r));
+
+	EXPECT_EQ(pool.connections(server.target()), 1U);
+	EXPECT_EQ(pool.in_flight(), 10U);
+
+	run(server, pool, r, 10);
+	ASSERT_EQ(r.ids, sent);
+	for(int i = 0; i < 10; i++)
+		EXPECT_EQ(r.values[i], std::string(1, static_cast<char>('0' + i)) + "\n");
+	EXPECT_EQ(pool.in_flight(), 0U);
+
+	// The warm connection is reused
+	send_line(pool, server.target(), "again\n", r);
+	run(server, pool, r, 11);
+	EXPECT_EQ(r.values.back(), "again\n");
+	EXPECT_EQ(pool.connections(server.target()), 1U);
+}
+
+TEST(networking_connection_pool, spreads_load_and_queues_backlog)
+{
+	echo_server server;
+	ASSERT_NE(server.port, 0);
+
+	lines framing;
+	networking::tcp::pool_options options;
+	options.max_connections_per_address = 3;
+	options.max_in_flight = 2;
+	networking::tcp::connection_pool pool { framing, options };
+
+	responses r;
+	for(int i = 0; i < 8; i++)
+		send_line(pool, server.target(), "request\n", r);
+
+	// Three connections with two requests each, the rest waits for room
+	EXPECT_EQ(pool.connections(server.target()), 3U);
+	EXPECT_EQ(pool.in_flight(), 6U);
+	EXPECT_EQ(pool.backlog(), 2U);
+
+	run(server, pool, r, 8);
+	EXPECT_EQ(r.ids.size(), 8U);
+	EXPECT_TRUE(r.failed.empty());
+	EXPECT_EQ(pool.backlog(), 0U);
+}
+
+TEST(networking_connection_pool, refused_connect_fails_requests)
+{
+	lines framing;
+	networking::tcp::connection_pool pool { framing };
+
+	responses r;
+	auto target = networking::create_numeric_address("127.0.0.1", 9, networking::ip_version::ipv4);
+	auto id = pool.send(target, std::vector<uint8_t> { 'x', '\n' }, r);
+
+	for(int i = 0; i < 50 && r.failed.empty(); i++)
+		pool.update(10);
+
+	ASSERT_EQ(r.failed.size(), 1U);
+	EXPECT_EQ(r.failed.front(), id);
+	EXPECT_EQ(r.error_code, ECONNREFUSED);
+	EXPECT_EQ(pool.connections(), 0U);
+}
+
+TEST(networking_connection_pool, closed_by_server_fails_in_flight)
+{
+	echo_server server;
+	ASSERT_NE(server.port, 0);
+	server.data.drop = true;
+
+	lines framing;
+	networking::tcp::connection_pool pool { framing };
+
+	responses r;
+	send_line(pool, server.target(), "dropped\n", r);
+	run(server, pool, r, 1);
+
+	EXPECT_EQ(r.failed.size(), 1U);
+	EXPECT_TRUE(r.ids.empty());
+	EXPECT_EQ(pool.connections(), 0U);
+}
+
+TEST(networking_connection_pool, idle_timeout_and_health_checks)
+{
+	echo_server server;
+	ASSERT_NE(server.port, 0);
+
+	lines framing;
+	framing.probe = true;
+	networking::tcp::pool_options options;
+	options.health_check_interval = std::chrono::milliseconds { 5 };
+	options.idle_timeout = std::chrono::milliseconds { 100 };
+	networking::tcp::connection_pool pool { framing, options };
+
+	responses r;
+	send_line(pool, server.target(), "hello\n", r);
+	run(server, pool, r, 1);
+	ASSERT_EQ(r.ids.size(), 1U);
+
+	// Probes are answered (and not reported), until the idle connection is closed
+	for(int i = 0; i < 200 && pool.connections() > 0; i++)
+	{
+		server.manager.update(1);
+		pool.update(1);
+	}
+
+	EXPECT_GT(framing.probes, 0);
+	EXPECT_EQ(r.ids.size(), 1U);
+	EXPECT_TRUE(r.failed.empty());
+	EXPECT_EQ(pool.connections(), 0U);
+}
+
+TEST(networking_connection_pool, unix_domain_targets_are_separate_backends)
+{
+	const auto pid = std::to_string(::getpid());
+	echo_server first { networking::create_local_address("@utilitylib_pool_first_" + pid) };
+	echo_server second { networking::create_local_address("@utilitylib_pool_second_" + pid) };
+	ASSERT_NE(first.target(), second.target());
+
+	lines framing;
+	networking::tcp::pool_options options;
+	options.max_connections_per_address = 1;
+	networking::tcp::connection_pool pool { framing, options };
+
+	responses r;
+	send_line(pool, first.target(), "first\n", r);
+	send_line(pool, second.target(), "second\n", r);
+	EXPECT_EQ(pool.connections(first.target()), 1U);
+	EXPECT_EQ(pool.connections(second.target()), 1U);
+
+	for(int i = 0; i < 200 && r.ids.size() + r.failed.size() < 2; i++)
+	{
+		first.manager.update(1);
+		second.manager.update(1);
+		pool.update(1);
+	}
+	ASSERT_EQ(r.values.size(), 2U);
+	EXPECT_TRUE(r.failed.empty());
+
+	// Closing one backend leaves the other
+	pool.close(first.target());
+	pool.update(0);
+	EXPECT_EQ(pool.connections(first.target()), 0U);
+	EXPECT_EQ(pool.connections(second.target()), 1U);
+}
@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////
+// Tests for the compact endpoint type and address comparison
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <set>
+#include <arpa/inet.h>
+
+#include <networking/address.h>
+#include <networking/endpoint.h>
+
+TEST(networking_endpoint, size)
+{
+	EXPECT_EQ(sizeof(networking::endpoint), 20U);
+}
+
+TEST(networking_endpoint, roundtrip)
+{
+	for(auto host : { "192.0.2.33", "2001:db8::1", "::ffff:10.0.0.1" })
+	{
+		auto a = networking::create_numeric_address(host, 5353);
+		networking::endpoint e { a };
+
+		EXPECT_TRUE(e.valid());
+		EXPECT_EQ(e.port_number(), 5353);
+		EXPECT_EQ(e.ip_version_value(), a.ip_version_value());
+		EXPECT_EQ(e.to_address(), a) << host;
+		EXPECT_EQ(e.to_address().host().value, host);
+	}
+}
+
+TEST(networking_endpoint, equality_hash_and_ordering)
+{
+	networking::endpoint a { networking::create_numeric_address("10.0.0.1", 80) };
+	networking::endpoint b { networking::create_numeric_address("10.0.0.1", 80) };
+	networking::endpoint c { networking::create_numeric_address("10.0.0.1", 81) };
+	networking::endpoint d { networking::create_numeric_address("::ffff:10.0.0.1", 80) };
+
+	EXPECT_EQ(a, b);
+	EXPECT_EQ(a.hash(), b.hash());
+	EXPECT_NE(a, c);
+	EXPECT_NE(a, d);	// Same bytes, but different families
+	EXPECT_NE(a, networking::endpoint {});
+
+	std::set<networking::endpoint> ordered { c, a, d, b };
+	EXPECT_EQ(ordered.size(), 3U);
+	EXPECT_EQ(*ordered.begin(), a);
+}
+
+TEST(networking_address, equality_and_hash)
+{
+	auto a = networking::create_numeric_address("2001:db8::7", 1000);
+	auto b = networking::create_address("2001:db8::7", 1000, networking::protocol::udp);
+	auto c = networking::create_numeric_address("2001:db8::8", 1000);
+
+	EXPECT_EQ(a, b);
+	EXPECT_EQ(std::hash<networking::address>{}(a), std::hash<networking::address>{}(b));
+	EXPECT_NE(a, c);
+	EXPECT_NE(a, networking::address::invalid());
+	EXPECT_EQ(networking::address::invalid(), networking::address::invalid());
+
+	// Link-local peers on different interfaces
+	sockaddr_in6 link_local {};
+	link_local.sin6_family = AF_INET6;
+	link_local.sin6_port = htons(1000);
+	inet_pton(AF_INET6, "fe80::1", &link_local.sin6_addr);
+	link_local.sin6_scope_id = 1;
+	const networking::address first { link_local };
+	link_local.sin6_scope_id = 2;
+	EXPECT_NE(first, networking::address { link_local });
+}
@@ -0,0 +1,194 @@
+///////////////////////////////////////////////////////////////////////
+// Tests for handing listeners and connections to a successor (hot restart)
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <networking/address.h>
+#include <networking/tcp/listener.h>
+#include <networking/tcp/connection.h>
+#include <networking/tcp/connection_manager.h>
+
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+namespace
+{
+	// Echoes with a prefix, keeping the state handed over with each connection
+	class echo : public networking::tcp::data_read_callback, public networking::tcp::handover_callback
+	{
+		public:
+			explicit echo(char tag) : _tag(tag) {}
+
+			void on_data(networking::tcp::connection& c, const uint8_t* data, std::size_t size) override
+			{
+				std::vector<uint8_t> reply { static_cast<uint8_t>(_tag) };
+				reply.insert(reply.end(), data, data + size);
+				c.send(reply.data(), reply.size());
+			}
+
+			void save_state(const networking::tcp::connection&, std::vector<uint8_t>& state) override
+			{
+				state.assign({ 's', 't', 'a', 't', 'e' });
+			}
+
+			void restore_state(networking::tcp::connection&, const uint8_t* data, std::size_t size) override
+			{
+				restored.emplace_back(reinterpret_cast<const char*>(data), size);
+			}
+
+			std::vector<std::string> restored;
+
+		private:
+			char _tag;
+	};
+
+	class keep_connections : public networking::tcp::incoming_connection_callback
+	{
+		public:
+			void on_new_connection(networking::tcp::connection&& c) override { connections.push_back(std::move(c)); }
+			std::vector<networking::tcp::connection> connections;
+	};
+
+	// A Unix domain connection pair for the hand-over
+	struct channel
+	{
+		keep_connections accepted;
+		networking::address local = networking::create_local_address("@utilitylib_handover_" + std::to_string(::getpid()));
+		networking::tcp::listener l { accepted, local };
+		std::unique_ptr<networking::tcp::connection> client;
+
+		channel()
+		{
+			l.start();
+			client = std::make_unique<networking::tcp::connection>(local);
+			l.accept();
+		}
+
+		networking::tcp::connection& sender() { return *client; }
+		networking::tcp::connection& receiver() { return accepted.connections.front(); }
+	};
+
+	std::string request(networking::tcp::connection_manager& manager, networking::tcp::connection& client, const std::string& text)
+	{
+		client.send(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+		for(int i = 0; i < 10; i++)
+			manager.update(10);
+
+		uint8_t buffer[64];
+		auto received = client.receive_available(buffer, sizeof(buffer));
+		return received > 0 ? std::string(reinterpret_cast<const char*>(buffer), static_cast<std::size_t>(received)) : std::string();
+	}
+}
+
+TEST(networking_hot_restart, passes_a_socket)
+{
+	channel ch;
+	ASSERT_EQ(ch.receiver().state(), networking::tcp::connection::status::open);
+
+	// Any socket, here one end of a pair
+	int pair[2];
+	ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM, 0, pair), 0);
+	networking::socket passed { pair[0] };
+	networking::socket other { pair[1] };
+
+	const uint8_t data[] = { 1, 2, 3 };
+	ASSERT_EQ(ch.sender().send_socket(passed, data, sizeof(data)), 3);
+	passed.close();
+
+	networking::socket received;
+	uint8_t buffer[8];
+	ASSERT_EQ(ch.receiver().receive_socket(received, buffer, sizeof(buffer)), 3);
+	ASSERT_TRUE(received.valid());
+
+	// The received descriptor refers to the same socket
+	ASSERT_EQ(::send(received.get(), "x", 1, 0), 1);
+	char c = 0;
+	EXPECT_EQ(::recv(other.get(), &c, 1, 0), 1);
+	EXPECT_EQ(c, 'x');
+
+	// Plain data carries no socket
+	ch.sender().send(data, sizeof(data));
+	EXPECT_EQ(ch.receiver().receive_socket(received, buffer, sizeof(buffer)), 3);
+	EXPECT_FALSE(received.valid());
+}
+
+TEST(networking_hot_restart, successor_keeps_serving)
+{
+	echo old_callback { 'o' };
+	networking::tcp::connection_manager old_manager { old_callback };
+	networking::tcp::listener l { old_manager, 0 };
+	ASSERT_TRUE(l.start());
+
+	const auto target = networking::create_numeric_address("127.0.0.1", l.bound_address().port_number(), networking::ip_version::ipv4);
+	old_manager.add_listener(std::move(l));
+
+	networking::tcp::connection client { target };
+	ASSERT_EQ(client.state(), networking::tcp::connection::status::open);
+	EXPECT_EQ(request(old_manager, client, "a"), "oa");
+
+	// Hand over, with a request arriving in between
+	channel ch;
+	ASSERT_TRUE(old_manager.hand_over(ch.sender(), &old_callback));
+	EXPECT_EQ(old_manager.connection_count(), 0U);
+	client.send(reinterpret_cast<const uint8_t*>("b"), 1);
+
+	echo new_callback { 'n' };
+	networking::tcp::connection_manager new_manager { new_callback };
+	networking::socket_error_information error { 0, "No error" };
+	ASSERT_TRUE(new_manager.take_over(ch.receiver(), &new_callback, &error)) << error.message;
+	EXPECT_EQ(new_manager.connection_count(), 1U);
+	ASSERT_EQ(new_callback.restored.size(), 1U);
+	EXPECT_EQ(new_callback.restored.front(), "state");
+
+	// The successor answers the queued request, and accepts on the same port
+	EXPECT_EQ(request(new_manager, client, "c"), "nbnc");
+
+	networking::tcp::connection second { target };
+	ASSERT_EQ(second.state(), networking::tcp::connection::status::open);
+	EXPECT_EQ(request(new_manager, second, "d"), "nd");
+	EXPECT_EQ(new_manager.connection_count(), 2U);
+}
+
+TEST(networking_hot_restart, keeps_unix_socket_files)
+{
+	const std::string path = "/tmp/utilitylib_handover_" + std::to_string(::getpid()) + ".sock";
+	const auto local = networking::create_local_address(path);
+
+	echo callback { 'n' };
+	networking::tcp::connection_manager new_manager { callback };
+	{
+		echo old_callback { 'o' };
+		networking::tcp::connection_manager old_manager { old_callback };
+		networking::tcp::listener l { old_manager, local };
+		ASSERT_TRUE(l.start());
+		old_manager.add_listener(std::move(l));
+
+		channel ch;
+		ASSERT_TRUE(old_manager.hand_over(ch.sender()));
+		ASSERT_TRUE(new_manager.take_over(ch.receiver()));
+	}
+
+	// The old manager is gone, but its socket file was not removed
+	ASSERT_EQ(::access(path.c_str(), F_OK), 0);
+	networking::tcp::connection client { local };
+	ASSERT_EQ(client.state(), networking::tcp::connection::status::open);
+	EXPECT_EQ(request(new_manager, client, "x"), "nx");
+}
+
+TEST(networking_hot_restart, rejects_other_data)
+{
+	echo callback { 'n' };
+	networking::tcp::connection_manager manager { callback };
+
+	channel ch;
+	const std::vector<uint8_t> garbage(200, 0xee);
+	ch.sender().send(garbage.data(), garbage.size());
+
+	networking::socket_error_information error { 0, "No error" };
+	EXPECT_FALSE(manager.take_over(ch.receiver(), nullptr, &error));
+	EXPECT_EQ(error.error_code, EPROTO);
+	EXPECT_EQ(manager.connection_count(), 0U);
+}
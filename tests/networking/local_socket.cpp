@@ -0,0 +1,173 @@
+///////////////////////////////////////////////////////////////////////
+// Tests for Unix domain sockets through the TCP and UDP classes
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <networking/address.h>
+#include <networking/tcp/listener.h>
+#include <networking/tcp/connection.h>
+#include <networking/tcp/connection_manager.h>
+#include <networking/udp/socket.h>
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <unistd.h>
+
+namespace
+{
+	std::string test_path(const std::string& name)
+	{
+		return "/tmp/utilitylib_" + name + "_" + std::to_string(::getpid()) + ".sock";
+	}
+
+	std::string abstract_name(const std::string& name)
+	{
+		return "@utilitylib_" + name + "_" + std::to_string(::getpid());
+	}
+
+	class keep_connections : public networking::tcp::incoming_connection_callback
+	{
+		public:
+			void on_new_connection(networking::tcp::connection&& c) override { connections.push_back(std::move(c)); }
+			std::vector<networking::tcp::connection> connections;
+	};
+
+	class echo : public networking::tcp::data_read_callback
+	{
+		public:
+			void on_data(networking::tcp::connection& c, const uint8_t* data, std::size_t size) override { c.send(data, size); }
+	};
+
+	// Checks that data round-trips through a listener and an outgoing connection
+	void round_trip(const networking::address& local, networking::protocol p)
+	{
+		keep_connections accepted;
+		networking::tcp::listener l { accepted, local, p };
+		ASSERT_EQ(l.state(), networking::tcp::listener::status::bound) << l.error().message;
+		ASSERT_TRUE(l.start());
+
+		networking::tcp::connection client { local, p };
+		ASSERT_EQ(client.state(), networking::tcp::connection::status::open) << client.error().message;
+		ASSERT_TRUE(l.accept());
+		ASSERT_EQ(accepted.connections.size(), 1U);
+
+		const uint8_t message[] = { 1, 2, 3, 4 };
+		ASSERT_EQ(client.send(message, sizeof(message)), static_cast<ssize_t>(sizeof(message)));
+
+		uint8_t received[16] = {};
+		ASSERT_EQ(accepted.connections.front().receive(received, sizeof(received)), static_cast<ssize_t>(sizeof(message)));
+		EXPECT_EQ(std::memcmp(received, message, sizeof(message)), 0);
+	}
+}
+
+TEST(networking_local_socket, addresses)
+{
+	const auto path = test_path("address");
+	auto a = networking::create_local_address(path);
+	ASSERT_TRUE(a.valid());
+	EXPECT_EQ(a.family(), AF_UNIX);
+	EXPECT_EQ(a.ip_version_value(), networking::ip_version::local);
+	EXPECT_EQ(a.host().value, path);
+	EXPECT_EQ(a.to_string().value, "unix:" + path);
+	EXPECT_EQ(a.port_number(), 0);
+
+	auto b = networking::create_local_address("@abstract");
+	ASSERT_TRUE(b.valid());
+	EXPECT_EQ(b.to_string().value, "unix:@abstract");
+	EXPECT_NE(a, b);
+	EXPECT_EQ(b, networking::create_local_address("@abstract"));
+	EXPECT_EQ(std::hash<networking::address> {}(b), std::hash<networking::address> {}(networking::create_local_address("@abstract")));
+
+	char buffer[16];
+	EXPECT_EQ(b.format(buffer, sizeof(buffer)), 14U);
+	EXPECT_STREQ(buffer, "unix:@abstract");
+	EXPECT_EQ(a.format(buffer, sizeof(buffer)), 0U);	// Too small
+
+	EXPECT_FALSE(networking::create_local_address("").valid());
+	EXPECT_FALSE(networking::create_local_address(std::string(200, 'x')).valid());
+}
+
+TEST(networking_local_socket, stream)
+{
+	const auto path = test_path("stream");
+	round_trip(networking::create_local_address(path), networking::protocol::tcp);
+
+	// The listener removes its socket file when stopped
+	EXPECT_NE(::access(path.c_str(), F_OK), 0);
+}
+
+TEST(networking_local_socket, abstract_stream)
+{
+	round_trip(networking::create_local_address(abstract_name("stream")), networking::protocol::tcp);
+}
+
+TEST(networking_local_socket, seqpacket_keeps_message_boundaries)
+{
+	const auto local = networking::create_local_address(abstract_name("seqpacket"));
+	keep_connections accepted;
+	networking::tcp::listener l { accepted, local, networking::protocol::seqpacket };
+	ASSERT_TRUE(l.start());
+
+	networking::tcp::connection client { local, networking::protocol::seqpacket };
+	ASSERT_EQ(client.state(), networking::tcp::connection::status::open);
+	ASSERT_TRUE(l.accept());
+
+	const uint8_t first[] = { 1, 2, 3 };
+	const uint8_t second[] = { 4, 5 };
+	client.send(first, sizeof(first));
+	client.send(second, sizeof(second));
+
+	uint8_t received[16];
+	EXPECT_EQ(accepted.connections.front().receive(received, sizeof(received)), 3);
+	EXPECT_EQ(accepted.connections.front().receive(received, sizeof(received)), 2);
+	EXPECT_EQ(received[0], 4);
+}
+
+TEST(networking_local_socket, connection_manager)
+{
+	echo server;
+	networking::tcp::connection_manager manager { server };
+
+	const auto local = networking::create_local_address(abstract_name("manager"));
+	networking::tcp::listener l { manager, local };
+	ASSERT_TRUE(l.start());
+	manager.add_listener(std::move(l));
+
+	networking::tcp::connection client { local };
+	ASSERT_EQ(client.state(), networking::tcp::connection::status::open);
+	while(manager.connection_count() == 0)
+		manager.update(50);
+
+	const uint8_t message[] = { 'p', 'i', 'n', 'g' };
+	client.send(message, sizeof(message));
+	manager.update(50);
+
+	uint8_t received[16] = {};
+	EXPECT_EQ(client.receive(received, sizeof(received)), 4);
+	EXPECT_EQ(std::memcmp(received, message, sizeof(message)), 0);
+}
+
+TEST(networking_local_socket, datagram)
+{
+	const auto server_address = networking::create_local_address(abstract_name("dgram_server"));
+	const auto client_address = networking::create_local_address(abstract_name("dgram_client"));
+
+	networking::udp::socket server { networking::ip_version::local };
+	networking::udp::socket client { networking::ip_version::local };
+	ASSERT_TRUE(server.bind(server_address));
+	ASSERT_TRUE(client.bind(client_address));
+
+	const uint8_t message[] = { 9, 8, 7 };
+	ASSERT_EQ(client.send_to(message, sizeof(message), server_address), 3);
+
+	uint8_t received[16];
+	networking::address sender;
+	ASSERT_EQ(server.receive_from(received, sizeof(received), sender), 3);
+	EXPECT_EQ(sender, client_address);
+
+	// Reply to the sender
+	ASSERT_EQ(server.send_to(received, 3, sender), 3);
+	ASSERT_EQ(client.receive_from(received, sizeof(received), sender), 3);
+	EXPECT_EQ(sender, server_address);
+}
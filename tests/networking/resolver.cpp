@@ -0,0 +1,163 @@
+///////////////////////////////////////////////////////////////////////
+// Tests for the asynchronous resolver (uses /etc/hosts entries)
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <networking/resolver.h>
+#include <networking/tcp/connection_manager.h>
+
+namespace
+{
+	class no_data : public networking::tcp::data_received_callback
+	{
+		public:
+			void on_receive(networking::tcp::connection&) override {}
+	};
+
+	class connect_result : public networking::tcp::connect_callback
+	{
+		public:
+			void on_connected(networking::tcp::connect_id id, networking::tcp::connection&) override { connected_id = id; calls++; }
+			void on_connect_failed(networking::tcp::connect_id id, const networking::socket_error_information& error) override
+			{
+				failed_id = id;
+				error_code = error.error_code;
+				calls++;
+			}
+
+			networking::tcp::connect_id connected_id = 0;
+			networking::tcp::connect_id failed_id = 0;
+			int error_code = 0;
+			int calls = 0;
+	};
+
+	// Port 9 (discard) is not expected to be open on loopback
+	constexpr networking::port_number_t closed_port = 9;
+}
+
+TEST(networking_resolver, resolve_localhost_future)
+{
+	networking::resolver r;
+	auto result = r.resolve("localhost", 8080, networking::protocol::tcp, networking::ip_version::ipv4).get();
+
+	ASSERT_EQ(result.code, 0);
+	ASSERT_FALSE(result.addresses.empty());
+	EXPECT_EQ(result.addresses.front().host().value, "127.0.0.1");
+	EXPECT_EQ(result.addresses.front().port_number(), 8080);
+}
+
+TEST(networking_resolver, positive_and_negative_cache)
+{
+	networking::resolver r;
+
+	r.resolve("localhost", 80, networking::protocol::tcp, networking::ip_version::ipv4).wait();
+	r.resolve("localhost", 80, networking::protocol::tcp, networking::ip_version::ipv4).wait();
+	EXPECT_EQ(r.lookups(), 1U);
+
+	// An IPv6 literal requested as IPv4 fails without any network traffic
+	auto failed = r.resolve("::1", 80, networking::protocol::tcp, networking::ip_version::ipv4).get();
+	EXPECT_NE(failed.code, 0);
+	r.resolve("::1", 80, networking::protocol::tcp, networking::ip_version::ipv4).wait();
+	EXPECT_EQ(r.lookups(), 2U);
+	EXPECT_EQ(r.cache_size(), 2U);
+
+	r.clear_cache();
+	r.resolve("localhost", 80, networking::protocol::tcp, networking::ip_version::ipv4).wait();
+	EXPECT_EQ(r.lookups(), 3U);
+}
+
+TEST(networking_resolver, ttl_expiry)
+{
+	networking::resolver_options options;
+	options.positive_ttl = std::chrono::milliseconds { 1 };
+	networking::resolver r { options };
+
+	r.resolve("localhost", 80, networking::protocol::tcp, networking::ip_version::ipv4).wait();
+	std::this_thread::sleep_for(std::chrono::milliseconds { 5 });
+	r.resolve("localhost", 80, networking::protocol::tcp, networking::ip_version::ipv4).wait();
+	EXPECT_EQ(r.lookups(), 2U);
+}
+
+TEST(networking_resolver, concurrent_lookups_are_shared)
+{
+	networking::resolver_options options;
+	options.workers = 1;
+	networking::resolver r { options };
+
+	std::vector<std::shared_future<networking::resolution>> futures;
+	for(int i = 0; i < 10; i++)
+		futures.push_back(r.resolve("localhost", 443, networking::protocol::tcp, networking::ip_version::ipv4));
+	for(auto& f : futures)
+		EXPECT_EQ(f.get().code, 0);
+
+	EXPECT_EQ(r.lookups(), 1U);
+}
+
+TEST(networking_resolver, callbacks_dispatched_by_connection_manager)
+{
+	networking::resolver r;
+	no_data callback;
+	networking::tcp::connection_manager manager { callback };
+	manager.attach(r);
+
+	int calls = 0;
+	for(int i = 0; i < 2; i++)
+		r.resolve("localhost", 80, networking::protocol::tcp, networking::ip_version::ipv4, [&](const networking::resolution& result) { EXPECT_EQ(result.code, 0); calls++; });
+
+	// The manager wakes up as soon as the lookup completes
+	for(int i = 0; i < 100 && calls < 2; i++)
+		manager.update(1000);
+
+	EXPECT_EQ(calls, 2);
+}
+
+TEST(networking_resolver, lookup_follows_moved_manager)
+{
+	networking::resolver r;
+	no_data callback;
+	connect_result result;
+	networking::tcp::connection_manager first { callback };
+	first.attach(r);
+	const auto id = first.connect("localhost", closed_port, result, networking::ip_version::ipv4);
+
+	// Refused (rather than timed out) shows the lookup reached the connect in the new manager
+	networking::tcp::connection_manager second { std::move(first) };
+	for(int i = 0; i < 100 && result.calls == 0; i++)
+		second.update(100);
+
+	EXPECT_EQ(result.failed_id, id);
+	EXPECT_EQ(result.error_code, ECONNREFUSED);
+}
+
+TEST(networking_resolver, manager_destroyed_with_lookup_in_flight)
+{
+	networking::resolver r;
+	connect_result result;
+	{
+		no_data callback;
+		networking::tcp::connection_manager manager { callback };
+		manager.attach(r);
+		manager.connect("localhost", closed_port, result, networking::ip_version::ipv4);
+	}
+
+	// The completion is still dispatched, but not passed on
+	r.resolve("localhost", closed_port, networking::protocol::tcp, networking::ip_version::ipv4).wait();
+	EXPECT_EQ(r.dispatch(), 1U);
+	EXPECT_EQ(result.calls, 0);
+}
+
+TEST(networking_resolver, detaching_abandons_lookups)
+{
+	networking::resolver r;
+	no_data callback;
+	connect_result result;
+	networking::tcp::connection_manager manager { callback };
+	manager.attach(r);
+	const auto id = manager.connect("localhost", closed_port, result, networking::ip_version::ipv4);
+
+	manager.detach_resolver();
+	manager.update(0);
+	EXPECT_EQ(result.failed_id, id);
+	EXPECT_EQ(result.error_code, ECANCELED);
+	EXPECT_EQ(manager.pending_connects(), 0U);
+}
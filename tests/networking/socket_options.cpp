@@ -0,0 +1,186 @@
+///////////////////////////////////////////////////////////////////////
+// Tests for socket tuning options
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <networking/socket.h>
+#include <networking/tcp/listener.h>
+#include <networking/tcp/connection.h>
+#include <networking/udp/socket.h>
+#include <networking/endpoint.h>
+
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+namespace
+{
+	int get_option(networking::socket_type s, int level, int name)
+	{
+		int value = 0;
+		socklen_t length = sizeof(value);
+		::getsockopt(s, level, name, &value, &length);
+		return value;
+	}
+
+	bool is_non_blocking(networking::socket_type s)
+	{
+		return (fcntl(s, F_GETFL, 0) & O_NONBLOCK) != 0;
+	}
+
+	class keep_connections : public networking::tcp::incoming_connection_callback
+	{
+		public:
+			void on_new_connection(networking::tcp::connection&& c) override { connections.push_back(std::move(c)); }
+			std::vector<networking::tcp::connection> connections;
+	};
+}
+
+TEST(networking_socket_options, applied_at_creation)
+{
+	networking::socket_options options;
+	options.no_delay = true;
+	options.send_buffer = 65536;
+	options.user_timeout = std::chrono::milliseconds { 2500 };
+	options.non_blocking = true;
+
+	networking::socket_error_information error { 0, "No error" };
+	networking::socket s { networking::protocol::tcp, networking::ip_version::ipv4, options, &error };
+	ASSERT_TRUE(s.valid());
+	EXPECT_EQ(error.error_code, 0);
+
+	EXPECT_NE(get_option(s.get(), IPPROTO_TCP, TCP_NODELAY), 0);
+	EXPECT_GE(get_option(s.get(), SOL_SOCKET, SO_SNDBUF), 65536);	// Linux doubles the value
+	EXPECT_EQ(get_option(s.get(), IPPROTO_TCP, TCP_USER_TIMEOUT), 2500);
+	EXPECT_TRUE(is_non_blocking(s.get()));
+
+	// Options can be changed later as well
+	networking::socket_options changed;
+	changed.no_delay = false;
+	changed.cork = true;
+	changed.non_blocking = false;
+	EXPECT_TRUE(s.set_options(changed));
+	EXPECT_EQ(get_option(s.get(), IPPROTO_TCP, TCP_NODELAY), 0);
+	EXPECT_NE(get_option(s.get(), IPPROTO_TCP, TCP_CORK), 0);
+	EXPECT_FALSE(is_non_blocking(s.get()));
+}
+
+TEST(networking_socket_options, failure_is_reported)
+{
+	networking::socket_options options;
+	options.defer_accept = 1;	// TCP option on a UDP socket
+
+	networking::socket_error_information error { 0, "No error" };
+	networking::socket s { networking::protocol::udp, networking::ip_version::ipv4, options, &error };
+	EXPECT_TRUE(s.valid());
+	EXPECT_NE(error.error_code, 0);
+}
+
+TEST(networking_socket_options, udp_socket_options)
+{
+	networking::udp::socket s { networking::ip_version::ipv4 };
+	ASSERT_TRUE(s.bind(networking::create_numeric_address("127.0.0.1", 0, networking::ip_version::ipv4)));
+
+	networking::socket_options options;
+	options.non_blocking = true;
+	options.receive_buffer = 65536;
+	EXPECT_TRUE(s.set_options(options));
+	EXPECT_TRUE(is_non_blocking(s.handle()));
+	EXPECT_GE(get_option(s.handle(), SOL_SOCKET, SO_RCVBUF), 65536);
+
+	// Nothing to receive: returns right away
+	uint8_t buffer[16];
+	networking::address sender;
+	EXPECT_LT(s.receive_from(buffer, sizeof(buffer), sender), 0);
+	EXPECT_TRUE(networking::would_block(networking::get_error_information()));
+
+	// The sender is left alone on failure
+	const auto previous = networking::endpoint { networking::create_numeric_address("127.0.0.1", 4242, networking::ip_version::ipv4) };
+	auto sender_endpoint = previous;
+	EXPECT_LT(s.receive_from(buffer, sizeof(buffer), sender_endpoint), 0);
+	EXPECT_EQ(sender_endpoint, previous);
+
+	// Failures are recorded
+	networking::socket_options tcp_only;
+	tcp_only.defer_accept = 1;
+	EXPECT_FALSE(s.set_options(tcp_only));
+	EXPECT_NE(s.error().error_code, 0);
+}
+
+TEST(networking_socket_options, inherited_by_accepted_connections)
+{
+	networking::socket_options options;
+	options.no_delay = true;
+	options.receive_buffer = 131072;
+	options.non_blocking = true;
+
+	keep_connections accepted;
+	networking::tcp::listener l { accepted, 0, false, options };
+	ASSERT_TRUE(l.start());
+	EXPECT_FALSE(is_non_blocking(l.socket().get()));	// accept() stays blocking
+
+	auto target = networking::create_numeric_address("127.0.0.1", l.bound_address().port_number(), networking::ip_version::ipv4);
+
+	networking::socket_options client_options;
+	client_options.no_delay = true;
+	networking::tcp::connection client { target, false, client_options };
+	ASSERT_EQ(client.state(), networking::tcp::connection::status::open);
+	EXPECT_NE(get_option(client.socket().get(), IPPROTO_TCP, TCP_NODELAY), 0);
+	EXPECT_FALSE(is_non_blocking(client.socket().get()));
+
+	ASSERT_TRUE(l.accept());
+	ASSERT_EQ(accepted.connections.size(), 1U);
+
+	auto fd = accepted.connections.front().socket().get();
+	EXPECT_NE(get_option(fd, IPPROTO_TCP, TCP_NODELAY), 0);
+	EXPECT_GE(get_option(fd, SOL_SOCKET, SO_RCVBUF), 131072);
+	EXPECT_TRUE(is_non_blocking(fd));
+}
+
+TEST(networking_socket_options, fast_open_connect_with_data)
+{
+	networking::socket_options options;
+	options.fast_open = 16;
+
+	keep_connections accepted;
+	networking::tcp::listener l { accepted, 0, false, options };
+	ASSERT_TRUE(l.start());
+	EXPECT_EQ(get_option(l.socket().get(), IPPROTO_TCP, TCP_FASTOPEN), 16);
+
+	auto target = networking::create_numeric_address("127.0.0.1", l.bound_address().port_number(), networking::ip_version::ipv4);
+
+	// The first connection fetches a cookie (when enabled), the second one may carry its data in the SYN
+	const uint8_t request[] = { 'h', 'e', 'l', 'l', 'o' };
+	for(int i = 0; i < 2; i++)
+	{
+		networking::tcp::connection client { target, request, sizeof(request) };
+		ASSERT_EQ(client.state(), networking::tcp::connection::status::open) << client.error().message;
+		ASSERT_TRUE(l.accept());
+
+		uint8_t received[sizeof(request)] = {};
+		std::size_t total = 0;
+		while(total < sizeof(received))
+		{
+			auto result = accepted.connections.back().receive(received + total, sizeof(received) - total);
+			ASSERT_GT(result, 0);
+			total += static_cast<std::size_t>(result);
+		}
+		EXPECT_EQ(std::memcmp(received, request, sizeof(request)), 0);
+
+		// Only checked where both client and server Fast Open are enabled system-wide
+		auto sysctl = std::fopen("/proc/sys/net/ipv4/tcp_fastopen", "r");
+		int mode = 0;
+		if(sysctl != nullptr)
+		{
+			if(std::fscanf(sysctl, "%d", &mode) != 1)
+				mode = 0;
+			std::fclose(sysctl);
+		}
+		if(i == 1 && (mode & 3) == 3)
+		{
+			EXPECT_TRUE(client.fast_open_accepted());
+		}
+	}
+}
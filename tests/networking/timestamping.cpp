@@ -0,0 +1,167 @@
+///////////////////////////////////////////////////////////////////////
+// Tests for kernel packet timestamps (software timestamps on loopback)
+///////////////////////////////////////////////////////////////////////
+#include <gtest/gtest.h>
+
+#include <networking/address.h>
+#include <networking/timestamping.h>
+#include <networking/tcp/listener.h>
+#include <networking/tcp/connection.h>
+#include <networking/udp/socket.h>
+#include <metrics/probes.h>
+
+#include <thread>
+#include <vector>
+#include <functional>
+
+namespace
+{
+	class keep_connections : public networking::tcp::incoming_connection_callback
+	{
+		public:
+			void on_new_connection(networking::tcp::connection&& c) override { connections.push_back(std::move(c)); }
+			std::vector<networking::tcp::connection> connections;
+	};
+
+	// Transmit timestamps are queued asynchronously, so poll for a while
+	bool wait_for_transmit_timestamp(const std::function<bool(networking::transmit_timestamp&)>& read, networking::transmit_timestamp& result)
+	{
+		for(int i = 0; i < 100; i++)
+		{
+			if(read(result))
+				return true;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return false;
+	}
+
+	networking::address loopback(uint16_t port)
+	{
+		return networking::create_numeric_address("127.0.0.1", port, networking::ip_version::ipv4);
+	}
+}
+
+TEST(timestamping, udp_receive_and_transmit)
+{
+	networking::udp::socket receiver { networking::ip_version::ipv4 };
+	ASSERT_TRUE(receiver.bind(loopback(0)));
+	ASSERT_TRUE(receiver.enable_timestamping()) << receiver.error().message;
+
+	networking::udp::socket sender { networking::ip_version::ipv4 };
+	networking::timestamp_options options;
+	options.receive = false;
+	options.transmit = true;
+	ASSERT_TRUE(sender.enable_timestamping(options)) << sender.error().message;
+
+	// Until the kernel has turned receive timestamping on (see the note in timestamping.h)
+	const uint8_t message[] = { 1, 2, 3 };
+	uint8_t received[16];
+	networking::address source;
+	networking::packet_timestamps timestamps;
+	networking::udp::socket warm_up { networking::ip_version::ipv4 };
+	for(int i = 0; i < 100 && !timestamps.valid(); i++)
+	{
+		ASSERT_EQ(warm_up.send_to(message, sizeof(message), loopback(receiver.bound_to().port_number())), 3);
+		ASSERT_EQ(receiver.receive_from(received, sizeof(received), source, timestamps), 3);
+		if(!timestamps.valid())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	metrics::registry r;
+	metrics::enable_probes(r);
+
+	const auto before = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch());
+	for(int i = 0; i < 2; i++)
+		ASSERT_EQ(sender.send_to(message, sizeof(message), loopback(receiver.bound_to().port_number())), 3);
+
+	ASSERT_EQ(receiver.receive_from(received, sizeof(received), source, timestamps), 3);
+	metrics::disable_probes();
+
+	// The kernel stamped the datagram between the send and the read
+	ASSERT_TRUE(timestamps.valid());
+	EXPECT_GE(timestamps.software, before);
+	EXPECT_GE(timestamps.age().count(), 0);
+	EXPECT_LT(timestamps.age(), std::chrono::seconds(10));
+	EXPECT_TRUE(source.valid());
+	EXPECT_EQ(r.make_histogram("net.packet.receive_delay_ns").snapshot().count, 1U);
+
+	// One transmit timestamp per datagram, numbered from zero
+	networking::transmit_timestamp sent;
+	ASSERT_TRUE(wait_for_transmit_timestamp([&sender](networking::transmit_timestamp& t) { return sender.read_transmit_timestamp(t); }, sent));
+	EXPECT_EQ(sent.id, 0U);
+	EXPECT_EQ(sent.stage, networking::transmit_stage::sent);
+	EXPECT_GE(sent.time.software, before);
+	EXPECT_LE(sent.time.software, timestamps.software);
+
+	ASSERT_TRUE(wait_for_transmit_timestamp([&sender](networking::transmit_timestamp& t) { return sender.read_transmit_timestamp(t); }, sent));
+	EXPECT_EQ(sent.id, 1U);
+	EXPECT_FALSE(sender.read_transmit_timestamp(sent));
+}
+
+TEST(timestamping, tcp_receive_and_acknowledged)
+{
+	keep_connections accepted;
+	networking::tcp::listener l { accepted, 0 };
+	ASSERT_TRUE(l.start());
+
+	networking::tcp::connection client { loopback(l.bound_address().port_number()) };
+	ASSERT_EQ(client.state(), networking::tcp::connection::status::open);
+	ASSERT_TRUE(l.accept());
+	auto& server = accepted.connections.front();
+	ASSERT_TRUE(server.enable_timestamping());
+
+	const uint8_t message[100] = {};
+	uint8_t received[200];
+	networking::packet_timestamps timestamps;
+	for(int i = 0; i < 100 && !timestamps.valid(); i++)
+	{
+		ASSERT_EQ(client.send(message, sizeof(message)), 100);
+		ASSERT_EQ(server.receive(received, sizeof(received), timestamps), 100);
+		if(!timestamps.valid())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	ASSERT_TRUE(timestamps.valid());
+
+	// Transmit ids count from the bytes sent when timestamping is enabled
+	networking::timestamp_options options;
+	options.transmit = true;
+	options.acknowledged = true;
+	ASSERT_TRUE(client.enable_timestamping(options)) << client.error().message;
+
+	ASSERT_EQ(client.send(message, sizeof(message)), 100);
+	ASSERT_EQ(server.receive(received, sizeof(received), timestamps), 100);
+	ASSERT_TRUE(timestamps.valid());
+	EXPECT_LT(timestamps.age(), std::chrono::seconds(10));
+
+	// Sent and acknowledged, both identified by the offset of the last byte
+	bool sent = false;
+	bool acknowledged = false;
+	networking::transmit_timestamp stamp;
+	while((!sent || !acknowledged) && wait_for_transmit_timestamp([&client](networking::transmit_timestamp& t) { return client.read_transmit_timestamp(t); }, stamp))
+	{
+		EXPECT_EQ(stamp.id, 99U);
+		sent |= stamp.stage == networking::transmit_stage::sent;
+		acknowledged |= stamp.stage == networking::transmit_stage::acknowledged;
+	}
+	EXPECT_TRUE(sent);
+	EXPECT_TRUE(acknowledged);
+}
+
+TEST(timestamping, not_enabled)
+{
+	networking::udp::socket receiver { networking::ip_version::ipv4 };
+	ASSERT_TRUE(receiver.bind(loopback(0)));
+	networking::udp::socket sender { networking::ip_version::ipv4 };
+
+	const uint8_t message[] = { 1 };
+	ASSERT_EQ(sender.send_to(message, sizeof(message), loopback(receiver.bound_to().port_number())), 1);
+
+	uint8_t received[4];
+	networking::address source;
+	networking::packet_timestamps timestamps;
+	ASSERT_EQ(receiver.receive_from(received, sizeof(received), source, timestamps), 1);
+	EXPECT_FALSE(timestamps.valid());
+
+	networking::transmit_timestamp stamp;
+	EXPECT_FALSE(sender.read_transmit_timestamp(stamp));
+}